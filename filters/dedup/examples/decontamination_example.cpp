@@ -5,6 +5,7 @@
 #include <fstream>
 #include <filesystem>
 
+using namespace rapidsift;
 using namespace rapidsift::dedup;
 
 int main() {
@@ -14,53 +15,53 @@ int main() {
     // Create sample training documents
     std::vector<Document> training_documents = {
         // Clean training data
-        Document("train1", 
+        Document(
                 "Machine learning is a subset of artificial intelligence that focuses on algorithms "
                 "that can learn and improve from experience without being explicitly programmed.",
-                "https://ml-tutorial.com/basics"),
+                1),
                 
         // Document with potential benchmark contamination (TriviaQA style)
-        Document("train2",
+        Document(
                 "Question: What is the capital of France? Answer: The capital of France is Paris. "
                 "Paris has been the capital since 987 AD and is located in northern France.",
-                "https://geography-facts.net/europe"),
+                2),
                 
         // Document with GLUE benchmark contamination
-        Document("train3",
+        Document(
                 "The movie was terrible. I would not recommend it to anyone. The acting was poor "
                 "and the plot made no sense whatsoever. Definitely a waste of time.",
-                "https://movie-reviews.com/bad-movie"),
+                3),
                 
         // Document with SQuAD-style contamination
-        Document("train4",
+        Document(
                 "Natural language processing (NLP) is a subfield of linguistics, computer science, "
                 "and artificial intelligence concerned with the interactions between computers and human language. "
                 "What is NLP concerned with? The interactions between computers and human language.",
-                "https://nlp-guide.org/introduction"),
+                4),
                 
         // Clean scientific content
-        Document("train5",
+        Document(
                 "Photosynthesis is the process by which plants convert light energy into chemical energy. "
                 "This process occurs in chloroplasts and requires carbon dioxide, water, and sunlight.",
-                "https://biology-textbook.edu/photosynthesis"),
+                5),
                 
         // Potential math competition contamination
-        Document("train6",
+        Document(
                 "If a triangle has sides of length 3, 4, and 5, what type of triangle is it? "
                 "Since 3² + 4² = 9 + 16 = 25 = 5², this is a right triangle by the Pythagorean theorem.",
-                "https://math-problems.net/geometry"),
+                6),
                 
         // Programming content (could be from coding benchmarks)
-        Document("train7",
+        Document(
                 "def fibonacci(n): if n <= 1: return n; return fibonacci(n-1) + fibonacci(n-2) "
                 "This is a recursive implementation of the Fibonacci sequence algorithm.",
-                "https://coding-examples.com/algorithms"),
+                7),
                 
         // Clean general knowledge
-        Document("train8",
+        Document(
                 "The Renaissance was a period of European cultural, artistic, political and economic rebirth "
                 "following the Middle Ages, generally spanning from the 14th to the 17th century.",
-                "https://history-encyclopedia.org/renaissance")
+                8)
     };
     
     // Create sample benchmark datasets (these would normally be loaded from files)
@@ -115,7 +116,7 @@ int main() {
     size_t default_kept = 0;
     for (const auto& doc : training_documents) {
         auto decision = default_filter.evaluate(doc);
-        std::cout << "Doc " << doc.id << ": ";
+        std::cout << "Doc " << doc.id() << ": ";
         
         if (decision.result == FilterResult::KEEP) {
             std::cout << "KEEP - " << decision.details << "\n";
@@ -145,7 +146,7 @@ int main() {
     size_t strict_kept = 0;
     for (const auto& doc : training_documents) {
         auto decision = strict_filter.evaluate(doc);
-        std::cout << "Doc " << doc.id << ": ";
+        std::cout << "Doc " << doc.id() << ": ";
         
         if (decision.result == FilterResult::KEEP) {
             std::cout << "KEEP - " << decision.details << "\n";
@@ -175,7 +176,7 @@ int main() {
     size_t fast_kept = 0;
     for (const auto& doc : training_documents) {
         auto decision = fast_filter.evaluate(doc);
-        std::cout << "Doc " << doc.id << ": ";
+        std::cout << "Doc " << doc.id() << ": ";
         
         if (decision.result == FilterResult::KEEP) {
             std::cout << "KEEP - " << decision.details << "\n";
@@ -195,8 +196,8 @@ int main() {
     for (size_t i = 0; i < std::min(size_t(4), training_documents.size()); ++i) {
         const auto& doc = training_documents[i];
         
-        std::cout << "\nAnalyzing Document: " << doc.id << "\n";
-        std::cout << "Text: " << doc.text.substr(0, 100) << "...\n";
+        std::cout << "\nAnalyzing Document: " << doc.id() << "\n";
+        std::cout << "Text: " << doc.text().substr(0, 100) << "...\n";
         
         auto assessment = default_filter.assess_document(doc);
         
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+namespace rapidsift {
+namespace dedup {
+
+// MinHash + LSH index of benchmark items for approximate (lightly edited)
+// contamination. Items are shingled into token k-grams and signed; items longer
+// than the maximum window are indexed as overlapping chunks. Documents are
+// scanned with sliding-window MinHash at each indexed window length, and every
+// window is looked up band by band, so a query costs O(bands) table probes per
+// window independent of how many benchmark items are indexed. Candidates are
+// verified against their full signature before being reported. The scan goes
+// a bounded chunk of shingles at a time, so its working memory does not grow
+// with the document.
+class ApproximateIndex {
+public:
+    struct Match {
+        size_t start = 0;          // First document token of the matched region
+        size_t length = 0;         // Region length in tokens
+        uint32_t dataset_id = 0;
+        double similarity = 0.0;   // Estimated Jaccard similarity of the best window
+    };
+
+    ApproximateIndex(double threshold = 0.9, size_t shingle_size = 3, size_t max_window_shingles = 64,
+                     size_t num_bands = 16, size_t band_rows = 4);
+
+    void add_item(const std::vector<std::string>& tokens, uint32_t dataset_id);
+    void clear();
+
+    // Document regions whose windows reach the threshold; overlapping windows
+    // are merged into one region
+    std::vector<Match> find_matches(const std::vector<std::string>& tokens, size_t max_matches = SIZE_MAX) const;
+
+    size_t size() const { return entry_datasets_.size(); }
+    bool empty() const { return entry_datasets_.empty(); }
+    size_t num_window_sizes() const { return window_sizes_.size(); }
+    double threshold() const { return threshold_; }
+    // Estimate of the heap memory held by signatures and band tables
+    size_t memory_bytes() const;
+
+private:
+    // Window start positions per scanning chunk
+    static constexpr size_t SCAN_CHUNK_SHINGLES = 1024;
+
+    double threshold_;
+    size_t shingle_size_;
+    size_t max_window_;
+    size_t num_bands_;
+    size_t band_rows_;
+    size_t chunk_stride_;
+
+    std::vector<uint64_t> permutation_a_;
+    std::vector<uint64_t> permutation_b_;
+
+    // Entry signatures are stored contiguously, num_hashes() values per entry
+    std::vector<uint64_t> signatures_;
+    std::vector<uint32_t> entry_datasets_;
+    std::vector<size_t> window_sizes_;  // Sorted distinct entry lengths in shingles
+
+    // One table per band; keys also fold in the window length so only
+    // same-length windows and entries are compared
+    std::vector<std::unordered_map<uint64_t, std::vector<uint32_t>>> band_tables_;
+
+    size_t num_hashes() const { return num_bands_ * band_rows_; }
+    std::vector<uint64_t> shingle_hashes(const std::vector<std::string>& tokens) const;
+    void sign(const uint64_t* shingles, size_t count, uint64_t* signature) const;
+    uint64_t band_key(const uint64_t* signature, size_t band, size_t window) const;
+    void add_entry(const uint64_t* shingles, size_t count, uint32_t dataset_id);
+};
+
+} // namespace dedup
+} // namespace rapidsift
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <istream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+namespace rapidsift {
+namespace dedup {
+
+// Benchmark file layouts. JSON layouts name the fields holding benchmark text;
+// everything else in the file (keys, ids, metadata) is skipped
+enum class BenchmarkFormat {
+    PLAIN_TEXT,   // One item per line
+    SQUAD,        // context, question, answers.text
+    TRIVIA_QA,    // Question, Answer.Value (official dumps and lower-case JSONL exports)
+    GLUE,         // sentence/sentence1/sentence2, question/question1/question2, premise, hypothesis
+    JSON          // Common question/answer/passage field names
+};
+
+// Streaming, field-selective JSON reader. Parses the input a buffer at a time
+// and hands over only string values whose key path ends in one of the selected
+// fields, so memory is bounded by the read buffer, the nesting depth and the
+// longest selected string; no document tree is ever built. A file may hold one
+// JSON value or a sequence of them (JSONL). Fields are key names, optionally
+// with parent keys ("answers.text"); arrays are transparent, so each element of
+// a selected array is reported. Malformed input throws std::runtime_error.
+class JsonFieldReader {
+public:
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+    static constexpr size_t MAX_DEPTH = 512;
+
+    JsonFieldReader(std::istream& input, const std::vector<std::string>& fields);
+
+    // Calls visit for each selected string value in document order; returns
+    // the number of values visited
+    size_t read(const std::function<void(const std::string&)>& visit);
+
+    uint64_t bytes_read() const { return consumed_ + position_; }
+
+private:
+    std::istream& input_;
+    std::vector<std::vector<std::string>> fields_;  // Each field as its key path
+    std::vector<std::string> key_path_;             // Keys of the enclosing objects
+
+    std::vector<char> buffer_;
+    size_t position_ = 0;
+    size_t length_ = 0;
+    uint64_t consumed_ = 0;
+
+    std::string value_;
+    size_t visited_ = 0;
+
+    bool fill();
+    int peek();
+    int get();
+    void expect(char c);
+    void skip_whitespace();
+
+    void parse_value(size_t depth, const std::function<void(const std::string&)>& visit);
+    void parse_object(size_t depth, const std::function<void(const std::string&)>& visit);
+    void parse_array(size_t depth, const std::function<void(const std::string&)>& visit);
+    void parse_string(std::string* out);
+    void skip_scalar();
+    void append_utf8(std::string& out, uint32_t code_point);
+    uint32_t parse_hex4();
+    bool key_path_selected() const;
+
+    [[noreturn]] void fail(const std::string& message) const;
+};
+
+} // namespace dedup
+} // namespace rapidsift
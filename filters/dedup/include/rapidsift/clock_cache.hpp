@@ -0,0 +1,124 @@
+#pragma once
+
+#include "common.hpp"
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+
+namespace rapidsift {
+
+// Keys are already uniformly distributed hashes
+struct Hash128Hasher {
+    size_t operator()(const Hash128& key) const { return static_cast<size_t>(key.low); }
+};
+
+/**
+ * @brief Bounded cache keyed by 128-bit content hashes, evicting with CLOCK
+ * (second-chance) replacement. Keys are spread over independently locked
+ * shards so concurrent readers rarely contend; memory is fixed by capacity.
+ */
+template<typename Value>
+class ShardedClockCache {
+public:
+    explicit ShardedClockCache(size_t capacity, size_t num_shards = 16) {
+        num_shards = std::max<size_t>(1, std::min(num_shards, std::max<size_t>(capacity, 1)));
+        size_t per_shard = (capacity + num_shards - 1) / num_shards;
+
+        shards_.reserve(num_shards);
+        for (size_t i = 0; i < num_shards; ++i) {
+            shards_.push_back(std::make_unique<Shard>());
+            shards_.back()->capacity = std::max<size_t>(per_shard, 1);
+        }
+    }
+
+    // Copies the cached value out; the entry gets a second chance on eviction
+    bool get(const Hash128& key, Value& value) {
+        Shard& shard = shard_for(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto it = shard.slots.find(key);
+        if (it == shard.slots.end()) return false;
+
+        Entry& entry = shard.entries[it->second];
+        entry.referenced = true;
+        value = entry.value;
+        return true;
+    }
+
+    void put(const Hash128& key, const Value& value) {
+        Shard& shard = shard_for(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto it = shard.slots.find(key);
+        if (it != shard.slots.end()) {
+            Entry& entry = shard.entries[it->second];
+            entry.value = value;
+            entry.referenced = true;
+            return;
+        }
+
+        if (shard.entries.size() < shard.capacity) {
+            shard.slots.emplace(key, shard.entries.size());
+            shard.entries.push_back(Entry{key, value, false});
+            return;
+        }
+
+        // Sweep the hand past recently used entries, clearing their bit
+        while (shard.entries[shard.hand].referenced) {
+            shard.entries[shard.hand].referenced = false;
+            shard.hand = (shard.hand + 1) % shard.capacity;
+        }
+
+        Entry& victim = shard.entries[shard.hand];
+        shard.slots.erase(victim.key);
+        victim = Entry{key, value, false};
+        shard.slots.emplace(key, shard.hand);
+        shard.hand = (shard.hand + 1) % shard.capacity;
+    }
+
+    void clear() {
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->entries.clear();
+            shard->slots.clear();
+            shard->hand = 0;
+        }
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            total += shard->entries.size();
+        }
+        return total;
+    }
+
+    size_t capacity() const { return shards_.size() * shards_.front()->capacity; }
+    size_t num_shards() const { return shards_.size(); }
+
+private:
+    struct Entry {
+        Hash128 key;
+        Value value;
+        bool referenced = false;
+    };
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::vector<Entry> entries;
+        std::unordered_map<Hash128, size_t, Hash128Hasher> slots;
+        size_t hand = 0;
+        size_t capacity = 1;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    // The low half already feeds the per-shard map, so shard on the high half
+    Shard& shard_for(const Hash128& key) {
+        return *shards_[static_cast<size_t>(key.high % shards_.size())];
+    }
+};
+
+} // namespace rapidsift
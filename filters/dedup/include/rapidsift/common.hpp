@@ -29,6 +29,17 @@ using Hash = uint64_t;
 using Weight = double;
 using SimilarityScore = double;
 
+/**
+ * @brief 128-bit hash value (two independent 64-bit halves)
+ */
+struct Hash128 {
+    uint64_t low = 0;
+    uint64_t high = 0;
+    
+    bool operator==(const Hash128& other) const { return low == other.low && high == other.high; }
+    bool operator!=(const Hash128& other) const { return !(*this == other); }
+};
+
 // Forward declarations
 class Document;
 class DeduplicationResult;
@@ -234,6 +245,10 @@ namespace hash_utils {
     Hash sha256_hash(const std::string& text);
     Hash xxhash64(const std::string& text);
     
+    // MurmurHash3 x64/128: one pass yields two independent 64-bit hashes
+    Hash128 hash128(const char* data, size_t length, uint64_t seed = 0);
+    Hash128 hash128(const std::string& text, uint64_t seed = 0);
+    
 } // namespace hash_utils
 
 /**
@@ -248,6 +263,28 @@ namespace io_utils {
     void save_documents_to_file(const std::vector<Document>& documents, const std::string& filename);
     void save_results_to_csv(const DeduplicationResult& result, const std::string& filename);
     
+    /**
+     * @brief Read-only view of a whole file, memory-mapped where the platform
+     * supports it and read into a 64-byte aligned buffer otherwise
+     */
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string& filename);
+        ~MappedFile();
+        
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        
+        const char* data() const { return data_; }
+        size_t size() const { return size_; }
+        bool is_mapped() const { return mapped_; }
+        
+    private:
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+        bool mapped_ = false;
+    };
+    
 } // namespace io_utils
 
 /**
@@ -1,12 +1,21 @@
 #pragma once
 
 #include "common.hpp"
+#include "decontamination_index.hpp"
+#include "overlap_automaton.hpp"
+#include "approximate_index.hpp"
+#include "clock_cache.hpp"
+#include "benchmark_reader.hpp"
+#include "partitioned_index.hpp"
 #include <string>
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
 #include <memory>
+#include <mutex>
 #include <fstream>
+#include <functional>
+#include <chrono>
 
 namespace rapidsift {
 namespace dedup {
@@ -16,14 +25,31 @@ constexpr size_t DEFAULT_NGRAM_SIZE = 13;
 constexpr size_t MIN_NGRAM_SIZE = 8;
 constexpr size_t MAX_NGRAM_SIZE = 50;
 
+// Filter verdict, mirroring the quality/content filter interface
+enum class FilterResult {
+    KEEP,
+    REJECT,
+    UNKNOWN
+};
+
+struct FilterDecision {
+    FilterResult result = FilterResult::UNKNOWN;
+    std::string filter_name;
+    double confidence = 0.0;
+    std::string details;
+};
+
 // Match result for decontamination
 struct ContaminationMatch {
     std::string ngram;
-    std::string source_dataset;
+    std::string source_dataset;                // First dataset containing the match
+    std::vector<std::string> other_datasets;   // Further datasets containing the same n-gram
     size_t position_in_document = 0;
     size_t position_in_benchmark = 0;
     double match_confidence = 1.0;
     std::string benchmark_context;
+    size_t overlap_length = 0;  // Span length in tokens (overlap engine and approximate matches)
+    bool approximate = false;   // MinHash match; match_confidence holds the estimated Jaccard
     
     ContaminationMatch() = default;
     ContaminationMatch(const std::string& ng, const std::string& dataset, 
@@ -39,7 +65,12 @@ struct DecontaminationAssessment {
     double contamination_score = 0.0;
     size_t total_ngrams_checked = 0;
     size_t contaminated_ngrams = 0;
+    size_t longest_overlap = 0;  // Longest benchmark overlap in tokens (overlap engine only)
+    size_t ngrams_probed = 0;    // Looked up in the index; below total_ngrams_checked when the verdict
+                                 // was decided early (in-memory index only) or common phrases were skipped
+    size_t approximate_matches = 0;
     std::string most_likely_source;
+    std::vector<std::string> contaminated_datasets;  // Every dataset with a match, by first match
     
     double get_contamination_ratio() const {
         return total_ngrams_checked > 0 ? 
@@ -47,17 +78,34 @@ struct DecontaminationAssessment {
     }
 };
 
+// Matching engine. NGRAM_INDEX looks up fixed-size n-grams; OVERLAP_AUTOMATON
+// scans documents through a suffix automaton of the full benchmark texts and
+// reports maximal overlapping spans of any length, including benchmark items
+// shorter than ngram_size. Choose the engine before loading benchmarks.
+enum class DecontaminationEngine {
+    NGRAM_INDEX,
+    OVERLAP_AUTOMATON
+};
+
 // Configuration for decontamination
 struct DecontaminationConfig {
+    // Matching engine
+    DecontaminationEngine engine = DecontaminationEngine::NGRAM_INDEX;
+    
     // N-gram settings
     size_t ngram_size = DEFAULT_NGRAM_SIZE;
     size_t min_ngram_size = MIN_NGRAM_SIZE;
     bool use_adaptive_ngram_size = false;
     
-    // Matching thresholds
+    // Matching thresholds. A document is rejected when it has at least
+    // min_matches_to_reject matches and the matched fraction reaches
+    // contamination_threshold; scanning stops as soon as either outcome is
+    // certain unless full_report is set
     double contamination_threshold = 0.1;  // Fraction of contaminated n-grams to reject
     size_t min_matches_to_reject = 1;      // Minimum number of matches to reject
     size_t max_matches_per_document = 100; // Stop checking after this many matches
+    bool full_report = false;              // Audit mode: probe every n-gram and collect all matches
+    size_t min_overlap_tokens = 8;         // Overlap engine: reject on an overlap at least this long
     
     // Preprocessing options
     bool normalize_whitespace = true;
@@ -67,14 +115,21 @@ struct DecontaminationConfig {
     
     // Performance settings
     bool use_bloom_filter = true;
+    double bloom_filter_false_positive_rate = 0.01;  // Sized from the loaded n-gram count
     bool enable_parallel_processing = true;
     size_t batch_size = 1000;
-    size_t max_memory_mb = 2048;
+    size_t max_memory_mb = 2048;             // Enforced for everything benchmarks load into; larger sets need a partitioned index
+    size_t assessment_cache_entries = 65536;  // Content-hash keyed, CLOCK-evicted; 0 disables
+    size_t assessment_cache_shards = 16;
     
     // Benchmark dataset paths
     std::vector<std::string> benchmark_files;
     std::vector<std::string> benchmark_directories;
     std::unordered_map<std::string, std::string> dataset_name_map;  // file -> dataset name
+    std::unordered_map<std::string, BenchmarkFormat> benchmark_format_map;  // file -> layout, instead of detecting it
+    std::string index_file;  // Prebuilt index (see save_index); used instead of re-reading benchmarks
+    std::string partitioned_index_dir;  // Disk-partitioned index (see build_partitioned_index), e.g. a prior corpus
+    size_t index_partitions = 256;      // Hash-range partitions when building one
     
     // Output settings
     bool save_matches = true;
@@ -85,6 +140,13 @@ struct DecontaminationConfig {
     // Advanced options
     bool check_approximate_matches = false;
     double approximate_match_threshold = 0.9;  // Jaccard similarity threshold
+    size_t approximate_shingle_size = 3;       // Tokens per shingle
+    size_t approximate_max_window = 64;        // Shingles; longer benchmark items are chunked. Scanning
+                                               // costs bands table probes per token per distinct item
+                                               // length, and about (1 + log2(window)) x bands x rows
+                                               // x 8 KB of working memory per thread
+    size_t approximate_num_bands = 16;         // LSH bands x rows = MinHash signature length
+    size_t approximate_band_rows = 4;
     bool exclude_common_phrases = true;
     size_t min_phrase_frequency_to_exclude = 100;
     
@@ -97,53 +159,94 @@ struct DecontaminationStats {
     size_t contaminated_documents = 0;
     size_t clean_documents = 0;
     size_t total_ngrams_checked = 0;
+    size_t total_ngrams_probed = 0;
     size_t contaminated_ngrams_found = 0;
+    size_t approximate_matches_found = 0;
     
-    std::unordered_map<std::string, size_t> contamination_by_dataset;
+    std::unordered_map<std::string, size_t> contamination_by_dataset;  // A document counts toward every matching dataset
     std::unordered_map<size_t, size_t> matches_per_document_histogram;
     
     // Performance metrics
     double average_processing_time_ms = 0.0;
+    double total_processing_time_ms = 0.0;
     size_t peak_memory_usage_mb = 0;
     size_t bloom_filter_false_positives = 0;
+    size_t cache_hits = 0;
+    size_t cache_misses = 0;
     
     double get_contamination_rate() const {
         return total_documents_processed > 0 ? 
                static_cast<double>(contaminated_documents) / total_documents_processed : 0.0;
     }
     
+    double get_cache_hit_rate() const {
+        size_t lookups = cache_hits + cache_misses;
+        return lookups > 0 ? static_cast<double>(cache_hits) / lookups : 0.0;
+    }
+    
     double get_ngram_contamination_rate() const {
         return total_ngrams_checked > 0 ? 
                static_cast<double>(contaminated_ngrams_found) / total_ngrams_checked : 0.0;
     }
 };
 
-// Bloom filter for efficient n-gram lookup
+// Cache-line-blocked Bloom filter for efficient n-gram lookup. Each key maps to a
+// single 512-bit block, so a probe costs one cache miss. The low half of the
+// 128-bit hash picks the block; the k bit positions inside it are the top bits
+// of the high half, re-mixed by a multiplication for each probe.
 class NGramBloomFilter {
 public:
+    static constexpr size_t BLOCK_BITS = 512;
+    static constexpr size_t MAX_HASH_FUNCTIONS = 16;
+    
     NGramBloomFilter(size_t expected_elements, double false_positive_rate = 0.01);
+    // Read-only view over serialized, 64-byte aligned blocks that outlive the filter
+    NGramBloomFilter(const void* blocks, size_t num_blocks, size_t num_hash_functions, 
+                     size_t expected_elements);
     ~NGramBloomFilter() = default;
     
     void add(const std::string& ngram);
     bool might_contain(const std::string& ngram) const;
     void clear();
     
-    size_t get_size() const { return bit_array_.size(); }
+    // Hash-level interface so callers can hash an n-gram once and reuse it
+    void add_hash(const Hash128& hash);
+    bool might_contain_hash(const Hash128& hash) const;
+    
+    size_t get_size() const { return num_blocks_ * BLOCK_BITS; }
+    size_t get_num_blocks() const { return num_blocks_; }
     size_t get_hash_functions() const { return num_hash_functions_; }
+    size_t get_expected_elements() const { return expected_elements_; }
     double get_expected_false_positive_rate() const;
     
-private:
-    std::vector<bool> bit_array_;
-    size_t num_hash_functions_;
-    size_t hash_function_seeds_[8];  // Support up to 8 hash functions
+    // Raw block storage for serialization
+    const void* data() const { return blocks_; }
+    size_t data_size_bytes() const { return num_blocks_ * sizeof(Block); }
+    bool is_view() const { return storage_.empty(); }
+    
+    // False positive rate of a blocked filter (Poisson-distributed block load)
+    static double blocked_false_positive_rate(size_t num_blocks, size_t num_elements, 
+                                              size_t num_hash_functions);
     
-    std::vector<size_t> hash(const std::string& item) const;
+private:
+    struct alignas(64) Block {
+        uint64_t words[BLOCK_BITS / 64];
+    };
+    
+    std::vector<Block> storage_;
+    const Block* blocks_ = nullptr;
+    size_t num_blocks_ = 0;
+    size_t num_hash_functions_ = 1;
+    size_t expected_elements_ = 0;
+    
+    size_t block_index(const Hash128& hash) const;
+    void make_block_mask(const Hash128& hash, uint64_t mask[BLOCK_BITS / 64]) const;
 };
 
 // Main decontamination filter
 class DecontaminationFilter {
 public:
-    DecontaminationFilter() = default;
+    DecontaminationFilter() : DecontaminationFilter(DecontaminationConfig{}) {}
     explicit DecontaminationFilter(const DecontaminationConfig& config);
     ~DecontaminationFilter() = default;
     
@@ -157,7 +260,23 @@ public:
     void load_benchmark_directory(const std::string& directory);
     void add_benchmark_ngrams(const std::vector<std::string>& ngrams, const std::string& source);
     
-    // Document assessment
+    // Prebuilt index: save_index writes the hashed n-gram table, bloom filter and
+    // dataset table to one versioned file; load_index maps it back read-only and
+    // rejects files built with n-gram settings that differ from the current config
+    void save_index(const std::string& filename) const;
+    void load_index(const std::string& filename);
+    
+    // Disk-partitioned index for reference sets that do not fit in memory.
+    // build_partitioned_index streams the configured benchmark files and
+    // directories straight to disk within max_memory_mb, without loading them
+    // into this filter; load_partitioned_index keeps only its Bloom filter and
+    // fence keys resident and looks documents up in one batch per document
+    size_t build_partitioned_index(const std::string& directory) const;
+    void load_partitioned_index(const std::string& directory);
+    
+    // Document assessment. Once loading is finished the index is frozen and only
+    // read, so these may be called concurrently; statistics are accumulated per
+    // call (or per thread for batches) and merged into get_stats() afterwards
     DecontaminationAssessment assess_document(const Document& doc) const;
     std::vector<DecontaminationAssessment> assess_documents(const std::vector<Document>& docs) const;
     
@@ -169,40 +288,98 @@ public:
     std::vector<std::string> extract_ngrams(const std::string& text, size_t n = 0) const;
     std::vector<ContaminationMatch> find_contaminated_ngrams(const Document& doc) const;
     
-    // Statistics and reporting
+    // Statistics and reporting (not synchronized with in-flight assessments)
     const DecontaminationStats& get_stats() const { return stats_; }
     void reset_stats();
     void print_contamination_report() const;
     void save_contamination_log(const std::string& filename) const;
     
     // Utility functions
-    size_t get_benchmark_ngrams_count() const { return benchmark_ngrams_.size(); }
+    size_t get_benchmark_ngrams_count() const { 
+        return partitioned_index_ ? partitioned_index_->size() : index_.size(); 
+    }
     std::vector<std::string> get_benchmark_datasets() const;
-    bool is_loaded() const { return !benchmark_ngrams_.empty(); }
+    bool is_loaded() const { 
+        return !index_.empty() || partitioned_index_ || !overlap_automaton_.empty() || 
+               (approximate_index_ && !approximate_index_->empty()); 
+    }
     
 private:
     DecontaminationConfig config_;
     mutable DecontaminationStats stats_;
+    mutable std::mutex stats_mutex_;
     
-    // Benchmark data storage
-    std::unordered_set<std::string> benchmark_ngrams_;
-    std::unordered_map<std::string, std::string> ngram_to_dataset_;
-    std::unordered_map<std::string, std::vector<size_t>> ngram_to_positions_;
+    // Benchmark data storage. When loaded from a prebuilt index, the table and
+    // bloom filter are views into mapped_index_, which must outlive them
+    std::unique_ptr<io_utils::MappedFile> mapped_index_;
+    NGramIndex index_;
     std::unique_ptr<NGramBloomFilter> bloom_filter_;
+    std::unique_ptr<PartitionedNGramIndex> partitioned_index_;
+    OverlapAutomaton overlap_automaton_;
+    std::unique_ptr<ApproximateIndex> approximate_index_;
     
-    // Performance optimization
+    // Performance optimization. The cache is internally synchronized; identical
+    // texts (e.g. repeated boilerplate pages) are assessed once
     std::unordered_set<std::string> common_phrases_;
-    mutable std::unordered_map<std::string, DecontaminationAssessment> assessment_cache_;
+    std::unordered_set<uint64_t> common_phrase_hashes_;
+    mutable std::unique_ptr<ShardedClockCache<DecontaminationAssessment>> assessment_cache_;
     
     // Helper methods
+    DecontaminationAssessment assess_document_impl(const Document& doc, DecontaminationStats& local_stats) const;
+    void assess_partitioned_batch(const std::vector<Document>& docs, size_t first, size_t last,
+                                  std::vector<DecontaminationAssessment>& assessments) const;
+    // Runs body over [0, count), in parallel when enabled, with per-thread stats merged at the end
+    void for_each_document(size_t count, const std::function<void(size_t, DecontaminationStats&)>& body) const;
+    bool lookup_cached(const Document& doc, Hash128& content_hash, DecontaminationAssessment& assessment,
+                       DecontaminationStats& local_stats,
+                       std::chrono::high_resolution_clock::time_point start_time) const;
+    void finish_assessment(const Document& doc, const Hash128& content_hash, DecontaminationAssessment& assessment,
+                           DecontaminationStats& local_stats,
+                           std::chrono::high_resolution_clock::time_point start_time, double earlier_ms) const;
+    void match_overlaps(const std::string& text, DecontaminationAssessment& assessment) const;
+    void match_approximate(const std::string& text, DecontaminationAssessment& assessment) const;
+    void index_benchmark_text(const std::string& text, uint32_t dataset_id);
+    std::vector<std::string> overlap_tokens(const std::string& text) const;
+    // N-grams as [offset, offset + length) spans of one preprocessed buffer, so
+    // they can be hashed in place without building a string per n-gram
+    struct NGramSpan {
+        size_t offset;
+        size_t length;
+    };
+    void ngram_spans(const std::string& text, size_t n, std::string& buffer, std::vector<NGramSpan>& spans) const;
+    void match_ngrams(const std::string& text, bool full_scan, DecontaminationAssessment& assessment,
+                      DecontaminationStats& local_stats) const;
+    void ngram_probes(const std::string& text, uint32_t document, std::string& buffer, std::vector<NGramSpan>& spans,
+                      std::vector<PartitionedNGramIndex::Probe>& probes) const;
+    void collect_partitioned_matches(const std::string& buffer, const std::vector<NGramSpan>& spans,
+                                     const PartitionedNGramIndex::Hit* first, const PartitionedNGramIndex::Hit* last,
+                                     DecontaminationAssessment& assessment) const;
+    void set_ngram_verdict(size_t total, size_t probed, DecontaminationAssessment& assessment) const;
+    size_t required_matches(size_t total_ngrams) const;
+    FilterDecision make_decision(const DecontaminationAssessment& assessment) const;
+    void merge_stats(const DecontaminationStats& local_stats) const;
     std::string preprocess_text(const std::string& text) const;
     std::vector<std::string> tokenize(const std::string& text) const;
     std::string normalize_ngram(const std::string& ngram) const;
-    bool is_common_phrase(const std::string& ngram) const;
+    bool is_common_phrase(const Hash128& ngram_hash) const;
     double calculate_contamination_score(const std::vector<ContaminationMatch>& matches, 
                                        size_t total_ngrams) const;
-    void update_stats(const DecontaminationAssessment& assessment) const;
+    static void update_stats(DecontaminationStats& stats, const DecontaminationAssessment& assessment,
+                             double processing_time_ms);
     void load_common_phrases();
+    void index_benchmark_file(const std::string& filename, const std::string& dataset_name);
+    BenchmarkFormat benchmark_format(const std::string& filename) const;
+    void warn_if_empty(const std::string& filename, BenchmarkFormat format, size_t items) const;
+    void index_benchmark_directory(const std::string& directory);
+    void for_each_benchmark_file(const std::string& directory,
+                                 const std::function<void(const std::string&, const std::string&)>& visit) const;
+    void index_benchmark_ngram(const std::string& ngram, uint32_t dataset_id);
+    size_t benchmark_memory_bytes(size_t pending_ngrams = 0) const;
+    bool within_memory_budget(size_t pending_ngrams) const;
+    void check_memory_budget(size_t pending_ngrams = 0) const;
+    [[noreturn]] void memory_budget_exceeded() const;
+    void rebuild_bloom_filter();
+    void reset_assessment_cache();
     
     // File I/O helpers
     std::vector<std::string> read_lines_from_file(const std::string& filename) const;
@@ -221,12 +398,25 @@ namespace decontamination_utils {
     
     // Benchmark dataset utilities
     std::vector<std::string> find_benchmark_files(const std::string& directory, 
-                                                  const std::vector<std::string>& extensions = {".txt", ".json"});
+                                                  const std::vector<std::string>& extensions = {".txt", ".json", ".jsonl"});
     std::vector<std::string> load_benchmark_questions(const std::string& filename);
     std::vector<std::string> load_trivia_qa_dataset(const std::string& filename);
     std::vector<std::string> load_squad_dataset(const std::string& filename);
     std::vector<std::string> load_glue_dataset(const std::string& filename);
     
+    // Streaming benchmark access: .json/.jsonl files are read field by field
+    // (layout chosen from whole tokens of the path, such as "squad" in
+    // "squad_dev.json" or a "glue/" directory), anything else line by line.
+    // Each benchmark text is passed to visit as it is read; returns the count
+    BenchmarkFormat detect_benchmark_format(const std::string& filename);
+    const char* benchmark_format_name(BenchmarkFormat format);
+    std::vector<std::string> benchmark_text_fields(BenchmarkFormat format);
+    size_t stream_benchmark_texts(const std::string& filename, BenchmarkFormat format,
+                                  const std::function<void(const std::string&)>& visit);
+    
+    // Fingerprint of the settings that determine which n-gram keys an index holds
+    uint64_t index_fingerprint(const DecontaminationConfig& config);
+    
     // N-gram utilities
     std::vector<std::string> generate_ngrams(const std::string& text, size_t n, 
                                             bool normalize = true, bool tokenize = true);
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "common.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <map>
+#include <algorithm>
+#include <cstdint>
+
+namespace rapidsift {
+namespace dedup {
+
+// Open-addressing table from 128-bit n-gram hashes to the datasets containing
+// them. The table is built in memory while benchmarks load and is only read
+// afterwards, so it can also point straight into a serialized index file (see
+// IndexFileHeader).
+//
+// Each slot holds one 32-bit attribution: a plain dataset id for the common
+// case of an n-gram seen in one benchmark, or MULTI_DATASET | offset into a
+// shared pool of sorted id lists stored as (count, ids...). Each distinct list
+// is stored once and shared by every n-gram with that set of datasets.
+class NGramIndex {
+public:
+    static constexpr uint32_t NOT_FOUND = 0xFFFFFFFFu;
+    static constexpr uint32_t MULTI_DATASET = 0x80000000u;
+    static constexpr size_t MIN_CAPACITY = 1024;
+
+    NGramIndex() = default;
+
+    // Build side. Re-inserting an n-gram adds the dataset to its attribution
+    uint32_t intern_dataset(const std::string& name);
+    void insert(const Hash128& hash, uint32_t dataset_id);
+    void clear();
+
+    // Query side: the attribution of an n-gram, or NOT_FOUND
+    uint32_t find(const Hash128& hash) const;
+    bool contains(const Hash128& hash) const { return find(hash) != NOT_FOUND; }
+
+    // Visits every dataset id of an attribution returned by find, in id order
+    template<typename Visitor>
+    void for_each_dataset(uint32_t attribution, Visitor&& visit) const {
+        if (attribution == NOT_FOUND) return;
+        if (!(attribution & MULTI_DATASET)) {
+            visit(attribution);
+            return;
+        }
+        size_t offset = attribution & ~MULTI_DATASET;
+        if (offset >= dataset_set_count_) return;
+        size_t count = std::min<size_t>(dataset_sets_[offset], dataset_set_count_ - offset - 1);
+        for (size_t i = 1; i <= count; ++i) visit(dataset_sets_[offset + i]);
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return capacity_; }
+    size_t memory_bytes() const { return memory_bytes_after(0); }
+    // Table and pool size once added more n-grams are inserted, growing the
+    // table as insert would
+    size_t memory_bytes_after(size_t added) const {
+        size_t capacity = capacity_;
+        if (added > 0 && (is_attached() || (size_ + added) * 2 > capacity)) {
+            capacity = std::max(capacity, MIN_CAPACITY);
+            while ((size_ + added) * 2 > capacity) capacity *= 2;
+        }
+        return capacity * (sizeof(Hash128) + sizeof(uint32_t)) + dataset_set_count_ * sizeof(uint32_t);
+    }
+
+    const std::vector<std::string>& datasets() const { return datasets_; }
+    const std::string& dataset_name(uint32_t id) const { return datasets_[id]; }
+
+    // Visits every stored (hash, attribution) pair
+    template<typename Visitor>
+    void for_each(Visitor&& visit) const {
+        for (size_t i = 0; i < capacity_; ++i) {
+            if (!is_empty_slot(keys_[i])) visit(keys_[i], dataset_ids_[i]);
+        }
+    }
+
+    // Serialization support: raw slot arrays, and attaching to external
+    // (e.g. memory-mapped) arrays that must outlive this index. attach reads
+    // every slot and pool entry once and throws on ids or offsets out of range
+    const Hash128* keys() const { return keys_; }
+    const uint32_t* dataset_ids() const { return dataset_ids_; }
+    const uint32_t* dataset_sets() const { return dataset_sets_; }
+    size_t dataset_sets_size() const { return dataset_set_count_; }
+    void attach(const Hash128* keys, const uint32_t* dataset_ids, size_t capacity, size_t size,
+                const uint32_t* dataset_sets, size_t dataset_sets_size, std::vector<std::string> datasets);
+    bool is_attached() const { return keys_ != nullptr && key_storage_.empty(); }
+
+private:
+    std::vector<Hash128> key_storage_;
+    std::vector<uint32_t> dataset_id_storage_;
+    const Hash128* keys_ = nullptr;
+    const uint32_t* dataset_ids_ = nullptr;
+    size_t capacity_ = 0;
+    size_t size_ = 0;
+
+    std::vector<uint32_t> dataset_set_storage_;
+    const uint32_t* dataset_sets_ = nullptr;
+    size_t dataset_set_count_ = 0;
+    std::map<std::vector<uint32_t>, uint32_t> dataset_set_offsets_;  // Build side: list -> pool offset
+
+    std::vector<std::string> datasets_;
+    std::unordered_map<std::string, uint32_t> dataset_lookup_;
+
+    // The all-zero key marks an empty slot
+    static bool is_empty_slot(const Hash128& key) { return key.low == 0 && key.high == 0; }
+    static Hash128 canonical_key(Hash128 hash) {
+        if (is_empty_slot(hash)) hash.high = 1;
+        return hash;
+    }
+
+    size_t home_slot(const Hash128& key) const { return static_cast<size_t>(key.high) & (capacity_ - 1); }
+    void rehash(size_t new_capacity);
+    uint32_t add_dataset(uint32_t attribution, uint32_t dataset_id);
+};
+
+// On-disk layout of a prebuilt decontamination index. All sections start on a
+// 64-byte boundary so the mapped file can be used in place:
+//   header | n-gram keys | attributions | dataset id lists | bloom filter blocks | dataset names
+// Dataset names are stored as (uint32 length, bytes) pairs. Integers are in
+// host byte order; endian_marker rejects files written on another byte order.
+struct IndexFileHeader {
+    static constexpr char MAGIC[8] = {'R', 'S', 'D', 'C', 'O', 'N', 'I', 'X'};
+    static constexpr uint32_t CURRENT_VERSION = 2;
+    static constexpr uint32_t ENDIAN_MARKER = 0x01020304u;
+    static constexpr size_t SECTION_ALIGNMENT = 64;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t endian_marker;
+    uint64_t config_fingerprint;
+    uint64_t file_size;
+
+    uint64_t ngram_count;
+    uint64_t table_capacity;
+    uint64_t keys_offset;
+    uint64_t dataset_ids_offset;
+    uint64_t dataset_sets_offset;
+    uint64_t dataset_sets_size;      // In uint32 words
+
+    uint64_t bloom_num_blocks;
+    uint64_t bloom_hash_functions;
+    uint64_t bloom_expected_elements;
+    double bloom_false_positive_rate;
+    uint64_t bloom_offset;
+
+    uint64_t dataset_count;
+    uint64_t datasets_offset;
+    uint64_t datasets_size;
+};
+
+} // namespace dedup
+} // namespace rapidsift
@@ -5,22 +5,51 @@
 #include <unordered_map>
 #include <memory>
 #include <functional>
+#include <cstdint>
 
 #include "common.hpp"
 
 namespace rapidsift {
 
+class CharNGramLanguageModel;
+
 /**
  * Language identification result containing detected language and confidence score
  */
 struct LanguageDetection {
     std::string language;      // ISO 639-1 language code (e.g., "en", "fr", "de")
     double confidence;         // Confidence score [0.0, 1.0]
+    size_t bytes_inspected = 0; // Document bytes read to decide, counting re-reads (set by LanguageFilter)
     
     LanguageDetection(const std::string& lang = "unknown", double conf = 0.0)
         : language(lang), confidence(conf) {}
 };
 
+/**
+ * A byte range of a text [begin, end) and the language detected in it
+ */
+struct LanguageSpan {
+    size_t begin = 0;
+    size_t end = 0;
+    std::string language = "unknown";
+    double confidence = 0.0;
+    
+    size_t length() const { return end - begin; }
+};
+
+/**
+ * Per-document language makeup from sliding-window detection
+ */
+struct LanguageSegmentation {
+    std::vector<LanguageSpan> spans;                       // In text order, adjacent spans differ in language
+    std::unordered_map<std::string, double> proportions;   // Share of the text's bytes per language
+    
+    std::string dominant_language() const;
+    
+    // Whether languages other than the dominant one cover at least threshold of the text
+    bool is_mixed(double threshold) const;
+};
+
 /**
  * Configuration for language filtering
  */
@@ -35,6 +64,20 @@ struct LanguageFilterConfig {
     bool enable_preprocessing = true;           // Clean text before detection
     bool normalize_scores = true;              // Normalize confidence scores
     double mixed_language_threshold = 0.3;    // Threshold for detecting mixed languages
+    
+    // Segment-level mixed-language detection
+    bool segment_languages = false;            // Detect mixed documents from sliding windows, not scripts
+    size_t segment_window_bytes = 256;         // Window length, rounded up to whole strides
+    size_t segment_stride_bytes = 128;         // Distance between window starts
+    bool trim_mixed_documents = false;         // Keep the target-language spans of mixed documents
+    
+    // Sampled detection: classify a prefix, read more only when it is unsure
+    size_t sample_bytes = 0;                   // Prefix and sample length; 0 detects the full text
+    size_t max_samples = 4;                    // Prefix plus strided samples before reading everything
+    
+    // Performance settings
+    bool enable_parallel_processing = true;    // Preprocess and detect batches across threads
+    size_t batch_size = 4096;                  // Documents preprocessed and detected per batch
 };
 
 /**
@@ -47,6 +90,9 @@ struct LanguageFilterResult {
     size_t total_processed = 0;
     size_t total_kept = 0;
     size_t total_rejected = 0;
+    size_t total_trimmed = 0;      // Mixed documents kept as their target-language spans (in total_kept)
+    size_t total_bytes = 0;        // Text bytes across all processed documents
+    size_t bytes_inspected = 0;    // Text bytes language detection actually read
     double average_confidence = 0.0;
     
     // Statistics
@@ -72,16 +118,23 @@ public:
     virtual LanguageDetection detect(const std::string& text) = 0;
     
     /**
-     * Detect languages for multiple texts (can be optimized for batch processing)
+     * Detect languages for multiple texts. Runs across threads when the
+     * detector supports concurrent detect calls; results keep input order
      */
-    virtual std::vector<LanguageDetection> detect_batch(const std::vector<std::string>& texts) {
-        std::vector<LanguageDetection> results;
-        results.reserve(texts.size());
-        for (const auto& text : texts) {
-            results.push_back(detect(text));
-        }
-        return results;
-    }
+    virtual std::vector<LanguageDetection> detect_batch(const std::vector<std::string>& texts);
+    
+    /**
+     * Detect languages of overlapping windows laid out by
+     * language_utils::sliding_windows. The default detects each window
+     * separately; detectors with additive features share work between windows
+     */
+    virtual std::vector<LanguageSpan> detect_windows(const std::string& text, size_t window_bytes,
+                                                     size_t stride_bytes);
+    
+    /**
+     * Whether detect only reads shared state and may be called concurrently
+     */
+    virtual bool supports_concurrent_detect() const { return false; }
     
     /**
      * Get supported languages
@@ -116,7 +169,13 @@ public:
     
     bool load_model(const std::string& model_path);
     LanguageDetection detect(const std::string& text) override;
+    
+    /**
+     * Batch inference: the loaded model is shared read-only by all worker
+     * threads, each with its own input view and prediction buffer
+     */
     std::vector<LanguageDetection> detect_batch(const std::vector<std::string>& texts) override;
+    bool supports_concurrent_detect() const override { return is_ready(); }
     std::vector<std::string> get_supported_languages() const override;
     bool is_ready() const override;
     
@@ -126,20 +185,63 @@ public:
 };
 
 /**
- * Simple rule-based language detector (fallback when FastText is not available)
+ * Simple rule-based language detector (fallback when FastText is not available).
+ * One pass over the text classifies the Unicode script of every letter; text
+ * dominated by a script with one known language (Cyrillic, Greek, Arabic, CJK,
+ * ...) is decided by script alone. Latin-script words are looked up once in a
+ * perfect-hash stopword table giving the bitmask of languages that use them.
  */
 class SimpleLanguageDetector : public LanguageDetector {
 private:
     std::unordered_map<std::string, std::vector<std::string>> language_patterns_;
     std::unordered_map<std::string, std::vector<std::string>> language_stopwords_;
     
+    // Perfect-hash stopword table: a word's hash picks a bucket, whose
+    // displacement picks the word's collision-free slot
+    struct StopwordSlot {
+        std::string word;
+        uint32_t languages = 0;    // Bit i set when word is a stopword of stopword_languages_[i]
+    };
+    std::vector<std::string> stopword_languages_;
+    std::vector<uint32_t> stopword_displacements_;
+    std::vector<StopwordSlot> stopword_slots_;
+    
     void initialize_patterns();
-    double calculate_language_score(const std::string& text, const std::string& language) const;
+    void build_stopword_table();
+    uint32_t lookup_stopword(const char* word, size_t length) const;
     
 public:
     SimpleLanguageDetector();
     
     LanguageDetection detect(const std::string& text) override;
+    bool supports_concurrent_detect() const override { return true; }
+    std::vector<std::string> get_supported_languages() const override;
+    bool is_ready() const override;
+};
+
+/**
+ * Built-in character n-gram detector backed by CharNGramLanguageModel; needs no
+ * external library, only a model file written by --mode train-langid
+ */
+class CharNGramLanguageDetector : public LanguageDetector {
+private:
+    std::unique_ptr<CharNGramLanguageModel> model_;
+    
+public:
+    explicit CharNGramLanguageDetector(const std::string& model_path = "");
+    explicit CharNGramLanguageDetector(CharNGramLanguageModel model);
+    ~CharNGramLanguageDetector();
+    
+    bool load_model(const std::string& model_path);
+    LanguageDetection detect(const std::string& text) override;
+    
+    /**
+     * Extracts features once, summed per stride block; each window adds up
+     * its blocks, sliding by one block at a time
+     */
+    std::vector<LanguageSpan> detect_windows(const std::string& text, size_t window_bytes,
+                                             size_t stride_bytes) override;
+    bool supports_concurrent_detect() const override { return is_ready(); }
     std::vector<std::string> get_supported_languages() const override;
     bool is_ready() const override;
 };
@@ -157,6 +259,33 @@ private:
     bool should_keep_document(const LanguageDetection& detection) const;
     bool is_mixed_language(const std::string& text) const;
     
+    // Detects documents [begin, end) as one batch. With apply_prefilters,
+    // documents rejected before detection (too short, mixed) are flagged
+    // instead, and trimmed mixed documents get their kept text in trimmed
+    enum class PreDetection { DETECTED, TOO_SHORT, MIXED, TRIMMED };
+    void detect_range(const std::vector<Document>& documents, size_t begin, size_t end, bool apply_prefilters,
+                      std::vector<PreDetection>& status, std::vector<LanguageDetection>& detections,
+                      std::vector<std::string>& trimmed) const;
+    
+    // Sampled detection: documents of detected whose prefix was below
+    // min_confidence move on to strided samples, then to their full text
+    void escalate_unsure(const std::vector<Document>& documents, size_t begin, const std::vector<size_t>& detected,
+                         std::vector<LanguageDetection>& detections, std::vector<size_t>& inspected) const;
+    
+    // Runs the detector over texts, as a batch when parallel processing is on
+    std::vector<LanguageDetection> detect_texts(const std::vector<std::string>& texts) const;
+    
+    // Sampled detection: the preprocessed strided samples read after an unsure
+    // prefix of prefix_bytes (adding their length to bytes_read), and whether
+    // the prefix and samples agree confidently enough to settle the language
+    std::vector<std::string> escalation_samples(const std::string& text, size_t prefix_bytes,
+                                                size_t& bytes_read) const;
+    bool combine_samples(const std::vector<LanguageDetection>& samples, LanguageDetection& combined) const;
+    
+    // Joins the spans of a mixed document worth keeping; sets the kept language
+    std::string trim_to_kept_spans(const std::string& text, const LanguageSegmentation& segmentation,
+                                   LanguageDetection& detection) const;
+    
 public:
     explicit LanguageFilter(const LanguageFilterConfig& config = LanguageFilterConfig{});
     ~LanguageFilter() = default;
@@ -192,6 +321,11 @@ public:
      */
     LanguageDetection detect_language(const Document& document) const;
     
+    /**
+     * Detect languages over sliding windows and merge them into spans
+     */
+    LanguageSegmentation segment_languages(const Document& document) const;
+    
     /**
      * Get language statistics for a set of documents
      */
@@ -241,6 +375,13 @@ namespace language_utils {
      */
     bool has_mixed_scripts(const std::string& text);
     
+    /**
+     * Windows of window_bytes (rounded up to whole strides) starting every
+     * stride_bytes, with edges moved forward to UTF-8 character boundaries.
+     * The last window ends at the end of the text
+     */
+    std::vector<LanguageSpan> sliding_windows(const std::string& text, size_t window_bytes, size_t stride_bytes);
+    
     /**
      * Get language confidence based on text length and other factors
      */
@@ -255,6 +396,11 @@ namespace language_utils {
      * Get default model path for fastText language detection
      */
     std::string get_default_model_path();
+    
+    /**
+     * Get default model path for the built-in n-gram detector
+     */
+    std::string get_default_ngram_model_path();
 }
 
 } // namespace rapidsift 
\ No newline at end of file
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "common.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+
+namespace rapidsift {
+
+// On-disk layout of a character n-gram language-ID model:
+//   header | biases (float x padded_languages) | weights (int8 x buckets x padded_languages) | language codes
+// Every section starts on a SECTION_ALIGNMENT boundary; weights are row-major by
+// feature bucket so one feature touches one contiguous row.
+struct LanguageModelHeader {
+    static constexpr char MAGIC[8] = {'R', 'S', 'L', 'A', 'N', 'G', 'I', 'D'};
+    static constexpr uint32_t CURRENT_VERSION = 1;
+    static constexpr uint32_t ENDIAN_MARKER = 0x01020304u;
+    static constexpr size_t SECTION_ALIGNMENT = 64;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t endian_marker;
+    uint64_t file_size;
+
+    uint32_t bucket_bits;
+    uint32_t max_ngram;
+    uint64_t num_languages;
+    uint64_t padded_languages;
+    float weight_scale;         // Dequantized weight = int8 weight * weight_scale
+    uint32_t reserved;
+
+    uint64_t biases_offset;
+    uint64_t weights_offset;
+    uint64_t languages_offset;
+    uint64_t languages_size;
+};
+
+/**
+ * @brief Built-in language identifier: a linear softmax classifier over hashed
+ * byte 1-4-grams, with int8 weights quantized against one shared scale.
+ *
+ * Text is case-folded (ASCII) and every run of ASCII digits, punctuation and
+ * whitespace becomes one space, so n-grams see word boundaries; bytes of
+ * multi-byte UTF-8 characters are kept as-is, which lets the same features
+ * cover every script. A prediction walks the text once, accumulating each
+ * feature's weight row into int16 lanes with SIMD and widening to int32 every
+ * few hundred features. Loaded models are memory-mapped and read-only, so one
+ * model may serve any number of threads.
+ */
+class CharNGramLanguageModel {
+public:
+    static constexpr uint32_t MAX_NGRAM = 4;
+    static constexpr size_t LANGUAGE_LANES = 32;   // Weight rows are padded to whole SIMD vectors
+    static constexpr uint32_t MIN_BUCKET_BITS = 8;
+    static constexpr uint32_t MAX_BUCKET_BITS = 24;
+
+    struct Prediction {
+        uint32_t language = 0;
+        float probability = 0.0f;
+        size_t features = 0;    // N-grams seen; zero means the text had nothing to classify
+    };
+
+    CharNGramLanguageModel() = default;
+
+    // Quantizes a trained model: weights are row-major, buckets x languages
+    CharNGramLanguageModel(std::vector<std::string> languages, uint32_t bucket_bits,
+                           const std::vector<float>& weights, const std::vector<float>& biases);
+    ~CharNGramLanguageModel();
+
+    CharNGramLanguageModel(CharNGramLanguageModel&&) noexcept;
+    CharNGramLanguageModel& operator=(CharNGramLanguageModel&&) noexcept;
+    CharNGramLanguageModel(const CharNGramLanguageModel&) = delete;
+    CharNGramLanguageModel& operator=(const CharNGramLanguageModel&) = delete;
+
+    // Throws std::runtime_error on unreadable, foreign or corrupt files
+    void load(const std::string& filename);
+    void save(const std::string& filename) const;
+
+    Prediction predict(const char* text, size_t length) const;
+    Prediction predict(const std::string& text) const { return predict(text.data(), text.size()); }
+
+    // Fills one probability per language; returns the number of features seen
+    size_t probabilities(const char* text, size_t length, std::vector<float>& out) const;
+
+    // One feature pass split into blocks starting at ascending byte offsets
+    // (the first is 0): fills each block's weight sums (padded_languages()
+    // entries per block) and feature count. A feature belongs to the block of
+    // its last byte, so a run of adjacent blocks sums to the features ending
+    // in the bytes it covers, and windows of blocks are scored without
+    // re-reading the text
+    void block_totals(const char* text, size_t length, const std::vector<size_t>& block_starts,
+                      std::vector<int32_t>& totals, std::vector<size_t>& counts) const;
+
+    // Prediction from weight sums over the given number of features
+    Prediction predict_totals(const int32_t* totals, size_t features) const;
+
+    bool is_loaded() const { return weights_ != nullptr; }
+    uint32_t bucket_bits() const { return bucket_bits_; }
+    size_t num_buckets() const { return size_t{1} << bucket_bits_; }
+    size_t padded_languages() const { return padded_languages_; }
+    size_t num_languages() const { return languages_.size(); }
+    const std::vector<std::string>& languages() const { return languages_; }
+    const std::string& language(uint32_t id) const { return languages_[id]; }
+    size_t memory_bytes() const { return num_buckets() * padded_languages_ + padded_languages_ * sizeof(float); }
+
+    // Calls visit(bucket) for every n-gram feature of the text, in text order;
+    // returns the number of features. Training and prediction share this
+    static size_t for_each_feature(const char* text, size_t length, uint32_t bucket_bits,
+                                   const std::function<void(uint32_t)>& visit);
+
+private:
+    std::vector<std::string> languages_;
+    uint32_t bucket_bits_ = 0;
+    size_t padded_languages_ = 0;
+    float weight_scale_ = 1.0f;
+    std::vector<float> biases_;                       // padded_languages_ entries
+    std::vector<int8_t> owned_weights_;               // Set when built in memory
+    std::unique_ptr<io_utils::MappedFile> mapped_;    // Set when loaded
+    const int8_t* weights_ = nullptr;
+
+    // Integer weight sums per language over all features; returns the feature count
+    size_t accumulate(const char* text, size_t length, std::vector<int32_t>& totals) const;
+    void softmax(const int32_t* totals, size_t features, std::vector<float>& out) const;
+};
+
+/**
+ * Training options for CharNGramModelTrainer
+ */
+struct LanguageModelTrainingConfig {
+    uint32_t bucket_bits = 16;              // 2^bits hashed feature rows
+    size_t epochs = 5;
+    double learning_rate = 1.0;             // Decays linearly to zero over training
+    size_t max_bytes_per_example = 4096;    // Longer examples are truncated
+    uint64_t seed = 42;                     // Example shuffling
+};
+
+/**
+ * @brief Trains a CharNGramLanguageModel with SGD on multinomial logistic loss.
+ * Examples come from a local labeled corpus, one per line, either fastText
+ * style ("__label__en Some text") or tab separated ("en<TAB>Some text").
+ * Each example is kept as sparse normalized feature counts, so the corpus is
+ * read once and must fit in memory in that form.
+ */
+class CharNGramModelTrainer {
+public:
+    explicit CharNGramModelTrainer(const LanguageModelTrainingConfig& config = LanguageModelTrainingConfig{});
+
+    void add_example(const std::string& language, const std::string& text);
+
+    // Returns the number of examples read; unlabeled lines are skipped
+    size_t add_corpus(const std::string& filename);
+
+    size_t num_examples() const { return examples_.size(); }
+    size_t num_languages() const { return languages_.size(); }
+
+    CharNGramLanguageModel train(
+        std::function<void(size_t epoch, size_t epochs, double loss)> progress_callback = nullptr) const;
+
+private:
+    struct Example {
+        uint32_t language;
+        std::vector<std::pair<uint32_t, float>> features;  // (bucket, count / total), by bucket
+    };
+
+    LanguageModelTrainingConfig config_;
+    std::vector<std::string> languages_;
+    std::unordered_map<std::string, uint32_t> language_ids_;
+    std::vector<Example> examples_;
+};
+
+} // namespace rapidsift
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+
+namespace rapidsift {
+namespace dedup {
+
+// Token-level generalized suffix automaton over every benchmark text. Each state
+// is a set of benchmark substrings with the same end positions; walking a
+// document through it tracks the longest benchmark substring ending at every
+// token, so maximal overlaps of any length come out of one linear-time pass.
+class OverlapAutomaton {
+public:
+    static constexpr uint32_t NO_STATE = 0xFFFFFFFFu;
+
+    // A maximal document span that also occurs in a benchmark text
+    struct Overlap {
+        size_t start = 0;          // First token of the span in the document
+        size_t length = 0;         // Span length in tokens
+        uint32_t dataset_id = 0;   // A dataset whose text contains the span
+    };
+
+    OverlapAutomaton();
+
+    void add_text(const std::vector<std::string>& tokens, uint32_t dataset_id);
+    void clear();
+
+    // Maximal overlaps of at least min_length tokens, in document order
+    std::vector<Overlap> find_overlaps(const std::vector<std::string>& tokens, size_t min_length,
+                                       size_t max_overlaps = SIZE_MAX) const;
+
+    bool empty() const { return num_texts_ == 0; }
+    size_t num_texts() const { return num_texts_; }
+    size_t num_states() const { return states_.size(); }
+    size_t vocabulary_size() const { return vocabulary_.size(); }
+    // Estimate of the heap memory held by states, transitions and vocabulary
+    size_t memory_bytes() const;
+
+private:
+    struct State {
+        uint32_t length = 0;
+        uint32_t link = NO_STATE;
+        uint32_t dataset_id = 0;
+        std::vector<std::pair<uint32_t, uint32_t>> next;  // (symbol, state), sorted by symbol
+    };
+
+    std::vector<State> states_;
+    std::unordered_map<std::string, uint32_t> vocabulary_;
+    size_t num_texts_ = 0;
+    size_t num_transitions_ = 0;
+    size_t vocabulary_chars_ = 0;
+
+    uint32_t transition(uint32_t state, uint32_t symbol) const;
+    void set_transition(uint32_t state, uint32_t symbol, uint32_t target);
+    uint32_t clone_state(uint32_t state, uint32_t length);
+    uint32_t extend(uint32_t last, uint32_t symbol, uint32_t dataset_id);
+};
+
+} // namespace dedup
+} // namespace rapidsift
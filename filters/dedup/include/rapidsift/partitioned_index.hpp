@@ -0,0 +1,162 @@
+#pragma once
+
+#include "common.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+
+namespace rapidsift {
+namespace dedup {
+
+class NGramBloomFilter;
+
+// Disk-partitioned n-gram index for reference sets far larger than memory,
+// such as a prior training corpus. N-gram hashes are range-partitioned on their
+// top bits into per-partition segment files of sorted (hash, dataset) records.
+// Only a Bloom filter and one fence key per block of records stay resident, so
+// a lookup that passes the Bloom filter reads a single block of one segment.
+//
+// Directory layout:
+//   manifest.bin      header | partition table | fence keys | bloom blocks | dataset names
+//   part-NNNNN.seg    PartitionRecord array sorted by hash, then dataset id
+struct PartitionRecord {
+    Hash128 key;
+    uint32_t dataset_id = 0;
+    uint32_t reserved = 0;
+};
+
+struct PartitionedIndexHeader {
+    static constexpr char MAGIC[8] = {'R', 'S', 'D', 'C', 'P', 'A', 'R', 'T'};
+    static constexpr uint32_t CURRENT_VERSION = 1;
+    static constexpr uint32_t ENDIAN_MARKER = 0x01020304u;
+    static constexpr size_t SECTION_ALIGNMENT = 64;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t endian_marker;
+    uint64_t config_fingerprint;
+    uint64_t file_size;
+
+    uint64_t record_count;
+    uint64_t num_partitions;
+    uint64_t fence_interval;    // Records per block; each block's first key is a fence
+    uint64_t partitions_offset;
+    uint64_t fences_offset;
+    uint64_t fence_count;
+
+    uint64_t bloom_num_blocks;
+    uint64_t bloom_hash_functions;
+    uint64_t bloom_expected_elements;
+    uint64_t bloom_offset;
+
+    uint64_t dataset_count;
+    uint64_t datasets_offset;
+    uint64_t datasets_size;
+};
+
+struct PartitionTableEntry {
+    uint64_t record_count;
+    uint64_t fence_start;  // Index of the partition's first fence key
+    uint64_t fence_count;
+};
+
+// Writes a partitioned index in bounded memory: records are buffered up to the
+// budget, sorted and spilled as runs per partition, then each partition's runs
+// are merged into its segment. The Bloom filter and fences are sized so they
+// fit the same budget when the index is opened.
+class PartitionedIndexBuilder {
+public:
+    static constexpr size_t MIN_FENCE_INTERVAL = 128;
+
+    PartitionedIndexBuilder(const std::string& directory, size_t num_partitions, size_t memory_budget_bytes,
+                            double bloom_false_positive_rate, uint64_t config_fingerprint);
+    ~PartitionedIndexBuilder();
+
+    PartitionedIndexBuilder(const PartitionedIndexBuilder&) = delete;
+    PartitionedIndexBuilder& operator=(const PartitionedIndexBuilder&) = delete;
+
+    uint32_t intern_dataset(const std::string& name);
+    void add(const Hash128& hash, uint32_t dataset_id);
+
+    // Merges the spilled runs, writes segments and the manifest; returns the
+    // number of distinct (hash, dataset) records. The builder is spent afterwards
+    size_t finish();
+
+private:
+    std::string directory_;
+    size_t num_partitions_;
+    size_t memory_budget_;
+    double bloom_false_positive_rate_;
+    uint64_t config_fingerprint_;
+
+    std::vector<PartitionRecord> buffer_;
+    size_t buffer_capacity_;
+    std::vector<std::vector<uint64_t>> run_lengths_;  // Per partition, records per spilled run
+    uint64_t spilled_records_ = 0;
+    bool finished_ = false;
+
+    std::vector<std::string> datasets_;
+    std::unordered_map<std::string, uint32_t> dataset_lookup_;
+
+    void spill();
+    std::string run_path(size_t partition) const;
+};
+
+// Read side of a partitioned index. Segments are memory-mapped and only read
+// where fences point; resident memory (Bloom filter and fences) is checked
+// against the budget when the index is opened.
+class PartitionedNGramIndex {
+public:
+    // Caller's tags, returned with every hit: a batch may mix the n-grams of
+    // many documents
+    struct Probe {
+        Hash128 hash;
+        uint32_t document = 0;
+        uint32_t position = 0;
+    };
+
+    struct Hit {
+        uint32_t document = 0;
+        uint32_t position = 0;
+        uint32_t dataset_id = 0;
+    };
+
+    PartitionedNGramIndex(const std::string& directory, size_t memory_budget_bytes, uint64_t config_fingerprint);
+    ~PartitionedNGramIndex();
+
+    // Screens probes with the Bloom filter, then visits the survivors in hash
+    // order: one pass per partition, reading its segment front to back. Hits
+    // come back sorted by document, position, then dataset id. Reorders probes
+    void lookup_batch(std::vector<Probe>& probes, std::vector<Hit>& hits) const;
+
+    size_t size() const { return static_cast<size_t>(header_.record_count); }
+    size_t num_partitions() const { return static_cast<size_t>(header_.num_partitions); }
+    size_t resident_bytes() const { return resident_bytes_; }
+    const std::vector<std::string>& datasets() const { return datasets_; }
+    const std::string& dataset_name(uint32_t id) const { return datasets_[id]; }
+
+    static std::string manifest_path(const std::string& directory);
+    static std::string segment_path(const std::string& directory, size_t partition);
+    static size_t partition_of(const Hash128& hash, size_t num_partitions);
+
+private:
+    PartitionedIndexHeader header_ = {};
+    std::unique_ptr<io_utils::MappedFile> manifest_;
+    std::vector<std::unique_ptr<io_utils::MappedFile>> segments_;
+    const PartitionTableEntry* partitions_ = nullptr;
+    const Hash128* fences_ = nullptr;
+    std::unique_ptr<NGramBloomFilter> bloom_;
+    std::vector<std::string> datasets_;
+    size_t resident_bytes_ = 0;
+};
+
+// Hash order used by segments and fences: high word first, matching the
+// partitioning on the top bits
+inline bool hash_less(const Hash128& a, const Hash128& b) {
+    return a.high != b.high ? a.high < b.high : a.low < b.low;
+}
+
+} // namespace dedup
+} // namespace rapidsift
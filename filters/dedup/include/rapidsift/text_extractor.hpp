@@ -6,7 +6,9 @@
 #include <unordered_set>
 #include <memory>
 #include <functional>
-#include <regex>
+#include <string_view>
+#include <deque>
+#include <cstdint>
 
 #include "common.hpp"
 
@@ -25,9 +27,13 @@ struct TextExtractionConfig {
     bool remove_ads = true;              // Remove advertisement blocks
     bool remove_forms = true;            // Remove form elements
     bool remove_metadata = true;         // Remove meta tags and hidden content
+    bool use_flat_dom = true;            // Parse into a FlatHtmlDocument instead of a shared_ptr tree
+    bool streaming_extraction = false;   // Extract in one pass over tokens without any DOM
+    size_t max_dom_depth = 256;          // Elements nested deeper are flattened into their ancestor
     
     // Content filtering
     bool extract_main_content = true;     // Focus on main content areas
+    bool classify_blocks = true;         // Flat DOM: keep the blocks BlockClassifier scores as content
     bool preserve_paragraphs = true;     // Keep paragraph structure
     bool preserve_lists = true;          // Keep list structure
     bool preserve_headings = true;       // Keep heading structure
@@ -46,11 +52,15 @@ struct TextExtractionConfig {
     size_t min_total_length = 100;       // Minimum total text length
     double min_text_ratio = 0.3;         // Minimum text/HTML ratio
     size_t max_link_density = 5;         // Max links per 100 words
+    double max_block_link_ratio = 0.5;   // Streaming: blocks with a larger share of link text are dropped
     
     // Language and encoding
     std::string default_encoding = "utf-8";
     bool auto_detect_encoding = true;
     bool fix_mojibake = true;            // Fix common encoding issues
+    
+    // Performance settings
+    bool enable_parallel_processing = true;  // Extract batches across threads
 };
 
 /**
@@ -59,7 +69,8 @@ struct TextExtractionConfig {
 struct TextExtractionResult {
     std::string extracted_text;           // Main extracted content
     std::string title;                   // Page title
-    std::string language;                // Detected language (if available)
+    std::string language;                // <html lang>, else the content-language or language meta tag
+    std::string encoding;                // Declared charset, lower case; empty if none
     std::string url;                     // Original URL (if provided)
     
     // Quality metrics
@@ -73,7 +84,7 @@ struct TextExtractionResult {
     // Extraction metadata
     std::vector<std::string> headings;   // Extracted headings
     std::vector<std::string> links;      // Extracted links (if preserved)
-    std::unordered_map<std::string, std::string> metadata; // Meta tags
+    std::unordered_map<std::string, std::string> metadata; // Meta tags: name, property or http-equiv -> content
     
     bool is_valid() const {
         return extracted_text_length >= 50 && text_ratio >= 0.1;
@@ -120,26 +131,181 @@ struct HtmlElement {
 };
 
 /**
- * Simple HTML parser for text extraction
+ * Attribute of a FlatHtmlNode; the name is lower case, the value is raw source
  */
-class HtmlParser {
+struct FlatHtmlAttribute {
+    std::string_view name;
+    std::string_view value;
+};
+
+/**
+ * One token of HTML: a start tag with its attributes, an end tag, or text
+ */
+struct HtmlToken {
+    enum class Type { START_TAG, END_TAG, TEXT };
+    
+    Type type = Type::TEXT;
+    std::string_view name;                       // Lower-case tag name
+    std::string_view text;                       // Raw source text of a TEXT token
+    bool self_closing = false;
+    std::vector<FlatHtmlAttribute> attributes;   // Start tags only
+    
+    // Empty view when the attribute is missing
+    std::string_view attribute(std::string_view attribute_name) const;
+};
+
+/**
+ * Pull tokenizer over HTML source. Comments, doctypes and processing
+ * instructions produce no tokens, and script or style content comes back as
+ * one TEXT token between its tags. Views into the source live as long as the
+ * source; names that had to be lower-cased live until the next call to next()
+ */
+class HtmlTokenizer {
+public:
+    explicit HtmlTokenizer(std::string_view html) : html_(html) {}
+    
+    // Fills token with the next token; false at the end of the input
+    bool next(HtmlToken& token);
+    
+    bool in_source(std::string_view view) const {
+        return view.data() >= html_.data() && view.data() + view.size() <= html_.data() + html_.size();
+    }
+    
 private:
-    std::string html_;
+    std::string_view html_;
     size_t pos_ = 0;
+    std::string_view raw_text_tag_;    // Set inside script or style content
+    size_t raw_text_end_ = 0;          // Where that content's end tag starts
     
-    // Helper methods
-    void skip_whitespace();
-    std::string parse_tag_name();
-    std::unordered_map<std::string, std::string> parse_attributes();
-    std::string parse_text();
-    std::shared_ptr<HtmlElement> parse_element();
+    std::deque<std::string> lowered_;  // Reused buffers for lower-cased names
+    size_t lowered_used_ = 0;
+    
+    std::string_view lowered(std::string_view name);
+    void parse_start_tag(HtmlToken& token);
+};
+
+/**
+ * Document metadata gathered from the tokens of the parse itself, so no
+ * separate scan of the source is needed. Only <html>, <title> and <meta>
+ * tokens do any work
+ */
+struct HtmlMetadata {
+    std::string title;               // Raw text of the first <title>; a start tag inside it ends it
+    std::string language;            // <html lang>, else <meta http-equiv="content-language"> or name="language"
+    std::string charset;             // <meta charset>, or charset= in a Content-Type meta tag; lower case
+    std::unordered_map<std::string, std::string> meta;   // Lower-case name, property or http-equiv -> content; first wins
+    
+    void observe(const HtmlToken& token);
+    void clear();
     
+private:
+    bool in_title_ = false;
+    bool title_seen_ = false;
+    bool html_language_ = false;     // language came from <html lang>
+};
+
+/**
+ * Node of a FlatHtmlDocument. Nodes are stored in document order, so a node's
+ * descendants are exactly the nodes in (its index, end)
+ */
+struct FlatHtmlNode {
+    std::string_view tag;          // Lower case; empty for text nodes
+    std::string_view text;         // Raw source text of a text node
+    uint32_t parent = 0;
+    uint32_t end = 0;              // One past the node's last descendant
+    uint32_t attributes_begin = 0;
+    uint32_t attributes_end = 0;
+    
+    bool is_text() const { return tag.empty(); }
+};
+
+/**
+ * HTML document parsed into flat arrays: nodes link to each other by index and
+ * refer to the source through string_views, so a parse makes no per-node
+ * allocations and the whole document is released (or reused after clear) at
+ * once. The source HTML must outlive the document
+ */
+class FlatHtmlDocument {
 public:
-    explicit HtmlParser(const std::string& html) : html_(html) {}
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+    
+    uint32_t root() const { return 0; }
+    size_t size() const { return nodes_.size(); }
+    bool empty() const { return nodes_.empty(); }
+    const FlatHtmlNode& node(uint32_t id) const { return nodes_[id]; }
+    std::string_view source() const { return source_; }
+    
+    // Children in order: first_child, then next_sibling until NO_NODE
+    uint32_t first_child(uint32_t id) const { return id + 1 < nodes_[id].end ? id + 1 : NO_NODE; }
+    uint32_t next_sibling(uint32_t id) const {
+        uint32_t parent = nodes_[id].parent;
+        return id != root() && nodes_[id].end < nodes_[parent].end ? nodes_[id].end : NO_NODE;
+    }
+    
+    // Empty view when the attribute is missing
+    std::string_view attribute(uint32_t id, std::string_view name) const;
+    bool has_attribute(uint32_t id, std::string_view name) const;
+    bool has_class(uint32_t id, std::string_view class_name) const;
+    bool has_id(uint32_t id, std::string_view id_value) const;
+    
+    // Concatenated text of the node's descendant text nodes
+    std::string text_content(uint32_t id) const;
+    
+    // Title, language, charset and meta tags seen during the parse
+    const HtmlMetadata& metadata() const { return metadata_; }
     
+    // Drops every node but keeps the arrays' capacity for the next parse
+    void clear();
+    
+private:
+    friend class HtmlParser;
+    
+    std::string_view source_;
+    std::vector<FlatHtmlNode> nodes_;
+    std::vector<FlatHtmlAttribute> attributes_;
+    std::deque<std::string> lowered_names_;    // Tag and attribute names not lower case in the source
+    std::vector<uint32_t> open_elements_;      // Parse stack
+    HtmlMetadata metadata_;
+};
+
+/**
+ * Simple HTML parser for text extraction
+ */
+class HtmlParser {
+private:
+    std::string html_;
+    size_t max_depth_;
+    HtmlMetadata metadata_;
+    
+public:
+    static constexpr size_t DEFAULT_MAX_DEPTH = 256;
+    
+    explicit HtmlParser(const std::string& html, size_t max_depth = DEFAULT_MAX_DEPTH)
+        : html_(html), max_depth_(max_depth) {}
+    
+    // Builds the element tree in one pass over HtmlTokenizer tokens with an
+    // explicit stack of open elements, so time is linear and no recursion
+    // happens however the page nests. An end tag closes the innermost open
+    // element of its name (stray ones are ignored), HTML5's implied end tags
+    // close open <p>, <li>, <dd>/<dt>, table cells, rows and sections, and
+    // void and self-closing elements take no children. Elements deeper than
+    // max_depth are dropped, their text going to the deepest element kept;
+    // their end tags close only them, never a kept element of the same name.
+    // An element's text is its text nodes concatenated, each without leading
+    // whitespace
     std::shared_ptr<HtmlElement> parse();
     
-    // Static utility methods
+    // Title, language, charset and meta tags seen by the last parse()
+    const HtmlMetadata& metadata() const { return metadata_; }
+    
+    // Parses into a flat document without copying the source. Comments,
+    // doctypes and processing instructions are dropped, script and style
+    // content becomes one text node, and nesting follows the rules of parse()
+    static void parse_flat(std::string_view html, FlatHtmlDocument& document,
+                           size_t max_depth = DEFAULT_MAX_DEPTH);
+    
+    // Static utility methods; each is one tokenizer pass over the source
+    // (HtmlMetadata has the same fields straight from a parse)
     static std::string extract_title(const std::string& html);
     static std::string extract_meta_content(const std::string& html, const std::string& name);
     static std::vector<std::string> extract_meta_tags(const std::string& html);
@@ -157,6 +323,13 @@ public:
     bool is_navigation_element(const std::shared_ptr<HtmlElement>& element) const;
     bool is_advertisement_element(const std::shared_ptr<HtmlElement>& element) const;
     bool is_content_element(const std::shared_ptr<HtmlElement>& element) const;
+    
+    // Flat DOM versions; the content score uses the node's direct text
+    double calculate_content_score(const FlatHtmlDocument& document, uint32_t node) const;
+    bool is_boilerplate_element(const FlatHtmlDocument& document, uint32_t node) const;
+    
+    // Streaming version: judges a start tag by its name, class and id
+    bool is_boilerplate_element(const HtmlToken& start_tag) const;
 
 private:
     TextExtractionConfig config_;
@@ -165,16 +338,113 @@ private:
     std::unordered_set<std::string> boilerplate_tags_;
     std::unordered_set<std::string> boilerplate_classes_;
     std::unordered_set<std::string> boilerplate_ids_;
-    std::vector<std::regex> boilerplate_patterns_;
     
     void initialize_patterns();
     
+    // Shared by the tree and flat DOM predicates
+    bool boilerplate_match(std::string_view tag, std::string_view class_attr, std::string_view id_attr) const;
+    bool navigation_match(std::string_view tag, std::string_view class_attr, std::string_view id_attr) const;
+    bool advertisement_match(std::string_view class_attr, std::string_view id_attr) const;
+    bool content_match(std::string_view tag, std::string_view class_attr) const;
+    double content_score(std::string_view tag, std::string_view class_attr, std::string_view id_attr,
+                         size_t text_length, size_t link_count) const;
+    
 public:
     explicit BoilerplateRemover(const TextExtractionConfig& config = TextExtractionConfig{});
     
     std::shared_ptr<HtmlElement> remove_boilerplate(std::shared_ptr<HtmlElement> root) const;
     std::vector<std::shared_ptr<HtmlElement>> find_main_content(const std::shared_ptr<HtmlElement>& root) const;
     double calculate_text_density(const std::shared_ptr<HtmlElement>& element) const;
+    
+    /**
+     * Flat DOM: instead of erasing nodes, marks every node inside a
+     * boilerplate subtree. Main content candidates are the unmarked elements,
+     * best first; each text-bearing element adds its score to itself and its
+     * parent and half of it to its grandparent, so the container of the most
+     * content ranks above any single paragraph
+     */
+    std::vector<bool> boilerplate_mask(const FlatHtmlDocument& document) const;
+    std::vector<uint32_t> find_main_content(const FlatHtmlDocument& document, const std::vector<bool>& removed) const;
+    double calculate_text_density(const FlatHtmlDocument& document, uint32_t node) const;
+};
+
+/**
+ * Features of one text block: the text a block-level element holds outside
+ * its nested blocks. Tag path and class features cover the block and its
+ * ancestors; class and id values are split into tokens, so "header" is not
+ * read as "ad"
+ */
+struct BlockFeatures {
+    enum Index {
+        LOG_TEXT_LENGTH,        // log(1 + non-space bytes)
+        LINK_RATIO,             // Share of those bytes inside <a>
+        STOPWORD_DENSITY,       // Share of words that are stopwords (bundled list, several European languages)
+        BOILERPLATE_WORDS,      // Share of words like "cookie", "copyright", "subscribe"
+        ENDS_SENTENCE,          // 1 when the text ends in '.', '!' or '?'
+        IN_NAV,                 // Tag path: <nav> or <menu>
+        IN_HEADER_FOOTER,
+        IN_ASIDE,
+        IN_LIST,
+        IN_TABLE,
+        IN_FORM,
+        IN_ARTICLE,             // <article> or <main>
+        IS_HEADING,             // The block itself is <h1>-<h6>
+        IS_PARAGRAPH,           // The block itself is <p>, <blockquote> or <pre>
+        BOILERPLATE_CLASSES,    // Class and id tokens such as nav, footer, share, comments (capped count)
+        AD_CLASSES,             // ad, ads, sponsor, promo, banner, ... (capped count)
+        CONTENT_CLASSES,        // content, article, post, entry, ... (capped count)
+        COUNT
+    };
+    
+    uint32_t node = 0;          // The block element in its FlatHtmlDocument
+    float values[COUNT] = {};
+};
+
+/**
+ * Logistic model over BlockFeatures: a block is content when
+ * sigmoid(bias + weights . features) reaches threshold
+ */
+struct BoilerplateModel {
+    float bias = 0.0f;
+    float weights[BlockFeatures::COUNT] = {};
+    float threshold = 0.5f;
+    
+    double probability(const BlockFeatures& block) const;
+    
+    // Hand-tuned default in the spirit of jusText: long, stopword-rich,
+    // link-poor blocks are content; navigation, header, footer and sidebar
+    // paths and boilerplate class names count against a block
+    static const BoilerplateModel& bundled();
+};
+
+/**
+ * Block-level boilerplate classification over a FlatHtmlDocument. Features
+ * for every block come from one forward pass over the nodes (parents come
+ * before children, so path and class context is inherited by index) and the
+ * removal mask from one backward pass, so the cost is linear in the document
+ * and no subtree is walked twice
+ */
+class BlockClassifier {
+public:
+    explicit BlockClassifier(const BoilerplateModel& model = BoilerplateModel::bundled()) : model_(model) {}
+    
+    // Features of every block holding text, in document order
+    void compute_features(const FlatHtmlDocument& document, std::vector<BlockFeatures>& blocks) const;
+    
+    // Mask for TextExtractor's flat DOM walks: script, style and other
+    // non-content subtrees, and the text of every block scored as
+    // boilerplate. A boilerplate block is skipped whole unless a content
+    // block is nested in it
+    std::vector<bool> boilerplate_mask(const FlatHtmlDocument& document) const;
+    
+    const BoilerplateModel& model() const { return model_; }
+    
+private:
+    BoilerplateModel model_;
+    
+    // Also fills, per node, the block element whose text it belongs to
+    void compute_features(const FlatHtmlDocument& document, std::vector<BlockFeatures>& blocks,
+                          std::vector<uint32_t>& owners) const;
 };
 
 /**
@@ -184,12 +454,13 @@ class TextCleaner {
 private:
     TextExtractionConfig config_;
     
-    // Cleaning patterns
-    std::vector<std::pair<std::regex, std::string>> cleaning_patterns_;
-    std::unordered_map<std::string, std::string> html_entities_;
-    
-    void initialize_patterns();
-    void initialize_html_entities();
+    /**
+     * One scan into a buffer reserved up front: whitespace runs become one
+     * space and are trimmed from both ends, and every '<' ... '>' span is
+     * removed (a '<' with no later '>' is kept). Spaces on both sides of a
+     * removed tag stay; trim_lines drops any this leaves at either end
+     */
+    std::string collapse_and_strip_tags(const std::string& text) const;
     
 public:
     explicit TextCleaner(const TextExtractionConfig& config = TextExtractionConfig{});
@@ -208,14 +479,26 @@ public:
 class TextExtractor {
 private:
     TextExtractionConfig config_;
-    std::unique_ptr<HtmlParser> parser_;
     std::unique_ptr<BoilerplateRemover> boilerplate_remover_;
+    std::unique_ptr<BlockClassifier> block_classifier_;
     std::unique_ptr<TextCleaner> text_cleaner_;
     
     // Helper methods
     std::string extract_text_from_element(const std::shared_ptr<HtmlElement>& element) const;
     std::vector<std::string> extract_headings(const std::shared_ptr<HtmlElement>& element) const;
     std::vector<std::string> extract_links(const std::shared_ptr<HtmlElement>& element) const;
+    
+    // Flat DOM versions; subtrees marked in removed are skipped
+    std::string extract_text_from_node(const FlatHtmlDocument& document, uint32_t node,
+                                       const std::vector<bool>& removed) const;
+    std::vector<std::string> extract_headings(const FlatHtmlDocument& document, uint32_t node,
+                                              const std::vector<bool>& removed) const;
+    std::vector<std::string> extract_links(const FlatHtmlDocument& document, uint32_t node,
+                                           const std::vector<bool>& removed) const;
+    
+    // Entity decoding and Unicode fixes for one block of streamed text
+    std::string clean_block(const std::string& block) const;
+    void apply_metadata(const HtmlMetadata& metadata, TextExtractionResult& result) const;
     void calculate_quality_metrics(TextExtractionResult& result) const;
     
 public:
@@ -235,6 +518,21 @@ public:
      */
     TextExtractionResult extract(const std::string& html, const std::string& url = "") const;
     
+    /**
+     * Extract text in one pass over the tokens, without building a DOM.
+     * Keeps a stack of open tags only: script, style, head and boilerplate
+     * subtrees are skipped as they stream by, and text is gathered per block
+     * element, whose link share decides whether it is kept. Used by extract
+     * when streaming_extraction is set
+     */
+    TextExtractionResult extract_streaming(const std::string& html, const std::string& url = "") const;
+    
+    /**
+     * Wrap text that is already extracted, such as a WET conversion record,
+     * as a result: the text is kept as is and scored like extracted HTML
+     */
+    TextExtractionResult from_text(const std::string& text, const std::string& url = "") const;
+    
     /**
      * Extract text from multiple HTML documents
      */
@@ -244,7 +542,9 @@ public:
     ) const;
     
     /**
-     * Extract text with progress callback
+     * Extract text with progress callback. Documents are extracted in
+     * parallel, largest first, and results come back in input order; the
+     * callback sees the number of documents finished so far
      */
     std::vector<TextExtractionResult> extract_batch(
         const std::vector<std::string>& html_documents,
@@ -284,11 +584,47 @@ namespace extraction_utils {
     ContentType detect_content_type(const std::string& content);
     
     /**
-     * Encoding detection and conversion
+     * Encoding detection and conversion. Legacy charsets are decoded through
+     * lookup tables: windows-125x, ISO-8859-x, KOI8, Shift_JIS (cp932) and
+     * GBK (GB18030 four-byte sequences become U+FFFD), plus UTF-16 with a BOM
      */
     std::string detect_encoding(const std::string& content);
+    
+    // Only "utf-8" is supported as a target; throws std::runtime_error for
+    // unknown labels
     std::string convert_encoding(const std::string& content, const std::string& from, const std::string& to);
     
+    // SIMD (AVX2) where available: rejects overlongs, surrogates, code points
+    // past U+10FFFF and truncated sequences
+    bool is_valid_utf8(const char* data, size_t length);
+    inline bool is_valid_utf8(std::string_view text) { return is_valid_utf8(text.data(), text.size()); }
+    
+    // Charset from a BOM, an XML declaration or a charset= inside a tag in the
+    // first 4 KB, lower-cased; empty if nothing is declared
+    std::string sniff_charset(std::string_view content);
+    
+    // Decodes a document into UTF-8 in out, using the declared charset or
+    // else default_encoding. Returns false, leaving out untouched, when the
+    // content is already valid UTF-8 without a BOM, so the common case costs
+    // one validation pass and no copy. Valid UTF-8 is kept even under a
+    // legacy label; invalid bytes in UTF-8 are read as windows-1252
+    bool transcode_to_utf8(const std::string& content, std::string& out,
+                           const std::string& default_encoding = "utf-8");
+    
+    // Single pass over UTF-8 that was decoded as windows-1252 and re-encoded
+    std::string fix_mojibake(const std::string& text);
+    
+    /**
+     * HTML character references: named (the full HTML5 table) and decimal or
+     * hex numeric, decoded in one left-to-right pass into UTF-8. As in HTML5,
+     * the longest known name wins and legacy names need no ';'
+     */
+    std::string decode_html_entities(const std::string& text);
+    
+    // Longest named reference at the start of text (the bytes after '&');
+    // returns its length, zero if none, and its one or two code points
+    size_t match_named_entity(std::string_view text, uint32_t& first, uint32_t& second);
+    
     /**
      * URL and link processing
      */
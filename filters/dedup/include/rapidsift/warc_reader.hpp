@@ -0,0 +1,116 @@
+#pragma once
+
+#include "text_extractor.hpp"
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+namespace rapidsift {
+
+// One WARC record. Views point into the reader's buffer and stay valid until
+// the next call to WarcReader::next
+struct WarcRecord {
+    std::string_view type;              // WARC-Type: warcinfo, request, response, metadata, conversion, ...
+    std::string_view target_uri;        // WARC-Target-URI
+    std::string_view record_id;         // WARC-Record-ID
+    std::string_view content_type;      // Content-Type of the record block
+    uint64_t content_length = 0;
+    std::string_view block;             // The whole record block
+
+    // Response records holding an HTTP message are split into status, headers
+    // and body; for any other record the payload is the whole block
+    int http_status = 0;
+    std::string_view http_content_type;
+    std::string_view payload;
+
+    bool is_response() const { return type == "response"; }
+    // Text a crawler already extracted from a response, as in WET files
+    bool is_conversion() const { return type == "conversion"; }
+    // A 2xx HTTP status; redirects and error pages are not documents
+    bool is_success() const { return http_status >= 200 && http_status < 300; }
+    // A response whose body is declared text/html or application/xhtml+xml
+    bool is_html() const;
+};
+
+// Streaming reader for WARC and WET files, plain or gzip-compressed (one
+// member per record, as Common Crawl writes them, or one stream for the whole
+// file). Decompression and parsing go a buffer at a time and record payloads
+// are never copied, so memory is bounded by the buffer and the largest record
+// kept; records with a block over max_record_bytes are read past without
+// being buffered. Gzip input needs zlib (HAVE_ZLIB). Malformed input throws
+// std::runtime_error.
+class WarcReader {
+public:
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+    static constexpr size_t MAX_HEADER_BYTES = 64 * 1024;
+    static constexpr size_t DEFAULT_MAX_RECORD_BYTES = size_t{64} << 20;
+
+    explicit WarcReader(std::istream& input, size_t max_record_bytes = DEFAULT_MAX_RECORD_BYTES);
+    ~WarcReader();
+
+    WarcReader(const WarcReader&) = delete;
+    WarcReader& operator=(const WarcReader&) = delete;
+
+    // Fills record with the next record; false at the end of the input
+    bool next(WarcRecord& record);
+
+    bool is_compressed() const { return compressed_; }
+    uint64_t bytes_read() const;        // Input bytes consumed, compressed if the input is
+    size_t records_read() const { return records_read_; }
+    size_t records_skipped() const { return records_skipped_; }
+
+private:
+    struct Inflater;
+
+    std::istream& input_;
+    size_t max_record_bytes_;
+    bool compressed_ = false;
+    std::unique_ptr<Inflater> inflater_;
+    std::vector<char> input_buffer_;    // Compressed bytes not yet inflated
+    uint64_t input_consumed_ = 0;
+
+    std::vector<char> buffer_;          // Decompressed bytes [begin_, end_) not yet parsed
+    size_t begin_ = 0;
+    size_t end_ = 0;
+    size_t pending_ = 0;                // Bytes of the record last returned
+    uint64_t offset_ = 0;               // Decompressed offset of begin_, for error messages
+
+    size_t records_read_ = 0;
+    size_t records_skipped_ = 0;
+
+    // Makes at least `needed` bytes available from begin_; false at end of input
+    bool fill(size_t needed);
+    size_t read_decompressed(char* out, size_t capacity);
+    void consume(size_t bytes);
+    void discard(uint64_t bytes);
+
+    [[noreturn]] void fail(const std::string& message) const;
+};
+
+struct WarcExtractionOptions {
+    size_t batch_size = 256;            // Responses handed to TextExtractor::extract_batch at once
+    size_t queue_batches = 4;           // Batches read ahead of extraction; bounds memory
+    size_t max_record_bytes = WarcReader::DEFAULT_MAX_RECORD_BYTES;
+};
+
+struct WarcExtractionStats {
+    size_t records_read = 0;
+    size_t records_skipped = 0;         // Over max_record_bytes
+    size_t documents_extracted = 0;     // 2xx HTML responses and conversion records
+    uint64_t bytes_read = 0;
+};
+
+// End-to-end extraction of a WARC or WET: a reader thread copies each 2xx HTML
+// response body and each conversion record's text into a batch and hands full
+// batches to the calling thread through a bounded queue, which extracts the
+// HTML in parallel; conversion text is passed through as already extracted.
+// visit sees every result in file order, with the record's target URI as its URL
+WarcExtractionStats extract_warc(std::istream& input, const TextExtractor& extractor,
+                                 const std::function<void(const TextExtractionResult&)>& visit,
+                                 const WarcExtractionOptions& options = WarcExtractionOptions{});
+
+} // namespace rapidsift
@@ -0,0 +1,250 @@
+#include "rapidsift/approximate_index.hpp"
+#include "rapidsift/common.hpp"
+#include <algorithm>
+#include <limits>
+#include <random>
+
+namespace rapidsift {
+namespace dedup {
+
+namespace {
+
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+} // anonymous namespace
+
+ApproximateIndex::ApproximateIndex(double threshold, size_t shingle_size, size_t max_window_shingles,
+                                   size_t num_bands, size_t band_rows)
+    : threshold_(std::min(std::max(threshold, 0.0), 1.0)),
+      shingle_size_(std::max<size_t>(shingle_size, 1)),
+      max_window_(std::max<size_t>(max_window_shingles, 1)),
+      num_bands_(std::max<size_t>(num_bands, 1)),
+      band_rows_(std::max<size_t>(band_rows, 1)) {
+
+    // A document window offset by d shingles from a chunk has Jaccard
+    // (W - d) / (W + d); with chunks every s shingles the worst offset is s / 2,
+    // so s <= 2W(1 - t) / (1 + t) keeps every long-item window findable
+    chunk_stride_ = std::max<size_t>(1, static_cast<size_t>(
+        2.0 * max_window_ * (1.0 - threshold_) / (1.0 + threshold_)));
+
+    // Fixed seed: signatures must be comparable across runs and instances
+    std::mt19937_64 gen(0x5EED0DECULL);
+    permutation_a_.resize(num_hashes());
+    permutation_b_.resize(num_hashes());
+    for (size_t i = 0; i < num_hashes(); ++i) {
+        permutation_a_[i] = gen() | 1;
+        permutation_b_[i] = gen();
+    }
+
+    band_tables_.resize(num_bands_);
+}
+
+void ApproximateIndex::clear() {
+    signatures_.clear();
+    entry_datasets_.clear();
+    window_sizes_.clear();
+    for (auto& table : band_tables_) {
+        table.clear();
+    }
+}
+
+size_t ApproximateIndex::memory_bytes() const {
+    // Every entry has one posting per band; each distinct band key costs a
+    // hash node (key, id vector, next pointer) and a bucket slot
+    size_t bytes = signatures_.capacity() * sizeof(uint64_t) + entry_datasets_.capacity() * sizeof(uint32_t) +
+                   entry_datasets_.size() * num_bands_ * sizeof(uint32_t);
+    for (const auto& table : band_tables_) {
+        bytes += table.size() * (sizeof(uint64_t) + sizeof(std::vector<uint32_t>) + sizeof(void*)) +
+                 table.bucket_count() * sizeof(void*);
+    }
+    return bytes;
+}
+
+void ApproximateIndex::add_item(const std::vector<std::string>& tokens, uint32_t dataset_id) {
+    auto shingles = shingle_hashes(tokens);
+    if (shingles.empty()) return;
+
+    if (shingles.size() <= max_window_) {
+        add_entry(shingles.data(), shingles.size(), dataset_id);
+        return;
+    }
+
+    size_t last_start = shingles.size() - max_window_;
+    for (size_t start = 0; start <= last_start; start += chunk_stride_) {
+        add_entry(shingles.data() + start, max_window_, dataset_id);
+    }
+    if (last_start % chunk_stride_ != 0) {
+        add_entry(shingles.data() + last_start, max_window_, dataset_id);
+    }
+}
+
+void ApproximateIndex::add_entry(const uint64_t* shingles, size_t count, uint32_t dataset_id) {
+    uint32_t entry = static_cast<uint32_t>(entry_datasets_.size());
+    size_t offset = signatures_.size();
+    signatures_.resize(offset + num_hashes());
+    sign(shingles, count, signatures_.data() + offset);
+    entry_datasets_.push_back(dataset_id);
+
+    for (size_t band = 0; band < num_bands_; ++band) {
+        band_tables_[band][band_key(signatures_.data() + offset, band, count)].push_back(entry);
+    }
+
+    auto it = std::lower_bound(window_sizes_.begin(), window_sizes_.end(), count);
+    if (it == window_sizes_.end() || *it != count) {
+        window_sizes_.insert(it, count);
+    }
+}
+
+std::vector<ApproximateIndex::Match> ApproximateIndex::find_matches(const std::vector<std::string>& tokens,
+                                                                    size_t max_matches) const {
+    std::vector<Match> hits;
+    if (empty() || max_matches == 0) return hits;
+
+    auto shingles = shingle_hashes(tokens);
+    const size_t n = shingles.size();
+    const size_t k = num_hashes();
+    if (n == 0) return hits;
+
+    // Windows are scanned in chunks of SCAN_CHUNK_SHINGLES start positions,
+    // each chunk loading its shingles plus the overlap the longest window
+    // needs. minima[(level * rows + i) * k + j] is the minimum of h_j over the
+    // 2^level shingles from chunk position i (a sparse table), so any window
+    // length reads its minimum from two overlapping power-of-two spans
+    const size_t longest = window_sizes_.back();
+    size_t levels = 1;
+    while ((size_t{2} << (levels - 1)) <= longest) levels++;
+    const size_t rows = std::min(SCAN_CHUNK_SHINGLES + longest - 1, n);
+    std::vector<uint64_t> minima(levels * rows * k);
+    std::vector<uint64_t> window_signature(k);
+    std::vector<uint32_t> candidates;
+
+    for (size_t base = 0; base < n; base += SCAN_CHUNK_SHINGLES) {
+        const size_t count = std::min(rows, n - base);
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t j = 0; j < k; ++j) {
+                minima[i * k + j] = permutation_a_[j] * shingles[base + i] + permutation_b_[j];
+            }
+        }
+        for (size_t level = 1; level < levels; ++level) {
+            const size_t half = size_t{1} << (level - 1);
+            const uint64_t* below = minima.data() + (level - 1) * rows * k;
+            uint64_t* row = minima.data() + level * rows * k;
+            for (size_t i = 0; i + 2 * half <= count; ++i) {
+                for (size_t j = 0; j < k; ++j) {
+                    row[i * k + j] = std::min(below[i * k + j], below[(i + half) * k + j]);
+                }
+            }
+        }
+
+        for (size_t window : window_sizes_) {
+            if (window > count) break;
+            size_t level = 0;
+            while ((size_t{2} << level) <= window) level++;
+            const uint64_t* row = minima.data() + level * rows * k;
+            const size_t tail = window - (size_t{1} << level);
+            const size_t starts = std::min(SCAN_CHUNK_SHINGLES, count - window + 1);
+
+            for (size_t start = 0; start < starts; ++start) {
+                for (size_t j = 0; j < k; ++j) {
+                    window_signature[j] = std::min(row[start * k + j], row[(start + tail) * k + j]);
+                }
+
+                candidates.clear();
+                for (size_t band = 0; band < num_bands_; ++band) {
+                    auto it = band_tables_[band].find(band_key(window_signature.data(), band, window));
+                    if (it != band_tables_[band].end()) {
+                        candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+                    }
+                }
+                if (candidates.empty()) continue;
+                std::sort(candidates.begin(), candidates.end());
+                candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+                double best = 0.0;
+                uint32_t best_entry = 0;
+                for (uint32_t entry : candidates) {
+                    const uint64_t* signature = signatures_.data() + static_cast<size_t>(entry) * k;
+                    size_t agree = 0;
+                    for (size_t j = 0; j < k; ++j) {
+                        agree += signature[j] == window_signature[j];
+                    }
+                    double similarity = static_cast<double>(agree) / k;
+                    if (similarity > best) {
+                        best = similarity;
+                        best_entry = entry;
+                    }
+                }
+
+                if (best >= threshold_) {
+                    hits.push_back({base + start, window + shingle_size_ - 1, entry_datasets_[best_entry], best});
+                }
+            }
+        }
+    }
+
+    // Merge overlapping windows into regions, keeping the best window's source
+    std::sort(hits.begin(), hits.end(), [](const Match& a, const Match& b) { return a.start < b.start; });
+    std::vector<Match> regions;
+    for (const auto& hit : hits) {
+        if (!regions.empty() && hit.start < regions.back().start + regions.back().length) {
+            Match& region = regions.back();
+            region.length = std::max(region.start + region.length, hit.start + hit.length) - region.start;
+            if (hit.similarity > region.similarity) {
+                region.similarity = hit.similarity;
+                region.dataset_id = hit.dataset_id;
+            }
+        } else {
+            if (regions.size() >= max_matches) break;
+            regions.push_back(hit);
+        }
+    }
+
+    return regions;
+}
+
+std::vector<uint64_t> ApproximateIndex::shingle_hashes(const std::vector<std::string>& tokens) const {
+    std::vector<uint64_t> shingles;
+    if (tokens.size() < shingle_size_) return shingles;
+
+    std::vector<uint64_t> token_hashes(tokens.size());
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        token_hashes[i] = hash_utils::hash128(tokens[i]).low;
+    }
+
+    shingles.resize(tokens.size() - shingle_size_ + 1);
+    for (size_t i = 0; i < shingles.size(); ++i) {
+        uint64_t h = 0x9E3779B97F4A7C15ULL;
+        for (size_t j = 0; j < shingle_size_; ++j) {
+            h = mix64(h ^ token_hashes[i + j]);
+        }
+        shingles[i] = h;
+    }
+    return shingles;
+}
+
+void ApproximateIndex::sign(const uint64_t* shingles, size_t count, uint64_t* signature) const {
+    std::fill(signature, signature + num_hashes(), std::numeric_limits<uint64_t>::max());
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t j = 0; j < num_hashes(); ++j) {
+            signature[j] = std::min(signature[j], permutation_a_[j] * shingles[i] + permutation_b_[j]);
+        }
+    }
+}
+
+uint64_t ApproximateIndex::band_key(const uint64_t* signature, size_t band, size_t window) const {
+    uint64_t h = mix64(static_cast<uint64_t>(window) * 0x9E3779B97F4A7C15ULL + band);
+    for (size_t r = 0; r < band_rows_; ++r) {
+        h = mix64(h ^ signature[band * band_rows_ + r]);
+    }
+    return h;
+}
+
+} // namespace dedup
+} // namespace rapidsift
@@ -0,0 +1,253 @@
+#include "rapidsift/benchmark_reader.hpp"
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+namespace rapidsift {
+namespace dedup {
+
+JsonFieldReader::JsonFieldReader(std::istream& input, const std::vector<std::string>& fields)
+    : input_(input), buffer_(BUFFER_SIZE) {
+    for (const auto& field : fields) {
+        std::vector<std::string> path;
+        size_t start = 0;
+        while (true) {
+            size_t dot = field.find('.', start);
+            path.push_back(field.substr(start, dot == std::string::npos ? std::string::npos : dot - start));
+            if (dot == std::string::npos) break;
+            start = dot + 1;
+        }
+        fields_.push_back(std::move(path));
+    }
+}
+
+size_t JsonFieldReader::read(const std::function<void(const std::string&)>& visit) {
+    visited_ = 0;
+    skip_whitespace();
+    while (peek() != EOF) {
+        parse_value(0, visit);
+        skip_whitespace();
+    }
+    return visited_;
+}
+
+bool JsonFieldReader::fill() {
+    consumed_ += length_;
+    position_ = 0;
+    length_ = 0;
+    if (!input_) return false;
+    input_.read(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    length_ = static_cast<size_t>(input_.gcount());
+    return length_ > 0;
+}
+
+int JsonFieldReader::peek() {
+    if (position_ == length_ && !fill()) return EOF;
+    return static_cast<unsigned char>(buffer_[position_]);
+}
+
+int JsonFieldReader::get() {
+    if (position_ == length_ && !fill()) return EOF;
+    return static_cast<unsigned char>(buffer_[position_++]);
+}
+
+void JsonFieldReader::expect(char c) {
+    if (get() != static_cast<unsigned char>(c)) {
+        fail(std::string("expected '") + c + "'");
+    }
+}
+
+void JsonFieldReader::skip_whitespace() {
+    for (int c = peek(); c == ' ' || c == '\n' || c == '\r' || c == '\t'; c = peek()) {
+        position_++;
+    }
+}
+
+void JsonFieldReader::parse_value(size_t depth, const std::function<void(const std::string&)>& visit) {
+    if (depth > MAX_DEPTH) {
+        fail("nesting deeper than " + std::to_string(MAX_DEPTH));
+    }
+
+    skip_whitespace();
+    switch (peek()) {
+        case '{':
+            parse_object(depth + 1, visit);
+            break;
+        case '[':
+            parse_array(depth + 1, visit);
+            break;
+        case '"':
+            position_++;
+            if (key_path_selected()) {
+                value_.clear();
+                parse_string(&value_);
+                visited_++;
+                visit(value_);
+            } else {
+                parse_string(nullptr);
+            }
+            break;
+        case EOF:
+            fail("unexpected end of input");
+        default:
+            skip_scalar();
+            break;
+    }
+}
+
+void JsonFieldReader::parse_object(size_t depth, const std::function<void(const std::string&)>& visit) {
+    expect('{');
+    skip_whitespace();
+    if (peek() == '}') {
+        position_++;
+        return;
+    }
+
+    key_path_.emplace_back();
+    while (true) {
+        skip_whitespace();
+        expect('"');
+        key_path_.back().clear();
+        parse_string(&key_path_.back());
+        skip_whitespace();
+        expect(':');
+        parse_value(depth, visit);
+        skip_whitespace();
+
+        int c = get();
+        if (c == '}') break;
+        if (c != ',') fail("expected ',' or '}'");
+    }
+    key_path_.pop_back();
+}
+
+void JsonFieldReader::parse_array(size_t depth, const std::function<void(const std::string&)>& visit) {
+    expect('[');
+    skip_whitespace();
+    if (peek() == ']') {
+        position_++;
+        return;
+    }
+
+    while (true) {
+        parse_value(depth, visit);
+        skip_whitespace();
+
+        int c = get();
+        if (c == ']') break;
+        if (c != ',') fail("expected ',' or ']'");
+    }
+}
+
+void JsonFieldReader::parse_string(std::string* out) {
+    // The opening quote has been consumed
+    while (true) {
+        if (position_ == length_ && !fill()) {
+            fail("unterminated string");
+        }
+
+        // Copy (or skip) the run up to the next quote or escape in one step
+        const char* begin = buffer_.data() + position_;
+        const char* end = buffer_.data() + length_;
+        const char* stop = begin;
+        while (stop != end && *stop != '"' && *stop != '\\') ++stop;
+        if (out) out->append(begin, stop);
+        position_ += static_cast<size_t>(stop - begin);
+        if (stop == end) continue;
+
+        position_++;
+        if (*stop == '"') return;
+
+        int escaped = get();
+        char decoded;
+        switch (escaped) {
+            case '"': decoded = '"'; break;
+            case '\\': decoded = '\\'; break;
+            case '/': decoded = '/'; break;
+            case 'b': decoded = '\b'; break;
+            case 'f': decoded = '\f'; break;
+            case 'n': decoded = '\n'; break;
+            case 'r': decoded = '\r'; break;
+            case 't': decoded = '\t'; break;
+            case 'u': {
+                uint32_t code_point = parse_hex4();
+                if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+                    // A high surrogate must be followed by an escaped low surrogate
+                    expect('\\');
+                    expect('u');
+                    uint32_t low = parse_hex4();
+                    if (low < 0xDC00 || low > 0xDFFF) fail("invalid surrogate pair");
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                } else if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+                    fail("unpaired low surrogate");
+                }
+                if (out) append_utf8(*out, code_point);
+                continue;
+            }
+            default:
+                fail("invalid escape sequence");
+        }
+        if (out) *out += decoded;
+    }
+}
+
+void JsonFieldReader::skip_scalar() {
+    // Numbers, true, false and null carry no benchmark text
+    bool any = false;
+    for (int c = peek(); c != EOF; c = peek()) {
+        bool scalar_char = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' ||
+                           c == 'E';
+        if (!scalar_char) break;
+        position_++;
+        any = true;
+    }
+    if (!any) fail("unexpected character");
+}
+
+uint32_t JsonFieldReader::parse_hex4() {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        int c = get();
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= static_cast<uint32_t>(c - '0');
+        else if (c >= 'a' && c <= 'f') value |= static_cast<uint32_t>(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') value |= static_cast<uint32_t>(c - 'A' + 10);
+        else fail("invalid \\u escape");
+    }
+    return value;
+}
+
+void JsonFieldReader::append_utf8(std::string& out, uint32_t code_point) {
+    if (code_point < 0x80) {
+        out += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        out += static_cast<char>(0xC0 | (code_point >> 6));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        out += static_cast<char>(0xE0 | (code_point >> 12));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code_point >> 18));
+        out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+bool JsonFieldReader::key_path_selected() const {
+    for (const auto& field : fields_) {
+        if (field.size() > key_path_.size()) continue;
+        if (std::equal(field.begin(), field.end(), key_path_.end() - static_cast<std::ptrdiff_t>(field.size()))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void JsonFieldReader::fail(const std::string& message) const {
+    throw std::runtime_error("Malformed JSON at byte " + std::to_string(bytes_read()) + ": " + message);
+}
+
+} // namespace dedup
+} // namespace rapidsift
@@ -5,95 +5,193 @@
 #include <algorithm>
 #include <regex>
 #include <chrono>
-#include <random>
 #include <filesystem>
 #include <cmath>
+#include <cstring>
+#include <cctype>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
 
 namespace rapidsift {
 namespace dedup {
 
 // NGramBloomFilter Implementation
-NGramBloomFilter::NGramBloomFilter(size_t expected_elements, double false_positive_rate) {
-    // Calculate optimal bloom filter size
-    double ln2 = std::log(2.0);
-    size_t optimal_size = static_cast<size_t>(
-        -expected_elements * std::log(false_positive_rate) / (ln2 * ln2));
+NGramBloomFilter::NGramBloomFilter(size_t expected_elements, double false_positive_rate)
+    : expected_elements_(std::max<size_t>(expected_elements, 1)) {
+    false_positive_rate = std::min(std::max(false_positive_rate, 1e-9), 0.5);
     
-    bit_array_.resize(optimal_size, false);
+    // Start from the classic (unblocked) optimum, then grow until the blocked
+    // layout - which loses a little to uneven block load - meets the target
+    double ln2 = std::log(2.0);
+    double bits = -static_cast<double>(expected_elements_) * std::log(false_positive_rate) / (ln2 * ln2);
+    size_t num_blocks = std::max<size_t>(1, static_cast<size_t>(std::ceil(bits / BLOCK_BITS)));
     
-    // Calculate optimal number of hash functions
-    num_hash_functions_ = std::max(1, static_cast<int>(
-        (static_cast<double>(optimal_size) / expected_elements) * ln2));
-    num_hash_functions_ = std::min(num_hash_functions_, size_t(8));  // Cap at 8
+    size_t best_k = 1;
+    for (int attempt = 0; attempt < 64; ++attempt) {
+        double best_fpr = 1.0;
+        for (size_t k = 1; k <= MAX_HASH_FUNCTIONS; ++k) {
+            double fpr = blocked_false_positive_rate(num_blocks, expected_elements_, k);
+            if (fpr < best_fpr) {
+                best_fpr = fpr;
+                best_k = k;
+            }
+        }
+        if (best_fpr <= false_positive_rate) break;
+        num_blocks += std::max<size_t>(1, num_blocks / 20);
+    }
     
-    // Initialize hash function seeds
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    for (size_t i = 0; i < num_hash_functions_; ++i) {
-        hash_function_seeds_[i] = gen();
+    num_hash_functions_ = best_k;
+    storage_.assign(num_blocks, Block{});
+    blocks_ = storage_.data();
+    num_blocks_ = num_blocks;
+}
+
+NGramBloomFilter::NGramBloomFilter(const void* blocks, size_t num_blocks, size_t num_hash_functions,
+                                   size_t expected_elements)
+    : blocks_(static_cast<const Block*>(blocks)), num_blocks_(num_blocks),
+      num_hash_functions_(num_hash_functions), expected_elements_(expected_elements) {
+    if (num_blocks_ == 0 || num_hash_functions_ == 0 || num_hash_functions_ > MAX_HASH_FUNCTIONS ||
+        reinterpret_cast<uintptr_t>(blocks) % alignof(Block) != 0) {
+        throw std::runtime_error("Invalid serialized bloom filter");
     }
 }
 
-void NGramBloomFilter::add(const std::string& ngram) {
-    auto hashes = hash(ngram);
-    for (size_t i = 0; i < num_hash_functions_; ++i) {
-        bit_array_[hashes[i] % bit_array_.size()] = true;
+double NGramBloomFilter::blocked_false_positive_rate(size_t num_blocks, size_t num_elements, 
+                                                     size_t num_hash_functions) {
+    if (num_blocks == 0) return 1.0;
+    if (num_elements == 0) return 0.0;
+    
+    // Keys per block follow Poisson(lambda); each block behaves as a small
+    // standard Bloom filter of BLOCK_BITS bits holding c keys
+    double lambda = static_cast<double>(num_elements) / num_blocks;
+    double k = static_cast<double>(num_hash_functions);
+    double miss_per_bit = std::log1p(-1.0 / BLOCK_BITS);
+    
+    size_t max_c = static_cast<size_t>(lambda + 12.0 * std::sqrt(lambda) + 32.0);
+    double log_p = -lambda;  // log P(c = 0)
+    double fpr = 0.0;
+    for (size_t c = 0; c <= max_c; ++c) {
+        if (c > 0) log_p += std::log(lambda) - std::log(static_cast<double>(c));
+        double bit_set = 1.0 - std::exp(k * c * miss_per_bit);
+        fpr += std::exp(log_p) * std::pow(bit_set, k);
     }
+    return std::min(fpr, 1.0);
 }
 
-bool NGramBloomFilter::might_contain(const std::string& ngram) const {
-    auto hashes = hash(ngram);
+double NGramBloomFilter::get_expected_false_positive_rate() const {
+    return blocked_false_positive_rate(num_blocks_, expected_elements_, num_hash_functions_);
+}
+
+size_t NGramBloomFilter::block_index(const Hash128& hash) const {
+    // Multiply-shift range reduction avoids a division on the hot path
+    return static_cast<size_t>((static_cast<unsigned __int128>(hash.low) * num_blocks_) >> 64);
+}
+
+void NGramBloomFilter::make_block_mask(const Hash128& hash, uint64_t mask[BLOCK_BITS / 64]) const {
+    // Probes come from the high half (the low half picked the block). Each
+    // probe takes the top bits of a multiplicatively re-mixed state; plain
+    // double hashing within a 512-bit block correlates the probes enough to
+    // miss the configured false positive rate by ~50%
+    constexpr unsigned BLOCK_BIT_SHIFT = 64 - 9;  // log2(BLOCK_BITS) == 9
+    static_assert(BLOCK_BITS == (1u << 9), "BLOCK_BIT_SHIFT assumes 512-bit blocks");
+    uint64_t state = hash.high | 1;
+
+    for (size_t w = 0; w < BLOCK_BITS / 64; ++w) mask[w] = 0;
     for (size_t i = 0; i < num_hash_functions_; ++i) {
-        if (!bit_array_[hashes[i] % bit_array_.size()]) {
-            return false;
-        }
+        uint32_t bit = static_cast<uint32_t>(state >> BLOCK_BIT_SHIFT);
+        mask[bit >> 6] |= uint64_t(1) << (bit & 63);
+        state *= 0x9E3779B97F4A7C15ULL;
     }
-    return true;
 }
 
-void NGramBloomFilter::clear() {
-    std::fill(bit_array_.begin(), bit_array_.end(), false);
+void NGramBloomFilter::add(const std::string& ngram) {
+    add_hash(hash_utils::hash128(ngram));
+}
+
+bool NGramBloomFilter::might_contain(const std::string& ngram) const {
+    return might_contain_hash(hash_utils::hash128(ngram));
 }
 
-std::vector<size_t> NGramBloomFilter::hash(const std::string& item) const {
-    std::vector<size_t> hashes;
-    hashes.reserve(num_hash_functions_);
+void NGramBloomFilter::add_hash(const Hash128& hash) {
+    if (is_view()) {
+        throw std::logic_error("Cannot add to a read-only bloom filter view");
+    }
     
-    for (size_t i = 0; i < num_hash_functions_; ++i) {
-        std::hash<std::string> hasher;
-        size_t hash_value = hasher(item + std::to_string(hash_function_seeds_[i]));
-        hashes.push_back(hash_value);
+    alignas(64) uint64_t mask[BLOCK_BITS / 64];
+    make_block_mask(hash, mask);
+    
+    Block& block = storage_[block_index(hash)];
+    for (size_t w = 0; w < BLOCK_BITS / 64; ++w) {
+        block.words[w] |= mask[w];
     }
+}
+
+bool NGramBloomFilter::might_contain_hash(const Hash128& hash) const {
+    alignas(64) uint64_t mask[BLOCK_BITS / 64];
+    make_block_mask(hash, mask);
     
-    return hashes;
+    const Block& block = blocks_[block_index(hash)];
+#if defined(__AVX2__)
+    const __m256i* b = reinterpret_cast<const __m256i*>(block.words);
+    const __m256i* m = reinterpret_cast<const __m256i*>(mask);
+    // testc(b, m) is true when every bit of m is also set in b
+    return _mm256_testc_si256(_mm256_load_si256(b), _mm256_load_si256(m)) &
+           _mm256_testc_si256(_mm256_load_si256(b + 1), _mm256_load_si256(m + 1));
+#elif defined(__SSE4_1__)
+    const __m128i* b = reinterpret_cast<const __m128i*>(block.words);
+    const __m128i* m = reinterpret_cast<const __m128i*>(mask);
+    return _mm_testc_si128(_mm_load_si128(b), _mm_load_si128(m)) &
+           _mm_testc_si128(_mm_load_si128(b + 1), _mm_load_si128(m + 1)) &
+           _mm_testc_si128(_mm_load_si128(b + 2), _mm_load_si128(m + 2)) &
+           _mm_testc_si128(_mm_load_si128(b + 3), _mm_load_si128(m + 3));
+#else
+    uint64_t missing = 0;
+    for (size_t w = 0; w < BLOCK_BITS / 64; ++w) {
+        missing |= mask[w] & ~block.words[w];
+    }
+    return missing == 0;
+#endif
+}
+
+void NGramBloomFilter::clear() {
+    if (is_view()) {
+        throw std::logic_error("Cannot clear a read-only bloom filter view");
+    }
+    std::fill(storage_.begin(), storage_.end(), Block{});
 }
 
 // DecontaminationFilter Implementation
 DecontaminationFilter::DecontaminationFilter(const DecontaminationConfig& config) 
     : config_(config) {
-    if (config_.use_bloom_filter) {
-        bloom_filter_ = std::make_unique<NGramBloomFilter>(1000000, 0.01);  // 1M elements, 1% FPR
-    }
-    
+    // The bloom filter is sized once the benchmark n-grams are loaded
     if (config_.exclude_common_phrases) {
         load_common_phrases();
     }
+    reset_assessment_cache();
 }
 
 void DecontaminationFilter::set_config(const DecontaminationConfig& config) {
     config_ = config;
     
-    // Reinitialize bloom filter if needed
-    if (config_.use_bloom_filter && !bloom_filter_) {
-        bloom_filter_ = std::make_unique<NGramBloomFilter>(1000000, 0.01);
-        // Repopulate with existing n-grams
-        for (const auto& ngram : benchmark_ngrams_) {
-            bloom_filter_->add(ngram);
-        }
-    }
+    // Rebuild (or drop) the bloom filter to match the new settings
+    rebuild_bloom_filter();
+    reset_assessment_cache();
 }
 
 void DecontaminationFilter::load_benchmark_datasets() {
+    // A prebuilt index replaces re-reading and re-tokenizing every benchmark file
+    if (!config_.index_file.empty() && std::filesystem::exists(config_.index_file)) {
+        load_index(config_.index_file);
+        return;
+    }
+    if (!config_.partitioned_index_dir.empty() && 
+        std::filesystem::exists(PartitionedNGramIndex::manifest_path(config_.partitioned_index_dir))) {
+        load_partitioned_index(config_.partitioned_index_dir);
+        return;
+    }
+    
     std::cout << "Loading benchmark datasets..." << std::endl;
     
     // Load individual files
@@ -101,137 +199,666 @@ void DecontaminationFilter::load_benchmark_datasets() {
         std::string dataset_name = config_.dataset_name_map.count(filename) ? 
                                    config_.dataset_name_map.at(filename) : 
                                    std::filesystem::path(filename).stem().string();
-        load_benchmark_file(filename, dataset_name);
+        index_benchmark_file(filename, dataset_name);
     }
     
     // Load directories
     for (const auto& directory : config_.benchmark_directories) {
-        load_benchmark_directory(directory);
+        index_benchmark_directory(directory);
     }
     
-    std::cout << "Loaded " << benchmark_ngrams_.size() << " benchmark n-grams from " 
+    rebuild_bloom_filter();
+    
+    std::cout << "Loaded " << index_.size() << " benchmark n-grams from " 
               << get_benchmark_datasets().size() << " datasets" << std::endl;
 }
 
 void DecontaminationFilter::load_benchmark_file(const std::string& filename, const std::string& dataset_name) {
+    index_benchmark_file(filename, dataset_name);
+    rebuild_bloom_filter();
+}
+
+void DecontaminationFilter::load_benchmark_directory(const std::string& directory) {
+    index_benchmark_directory(directory);
+    rebuild_bloom_filter();
+}
+
+void DecontaminationFilter::index_benchmark_directory(const std::string& directory) {
+    std::cout << "Loading benchmark directory: " << directory << std::endl;
+    
+    for_each_benchmark_file(directory, [this](const std::string& filename, const std::string& dataset_name) {
+        index_benchmark_file(filename, dataset_name);
+    });
+}
+
+void DecontaminationFilter::for_each_benchmark_file(
+    const std::string& directory, const std::function<void(const std::string&, const std::string&)>& visit) const {
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
+        if (entry.is_regular_file()) {
+            std::string extension = entry.path().extension().string();
+            
+            // Only process text files
+            if (extension == ".txt" || extension == ".json" || extension == ".jsonl" || extension == ".csv") {
+                visit(entry.path().string(), entry.path().stem().string());
+            }
+        }
+    }
+}
+
+void DecontaminationFilter::add_benchmark_ngrams(const std::vector<std::string>& ngrams, const std::string& source) {
+    uint32_t dataset_id = index_.intern_dataset(source);
+    
+    for (const auto& ngram : ngrams) {
+        std::string normalized = normalize_ngram(preprocess_text(ngram));
+        check_memory_budget(normalized.empty() ? 0 : 1);
+        if (!normalized.empty()) {
+            index_benchmark_ngram(normalized, dataset_id);
+        }
+        index_benchmark_text(ngram, dataset_id);
+    }
+    
+    rebuild_bloom_filter();
+}
+
+void DecontaminationFilter::index_benchmark_file(const std::string& filename, const std::string& dataset_name) {
     std::cout << "Loading benchmark file: " << filename << std::endl;
     
-    std::ifstream file(filename);
-    if (!file.is_open()) {
+    if (!std::ifstream(filename).is_open()) {
         std::cerr << "Warning: Cannot open benchmark file: " << filename << std::endl;
         return;
     }
     
-    std::string line;
-    size_t line_count = 0;
+    uint32_t dataset_id = index_.intern_dataset(dataset_name.empty() ? filename : dataset_name);
+    BenchmarkFormat format = benchmark_format(filename);
+    std::string buffer;
+    std::vector<NGramSpan> spans;
+    size_t item_count = 0;
+    bool over_budget = false;
     
-    while (std::getline(file, line)) {
-        if (line.empty() || line[0] == '#') continue;
-        
-        // Extract n-grams from this line
-        auto ngrams = extract_ngrams(line, config_.ngram_size);
+    // Benchmark texts go straight into the index as they are read
+    auto index_item = [&](const std::string& text) {
+        if (over_budget) return;
         
-        for (const auto& ngram : ngrams) {
-            benchmark_ngrams_.insert(ngram);
-            ngram_to_dataset_[ngram] = dataset_name.empty() ? filename : dataset_name;
-            
-            if (bloom_filter_) {
-                bloom_filter_->add(ngram);
-            }
+        // Hash this item's n-grams in place, exactly as documents are scanned;
+        // nothing goes in unless the item fits the memory budget
+        ngram_spans(text, config_.ngram_size, buffer, spans);
+        if (!within_memory_budget(spans.size())) {
+            over_budget = true;
+            return;
         }
+        for (const auto& span : spans) {
+            index_.insert(hash_utils::hash128(buffer.data() + span.offset, span.length), dataset_id);
+        }
+        index_benchmark_text(text, dataset_id);
         
-        line_count++;
-        if (line_count % 1000 == 0) {
-            std::cout << "  Processed " << line_count << " lines from " << filename << std::endl;
+        item_count++;
+        if (item_count % 1000 == 0) {
+            std::cout << "  Processed " << item_count << " items from " << filename << std::endl;
         }
+    };
+    
+    try {
+        decontamination_utils::stream_benchmark_texts(filename, format, index_item);
+    } catch (const std::runtime_error& e) {
+        // Keep what was indexed before the error, as with an unreadable file
+        std::cerr << "Warning: " << filename << ": " << e.what() << std::endl;
+    }
+    if (over_budget) {
+        memory_budget_exceeded();
     }
     
-    std::cout << "Loaded " << line_count << " lines from " << filename << std::endl;
+    std::cout << "Loaded " << item_count << " items from " << filename << std::endl;
+    warn_if_empty(filename, format, item_count);
 }
 
-void DecontaminationFilter::load_benchmark_directory(const std::string& directory) {
-    std::cout << "Loading benchmark directory: " << directory << std::endl;
+BenchmarkFormat DecontaminationFilter::benchmark_format(const std::string& filename) const {
+    auto it = config_.benchmark_format_map.find(filename);
+    return it != config_.benchmark_format_map.end() ? it->second 
+                                                     : decontamination_utils::detect_benchmark_format(filename);
+}
+
+void DecontaminationFilter::warn_if_empty(const std::string& filename, BenchmarkFormat format, size_t items) const {
+    // Usually a layout picked from a misleading file name: the selected
+    // fields never occur, so the benchmark would silently go unchecked
+    if (items == 0) {
+        std::cerr << "Warning: no benchmark items read from " << filename << " as " 
+                  << decontamination_utils::benchmark_format_name(format) 
+                  << "; set benchmark_format_map if the layout is wrong" << std::endl;
+    }
+}
+
+void DecontaminationFilter::index_benchmark_ngram(const std::string& ngram, uint32_t dataset_id) {
+    index_.insert(hash_utils::hash128(ngram), dataset_id);
+}
+
+size_t DecontaminationFilter::benchmark_memory_bytes(size_t pending_ngrams) const {
+    // Everything benchmarks are loaded into, with the n-gram table as it will
+    // be once pending_ngrams more are inserted
+    size_t bytes = index_.memory_bytes_after(pending_ngrams) + overlap_automaton_.memory_bytes();
+    if (approximate_index_) {
+        bytes += approximate_index_->memory_bytes();
+    }
+    return bytes;
+}
+
+bool DecontaminationFilter::within_memory_budget(size_t pending_ngrams) const {
+    return benchmark_memory_bytes(pending_ngrams) <= (config_.max_memory_mb << 20);
+}
+
+void DecontaminationFilter::check_memory_budget(size_t pending_ngrams) const {
+    if (!within_memory_budget(pending_ngrams)) {
+        memory_budget_exceeded();
+    }
+}
+
+void DecontaminationFilter::memory_budget_exceeded() const {
+    throw std::runtime_error("Benchmark index exceeds max_memory_mb (" + 
+                             std::to_string(config_.max_memory_mb) + " MB); build a partitioned index "
+                             "with build_partitioned_index (--index-dir) for reference sets this large");
+}
+
+size_t DecontaminationFilter::build_partitioned_index(const std::string& directory) const {
+    PartitionedIndexBuilder builder(directory, config_.index_partitions, config_.max_memory_mb << 20,
+                                    config_.bloom_filter_false_positive_rate,
+                                    decontamination_utils::index_fingerprint(config_));
+    std::string buffer;
+    std::vector<NGramSpan> spans;
     
-    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
-        if (entry.is_regular_file()) {
-            std::string filename = entry.path().string();
-            std::string extension = entry.path().extension().string();
-            
-            // Only process text files
-            if (extension == ".txt" || extension == ".json" || extension == ".csv") {
-                std::string dataset_name = entry.path().stem().string();
-                load_benchmark_file(filename, dataset_name);
-            }
+    // Same n-gram hashing as index_benchmark_file, streamed to disk instead of memory
+    auto add_file = [&](const std::string& filename, const std::string& dataset_name) {
+        std::cout << "Indexing benchmark file: " << filename << std::endl;
+        uint32_t dataset_id = builder.intern_dataset(dataset_name.empty() ? filename : dataset_name);
+        BenchmarkFormat format = benchmark_format(filename);
+        try {
+            size_t items = decontamination_utils::stream_benchmark_texts(
+                filename, format, [&](const std::string& text) {
+                    ngram_spans(text, config_.ngram_size, buffer, spans);
+                    for (const auto& span : spans) {
+                        builder.add(hash_utils::hash128(buffer.data() + span.offset, span.length), dataset_id);
+                    }
+                });
+            std::cout << "Indexed " << items << " items from " << filename << std::endl;
+            warn_if_empty(filename, format, items);
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Warning: " << filename << ": " << e.what() << std::endl;
         }
+    };
+    
+    for (const auto& filename : config_.benchmark_files) {
+        add_file(filename, config_.dataset_name_map.count(filename) ? 
+                           config_.dataset_name_map.at(filename) : 
+                           std::filesystem::path(filename).stem().string());
+    }
+    for (const auto& benchmark_directory : config_.benchmark_directories) {
+        for_each_benchmark_file(benchmark_directory, add_file);
     }
+    
+    return builder.finish();
 }
 
-DecontaminationAssessment DecontaminationFilter::assess_document(const Document& doc) const {
-    auto start_time = std::chrono::high_resolution_clock::now();
+void DecontaminationFilter::load_partitioned_index(const std::string& directory) {
+    partitioned_index_ = std::make_unique<PartitionedNGramIndex>(
+        directory, config_.max_memory_mb << 20, decontamination_utils::index_fingerprint(config_));
     
-    DecontaminationAssessment assessment;
+    if (assessment_cache_) {
+        assessment_cache_->clear();
+    }
     
-    // Check cache first
-    if (assessment_cache_.count(doc.id)) {
-        return assessment_cache_[doc.id];
+    std::cout << "Opened partitioned index of " << partitioned_index_->size() << " n-grams in " 
+              << partitioned_index_->num_partitions() << " partitions from " 
+              << partitioned_index_->datasets().size() << " datasets (" 
+              << (partitioned_index_->resident_bytes() >> 20) << " MB resident)" << std::endl;
+}
+
+void DecontaminationFilter::index_benchmark_text(const std::string& text, uint32_t dataset_id) {
+    // Whole benchmark items, for the engines that match more than fixed n-grams
+    if (config_.engine != DecontaminationEngine::OVERLAP_AUTOMATON && !config_.check_approximate_matches) {
+        return;
     }
     
-    // Extract n-grams from document
-    auto document_ngrams = extract_ngrams(doc.text, config_.ngram_size);
-    assessment.total_ngrams_checked = document_ngrams.size();
+    auto tokens = overlap_tokens(text);
+    if (config_.engine == DecontaminationEngine::OVERLAP_AUTOMATON) {
+        overlap_automaton_.add_text(tokens, dataset_id);
+    }
+    if (config_.check_approximate_matches) {
+        if (!approximate_index_) {
+            approximate_index_ = std::make_unique<ApproximateIndex>(
+                config_.approximate_match_threshold, config_.approximate_shingle_size,
+                config_.approximate_max_window, config_.approximate_num_bands, config_.approximate_band_rows);
+        }
+        approximate_index_->add_item(tokens, dataset_id);
+    }
+}
+
+void DecontaminationFilter::rebuild_bloom_filter() {
+    if (!config_.use_bloom_filter) {
+        bloom_filter_.reset();
+    } else {
+        // Size for the n-grams actually loaded so the configured FPR holds
+        bloom_filter_ = std::make_unique<NGramBloomFilter>(
+            index_.size(), config_.bloom_filter_false_positive_rate);
+        index_.for_each([this](const Hash128& hash, uint32_t) {
+            bloom_filter_->add_hash(hash);
+        });
+    }
     
-    // Find contaminated n-grams
-    assessment.matches = find_contaminated_ngrams(doc);
-    assessment.contaminated_ngrams = assessment.matches.size();
+    // Adding to a mapped index copies it, after which the mapping is unused
+    if (!index_.is_attached()) {
+        mapped_index_.reset();
+    }
+    
+    // Cached assessments were made against the previous benchmark set
+    if (assessment_cache_) {
+        assessment_cache_->clear();
+    }
+}
+
+void DecontaminationFilter::reset_assessment_cache() {
+    if (config_.assessment_cache_entries == 0) {
+        assessment_cache_.reset();
+        return;
+    }
+    assessment_cache_ = std::make_unique<ShardedClockCache<DecontaminationAssessment>>(
+        config_.assessment_cache_entries, config_.assessment_cache_shards);
+}
+
+namespace {
+
+uint64_t align_section(uint64_t offset) {
+    const uint64_t alignment = IndexFileHeader::SECTION_ALIGNMENT;
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+void write_padding(std::ofstream& file, uint64_t target_offset) {
+    static const char zeros[IndexFileHeader::SECTION_ALIGNMENT] = {};
+    uint64_t position = static_cast<uint64_t>(file.tellp());
+    file.write(zeros, static_cast<std::streamsize>(target_offset - position));
+}
+
+} // anonymous namespace
+
+void DecontaminationFilter::save_index(const std::string& filename) const {
+    // An index saved without a bloom filter gets one built for it, so loading
+    // with use_bloom_filter on never has to rebuild
+    std::unique_ptr<NGramBloomFilter> built_bloom;
+    const NGramBloomFilter* bloom = bloom_filter_.get();
+    if (!bloom) {
+        built_bloom = std::make_unique<NGramBloomFilter>(index_.size(), config_.bloom_filter_false_positive_rate);
+        index_.for_each([&](const Hash128& hash, uint32_t) { built_bloom->add_hash(hash); });
+        bloom = built_bloom.get();
+    }
     
-    // Calculate contamination score
-    assessment.contamination_score = calculate_contamination_score(
-        assessment.matches, assessment.total_ngrams_checked);
+    std::string dataset_blob;
+    for (const auto& name : index_.datasets()) {
+        uint32_t length = static_cast<uint32_t>(name.size());
+        dataset_blob.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        dataset_blob.append(name);
+    }
     
-    // Determine if document is contaminated
-    assessment.is_contaminated = assessment.contamination_score >= config_.contamination_threshold;
+    // An empty table is written as one empty slot so the file always attaches
+    static const Hash128 empty_key{};
+    static const uint32_t empty_id = NGramIndex::NOT_FOUND;
+    const size_t capacity = std::max<size_t>(index_.capacity(), 1);
+    const Hash128* keys = index_.capacity() > 0 ? index_.keys() : &empty_key;
+    const uint32_t* ids = index_.capacity() > 0 ? index_.dataset_ids() : &empty_id;
+    const size_t dataset_sets_size = index_.dataset_sets_size();
     
-    // Find most likely source
-    std::unordered_map<std::string, size_t> source_counts;
-    for (const auto& match : assessment.matches) {
-        source_counts[match.source_dataset]++;
+    IndexFileHeader header = {};
+    std::memcpy(header.magic, IndexFileHeader::MAGIC, sizeof(header.magic));
+    header.version = IndexFileHeader::CURRENT_VERSION;
+    header.endian_marker = IndexFileHeader::ENDIAN_MARKER;
+    header.config_fingerprint = decontamination_utils::index_fingerprint(config_);
+    header.ngram_count = index_.size();
+    header.table_capacity = capacity;
+    header.keys_offset = align_section(sizeof(IndexFileHeader));
+    header.dataset_ids_offset = align_section(header.keys_offset + capacity * sizeof(Hash128));
+    header.dataset_sets_offset = align_section(header.dataset_ids_offset + capacity * sizeof(uint32_t));
+    header.dataset_sets_size = dataset_sets_size;
+    header.bloom_num_blocks = bloom->get_num_blocks();
+    header.bloom_hash_functions = bloom->get_hash_functions();
+    header.bloom_expected_elements = bloom->get_expected_elements();
+    header.bloom_false_positive_rate = config_.bloom_filter_false_positive_rate;
+    header.bloom_offset = align_section(header.dataset_sets_offset + dataset_sets_size * sizeof(uint32_t));
+    header.dataset_count = index_.datasets().size();
+    header.datasets_offset = align_section(header.bloom_offset + bloom->data_size_bytes());
+    header.datasets_size = dataset_blob.size();
+    header.file_size = header.datasets_offset + header.datasets_size;
+    
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not create index file: " + filename);
     }
     
-    if (!source_counts.empty()) {
-        auto max_source = std::max_element(source_counts.begin(), source_counts.end(),
-            [](const auto& a, const auto& b) { return a.second < b.second; });
-        assessment.most_likely_source = max_source->first;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_padding(file, header.keys_offset);
+    file.write(reinterpret_cast<const char*>(keys), static_cast<std::streamsize>(capacity * sizeof(Hash128)));
+    write_padding(file, header.dataset_ids_offset);
+    file.write(reinterpret_cast<const char*>(ids), static_cast<std::streamsize>(capacity * sizeof(uint32_t)));
+    write_padding(file, header.dataset_sets_offset);
+    if (dataset_sets_size > 0) {
+        file.write(reinterpret_cast<const char*>(index_.dataset_sets()),
+                   static_cast<std::streamsize>(dataset_sets_size * sizeof(uint32_t)));
     }
+    write_padding(file, header.bloom_offset);
+    file.write(static_cast<const char*>(bloom->data()), static_cast<std::streamsize>(bloom->data_size_bytes()));
+    write_padding(file, header.datasets_offset);
+    file.write(dataset_blob.data(), static_cast<std::streamsize>(dataset_blob.size()));
     
-    // Cache the result
-    assessment_cache_[doc.id] = assessment;
+    if (!file) {
+        throw std::runtime_error("Failed writing index file: " + filename);
+    }
+}
+
+void DecontaminationFilter::load_index(const std::string& filename) {
+    auto mapped = std::make_unique<io_utils::MappedFile>(filename);
+    const char* base = mapped->data();
     
-    // Update statistics
-    update_stats(assessment);
+    IndexFileHeader header;
+    if (mapped->size() < sizeof(header)) {
+        throw std::runtime_error("Not a decontamination index: " + filename);
+    }
+    std::memcpy(&header, base, sizeof(header));
     
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-    stats_.average_processing_time_ms = 
-        (stats_.average_processing_time_ms * (stats_.total_documents_processed - 1) + duration.count()) / 
-        stats_.total_documents_processed;
+    if (std::memcmp(header.magic, IndexFileHeader::MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("Not a decontamination index: " + filename);
+    }
+    if (header.version != IndexFileHeader::CURRENT_VERSION || header.endian_marker != IndexFileHeader::ENDIAN_MARKER) {
+        throw std::runtime_error("Unsupported decontamination index version in " + filename + 
+                                 "; rebuild it with --mode build-index");
+    }
+    if (header.config_fingerprint != decontamination_utils::index_fingerprint(config_)) {
+        throw std::runtime_error("Stale decontamination index " + filename + 
+                                 ": built with different n-gram settings; rebuild it with --mode build-index");
+    }
     
+    // Counts come from the file, so they are divided into the space left
+    // rather than multiplied out, which could overflow past the check
+    auto section_ok = [&](uint64_t offset, uint64_t count, uint64_t element_size) {
+        return offset % IndexFileHeader::SECTION_ALIGNMENT == 0 && offset <= mapped->size() && 
+               count <= (mapped->size() - offset) / element_size;
+    };
+    if (header.file_size != mapped->size() ||
+        !section_ok(header.keys_offset, header.table_capacity, sizeof(Hash128)) ||
+        !section_ok(header.dataset_ids_offset, header.table_capacity, sizeof(uint32_t)) ||
+        !section_ok(header.dataset_sets_offset, header.dataset_sets_size, sizeof(uint32_t)) ||
+        !section_ok(header.bloom_offset, header.bloom_num_blocks, NGramBloomFilter::BLOCK_BITS / 8) ||
+        !section_ok(header.datasets_offset, header.datasets_size, 1) ||
+        header.dataset_count > header.datasets_size / sizeof(uint32_t) ||
+        header.dataset_count > NGramIndex::MULTI_DATASET) {
+        throw std::runtime_error("Truncated or corrupt decontamination index: " + filename);
+    }
+    
+    std::vector<std::string> datasets;
+    datasets.reserve(header.dataset_count);
+    const char* cursor = base + header.datasets_offset;
+    const char* end = cursor + header.datasets_size;
+    for (uint64_t i = 0; i < header.dataset_count; ++i) {
+        uint32_t length;
+        if (static_cast<size_t>(end - cursor) < sizeof(length)) {
+            throw std::runtime_error("Corrupt dataset table in index: " + filename);
+        }
+        std::memcpy(&length, cursor, sizeof(length));
+        cursor += sizeof(length);
+        if (static_cast<size_t>(end - cursor) < length) {
+            throw std::runtime_error("Corrupt dataset table in index: " + filename);
+        }
+        datasets.emplace_back(cursor, length);
+        cursor += length;
+    }
+    
+    if (assessment_cache_) {
+        assessment_cache_->clear();
+    }
+    
+    // attach checks every attribution against the dataset table and the pool,
+    // and leaves the current index in place when it throws
+    try {
+        index_.attach(reinterpret_cast<const Hash128*>(base + header.keys_offset),
+                      reinterpret_cast<const uint32_t*>(base + header.dataset_ids_offset),
+                      header.table_capacity, header.ngram_count,
+                      reinterpret_cast<const uint32_t*>(base + header.dataset_sets_offset),
+                      header.dataset_sets_size, std::move(datasets));
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error(std::string(e.what()) + ": " + filename);
+    }
+    mapped_index_ = std::move(mapped);
+    
+    // Reuse the stored bloom filter unless the configured FPR has changed
+    if (config_.use_bloom_filter && 
+        header.bloom_false_positive_rate == config_.bloom_filter_false_positive_rate) {
+        bloom_filter_ = std::make_unique<NGramBloomFilter>(
+            mapped_index_->data() + header.bloom_offset, header.bloom_num_blocks,
+            header.bloom_hash_functions, header.bloom_expected_elements);
+    } else {
+        rebuild_bloom_filter();
+    }
+    
+    if (config_.engine == DecontaminationEngine::OVERLAP_AUTOMATON) {
+        std::cerr << "Warning: prebuilt indexes hold n-gram keys only; the overlap engine "
+                  << "needs benchmark texts loaded with load_benchmark_file/add_benchmark_ngrams" << std::endl;
+    }
+    
+    std::cout << "Mapped " << index_.size() << " benchmark n-grams from " 
+              << index_.datasets().size() << " datasets (" << filename << ")" << std::endl;
+}
+
+DecontaminationAssessment DecontaminationFilter::assess_document(const Document& doc) const {
+    DecontaminationStats local_stats;
+    auto assessment = assess_document_impl(doc, local_stats);
+    merge_stats(local_stats);
     return assessment;
 }
 
 std::vector<DecontaminationAssessment> DecontaminationFilter::assess_documents(const std::vector<Document>& docs) const {
-    std::vector<DecontaminationAssessment> assessments;
-    assessments.reserve(docs.size());
+    std::vector<DecontaminationAssessment> assessments(docs.size());
     
-    for (const auto& doc : docs) {
-        assessments.push_back(assess_document(doc));
+    if (partitioned_index_ && config_.engine == DecontaminationEngine::NGRAM_INDEX) {
+        const size_t batch = std::max<size_t>(config_.batch_size, 1);
+        for (size_t first = 0; first < docs.size(); first += batch) {
+            assess_partitioned_batch(docs, first, std::min(docs.size(), first + batch), assessments);
+        }
+        return assessments;
     }
     
+    for_each_document(docs.size(), [&](size_t i, DecontaminationStats& local_stats) {
+        assessments[i] = assess_document_impl(docs[i], local_stats);
+    });
     return assessments;
 }
 
+void DecontaminationFilter::for_each_document(
+    size_t count, const std::function<void(size_t, DecontaminationStats&)>& body) const {
+#ifdef USE_OPENMP
+    if (config_.enable_parallel_processing && count > 1) {
+        // The index is read-only here; each thread accumulates its own stats
+        // and merges them once, so the hot loop shares nothing writable
+        #pragma omp parallel
+        {
+            DecontaminationStats local_stats;
+            
+            #pragma omp for schedule(dynamic, 16) nowait
+            for (size_t i = 0; i < count; ++i) {
+                body(i, local_stats);
+            }
+            
+            merge_stats(local_stats);
+        }
+        return;
+    }
+#endif
+    
+    DecontaminationStats local_stats;
+    for (size_t i = 0; i < count; ++i) {
+        body(i, local_stats);
+    }
+    merge_stats(local_stats);
+}
+
+void DecontaminationFilter::assess_partitioned_batch(const std::vector<Document>& docs, size_t first, size_t last,
+                                                     std::vector<DecontaminationAssessment>& assessments) const {
+    // The n-grams of every document in the batch go to the index as one set of
+    // probes, so each partition's segment is read once per batch, front to
+    // back, rather than once per document
+    struct Pending {
+        Hash128 content_hash;
+        bool cached = false;
+        std::string buffer;
+        std::vector<NGramSpan> spans;
+        std::vector<PartitionedNGramIndex::Probe> probes;
+        size_t probed = 0;
+        double elapsed_ms = 0.0;
+    };
+    const size_t count = last - first;
+    std::vector<Pending> pending(count);
+    
+    for_each_document(count, [&](size_t i, DecontaminationStats& local_stats) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        Pending& state = pending[i];
+        const Document& doc = docs[first + i];
+        state.cached = lookup_cached(doc, state.content_hash, assessments[first + i], local_stats, start_time);
+        if (state.cached) return;
+        
+        ngram_probes(doc.text(), static_cast<uint32_t>(i), state.buffer, state.spans, state.probes);
+        state.probed = state.probes.size();
+        std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - start_time;
+        state.elapsed_ms = duration.count();
+    });
+    
+    auto lookup_start = std::chrono::high_resolution_clock::now();
+    std::vector<PartitionedNGramIndex::Probe> probes;
+    size_t total_probes = 0;
+    for (const auto& state : pending) total_probes += state.probes.size();
+    probes.reserve(total_probes);
+    for (auto& state : pending) {
+        probes.insert(probes.end(), state.probes.begin(), state.probes.end());
+        std::vector<PartitionedNGramIndex::Probe>().swap(state.probes);
+    }
+    std::vector<PartitionedNGramIndex::Hit> hits;
+    partitioned_index_->lookup_batch(probes, hits);
+    
+    // Hits are sorted by document; hit_starts[i] is document i's first
+    std::vector<size_t> hit_starts(count + 1, hits.size());
+    for (size_t h = hits.size(); h-- > 0;) {
+        hit_starts[hits[h].document] = h;
+    }
+    for (size_t i = count; i-- > 0;) {
+        hit_starts[i] = std::min(hit_starts[i], hit_starts[i + 1]);
+    }
+    std::chrono::duration<double, std::milli> lookup_duration = std::chrono::high_resolution_clock::now() - lookup_start;
+    const double lookup_share_ms = lookup_duration.count() / count;
+    
+    for_each_document(count, [&](size_t i, DecontaminationStats& local_stats) {
+        Pending& state = pending[i];
+        if (state.cached) return;
+        
+        auto start_time = std::chrono::high_resolution_clock::now();
+        DecontaminationAssessment& assessment = assessments[first + i];
+        collect_partitioned_matches(state.buffer, state.spans, hits.data() + hit_starts[i],
+                                    hits.data() + hit_starts[i + 1], assessment);
+        set_ngram_verdict(state.spans.size(), state.probed, assessment);
+        finish_assessment(docs[first + i], state.content_hash, assessment, local_stats, start_time,
+                          state.elapsed_ms + lookup_share_ms);
+    });
+}
+
+DecontaminationAssessment DecontaminationFilter::assess_document_impl(const Document& doc, 
+                                                                      DecontaminationStats& local_stats) const {
+    auto start_time = std::chrono::high_resolution_clock::now();
+    
+    DecontaminationAssessment assessment;
+    Hash128 content_hash;
+    if (lookup_cached(doc, content_hash, assessment, local_stats, start_time)) {
+        return assessment;
+    }
+    
+    if (config_.engine == DecontaminationEngine::OVERLAP_AUTOMATON) {
+        match_overlaps(doc.text(), assessment);
+    } else {
+        // Single pass: n-grams are hashed and probed in place, stopping once the verdict is decided
+        match_ngrams(doc.text(), config_.full_report, assessment, local_stats);
+    }
+    
+    finish_assessment(doc, content_hash, assessment, local_stats, start_time, 0.0);
+    return assessment;
+}
+
+bool DecontaminationFilter::lookup_cached(const Document& doc, Hash128& content_hash, 
+                                          DecontaminationAssessment& assessment, DecontaminationStats& local_stats,
+                                          std::chrono::high_resolution_clock::time_point start_time) const {
+    if (!assessment_cache_) return false;
+    
+    // Keyed by content, not id: ids repeat across input files
+    content_hash = hash_utils::hash128(doc.text());
+    if (assessment_cache_->get(content_hash, assessment)) {
+        local_stats.cache_hits++;
+        std::chrono::duration<double, std::milli> duration = 
+            std::chrono::high_resolution_clock::now() - start_time;
+        update_stats(local_stats, assessment, duration.count());
+        return true;
+    }
+    local_stats.cache_misses++;
+    return false;
+}
+
+void DecontaminationFilter::finish_assessment(const Document& doc, const Hash128& content_hash,
+                                              DecontaminationAssessment& assessment, DecontaminationStats& local_stats,
+                                              std::chrono::high_resolution_clock::time_point start_time,
+                                              double earlier_ms) const {
+    // Lightly edited leaks: only worth checking when exact matching found nothing
+    if (!assessment.is_contaminated && approximate_index_ && config_.check_approximate_matches) {
+        match_approximate(doc.text(), assessment);
+    }
+    
+    // Find every contributing dataset and the most likely source; a match
+    // shared by several benchmarks counts toward each of them
+    std::unordered_map<std::string, size_t> source_counts;
+    auto count_source = [&](const std::string& dataset) {
+        if (source_counts[dataset]++ == 0) {
+            assessment.contaminated_datasets.push_back(dataset);
+        }
+    };
+    for (const auto& match : assessment.matches) {
+        count_source(match.source_dataset);
+        for (const auto& dataset : match.other_datasets) {
+            count_source(dataset);
+        }
+    }
+    
+    size_t best_count = 0;
+    for (const auto& dataset : assessment.contaminated_datasets) {
+        if (source_counts[dataset] > best_count) {
+            best_count = source_counts[dataset];
+            assessment.most_likely_source = dataset;
+        }
+    }
+    
+    if (assessment_cache_) {
+        assessment_cache_->put(content_hash, assessment);
+    }
+    
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end_time - start_time;
+    update_stats(local_stats, assessment, earlier_ms + duration.count());
+}
+
 FilterDecision DecontaminationFilter::evaluate(const Document& doc) const {
-    auto assessment = assess_document(doc);
+    return make_decision(assess_document(doc));
+}
+
+std::vector<FilterDecision> DecontaminationFilter::evaluate_batch(const std::vector<Document>& docs) const {
+    auto assessments = assess_documents(docs);
+    
+    std::vector<FilterDecision> decisions;
+    decisions.reserve(assessments.size());
+    
+    for (const auto& assessment : assessments) {
+        decisions.push_back(make_decision(assessment));
+    }
     
+    return decisions;
+}
+
+FilterDecision DecontaminationFilter::make_decision(const DecontaminationAssessment& assessment) const {
     FilterDecision decision;
     decision.filter_name = "DecontaminationFilter";
     decision.confidence = assessment.contamination_score;
@@ -280,42 +907,275 @@ std::vector<std::string> DecontaminationFilter::extract_ngrams(const std::string
 }
 
 std::vector<ContaminationMatch> DecontaminationFilter::find_contaminated_ngrams(const Document& doc) const {
-    std::vector<ContaminationMatch> matches;
-    auto document_ngrams = extract_ngrams(doc.text, config_.ngram_size);
+    DecontaminationStats local_stats;
+    DecontaminationAssessment assessment;
+    match_ngrams(doc.text(), true, assessment, local_stats);
+    merge_stats(local_stats);
+    return std::move(assessment.matches);
+}
+
+void DecontaminationFilter::match_overlaps(const std::string& text, DecontaminationAssessment& assessment) const {
+    auto tokens = overlap_tokens(text);
+    auto overlaps = overlap_automaton_.find_overlaps(tokens, config_.min_overlap_tokens, 
+                                                     config_.max_matches_per_document);
+    
+    // Score by the fraction of document tokens covered by qualifying overlaps;
+    // maximal spans are in document order but may overlap each other
+    size_t covered = 0;
+    size_t covered_until = 0;
+    const char* separator = config_.tokenize_before_ngrams ? " " : "";
+    
+    for (const auto& overlap : overlaps) {
+        size_t end = overlap.start + overlap.length;
+        covered += end - std::max(overlap.start, std::min(covered_until, end));
+        covered_until = std::max(covered_until, end);
+        assessment.longest_overlap = std::max(assessment.longest_overlap, overlap.length);
+        
+        ContaminationMatch match;
+        for (size_t i = overlap.start; i < end; ++i) {
+            if (i > overlap.start) match.ngram += separator;
+            match.ngram += tokens[i];
+        }
+        match.position_in_document = overlap.start;
+        match.overlap_length = overlap.length;
+        match.source_dataset = index_.dataset_name(overlap.dataset_id);
+        assessment.matches.push_back(std::move(match));
+    }
+    
+    assessment.total_ngrams_checked = tokens.size();
+    assessment.contaminated_ngrams = assessment.matches.size();
+    assessment.contamination_score = tokens.empty() ? 0.0 : static_cast<double>(covered) / tokens.size();
+    assessment.is_contaminated = !overlaps.empty() && 
+                                 assessment.matches.size() >= config_.min_matches_to_reject;
+}
+
+void DecontaminationFilter::match_approximate(const std::string& text, DecontaminationAssessment& assessment) const {
+    auto tokens = overlap_tokens(text);
+    auto regions = approximate_index_->find_matches(tokens, config_.max_matches_per_document);
+    const char* separator = config_.tokenize_before_ngrams ? " " : "";
+    
+    for (const auto& region : regions) {
+        ContaminationMatch match;
+        for (size_t i = region.start; i < region.start + region.length; ++i) {
+            if (i > region.start) match.ngram += separator;
+            match.ngram += tokens[i];
+        }
+        match.position_in_document = region.start;
+        match.overlap_length = region.length;
+        match.match_confidence = region.similarity;
+        match.approximate = true;
+        match.source_dataset = index_.dataset_name(region.dataset_id);
+        assessment.matches.push_back(std::move(match));
+    }
+    
+    assessment.approximate_matches = regions.size();
+    if (!regions.empty()) {
+        assessment.is_contaminated = true;
+    }
+}
+
+std::vector<std::string> DecontaminationFilter::overlap_tokens(const std::string& text) const {
+    std::string processed_text = preprocess_text(text);
+    if (config_.tokenize_before_ngrams) {
+        return tokenize(processed_text);
+    }
+    
+    // Character-level overlaps use one symbol per byte
+    std::vector<std::string> symbols;
+    symbols.reserve(processed_text.size());
+    for (char c : processed_text) {
+        symbols.emplace_back(1, c);
+    }
+    return symbols;
+}
+
+void DecontaminationFilter::ngram_spans(const std::string& text, size_t n, std::string& buffer,
+                                        std::vector<NGramSpan>& spans) const {
+    buffer.clear();
+    spans.clear();
+    if (n == 0) return;
+    
+    std::string processed_text = preprocess_text(text);
+    
+    if (config_.tokenize_before_ngrams) {
+        // Re-join tokens with single spaces: each n-gram is then a contiguous
+        // slice identical to the string extract_ngrams would build
+        std::vector<size_t> token_starts;
+        buffer.reserve(processed_text.size());
+        size_t i = 0;
+        while (i < processed_text.size()) {
+            while (i < processed_text.size() && std::isspace(static_cast<unsigned char>(processed_text[i]))) ++i;
+            if (i >= processed_text.size()) break;
+            
+            if (!buffer.empty()) buffer += ' ';
+            token_starts.push_back(buffer.size());
+            while (i < processed_text.size() && !std::isspace(static_cast<unsigned char>(processed_text[i]))) {
+                buffer += processed_text[i++];
+            }
+        }
+        
+        if (token_starts.size() < n) return;
+        spans.reserve(token_starts.size() - n + 1);
+        for (size_t t = 0; t + n <= token_starts.size(); ++t) {
+            size_t end = (t + n < token_starts.size()) ? token_starts[t + n] - 1 : buffer.size();
+            spans.push_back({token_starts[t], end - token_starts[t]});
+        }
+    } else {
+        // Character-level n-grams, trimmed like normalize_ngram
+        buffer = std::move(processed_text);
+        if (buffer.size() < n) return;
+        
+        auto is_trimmed = [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; };
+        spans.reserve(buffer.size() - n + 1);
+        for (size_t i = 0; i + n <= buffer.size(); ++i) {
+            size_t begin = i;
+            size_t end = i + n;
+            while (begin < end && is_trimmed(buffer[begin])) ++begin;
+            while (end > begin && is_trimmed(buffer[end - 1])) --end;
+            spans.push_back({begin, end - begin});
+        }
+    }
+}
+
+size_t DecontaminationFilter::required_matches(size_t total_ngrams) const {
+    // Smallest match count whose ratio reaches the threshold, evaluated with the
+    // same expression as the score so rounding cannot disagree with it
+    size_t needed = 0;
+    if (total_ngrams > 0 && config_.contamination_threshold > 0.0) {
+        needed = static_cast<size_t>(config_.contamination_threshold * total_ngrams);
+        while (needed > 0 && static_cast<double>(needed - 1) / total_ngrams >= config_.contamination_threshold) {
+            needed--;
+        }
+        while (needed <= total_ngrams && static_cast<double>(needed) / total_ngrams < config_.contamination_threshold) {
+            needed++;
+        }
+    }
+    return std::max<size_t>({needed, config_.min_matches_to_reject, 1});
+}
+
+void DecontaminationFilter::match_ngrams(const std::string& text, bool full_scan, DecontaminationAssessment& assessment,
+                                         DecontaminationStats& local_stats) const {
+    std::string buffer;
+    std::vector<NGramSpan> spans;
+    
+    if (partitioned_index_) {
+        // Disk lookups pay off in one batch visited in hash order, so every
+        // n-gram past the common-phrase screen is probed, early exit or not;
+        // the verdict rule is unchanged
+        std::vector<PartitionedNGramIndex::Probe> probes;
+        std::vector<PartitionedNGramIndex::Hit> hits;
+        ngram_probes(text, 0, buffer, spans, probes);
+        size_t probed = probes.size();
+        partitioned_index_->lookup_batch(probes, hits);
+        collect_partitioned_matches(buffer, spans, hits.data(), hits.data() + hits.size(), assessment);
+        set_ngram_verdict(spans.size(), probed, assessment);
+        return;
+    }
     
-    for (size_t i = 0; i < document_ngrams.size(); ++i) {
-        const auto& ngram = document_ngrams[i];
+    ngram_spans(text, config_.ngram_size, buffer, spans);
+    const size_t total = spans.size();
+    const size_t needed = required_matches(total);
+    const size_t match_limit = std::max<size_t>(config_.max_matches_per_document, 1);
+    size_t probed = 0;
+    
+    for (size_t i = 0; i < total; ++i) {
+        // Decided either way: enough matches to reject, or too few n-grams left
+        if (!full_scan && 
+            (assessment.matches.size() >= needed || assessment.matches.size() + (total - i) < needed)) {
+            break;
+        }
+        
+        // The same hash screens common phrases, probes the bloom filter and keys the index
+        Hash128 hash = hash_utils::hash128(buffer.data() + spans[i].offset, spans[i].length);
         
         // Skip common phrases if configured
-        if (config_.exclude_common_phrases && is_common_phrase(ngram)) {
+        if (config_.exclude_common_phrases && is_common_phrase(hash)) {
             continue;
         }
+        probed++;
         
         // Check bloom filter first for efficiency
-        if (bloom_filter_ && !bloom_filter_->might_contain(ngram)) {
+        if (bloom_filter_ && !bloom_filter_->might_contain_hash(hash)) {
             continue;
         }
         
         // Check if n-gram exists in benchmark
-        if (benchmark_ngrams_.count(ngram)) {
-            ContaminationMatch match;
-            match.ngram = ngram;
-            match.position_in_document = i;
-            match.source_dataset = ngram_to_dataset_.count(ngram) ? 
-                                   ngram_to_dataset_.at(ngram) : "unknown";
-            matches.push_back(match);
-            
-            // Stop if we've found too many matches
-            if (matches.size() >= config_.max_matches_per_document) {
-                break;
+        // One probe yields every dataset containing the n-gram
+        uint32_t dataset_id = index_.find(hash);
+        if (dataset_id == NGramIndex::NOT_FOUND) {
+            if (bloom_filter_) {
+                local_stats.bloom_filter_false_positives++;
             }
+            continue;
+        }
+        
+        ContaminationMatch match;
+        match.ngram.assign(buffer, spans[i].offset, spans[i].length);
+        match.position_in_document = i;
+        index_.for_each_dataset(dataset_id, [&](uint32_t id) {
+            if (match.source_dataset.empty()) {
+                match.source_dataset = index_.dataset_name(id);
+            } else {
+                match.other_datasets.push_back(index_.dataset_name(id));
+            }
+        });
+        assessment.matches.push_back(std::move(match));
+        
+        // Stop if we've found too many matches
+        if (assessment.matches.size() >= match_limit) {
+            break;
         }
     }
     
-    return matches;
+    set_ngram_verdict(total, probed, assessment);
+}
+
+void DecontaminationFilter::ngram_probes(const std::string& text, uint32_t document, std::string& buffer,
+                                         std::vector<NGramSpan>& spans,
+                                         std::vector<PartitionedNGramIndex::Probe>& probes) const {
+    ngram_spans(text, config_.ngram_size, buffer, spans);
+    probes.clear();
+    probes.reserve(spans.size());
+    for (size_t i = 0; i < spans.size(); ++i) {
+        Hash128 hash = hash_utils::hash128(buffer.data() + spans[i].offset, spans[i].length);
+        if (config_.exclude_common_phrases && is_common_phrase(hash)) continue;
+        probes.push_back({hash, document, static_cast<uint32_t>(i)});
+    }
+}
+
+void DecontaminationFilter::collect_partitioned_matches(const std::string& buffer, const std::vector<NGramSpan>& spans,
+                                                        const PartitionedNGramIndex::Hit* first,
+                                                        const PartitionedNGramIndex::Hit* last,
+                                                        DecontaminationAssessment& assessment) const {
+    // Hits of one document, sorted by position; each position is one match
+    const size_t match_limit = std::max<size_t>(config_.max_matches_per_document, 1);
+    for (const auto* hit = first; hit != last && assessment.matches.size() < match_limit;) {
+        size_t position = hit->position;
+        ContaminationMatch match;
+        match.ngram.assign(buffer, spans[position].offset, spans[position].length);
+        match.position_in_document = position;
+        for (; hit != last && hit->position == position; ++hit) {
+            const std::string& dataset = partitioned_index_->dataset_name(hit->dataset_id);
+            if (match.source_dataset.empty()) {
+                match.source_dataset = dataset;
+            } else {
+                match.other_datasets.push_back(dataset);
+            }
+        }
+        assessment.matches.push_back(std::move(match));
+    }
+}
+
+void DecontaminationFilter::set_ngram_verdict(size_t total, size_t probed, DecontaminationAssessment& assessment) const {
+    assessment.total_ngrams_checked = total;
+    assessment.ngrams_probed = probed;
+    assessment.contaminated_ngrams = assessment.matches.size();
+    assessment.contamination_score = calculate_contamination_score(assessment.matches, total);
+    assessment.is_contaminated = total > 0 && assessment.matches.size() >= required_matches(total);
 }
 
 void DecontaminationFilter::reset_stats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
     stats_ = DecontaminationStats{};
 }
 
@@ -325,7 +1185,8 @@ void DecontaminationFilter::print_contamination_report() const {
     std::cout << "Contaminated documents: " << stats_.contaminated_documents 
               << " (" << (stats_.get_contamination_rate() * 100) << "%)\n";
     std::cout << "Clean documents: " << stats_.clean_documents << "\n";
-    std::cout << "Total n-grams checked: " << stats_.total_ngrams_checked << "\n";
+    std::cout << "Total n-grams checked: " << stats_.total_ngrams_checked 
+              << " (" << stats_.total_ngrams_probed << " probed before the verdict was decided)\n";
     std::cout << "Contaminated n-grams found: " << stats_.contaminated_ngrams_found 
               << " (" << (stats_.get_ngram_contamination_rate() * 100) << "%)\n";
     std::cout << "Average processing time: " << stats_.average_processing_time_ms << " ms\n";
@@ -339,18 +1200,41 @@ void DecontaminationFilter::print_contamination_report() const {
     
     if (bloom_filter_) {
         std::cout << "\nBloom filter stats:\n";
-        std::cout << "  Size: " << bloom_filter_->get_size() << " bits\n";
+        std::cout << "  Size: " << bloom_filter_->get_size() << " bits ("
+                  << bloom_filter_->get_num_blocks() << " cache-line blocks)\n";
         std::cout << "  Hash functions: " << bloom_filter_->get_hash_functions() << "\n";
+        std::cout << "  Expected FPR: " << bloom_filter_->get_expected_false_positive_rate() << "\n";
         std::cout << "  False positives: " << stats_.bloom_filter_false_positives << "\n";
     }
+    
+    if (assessment_cache_) {
+        std::cout << "\nAssessment cache:\n";
+        std::cout << "  Entries: " << assessment_cache_->size() << " / " << assessment_cache_->capacity() << "\n";
+        std::cout << "  Hits: " << stats_.cache_hits << ", misses: " << stats_.cache_misses
+                  << " (" << (stats_.get_cache_hit_rate() * 100) << "% hit rate)\n";
+    }
+    
+    if (approximate_index_) {
+        std::cout << "\nApproximate matching:\n";
+        std::cout << "  Indexed windows: " << approximate_index_->size() << " ("
+                  << approximate_index_->num_window_sizes() << " window sizes)\n";
+        std::cout << "  Jaccard threshold: " << approximate_index_->threshold() << "\n";
+        std::cout << "  Approximate matches: " << stats_.approximate_matches_found << "\n";
+    }
+    
+    if (!overlap_automaton_.empty()) {
+        std::cout << "\nOverlap automaton:\n";
+        std::cout << "  Benchmark texts: " << overlap_automaton_.num_texts() << "\n";
+        std::cout << "  States: " << overlap_automaton_.num_states() << "\n";
+        std::cout << "  Vocabulary: " << overlap_automaton_.vocabulary_size() << " tokens\n";
+    }
 }
 
 std::vector<std::string> DecontaminationFilter::get_benchmark_datasets() const {
-    std::unordered_set<std::string> datasets;
-    for (const auto& [ngram, dataset] : ngram_to_dataset_) {
-        datasets.insert(dataset);
+    if (partitioned_index_) {
+        return partitioned_index_->datasets();
     }
-    return std::vector<std::string>(datasets.begin(), datasets.end());
+    return index_.datasets();
 }
 
 // Private helper methods
@@ -395,8 +1279,8 @@ std::string DecontaminationFilter::normalize_ngram(const std::string& ngram) con
     return result;
 }
 
-bool DecontaminationFilter::is_common_phrase(const std::string& ngram) const {
-    return common_phrases_.count(ngram) > 0;
+bool DecontaminationFilter::is_common_phrase(const Hash128& ngram_hash) const {
+    return !common_phrase_hashes_.empty() && common_phrase_hashes_.count(ngram_hash.low) > 0;
 }
 
 double DecontaminationFilter::calculate_contamination_score(const std::vector<ContaminationMatch>& matches, 
@@ -405,22 +1289,54 @@ double DecontaminationFilter::calculate_contamination_score(const std::vector<Co
     return static_cast<double>(matches.size()) / total_ngrams;
 }
 
-void DecontaminationFilter::update_stats(const DecontaminationAssessment& assessment) const {
-    stats_.total_documents_processed++;
-    stats_.total_ngrams_checked += assessment.total_ngrams_checked;
-    stats_.contaminated_ngrams_found += assessment.contaminated_ngrams;
+void DecontaminationFilter::update_stats(DecontaminationStats& stats, const DecontaminationAssessment& assessment,
+                                         double processing_time_ms) {
+    stats.total_documents_processed++;
+    stats.total_ngrams_checked += assessment.total_ngrams_checked;
+    stats.total_ngrams_probed += assessment.ngrams_probed;
+    stats.contaminated_ngrams_found += assessment.contaminated_ngrams;
+    stats.approximate_matches_found += assessment.approximate_matches;
+    stats.total_processing_time_ms += processing_time_ms;
+    stats.average_processing_time_ms = stats.total_processing_time_ms / stats.total_documents_processed;
     
     if (assessment.is_contaminated) {
-        stats_.contaminated_documents++;
-        if (!assessment.most_likely_source.empty()) {
-            stats_.contamination_by_dataset[assessment.most_likely_source]++;
+        stats.contaminated_documents++;
+        for (const auto& dataset : assessment.contaminated_datasets) {
+            stats.contamination_by_dataset[dataset]++;
         }
     } else {
-        stats_.clean_documents++;
+        stats.clean_documents++;
     }
     
     // Update histogram
-    stats_.matches_per_document_histogram[assessment.contaminated_ngrams]++;
+    stats.matches_per_document_histogram[assessment.contaminated_ngrams]++;
+}
+
+void DecontaminationFilter::merge_stats(const DecontaminationStats& local_stats) const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    
+    stats_.total_documents_processed += local_stats.total_documents_processed;
+    stats_.contaminated_documents += local_stats.contaminated_documents;
+    stats_.clean_documents += local_stats.clean_documents;
+    stats_.total_ngrams_checked += local_stats.total_ngrams_checked;
+    stats_.total_ngrams_probed += local_stats.total_ngrams_probed;
+    stats_.contaminated_ngrams_found += local_stats.contaminated_ngrams_found;
+    stats_.approximate_matches_found += local_stats.approximate_matches_found;
+    stats_.bloom_filter_false_positives += local_stats.bloom_filter_false_positives;
+    stats_.cache_hits += local_stats.cache_hits;
+    stats_.cache_misses += local_stats.cache_misses;
+    stats_.total_processing_time_ms += local_stats.total_processing_time_ms;
+    
+    for (const auto& [dataset, count] : local_stats.contamination_by_dataset) {
+        stats_.contamination_by_dataset[dataset] += count;
+    }
+    for (const auto& [matches, count] : local_stats.matches_per_document_histogram) {
+        stats_.matches_per_document_histogram[matches] += count;
+    }
+    
+    if (stats_.total_documents_processed > 0) {
+        stats_.average_processing_time_ms = stats_.total_processing_time_ms / stats_.total_documents_processed;
+    }
 }
 
 void DecontaminationFilter::load_common_phrases() {
@@ -434,6 +1350,12 @@ void DecontaminationFilter::load_common_phrases() {
         "each", "which", "she", "do", "how", "their", "if", "will", "up",
         "other", "about", "out", "many", "then", "them", "these", "so", "some"
     };
+    
+    // Matching compares hashes, so screen phrases the same way
+    common_phrase_hashes_.clear();
+    for (const auto& phrase : common_phrases_) {
+        common_phrase_hashes_.insert(hash_utils::hash128(phrase).low);
+    }
 }
 
 // Utility function implementations
@@ -444,6 +1366,7 @@ DecontaminationConfig create_default_config() {
     config.ngram_size = DEFAULT_NGRAM_SIZE;
     config.contamination_threshold = 0.1;
     config.use_bloom_filter = true;
+    config.bloom_filter_false_positive_rate = 0.01;
     config.enable_parallel_processing = true;
     config.normalize_whitespace = true;
     config.tokenize_before_ngrams = true;
@@ -470,6 +1393,139 @@ DecontaminationConfig create_fast_config() {
     return config;
 }
 
+uint64_t index_fingerprint(const DecontaminationConfig& config) {
+    // Only settings that change which n-gram strings (and so which keys) are
+    // produced belong here; query-time options may differ freely
+    std::ostringstream settings;
+    settings << "ngram_size=" << config.ngram_size
+             << ";normalize_whitespace=" << config.normalize_whitespace
+             << ";case_insensitive=" << config.case_insensitive
+             << ";remove_punctuation=" << config.remove_punctuation
+             << ";tokenize_before_ngrams=" << config.tokenize_before_ngrams
+             << ";hash=murmur3_x64_128";
+    return hash_utils::hash128(settings.str()).low;
+}
+
+BenchmarkFormat detect_benchmark_format(const std::string& filename) {
+    std::filesystem::path path(filename);
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension != ".json" && extension != ".jsonl") {
+        return BenchmarkFormat::PLAIN_TEXT;
+    }
+    
+    // Benchmarks are recognized by whole tokens of the path (directory names
+    // and the '_', '-' and '.' separated parts of the file name), so a name
+    // that merely contains a task name, like "sorted" or "chocolate", stays JSON
+    std::string name = path.string();
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    std::vector<std::string> tokens;
+    size_t start = 0;
+    for (size_t i = 0; i <= name.size(); ++i) {
+        if (i == name.size() || std::strchr("/\\_-. ", name[i])) {
+            if (i > start) tokens.push_back(name.substr(start, i - start));
+            start = i + 1;
+        }
+    }
+    auto has_token = [&](std::initializer_list<const char*> names) {
+        for (const char* candidate : names) {
+            if (std::find(tokens.begin(), tokens.end(), candidate) != tokens.end()) return true;
+        }
+        return false;
+    };
+    
+    if (has_token({"squad", "squad2", "squadv2"})) return BenchmarkFormat::SQUAD;
+    if (has_token({"trivia", "triviaqa"})) return BenchmarkFormat::TRIVIA_QA;
+    if (has_token({"glue", "cola", "sst", "sst2", "mrpc", "qqp", "sts", "stsb", "mnli", "qnli", "rte", "wnli"})) {
+        return BenchmarkFormat::GLUE;
+    }
+    return BenchmarkFormat::JSON;
+}
+
+const char* benchmark_format_name(BenchmarkFormat format) {
+    switch (format) {
+        case BenchmarkFormat::PLAIN_TEXT: return "plain text";
+        case BenchmarkFormat::SQUAD: return "SQuAD";
+        case BenchmarkFormat::TRIVIA_QA: return "TriviaQA";
+        case BenchmarkFormat::GLUE: return "GLUE";
+        case BenchmarkFormat::JSON: return "JSON";
+    }
+    return "unknown";
+}
+
+std::vector<std::string> benchmark_text_fields(BenchmarkFormat format) {
+    switch (format) {
+        case BenchmarkFormat::SQUAD:
+            return {"context", "question", "answers.text"};
+        case BenchmarkFormat::TRIVIA_QA:
+            return {"Question", "Answer.Value", "question", "answer.value"};
+        case BenchmarkFormat::GLUE:
+            return {"sentence", "sentence1", "sentence2", "question", "question1", "question2",
+                    "premise", "hypothesis"};
+        case BenchmarkFormat::JSON:
+            return {"question", "query", "context", "passage", "text", "sentence", "prompt",
+                    "answer", "answers.text", "choices.text", "premise", "hypothesis"};
+        case BenchmarkFormat::PLAIN_TEXT:
+            break;
+    }
+    return {};
+}
+
+size_t stream_benchmark_texts(const std::string& filename, BenchmarkFormat format,
+                              const std::function<void(const std::string&)>& visit) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open benchmark file: " + filename);
+    }
+    
+    // Files named .json that are really line lists keep loading as lines
+    if (format != BenchmarkFormat::PLAIN_TEXT) {
+        int first = (file >> std::ws).peek();
+        if (first != '{' && first != '[') format = BenchmarkFormat::PLAIN_TEXT;
+    }
+    
+    if (format == BenchmarkFormat::PLAIN_TEXT) {
+        size_t count = 0;
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line[0] == '#') continue;
+            visit(line);
+            count++;
+        }
+        return count;
+    }
+    
+    JsonFieldReader reader(file, benchmark_text_fields(format));
+    return reader.read(visit);
+}
+
+namespace {
+
+std::vector<std::string> collect_benchmark_texts(const std::string& filename, BenchmarkFormat format) {
+    std::vector<std::string> texts;
+    stream_benchmark_texts(filename, format, [&](const std::string& text) { texts.push_back(text); });
+    return texts;
+}
+
+} // anonymous namespace
+
+std::vector<std::string> load_benchmark_questions(const std::string& filename) {
+    return collect_benchmark_texts(filename, detect_benchmark_format(filename));
+}
+
+std::vector<std::string> load_trivia_qa_dataset(const std::string& filename) {
+    return collect_benchmark_texts(filename, BenchmarkFormat::TRIVIA_QA);
+}
+
+std::vector<std::string> load_squad_dataset(const std::string& filename) {
+    return collect_benchmark_texts(filename, BenchmarkFormat::SQUAD);
+}
+
+std::vector<std::string> load_glue_dataset(const std::string& filename) {
+    return collect_benchmark_texts(filename, BenchmarkFormat::GLUE);
+}
+
 std::vector<std::string> generate_ngrams(const std::string& text, size_t n, 
                                         bool normalize, bool tokenize) {
     std::vector<std::string> ngrams;
@@ -0,0 +1,191 @@
+#include "rapidsift/decontamination_index.hpp"
+#include <stdexcept>
+
+namespace rapidsift {
+namespace dedup {
+
+uint32_t NGramIndex::intern_dataset(const std::string& name) {
+    auto it = dataset_lookup_.find(name);
+    if (it != dataset_lookup_.end()) {
+        return it->second;
+    }
+
+    uint32_t id = static_cast<uint32_t>(datasets_.size());
+    datasets_.push_back(name);
+    dataset_lookup_.emplace(name, id);
+    return id;
+}
+
+void NGramIndex::insert(const Hash128& hash, uint32_t dataset_id) {
+    // Keep the load factor at or below 1/2 so probe sequences stay short;
+    // this also copies an attached (read-only) table into owned storage
+    if (is_attached()) {
+        dataset_set_storage_.assign(dataset_sets_, dataset_sets_ + dataset_set_count_);
+        dataset_sets_ = dataset_set_storage_.data();
+        // attach checked that the pool is a run of whole lists
+        for (size_t offset = 0; offset < dataset_set_count_; offset += dataset_sets_[offset] + 1) {
+            const uint32_t* ids = dataset_sets_ + offset + 1;
+            dataset_set_offsets_.emplace(std::vector<uint32_t>(ids, ids + dataset_sets_[offset]),
+                                         static_cast<uint32_t>(offset));
+        }
+    }
+    if (is_attached() || (size_ + 1) * 2 > capacity_) {
+        size_t new_capacity = std::max(capacity_, MIN_CAPACITY);
+        while ((size_ + 1) * 2 > new_capacity) new_capacity *= 2;
+        rehash(new_capacity);
+    }
+
+    Hash128 key = canonical_key(hash);
+    size_t mask = capacity_ - 1;
+    for (size_t slot = home_slot(key);; slot = (slot + 1) & mask) {
+        if (is_empty_slot(key_storage_[slot])) {
+            key_storage_[slot] = key;
+            dataset_id_storage_[slot] = dataset_id;
+            size_++;
+            return;
+        }
+        if (key_storage_[slot] == key) {
+            dataset_id_storage_[slot] = add_dataset(dataset_id_storage_[slot], dataset_id);
+            return;
+        }
+    }
+}
+
+uint32_t NGramIndex::find(const Hash128& hash) const {
+    if (size_ == 0) return NOT_FOUND;
+
+    Hash128 key = canonical_key(hash);
+    size_t mask = capacity_ - 1;
+    for (size_t slot = home_slot(key);; slot = (slot + 1) & mask) {
+        const Hash128& stored = keys_[slot];
+        if (stored == key) return dataset_ids_[slot];
+        if (is_empty_slot(stored)) return NOT_FOUND;
+    }
+}
+
+void NGramIndex::clear() {
+    key_storage_.clear();
+    key_storage_.shrink_to_fit();
+    dataset_id_storage_.clear();
+    dataset_id_storage_.shrink_to_fit();
+    keys_ = nullptr;
+    dataset_ids_ = nullptr;
+    capacity_ = 0;
+    size_ = 0;
+    dataset_set_storage_.clear();
+    dataset_set_storage_.shrink_to_fit();
+    dataset_sets_ = nullptr;
+    dataset_set_count_ = 0;
+    dataset_set_offsets_.clear();
+    datasets_.clear();
+    dataset_lookup_.clear();
+}
+
+void NGramIndex::attach(const Hash128* keys, const uint32_t* dataset_ids, size_t capacity, size_t size,
+                        const uint32_t* dataset_sets, size_t dataset_sets_size, std::vector<std::string> datasets) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0 || size * 2 > capacity) {
+        throw std::runtime_error("Invalid n-gram index table geometry");
+    }
+
+    // The arrays usually come from a file, so every attribution is checked
+    // once here instead of on each lookup: pool lists must fit in the pool and
+    // name known datasets, slots must hold a known dataset or the start of a
+    // list, and the occupied slots must number size (a full table would make
+    // find probe forever)
+    auto corrupt = [] { return std::runtime_error("Corrupt n-gram index attribution table"); };
+    std::vector<bool> list_starts(dataset_sets_size, false);
+    for (size_t offset = 0; offset < dataset_sets_size;) {
+        size_t count = dataset_sets[offset];
+        if (count == 0 || count >= dataset_sets_size - offset) throw corrupt();
+        for (size_t i = 1; i <= count; ++i) {
+            if (dataset_sets[offset + i] >= datasets.size()) throw corrupt();
+        }
+        list_starts[offset] = true;
+        offset += count + 1;
+    }
+
+    size_t occupied = 0;
+    for (size_t i = 0; i < capacity; ++i) {
+        if (is_empty_slot(keys[i])) continue;
+        occupied++;
+        uint32_t attribution = dataset_ids[i];
+        bool valid = (attribution & MULTI_DATASET)
+            ? (attribution & ~MULTI_DATASET) < dataset_sets_size && list_starts[attribution & ~MULTI_DATASET]
+            : attribution < datasets.size();
+        if (!valid) throw corrupt();
+    }
+    if (occupied != size) throw corrupt();
+
+    key_storage_.clear();
+    dataset_id_storage_.clear();
+    keys_ = keys;
+    dataset_ids_ = dataset_ids;
+    capacity_ = capacity;
+    size_ = size;
+    dataset_set_storage_.clear();
+    dataset_sets_ = dataset_sets;
+    dataset_set_count_ = dataset_sets_size;
+    dataset_set_offsets_.clear();
+
+    datasets_ = std::move(datasets);
+    dataset_lookup_.clear();
+    for (uint32_t id = 0; id < datasets_.size(); ++id) {
+        dataset_lookup_.emplace(datasets_[id], id);
+    }
+}
+
+void NGramIndex::rehash(size_t new_capacity) {
+    std::vector<Hash128> new_keys(new_capacity);
+    std::vector<uint32_t> new_ids(new_capacity, NOT_FOUND);
+    size_t mask = new_capacity - 1;
+
+    for (size_t i = 0; i < capacity_; ++i) {
+        const Hash128& key = keys_[i];
+        if (is_empty_slot(key)) continue;
+
+        size_t slot = static_cast<size_t>(key.high) & mask;
+        while (!is_empty_slot(new_keys[slot])) slot = (slot + 1) & mask;
+        new_keys[slot] = key;
+        new_ids[slot] = dataset_ids_[i];
+    }
+
+    key_storage_ = std::move(new_keys);
+    dataset_id_storage_ = std::move(new_ids);
+    keys_ = key_storage_.data();
+    dataset_ids_ = dataset_id_storage_.data();
+    capacity_ = new_capacity;
+}
+
+uint32_t NGramIndex::add_dataset(uint32_t attribution, uint32_t dataset_id) {
+    if (attribution == dataset_id) return attribution;
+
+    // Current members, then the new id in sorted position
+    std::vector<uint32_t> ids;
+    for_each_dataset(attribution, [&](uint32_t id) { ids.push_back(id); });
+    auto it = std::lower_bound(ids.begin(), ids.end(), dataset_id);
+    if (it != ids.end() && *it == dataset_id) return attribution;
+    ids.insert(it, dataset_id);
+
+    // Lists are interned, so the pool grows with the number of distinct
+    // dataset sets rather than with the number of shared n-grams
+    auto interned = dataset_set_offsets_.find(ids);
+    if (interned != dataset_set_offsets_.end()) {
+        return MULTI_DATASET | interned->second;
+    }
+
+    size_t offset = dataset_set_storage_.size();
+    if (offset >= MULTI_DATASET) {
+        throw std::runtime_error("N-gram index dataset lists exceed 2^31 entries");
+    }
+    dataset_set_storage_.push_back(static_cast<uint32_t>(ids.size()));
+    dataset_set_storage_.insert(dataset_set_storage_.end(), ids.begin(), ids.end());
+    dataset_set_offsets_.emplace(std::move(ids), static_cast<uint32_t>(offset));
+    attribution = MULTI_DATASET | static_cast<uint32_t>(offset);
+
+    dataset_sets_ = dataset_set_storage_.data();
+    dataset_set_count_ = dataset_set_storage_.size();
+    return attribution;
+}
+
+} // namespace dedup
+} // namespace rapidsift
@@ -1,4 +1,5 @@
 #include "rapidsift/language_filter.hpp"
+#include "rapidsift/ngram_language_model.hpp"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
@@ -7,18 +8,187 @@
 #include <cctype>
 #include <fstream>
 #include <random>
+#include <streambuf>
+#include <cstring>
+#include <stdexcept>
 
 #ifdef HAVE_FASTTEXT
 #include <fasttext.h>
 #endif
 
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
 namespace rapidsift {
 
+namespace {
+
+// First UTF-8 character start at or after offset
+size_t utf8_boundary(const std::string& text, size_t offset) {
+    while (offset < text.size() && (static_cast<unsigned char>(text[offset]) & 0xC0) == 0x80) ++offset;
+    return std::min(offset, text.size());
+}
+
+// Offsets every stride_bytes, moved forward to the next UTF-8 character start
+std::vector<size_t> stride_block_starts(const std::string& text, size_t stride_bytes) {
+    std::vector<size_t> starts;
+    const size_t stride = std::max<size_t>(stride_bytes, 1);
+    for (size_t offset = 0; offset < text.size(); offset += stride) {
+        size_t start = utf8_boundary(text, offset);
+        if (start < text.size() && (starts.empty() || start > starts.back())) {
+            starts.push_back(start);
+        }
+    }
+    return starts;
+}
+
+size_t blocks_per_window(size_t window_bytes, size_t stride_bytes) {
+    const size_t stride = std::max<size_t>(stride_bytes, 1);
+    return std::max<size_t>(1, (window_bytes + stride - 1) / stride);
+}
+
+// Splits the text at every window edge; each piece takes the language with the
+// most confidence among the windows covering it, and equal neighbours merge
+LanguageSegmentation segment_from_windows(size_t length, const std::vector<LanguageSpan>& windows) {
+    LanguageSegmentation segmentation;
+    if (windows.empty() || length == 0) {
+        return segmentation;
+    }
+    
+    std::vector<size_t> cuts;
+    for (const auto& window : windows) {
+        cuts.push_back(window.begin);
+        cuts.push_back(window.end);
+    }
+    std::sort(cuts.begin(), cuts.end());
+    cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+    
+    // Window begins and ends both ascend, so covering windows form a sliding range
+    std::vector<std::pair<std::string, double>> votes;
+    size_t first = 0;
+    for (size_t c = 0; c + 1 < cuts.size(); ++c) {
+        const size_t begin = cuts[c];
+        const size_t end = cuts[c + 1];
+        while (first < windows.size() && windows[first].end <= begin) ++first;
+        
+        votes.clear();
+        size_t voters = 0;
+        for (size_t w = first; w < windows.size() && windows[w].begin <= begin; ++w) {
+            voters++;
+            if (windows[w].language == "unknown") continue;
+            auto it = std::find_if(votes.begin(), votes.end(),
+                                   [&](const auto& vote) { return vote.first == windows[w].language; });
+            if (it == votes.end()) {
+                votes.emplace_back(windows[w].language, windows[w].confidence);
+            } else {
+                it->second += windows[w].confidence;
+            }
+        }
+        
+        LanguageSpan piece;
+        piece.begin = begin;
+        piece.end = end;
+        for (const auto& [language, weight] : votes) {
+            if (weight > piece.confidence) {
+                piece.language = language;
+                piece.confidence = weight;
+            }
+        }
+        piece.confidence = voters > 0 ? piece.confidence / voters : 0.0;
+        
+        auto& spans = segmentation.spans;
+        if (!spans.empty() && spans.back().language == piece.language && spans.back().end == piece.begin) {
+            LanguageSpan& last = spans.back();
+            last.confidence = (last.confidence * last.length() + piece.confidence * piece.length()) /
+                              (last.length() + piece.length());
+            last.end = piece.end;
+        } else {
+            spans.push_back(piece);
+        }
+    }
+    
+    for (const auto& span : segmentation.spans) {
+        segmentation.proportions[span.language] += double(span.length()) / length;
+    }
+    return segmentation;
+}
+
+} // anonymous namespace
+
+std::string LanguageSegmentation::dominant_language() const {
+    std::string dominant = "unknown";
+    double best = 0.0;
+    for (const auto& [language, share] : proportions) {
+        if (language == "unknown") continue;
+        if (share > best || (share == best && language < dominant)) {
+            best = share;
+            dominant = language;
+        }
+    }
+    return dominant;
+}
+
+bool LanguageSegmentation::is_mixed(double threshold) const {
+    const std::string dominant = dominant_language();
+    double others = 0.0;
+    for (const auto& [language, share] : proportions) {
+        if (language != dominant && language != "unknown") {
+            others += share;
+        }
+    }
+    return others > 0.0 && others >= threshold;
+}
+
+std::vector<LanguageSpan> LanguageDetector::detect_windows(const std::string& text, size_t window_bytes,
+                                                           size_t stride_bytes) {
+    std::vector<LanguageSpan> windows = language_utils::sliding_windows(text, window_bytes, stride_bytes);
+    for (auto& window : windows) {
+        LanguageDetection detection = detect(text.substr(window.begin, window.length()));
+        window.language = detection.language;
+        window.confidence = detection.confidence;
+    }
+    return windows;
+}
+
+std::vector<LanguageDetection> LanguageDetector::detect_batch(const std::vector<std::string>& texts) {
+    std::vector<LanguageDetection> results(texts.size());
+    
+#ifdef USE_OPENMP
+    if (supports_concurrent_detect() && texts.size() > 1) {
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (size_t i = 0; i < texts.size(); ++i) {
+            results[i] = detect(texts[i]);
+        }
+        return results;
+    }
+#endif
+    
+    for (size_t i = 0; i < texts.size(); ++i) {
+        results[i] = detect(texts[i]);
+    }
+    return results;
+}
+
 // ==============================================================================
 // FastText Language Detector Implementation
 // ==============================================================================
 
 #ifdef HAVE_FASTTEXT
+namespace {
+
+// Zero-copy read-only view of a string for fastText's istream-based tokenizer,
+// so predicting does not copy the text into a fresh istringstream
+class TextViewBuf : public std::streambuf {
+public:
+    void reset(const std::string& text) {
+        char* begin = const_cast<char*>(text.data());
+        setg(begin, begin, begin + text.size());
+    }
+};
+
+} // anonymous namespace
+
 struct FastTextLanguageDetector::Implementation {
     fasttext::FastText ft;
     bool model_loaded = false;
@@ -26,6 +196,33 @@ struct FastTextLanguageDetector::Implementation {
     int32_t top_k = 1;
     
     Implementation() = default;
+    
+    // Per-caller scratch: one per thread in batches, reused across texts
+    struct Scratch {
+        TextViewBuf buffer;
+        std::istream input{&buffer};
+        std::vector<std::pair<fasttext::real, std::string>> predictions;
+    };
+    
+    // FastText::predictLine only reads the model, so calls may run concurrently
+    LanguageDetection predict(const std::string& text, Scratch& scratch) const {
+        scratch.buffer.reset(text);
+        scratch.input.clear();
+        scratch.predictions.clear();
+        ft.predictLine(scratch.input, scratch.predictions, top_k, static_cast<fasttext::real>(threshold));
+        
+        if (scratch.predictions.empty()) {
+            return LanguageDetection("unknown", 0.0);
+        }
+        
+        // Extract language from fastText label format (__label__en -> en)
+        const std::string& label = scratch.predictions[0].second;
+        std::string language = label.compare(0, 9, "__label__") == 0 ? label.substr(9) : label;
+        
+        double confidence = std::exp(scratch.predictions[0].first);  // Convert log-prob to probability
+        
+        return LanguageDetection(language, confidence);
+    }
 };
 #else
 struct FastTextLanguageDetector::Implementation {
@@ -80,23 +277,8 @@ LanguageDetection FastTextLanguageDetector::detect(const std::string& text) {
     
 #ifdef HAVE_FASTTEXT
     try {
-        std::vector<std::pair<fasttext::real, std::string>> predictions;
-        std::istringstream iss(text);
-        impl_->ft.predictLine(iss, predictions, impl_->top_k, impl_->threshold);
-        
-        if (predictions.empty()) {
-            return LanguageDetection("unknown", 0.0);
-        }
-        
-        // Extract language from fastText label format (__label__en -> en)
-        std::string language = predictions[0].second;
-        if (language.substr(0, 9) == "__label__") {
-            language = language.substr(9);
-        }
-        
-        double confidence = std::exp(predictions[0].first);  // Convert log-prob to probability
-        
-        return LanguageDetection(language, confidence);
+        Implementation::Scratch scratch;
+        return impl_->predict(text, scratch);
     } catch (const std::exception& e) {
         std::cerr << "Error in language detection: " << e.what() << std::endl;
         return LanguageDetection("unknown", 0.0);
@@ -107,12 +289,36 @@ LanguageDetection FastTextLanguageDetector::detect(const std::string& text) {
 }
 
 std::vector<LanguageDetection> FastTextLanguageDetector::detect_batch(const std::vector<std::string>& texts) {
-    std::vector<LanguageDetection> results;
-    results.reserve(texts.size());
+    std::vector<LanguageDetection> results(texts.size(), LanguageDetection("unknown", 0.0));
+    if (!impl_ || !impl_->model_loaded) {
+        return results;
+    }
     
-    for (const auto& text : texts) {
-        results.push_back(detect(text));
+#ifdef HAVE_FASTTEXT
+    const Implementation& model = *impl_;
+    
+#ifdef USE_OPENMP
+    #pragma omp parallel if(texts.size() > 1)
+#endif
+    {
+        Implementation::Scratch scratch;
+        
+#ifdef USE_OPENMP
+        #pragma omp for schedule(dynamic, 16)
+#endif
+        for (size_t i = 0; i < texts.size(); ++i) {
+            try {
+                results[i] = model.predict(texts[i], scratch);
+            } catch (const std::exception& e) {
+                // Exceptions must not escape the parallel region
+#ifdef USE_OPENMP
+                #pragma omp critical(language_detection_errors)
+#endif
+                std::cerr << "Error in language detection: " << e.what() << std::endl;
+            }
+        }
     }
+#endif
     
     return results;
 }
@@ -147,8 +353,97 @@ void FastTextLanguageDetector::set_top_k(int k) {
 // Simple Language Detector Implementation
 // ==============================================================================
 
+namespace {
+
+// Unicode scripts told apart by the simple detector
+enum class Script : uint8_t {
+    OTHER, LATIN, GREEK, CYRILLIC, HEBREW, ARABIC, DEVANAGARI, THAI, HANGUL, KANA, HAN, COUNT
+};
+
+constexpr size_t SCRIPT_COUNT = static_cast<size_t>(Script::COUNT);
+constexpr size_t SCRIPT_SAMPLE = 64;         // Letters of one non-Latin script that decide on their own
+constexpr size_t MAX_STOPWORD_BYTES = 16;    // Longer words are never looked up
+
+Script classify_code_point(uint32_t cp) {
+    if ((cp >= 'A' && cp <= 'Z') || (cp >= 'a' && cp <= 'z')) return Script::LATIN;
+    if (cp < 0x00C0) return Script::OTHER;
+    if (cp <= 0x024F) return (cp == 0x00D7 || cp == 0x00F7) ? Script::OTHER : Script::LATIN;
+    if (cp >= 0x0370 && cp <= 0x03FF) return Script::GREEK;
+    if (cp >= 0x0400 && cp <= 0x052F) return Script::CYRILLIC;
+    if (cp >= 0x0590 && cp <= 0x05FF) return Script::HEBREW;
+    if ((cp >= 0x0600 && cp <= 0x06FF) || (cp >= 0x0750 && cp <= 0x077F)) return Script::ARABIC;
+    if (cp >= 0x0900 && cp <= 0x097F) return Script::DEVANAGARI;
+    if (cp >= 0x0E00 && cp <= 0x0E7F) return Script::THAI;
+    if ((cp >= 0x1100 && cp <= 0x11FF) || (cp >= 0x3130 && cp <= 0x318F)) return Script::HANGUL;
+    if (cp >= 0x1E00 && cp <= 0x1EFF) return Script::LATIN;
+    if (cp >= 0x1F00 && cp <= 0x1FFF) return Script::GREEK;
+    if (cp >= 0x3040 && cp <= 0x30FF) return Script::KANA;
+    if ((cp >= 0x3400 && cp <= 0x4DBF) || (cp >= 0x4E00 && cp <= 0x9FFF) || (cp >= 0xF900 && cp <= 0xFAFF)) {
+        return Script::HAN;
+    }
+    if (cp >= 0xAC00 && cp <= 0xD7AF) return Script::HANGUL;
+    if ((cp >= 0xFB50 && cp <= 0xFDFF) || (cp >= 0xFE70 && cp <= 0xFEFF)) return Script::ARABIC;
+    return Script::OTHER;
+}
+
+// The language a script implies on its own; Latin needs stopwords
+const char* script_language(Script script) {
+    switch (script) {
+        case Script::GREEK: return "el";
+        case Script::CYRILLIC: return "ru";
+        case Script::HEBREW: return "he";
+        case Script::ARABIC: return "ar";
+        case Script::DEVANAGARI: return "hi";
+        case Script::THAI: return "th";
+        case Script::HANGUL: return "ko";
+        case Script::KANA: return "ja";
+        case Script::HAN: return "zh";
+        default: return nullptr;
+    }
+}
+
+// Decodes the UTF-8 sequence at text[i] and advances i past it; malformed
+// bytes are consumed one at a time and decode as U+FFFD
+uint32_t next_code_point(const std::string& text, size_t& i) {
+    const unsigned char lead = static_cast<unsigned char>(text[i]);
+    size_t length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 0;
+    if (length == 0 || i + length > text.size()) {
+        i++;
+        return 0xFFFD;
+    }
+    
+    uint32_t cp = lead & (0x7F >> length);
+    for (size_t k = 1; k < length; ++k) {
+        unsigned char next = static_cast<unsigned char>(text[i + k]);
+        if ((next & 0xC0) != 0x80) {
+            i++;
+            return 0xFFFD;
+        }
+        cp = (cp << 6) | (next & 0x3F);
+    }
+    i += length;
+    return cp;
+}
+
+uint64_t stopword_hash(const char* word, size_t length) {
+    uint64_t hash = 14695981039346656037ull;  // FNV-1a
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ static_cast<unsigned char>(word[i])) * 1099511628211ull;
+    }
+    return hash;
+}
+
+size_t stopword_slot(uint64_t hash, uint32_t displacement, size_t slot_mask) {
+    uint32_t h1 = static_cast<uint32_t>(hash);
+    uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1u;
+    return (h1 + displacement * h2) & slot_mask;
+}
+
+} // anonymous namespace
+
 SimpleLanguageDetector::SimpleLanguageDetector() {
     initialize_patterns();
+    build_stopword_table();
 }
 
 void SimpleLanguageDetector::initialize_patterns() {
@@ -195,33 +490,89 @@ void SimpleLanguageDetector::initialize_patterns() {
     };
 }
 
-double SimpleLanguageDetector::calculate_language_score(const std::string& text, const std::string& language) const {
-    auto it = language_patterns_.find(language);
-    if (it == language_patterns_.end()) {
-        return 0.0;
+void SimpleLanguageDetector::build_stopword_table() {
+    // Bits follow sorted language codes so ties resolve the same way every run
+    stopword_languages_.clear();
+    for (const auto& [language, patterns] : language_patterns_) {
+        stopword_languages_.push_back(language);
+    }
+    std::sort(stopword_languages_.begin(), stopword_languages_.end());
+    if (stopword_languages_.size() > 32) {
+        throw std::runtime_error("Stopword table supports at most 32 languages");
+    }
+    
+    // Words shared by several languages become one key with several bits
+    std::unordered_map<std::string, uint32_t> masks;
+    for (size_t l = 0; l < stopword_languages_.size(); ++l) {
+        for (const auto& word : language_patterns_.at(stopword_languages_[l])) {
+            if (!word.empty() && word.size() <= MAX_STOPWORD_BYTES) {
+                masks[word] |= 1u << l;
+            }
+        }
     }
     
-    const auto& patterns = it->second;
-    std::string lower_text = text;
-    std::transform(lower_text.begin(), lower_text.end(), lower_text.begin(), ::tolower);
+    // Hash and displace: place the largest buckets first, trying displacements
+    // until every word of the bucket lands in a free slot
+    size_t capacity = 1;
+    while (capacity < 2 * masks.size()) capacity <<= 1;
+    const size_t num_buckets = std::max<size_t>(1, masks.size() / 2);
     
-    int matches = 0;
-    int total_words = 0;
+    std::vector<std::vector<std::pair<const std::string*, uint32_t>>> buckets(num_buckets);
+    for (const auto& [word, mask] : masks) {
+        buckets[stopword_hash(word.data(), word.size()) % num_buckets].emplace_back(&word, mask);
+    }
+    std::vector<size_t> order(num_buckets);
+    for (size_t b = 0; b < num_buckets; ++b) order[b] = b;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
     
-    std::istringstream iss(lower_text);
-    std::string word;
+    stopword_slots_.assign(capacity, StopwordSlot{});
+    stopword_displacements_.assign(num_buckets, 0);
+    std::vector<bool> used(capacity, false);
+    std::vector<size_t> slots;
     
-    while (iss >> word) {
-        total_words++;
-        // Remove punctuation
-        word.erase(std::remove_if(word.begin(), word.end(), ::ispunct), word.end());
+    for (size_t b : order) {
+        const auto& bucket = buckets[b];
+        if (bucket.empty()) continue;
         
-        if (std::find(patterns.begin(), patterns.end(), word) != patterns.end()) {
-            matches++;
+        for (uint32_t displacement = 0;; ++displacement) {
+            if (displacement == (1u << 24)) {
+                throw std::runtime_error("Could not build perfect hash for stopword table");
+            }
+            
+            slots.clear();
+            bool placed = true;
+            for (const auto& [word, mask] : bucket) {
+                size_t slot = stopword_slot(stopword_hash(word->data(), word->size()), displacement, capacity - 1);
+                if (used[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                    placed = false;
+                    break;
+                }
+                slots.push_back(slot);
+            }
+            if (!placed) continue;
+            
+            for (size_t k = 0; k < bucket.size(); ++k) {
+                used[slots[k]] = true;
+                stopword_slots_[slots[k]] = StopwordSlot{*bucket[k].first, bucket[k].second};
+            }
+            stopword_displacements_[b] = displacement;
+            break;
         }
     }
+}
+
+uint32_t SimpleLanguageDetector::lookup_stopword(const char* word, size_t length) const {
+    if (stopword_slots_.empty()) {
+        return 0;
+    }
+    
+    uint64_t hash = stopword_hash(word, length);
+    uint32_t displacement = stopword_displacements_[hash % stopword_displacements_.size()];
+    const StopwordSlot& slot = stopword_slots_[stopword_slot(hash, displacement, stopword_slots_.size() - 1)];
     
-    return total_words > 0 ? double(matches) / total_words : 0.0;
+    bool match = slot.word.size() == length && std::memcmp(slot.word.data(), word, length) == 0;
+    return match ? slot.languages : 0;
 }
 
 LanguageDetection SimpleLanguageDetector::detect(const std::string& text) {
@@ -229,14 +580,101 @@ LanguageDetection SimpleLanguageDetector::detect(const std::string& text) {
         return LanguageDetection("unknown", 0.0);
     }
     
+    size_t script_letters[SCRIPT_COUNT] = {};
+    size_t letters = 0;
+    uint32_t matches[32] = {};
+    size_t total_words = 0;
+    
+    // Whitespace-separated words, ASCII-lowercased with ASCII punctuation dropped
+    char word[MAX_STOPWORD_BYTES];
+    size_t word_length = 0;
+    bool in_word = false;
+    bool word_fits = true;
+    
+    auto append = [&](char c) {
+        if (word_length < MAX_STOPWORD_BYTES) {
+            word[word_length++] = c;
+        } else {
+            word_fits = false;
+        }
+    };
+    
+    auto end_word = [&]() {
+        if (!in_word) return;
+        total_words++;
+        if (word_fits && word_length > 0) {
+            for (uint32_t mask = lookup_stopword(word, word_length); mask != 0; mask &= mask - 1) {
+                matches[__builtin_ctz(mask)]++;
+            }
+        }
+        in_word = false;
+        word_fits = true;
+        word_length = 0;
+    };
+    
+    for (size_t i = 0; i < text.size();) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c < 0x80) {
+            i++;
+            if (std::isspace(c)) {
+                end_word();
+                continue;
+            }
+            in_word = true;
+            if (std::ispunct(c)) continue;
+            if (std::isalpha(c)) {
+                script_letters[static_cast<size_t>(Script::LATIN)]++;
+                letters++;
+            }
+            append(static_cast<char>(std::tolower(c)));
+            continue;
+        }
+        
+        size_t start = i;
+        Script script = classify_code_point(next_code_point(text, i));
+        in_word = true;
+        for (size_t k = start; k < i; ++k) {
+            append(text[k]);
+        }
+        if (script == Script::OTHER) continue;
+        
+        size_t& count = script_letters[static_cast<size_t>(script)];
+        count++;
+        letters++;
+        
+        // A run of letters all in one script that implies a language decides at once;
+        // Han is shared by Chinese and Japanese, so it waits for the whole text
+        if (letters == SCRIPT_SAMPLE && count == SCRIPT_SAMPLE && script != Script::HAN && script_language(script)) {
+            return LanguageDetection(script_language(script), 1.0);
+        }
+    }
+    end_word();
+    
+    // Japanese mixes kana with Han characters
+    size_t& kana = script_letters[static_cast<size_t>(Script::KANA)];
+    size_t& han = script_letters[static_cast<size_t>(Script::HAN)];
+    if (kana > 0) {
+        kana += han;
+        han = 0;
+    }
+    
+    size_t dominant = static_cast<size_t>(Script::LATIN);
+    for (size_t s = 0; s < SCRIPT_COUNT; ++s) {
+        if (script_letters[s] > script_letters[dominant]) dominant = s;
+    }
+    const char* script_code = script_language(static_cast<Script>(dominant));
+    if (script_code && script_letters[dominant] * 2 > letters) {
+        return LanguageDetection(script_code, double(script_letters[dominant]) / letters);
+    }
+    
+    // Latin script: the language whose stopwords make up most of the words
     std::string best_language = "unknown";
     double best_score = 0.0;
-    
-    for (const auto& [language, patterns] : language_patterns_) {
-        double score = calculate_language_score(text, language);
+    for (size_t l = 0; l < stopword_languages_.size() && total_words > 0; ++l) {
+        double score = double(matches[l]) / total_words;
         if (score > best_score) {
             best_score = score;
-            best_language = language;
+            best_language = stopword_languages_[l];
         }
     }
     
@@ -247,9 +685,12 @@ LanguageDetection SimpleLanguageDetector::detect(const std::string& text) {
 }
 
 std::vector<std::string> SimpleLanguageDetector::get_supported_languages() const {
-    std::vector<std::string> languages;
-    for (const auto& [lang, patterns] : language_patterns_) {
-        languages.push_back(lang);
+    std::vector<std::string> languages = stopword_languages_;
+    for (size_t s = 0; s < SCRIPT_COUNT; ++s) {
+        const char* code = script_language(static_cast<Script>(s));
+        if (code && std::find(languages.begin(), languages.end(), code) == languages.end()) {
+            languages.push_back(code);
+        }
     }
     return languages;
 }
@@ -258,23 +699,117 @@ bool SimpleLanguageDetector::is_ready() const {
     return !language_patterns_.empty();
 }
 
+// ==============================================================================
+// Character N-gram Language Detector Implementation
+// ==============================================================================
+
+CharNGramLanguageDetector::CharNGramLanguageDetector(const std::string& model_path) {
+    if (!model_path.empty()) {
+        load_model(model_path);
+    }
+}
+
+CharNGramLanguageDetector::CharNGramLanguageDetector(CharNGramLanguageModel model)
+    : model_(std::make_unique<CharNGramLanguageModel>(std::move(model))) {}
+
+CharNGramLanguageDetector::~CharNGramLanguageDetector() = default;
+
+bool CharNGramLanguageDetector::load_model(const std::string& model_path) {
+    try {
+        auto model = std::make_unique<CharNGramLanguageModel>();
+        model->load(model_path);
+        model_ = std::move(model);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading language model: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+LanguageDetection CharNGramLanguageDetector::detect(const std::string& text) {
+    if (!is_ready()) {
+        return LanguageDetection("unknown", 0.0);
+    }
+    
+    CharNGramLanguageModel::Prediction prediction = model_->predict(text);
+    if (prediction.features == 0) {
+        return LanguageDetection("unknown", 0.0);
+    }
+    return LanguageDetection(model_->language(prediction.language), prediction.probability);
+}
+
+std::vector<LanguageSpan> CharNGramLanguageDetector::detect_windows(const std::string& text, size_t window_bytes,
+                                                                    size_t stride_bytes) {
+    std::vector<LanguageSpan> windows = language_utils::sliding_windows(text, window_bytes, stride_bytes);
+    if (!is_ready() || windows.empty()) {
+        return windows;
+    }
+    
+    // Window k covers blocks [k, k + per_window)
+    const std::vector<size_t> starts = stride_block_starts(text, stride_bytes);
+    const size_t per_window = blocks_per_window(window_bytes, stride_bytes);
+    const size_t lanes = model_->padded_languages();
+    std::vector<int32_t> block_sums;
+    std::vector<size_t> block_features;
+    model_->block_totals(text.data(), text.size(), starts, block_sums, block_features);
+    
+    std::vector<int32_t> sums(lanes, 0);
+    size_t features = 0;
+    size_t added = 0;
+    for (size_t k = 0; k < windows.size(); ++k) {
+        for (; added < std::min(k + per_window, starts.size()); ++added) {
+            const int32_t* block = &block_sums[added * lanes];
+            for (size_t l = 0; l < lanes; ++l) sums[l] += block[l];
+            features += block_features[added];
+        }
+        if (k > 0) {
+            const int32_t* block = &block_sums[(k - 1) * lanes];
+            for (size_t l = 0; l < lanes; ++l) sums[l] -= block[l];
+            features -= block_features[k - 1];
+        }
+        
+        CharNGramLanguageModel::Prediction prediction = model_->predict_totals(sums.data(), features);
+        if (prediction.features > 0) {
+            windows[k].language = model_->language(prediction.language);
+            windows[k].confidence = prediction.probability;
+        }
+    }
+    return windows;
+}
+
+std::vector<std::string> CharNGramLanguageDetector::get_supported_languages() const {
+    return is_ready() ? model_->languages() : std::vector<std::string>{};
+}
+
+bool CharNGramLanguageDetector::is_ready() const {
+    return model_ && model_->is_loaded();
+}
+
 // ==============================================================================
 // Language Filter Implementation
 // ==============================================================================
 
 LanguageFilter::LanguageFilter(const LanguageFilterConfig& config)
     : config_(config) {
-    // Try to initialize FastText detector, fallback to simple detector
+    // Prefer a fastText model, then the built-in n-gram model, then the simple detector
     auto fasttext_detector = std::make_unique<FastTextLanguageDetector>();
     
     // Try to load default model
     std::string model_path = language_utils::get_default_model_path();
     if (!model_path.empty() && fasttext_detector->load_model(model_path)) {
         detector_ = std::move(fasttext_detector);
-    } else {
-        // Fallback to simple detector
-        detector_ = std::make_unique<SimpleLanguageDetector>();
+        return;
     }
+    
+    std::string ngram_model_path = language_utils::get_default_ngram_model_path();
+    if (!ngram_model_path.empty()) {
+        auto ngram_detector = std::make_unique<CharNGramLanguageDetector>(ngram_model_path);
+        if (ngram_detector->is_ready()) {
+            detector_ = std::move(ngram_detector);
+            return;
+        }
+    }
+    detector_ = std::make_unique<SimpleLanguageDetector>();
 }
 
 LanguageFilter::LanguageFilter(LanguageFilter&& other) noexcept
@@ -316,6 +851,107 @@ bool LanguageFilter::should_keep_document(const LanguageDetection& detection) co
     return true;
 }
 
+std::vector<LanguageDetection> LanguageFilter::detect_texts(const std::vector<std::string>& texts) const {
+    if (config_.enable_parallel_processing) {
+        return detector_->detect_batch(texts);
+    }
+    
+    std::vector<LanguageDetection> results;
+    results.reserve(texts.size());
+    for (const auto& text : texts) {
+        results.push_back(detector_->detect(text));
+    }
+    return results;
+}
+
+std::vector<std::string> LanguageFilter::escalation_samples(const std::string& text, size_t prefix_bytes,
+                                                           size_t& bytes_read) const {
+    // Samples start at even fractions of the text, after the prefix already read
+    std::vector<std::string> samples;
+    const size_t count = std::max<size_t>(config_.max_samples, 1);
+    size_t previous_end = prefix_bytes;
+    for (size_t k = 1; k < count; ++k) {
+        size_t start = utf8_boundary(text, std::max(previous_end, text.size() / count * k));
+        if (start >= text.size()) break;
+        size_t end = utf8_boundary(text, start + config_.sample_bytes);
+        samples.push_back(preprocess_text(text.substr(start, end - start)));
+        bytes_read += end - start;
+        previous_end = end;
+    }
+    return samples;
+}
+
+bool LanguageFilter::combine_samples(const std::vector<LanguageDetection>& samples,
+                                     LanguageDetection& combined) const {
+    // Samples with nothing to classify abstain; the rest must name one language
+    std::string language;
+    double total_confidence = 0.0;
+    size_t voters = 0;
+    for (const auto& sample : samples) {
+        if (sample.language == "unknown") continue;
+        if (!language.empty() && sample.language != language) {
+            return false;
+        }
+        language = sample.language;
+        total_confidence += sample.confidence;
+        voters++;
+    }
+    if (voters == 0 || total_confidence / voters < config_.min_confidence) {
+        return false;
+    }
+    
+    combined.language = language;
+    combined.confidence = total_confidence / voters;
+    return true;
+}
+
+LanguageSegmentation LanguageFilter::segment_languages(const Document& document) const {
+    if (!detector_) {
+        return LanguageSegmentation{};
+    }
+    
+    const std::string& text = document.text();
+    std::vector<LanguageSpan> windows = detector_->detect_windows(text, config_.segment_window_bytes,
+                                                                  config_.segment_stride_bytes);
+    return segment_from_windows(text.size(), windows);
+}
+
+std::string LanguageFilter::trim_to_kept_spans(const std::string& text, const LanguageSegmentation& segmentation,
+                                               LanguageDetection& detection) const {
+    std::vector<std::string> keep = config_.target_languages;
+    if (keep.empty()) {
+        keep.push_back(segmentation.dominant_language());
+    }
+    
+    std::string kept;
+    std::unordered_map<std::string, size_t> kept_bytes;
+    double weighted_confidence = 0.0;
+    for (const auto& span : segmentation.spans) {
+        if (span.confidence < config_.min_confidence ||
+            std::find(keep.begin(), keep.end(), span.language) == keep.end()) {
+            continue;
+        }
+        if (!kept.empty()) {
+            kept += '\n';
+        }
+        kept.append(text, span.begin, span.length());
+        kept_bytes[span.language] += span.length();
+        weighted_confidence += span.confidence * span.length();
+    }
+    
+    size_t total = 0;
+    size_t best_bytes = 0;
+    for (const auto& [language, bytes] : kept_bytes) {
+        total += bytes;
+        if (bytes > best_bytes || (bytes == best_bytes && language < detection.language)) {
+            best_bytes = bytes;
+            detection.language = language;
+        }
+    }
+    detection.confidence = total > 0 ? weighted_confidence / total : 0.0;
+    return kept;
+}
+
 bool LanguageFilter::is_mixed_language(const std::string& text) const {
     if (!config_.remove_mixed_language) {
         return false;
@@ -328,57 +964,234 @@ LanguageFilterResult LanguageFilter::filter(const std::vector<Document>& documen
     return filter(documents, nullptr);
 }
 
-LanguageFilterResult LanguageFilter::filter(
-    const std::vector<Document>& documents,
-    std::function<void(size_t, size_t, const std::string&)> progress_callback
-) const {
-    LanguageFilterResult result;
-    result.total_processed = documents.size();
-    
-    double total_confidence = 0.0;
-    size_t valid_detections = 0;
+void LanguageFilter::detect_range(const std::vector<Document>& documents, size_t begin, size_t end,
+                                  bool apply_prefilters, std::vector<PreDetection>& status,
+                                  std::vector<LanguageDetection>& detections,
+                                  std::vector<std::string>& trimmed) const {
+    const size_t count = end - begin;
+    status.assign(count, PreDetection::DETECTED);
+    detections.assign(count, LanguageDetection("unknown", 0.0));
+    trimmed.assign(count, std::string());
+    std::vector<std::string> texts(count);
+    std::vector<size_t> inspected(count, 0);
+    std::vector<char> from_windows(count, false);
+    const bool segment = apply_prefilters && config_.remove_mixed_language && config_.segment_languages;
+    const bool sampling = config_.sample_bytes > 0;
     
-    for (size_t i = 0; i < documents.size(); ++i) {
-        const auto& doc = documents[i];
+    // Preprocessing (regex cleaning, script checks) is independent per document
+    auto prepare = [&](size_t i) {
+        const auto& doc = documents[begin + i];
         
-        if (progress_callback) {
-            progress_callback(i + 1, documents.size(), "Language filtering");
+        // Skip very short documents
+        if (apply_prefilters && doc.text().length() < config_.min_text_length) {
+            status[i] = PreDetection::TOO_SHORT;
+            return;
         }
         
-        // Skip very short documents
-        if (doc.text().length() < config_.min_text_length) {
-            result.rejected_documents.push_back(doc);
-            result.total_rejected++;
-            continue;
+        // Mixed documents by language proportions over sliding windows
+        if (segment) {
+            inspected[i] = doc.text().size();
+            LanguageSegmentation segmentation = segment_languages(doc);
+            if (segmentation.is_mixed(config_.mixed_language_threshold)) {
+                std::string kept;
+                if (config_.trim_mixed_documents) {
+                    kept = trim_to_kept_spans(doc.text(), segmentation, detections[i]);
+                }
+                if (!kept.empty() && kept.size() >= config_.min_text_length) {
+                    status[i] = PreDetection::TRIMMED;
+                    trimmed[i] = std::move(kept);
+                } else {
+                    status[i] = PreDetection::MIXED;
+                }
+                return;
+            }
+            
+            // Not mixed: the windows have already detected the document
+            std::string dominant = segmentation.dominant_language();
+            if (dominant != "unknown") {
+                double weighted_confidence = 0.0;
+                size_t bytes = 0;
+                for (const auto& span : segmentation.spans) {
+                    if (span.language != dominant) continue;
+                    weighted_confidence += span.confidence * span.length();
+                    bytes += span.length();
+                }
+                detections[i] = LanguageDetection(dominant, weighted_confidence / bytes);
+                from_windows[i] = true;
+                return;
+            }
         }
         
-        // Preprocess text
-        std::string processed_text = preprocess_text(doc.text());
+        // A sampled document is read from its prefix; the script check sees only that
+        if (sampling && !segment && doc.text().size() > config_.sample_bytes) {
+            inspected[i] = utf8_boundary(doc.text(), config_.sample_bytes);
+            texts[i] = preprocess_text(doc.text().substr(0, inspected[i]));
+        } else {
+            inspected[i] = doc.text().size();
+            texts[i] = preprocess_text(doc.text());
+        }
         
         // Check for mixed languages if enabled
-        if (is_mixed_language(processed_text)) {
-            result.rejected_documents.push_back(doc);
-            result.total_rejected++;
-            continue;
+        if (apply_prefilters && !segment && is_mixed_language(texts[i])) {
+            status[i] = PreDetection::MIXED;
+            texts[i].clear();
         }
-        
-        // Detect language
-        LanguageDetection detection = detector_->detect(processed_text);
-        
-        // Update statistics
-        result.language_counts[detection.language]++;
-        if (detection.confidence > 0.0) {
-            total_confidence += detection.confidence;
-            valid_detections++;
+    };
+    
+#ifdef USE_OPENMP
+    // Segmenting runs the detector too, so it must allow concurrent calls
+    const bool parallel_prepare = config_.enable_parallel_processing && count > 1 &&
+                                  (!segment || detector_->supports_concurrent_detect());
+    #pragma omp parallel for schedule(dynamic, 16) if(parallel_prepare)
+#endif
+    for (size_t i = 0; i < count; ++i) {
+        prepare(i);
+    }
+    
+    // Detect the survivors as one batch so the detector can spread it over threads
+    std::vector<size_t> pending;
+    std::vector<std::string> pending_texts;
+    for (size_t i = 0; i < count; ++i) {
+        if (status[i] == PreDetection::DETECTED && !from_windows[i]) {
+            pending.push_back(i);
+            pending_texts.push_back(std::move(texts[i]));
+        }
+    }
+    
+    std::vector<LanguageDetection> results = detect_texts(pending_texts);
+    for (size_t j = 0; j < pending.size(); ++j) {
+        detections[pending[j]] = std::move(results[j]);
+    }
+    
+    if (sampling) {
+        escalate_unsure(documents, begin, pending, detections, inspected);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        detections[i].bytes_inspected = inspected[i];
+    }
+}
+
+void LanguageFilter::escalate_unsure(const std::vector<Document>& documents, size_t begin,
+                                     const std::vector<size_t>& detected,
+                                     std::vector<LanguageDetection>& detections,
+                                     std::vector<size_t>& inspected) const {
+    // Prefixes below min_confidence with text left unread
+    std::vector<size_t> unsure;
+    for (size_t i : detected) {
+        if (detections[i].confidence < config_.min_confidence && inspected[i] < documents[begin + i].text().size()) {
+            unsure.push_back(i);
+        }
+    }
+    if (unsure.empty()) {
+        return;
+    }
+    
+    // First escalation: strided samples across the rest of each document
+    std::vector<std::vector<std::string>> samples(unsure.size());
+#ifdef USE_OPENMP
+    #pragma omp parallel for schedule(dynamic, 16) if(config_.enable_parallel_processing && unsure.size() > 1)
+#endif
+    for (size_t u = 0; u < unsure.size(); ++u) {
+        const size_t i = unsure[u];
+        samples[u] = escalation_samples(documents[begin + i].text(), inspected[i], inspected[i]);
+    }
+    
+    std::vector<std::string> sample_texts;
+    for (auto& document_samples : samples) {
+        for (auto& sample : document_samples) sample_texts.push_back(std::move(sample));
+    }
+    std::vector<LanguageDetection> sample_results = detect_texts(sample_texts);
+    
+    std::vector<size_t> undecided;
+    size_t next = 0;
+    for (size_t u = 0; u < unsure.size(); ++u) {
+        const size_t i = unsure[u];
+        std::vector<LanguageDetection> votes = {detections[i]};
+        for (size_t k = 0; k < samples[u].size(); ++k) {
+            votes.push_back(std::move(sample_results[next++]));
+        }
+        if (!combine_samples(votes, detections[i])) {
+            undecided.push_back(i);
         }
+    }
+    
+    // Last resort: unsure or disagreeing samples fall back to the full text
+    std::vector<std::string> full_texts(undecided.size());
+#ifdef USE_OPENMP
+    #pragma omp parallel for schedule(dynamic, 16) if(config_.enable_parallel_processing && undecided.size() > 1)
+#endif
+    for (size_t u = 0; u < undecided.size(); ++u) {
+        full_texts[u] = preprocess_text(documents[begin + undecided[u]].text());
+    }
+    std::vector<LanguageDetection> full_results = detect_texts(full_texts);
+    for (size_t u = 0; u < undecided.size(); ++u) {
+        const size_t i = undecided[u];
+        inspected[i] += documents[begin + i].text().size();
+        detections[i] = std::move(full_results[u]);
+    }
+}
+
+LanguageFilterResult LanguageFilter::filter(
+    const std::vector<Document>& documents,
+    std::function<void(size_t, size_t, const std::string&)> progress_callback
+) const {
+    LanguageFilterResult result;
+    result.total_processed = documents.size();
+    
+    double total_confidence = 0.0;
+    size_t valid_detections = 0;
+    
+    const size_t batch_size = std::max<size_t>(config_.batch_size, 1);
+    std::vector<PreDetection> status;
+    std::vector<LanguageDetection> detections;
+    std::vector<std::string> trimmed;
+    
+    for (size_t begin = 0; begin < documents.size(); begin += batch_size) {
+        size_t end = std::min(documents.size(), begin + batch_size);
+        detect_range(documents, begin, end, true, status, detections, trimmed);
         
-        // Decide whether to keep the document
-        if (should_keep_document(detection)) {
-            result.filtered_documents.push_back(doc);
-            result.total_kept++;
-        } else {
-            result.rejected_documents.push_back(doc);
-            result.total_rejected++;
+        // Results are assembled in input order
+        for (size_t i = begin; i < end; ++i) {
+            const auto& doc = documents[i];
+            const LanguageDetection& detection = detections[i - begin];
+            
+            if (progress_callback) {
+                progress_callback(i + 1, documents.size(), "Language filtering");
+            }
+            
+            result.total_bytes += doc.text().size();
+            result.bytes_inspected += detection.bytes_inspected;
+            
+            const PreDetection outcome = status[i - begin];
+            if (outcome == PreDetection::TOO_SHORT || outcome == PreDetection::MIXED) {
+                result.rejected_documents.push_back(doc);
+                result.total_rejected++;
+                continue;
+            }
+            
+            // Update statistics
+            result.language_counts[detection.language]++;
+            if (detection.confidence > 0.0) {
+                total_confidence += detection.confidence;
+                valid_detections++;
+            }
+            
+            // Mixed documents keep only their target-language spans
+            if (outcome == PreDetection::TRIMMED) {
+                result.filtered_documents.emplace_back(trimmed[i - begin], doc.id());
+                result.total_kept++;
+                result.total_trimmed++;
+                continue;
+            }
+            
+            // Decide whether to keep the document
+            if (should_keep_document(detection)) {
+                result.filtered_documents.push_back(doc);
+                result.total_kept++;
+            } else {
+                result.rejected_documents.push_back(doc);
+                result.total_rejected++;
+            }
         }
     }
     
@@ -393,18 +1206,55 @@ LanguageDetection LanguageFilter::detect_language(const Document& document) cons
         return LanguageDetection("unknown", 0.0);
     }
     
-    std::string processed_text = preprocess_text(document.text());
-    return detector_->detect(processed_text);
+    const std::string& text = document.text();
+    if (config_.sample_bytes == 0 || text.size() <= config_.sample_bytes) {
+        LanguageDetection detection = detector_->detect(preprocess_text(text));
+        detection.bytes_inspected = text.size();
+        return detection;
+    }
+    
+    // Prefix first, then strided samples, then the full text
+    size_t prefix_bytes = utf8_boundary(text, config_.sample_bytes);
+    LanguageDetection detection = detector_->detect(preprocess_text(text.substr(0, prefix_bytes)));
+    detection.bytes_inspected = prefix_bytes;
+    if (detection.confidence >= config_.min_confidence) {
+        return detection;
+    }
+    
+    std::vector<LanguageDetection> votes = {detection};
+    for (const auto& sample : escalation_samples(text, prefix_bytes, detection.bytes_inspected)) {
+        votes.push_back(detector_->detect(sample));
+    }
+    if (combine_samples(votes, detection)) {
+        return detection;
+    }
+    
+    size_t bytes_read = detection.bytes_inspected + text.size();
+    detection = detector_->detect(preprocess_text(text));
+    detection.bytes_inspected = bytes_read;
+    return detection;
 }
 
 std::unordered_map<std::string, size_t> LanguageFilter::get_language_stats(
     const std::vector<Document>& documents
 ) const {
     std::unordered_map<std::string, size_t> stats;
+    if (!detector_) {
+        stats["unknown"] = documents.size();
+        return stats;
+    }
     
-    for (const auto& doc : documents) {
-        LanguageDetection detection = detect_language(doc);
-        stats[detection.language]++;
+    const size_t batch_size = std::max<size_t>(config_.batch_size, 1);
+    std::vector<PreDetection> status;
+    std::vector<LanguageDetection> detections;
+    std::vector<std::string> trimmed;
+    
+    for (size_t begin = 0; begin < documents.size(); begin += batch_size) {
+        size_t end = std::min(documents.size(), begin + batch_size);
+        detect_range(documents, begin, end, false, status, detections, trimmed);
+        for (const auto& detection : detections) {
+            stats[detection.language]++;
+        }
     }
     
     return stats;
@@ -509,6 +1359,21 @@ bool has_mixed_scripts(const std::string& text) {
     return script_count > 1;
 }
 
+std::vector<LanguageSpan> sliding_windows(const std::string& text, size_t window_bytes, size_t stride_bytes) {
+    std::vector<LanguageSpan> windows;
+    const std::vector<size_t> starts = stride_block_starts(text, stride_bytes);
+    const size_t per_window = blocks_per_window(window_bytes, stride_bytes);
+    
+    for (size_t k = 0; k < starts.size(); ++k) {
+        LanguageSpan window;
+        window.begin = starts[k];
+        window.end = k + per_window < starts.size() ? starts[k + per_window] : text.size();
+        windows.push_back(window);
+        if (k + per_window >= starts.size()) break;
+    }
+    return windows;
+}
+
 double adjust_confidence_for_length(double base_confidence, size_t text_length) {
     if (text_length < 20) {
         return base_confidence * 0.5;  // Very short text is unreliable
@@ -547,6 +1412,24 @@ std::string get_default_model_path() {
     return "";  // No model found
 }
 
+std::string get_default_ngram_model_path() {
+    std::vector<std::string> possible_paths = {
+        "./models/rapidsift-langid.bin",
+        "./rapidsift-langid.bin",
+        "/usr/local/share/rapidsift/langid.bin",
+        "/opt/rapidsift/langid.bin"
+    };
+    
+    for (const auto& path : possible_paths) {
+        std::ifstream file(path);
+        if (file.good()) {
+            return path;
+        }
+    }
+    
+    return "";  // No model found
+}
+
 } // namespace language_utils
 
 } // namespace rapidsift 
\ No newline at end of file
@@ -5,11 +5,16 @@
 #include <vector>
 #include <algorithm>
 #include <sstream>
+#include <filesystem>
+#include <fstream>
 
 #include "rapidsift/exact_dedup.hpp"
 #include "rapidsift/near_dedup.hpp"
 #include "rapidsift/language_filter.hpp"
+#include "rapidsift/ngram_language_model.hpp"
 #include "rapidsift/text_extractor.hpp"
+#include "rapidsift/warc_reader.hpp"
+#include "rapidsift/decontamination_filter.hpp"
 #include "rapidsift/common.hpp"
 
 using namespace rapidsift;
@@ -24,7 +29,8 @@ void print_help() {
     std::cout << "Usage: rapidsift [OPTIONS]\n\n";
     std::cout << "Options:\n";
     std::cout << "  --help              Show this help message\n";
-    std::cout << "  --mode MODE         Processing mode: exact, near, language, extract, benchmark\n";
+    std::cout << "  --mode MODE         Processing mode: exact, near, language, train-langid, extract,\n";
+    std::cout << "                      build-index, decontaminate, benchmark\n";
     std::cout << "  --input FILE        Input file (TXT or CSV)\n";
     std::cout << "  --output FILE       Output file (optional)\n";
     std::cout << "  --algorithm ALGO    Hash algorithm for exact mode: md5, sha1, sha256, xxhash (default: xxhash)\n";
@@ -35,7 +41,19 @@ void print_help() {
     std::cout << "  --min-confidence N  Minimum confidence threshold (default: 0.65)\n";
     std::cout << "  --min-length N      Minimum text length for filtering (default: 10)\n";
     std::cout << "  --mixed-languages   Allow mixed-language documents (default: reject)\n";
+    std::cout << "  --segment-languages Find mixed documents from per-window language proportions\n";
+    std::cout << "  --trim-mixed        Keep the target-language spans of mixed documents (implies --segment-languages)\n";
+    std::cout << "  --segment-window N  Bytes per segmentation window (default: 256)\n";
+    std::cout << "  --segment-stride N  Bytes between segmentation windows (default: 128)\n";
+    std::cout << "  --sample-bytes N    Detect from an N-byte prefix, reading more only when unsure (default: full text)\n";
+    std::cout << "  --max-samples N     Prefix plus strided samples before reading the full text (default: 4)\n";
     std::cout << "  --lang-stats        Show language statistics only\n";
+    std::cout << "  --langid-model FILE Built-in n-gram language model (written by train-langid)\n";
+    std::cout << "\nLanguage Model Training Options (train-langid):\n";
+    std::cout << "  --input FILE        Labeled corpus: \"__label__en text\" or \"en<TAB>text\" per line\n";
+    std::cout << "  --output FILE       Model file to write\n";
+    std::cout << "  --bucket-bits N     Log2 of hashed n-gram feature rows (default: 16)\n";
+    std::cout << "  --epochs N          Training passes over the corpus (default: 5)\n";
     std::cout << "\nText Extraction Options:\n";
     std::cout << "  --html-input        Input contains HTML documents\n";
     std::cout << "  --extract-title     Extract document titles\n";
@@ -43,13 +61,30 @@ void print_help() {
     std::cout << "  --min-text-ratio N  Minimum text/HTML ratio (default: 0.3)\n";
     std::cout << "  --quality-threshold N Minimum quality score (default: 0.0)\n";
     std::cout << "  --extraction-report FILE Save extraction quality report\n";
+    std::cout << "  --streaming         Extract in one pass over the HTML without building a DOM\n";
+    std::cout << "  An --input ending in .warc(.gz) or .wet(.gz) is streamed record by record; its HTML responses\n";
+    std::cout << "  are extracted and WET conversion text is passed through\n";
+    std::cout << "\nDecontamination Options:\n";
+    std::cout << "  --benchmarks PATHS  Benchmark files/directories for build-index (comma-separated)\n";
+    std::cout << "  --index FILE        Prebuilt benchmark n-gram index (written by build-index)\n";
+    std::cout << "  --ngram-size N      N-gram size; must match between build-index and decontaminate (default: 13)\n";
+    std::cout << "  --full-report       Probe every n-gram instead of stopping once the verdict is decided\n";
+    std::cout << "  --index-dir DIR     Disk-partitioned index for reference sets larger than memory (replaces --index)\n";
+    std::cout << "  --partitions N      Hash-range partitions when building --index-dir (default: 256)\n";
+    std::cout << "  --max-memory-mb N   Memory budget for the index and its build (default: 2048)\n";
     std::cout << "\nExamples:\n";
     std::cout << "  rapidsift --mode exact --input data.txt --output unique.txt\n";
     std::cout << "  rapidsift --mode near --method minhash --threshold 0.8 --input data.txt\n";
     std::cout << "  rapidsift --mode language --languages en --min-confidence 0.7 --input data.txt\n";
     std::cout << "  rapidsift --mode language --lang-stats --input data.txt\n";
+    std::cout << "  rapidsift --mode train-langid --input labeled.txt --output langid.bin\n";
+    std::cout << "  rapidsift --mode language --langid-model langid.bin --languages en --input data.txt\n";
     std::cout << "  rapidsift --mode extract --html-input --input pages.txt --output clean.txt\n";
     std::cout << "  rapidsift --mode extract --remove-boilerplate --quality-threshold 0.5 --input web.txt\n";
+    std::cout << "  rapidsift --mode extract --input segment.warc.gz --output clean.txt\n";
+    std::cout << "  rapidsift --mode build-index --benchmarks evals/ --index benchmarks.idx\n";
+    std::cout << "  rapidsift --mode decontaminate --index benchmarks.idx --input data.txt --output clean.txt\n";
+    std::cout << "  rapidsift --mode build-index --benchmarks corpus/ --index-dir corpus.idx --max-memory-mb 8192\n";
     std::cout << "  rapidsift --mode benchmark --input data.txt\n";
 }
 
@@ -101,24 +136,24 @@ bool has_flag(const std::vector<std::string>& args, const std::string& flag) {
     return std::find(args.begin(), args.end(), flag) != args.end();
 }
 
-std::vector<std::string> parse_languages(const std::string& lang_str) {
-    std::vector<std::string> languages;
-    if (lang_str.empty()) return languages;
+std::vector<std::string> parse_comma_list(const std::string& list_str) {
+    std::vector<std::string> items;
+    if (list_str.empty()) return items;
     
-    std::istringstream iss(lang_str);
-    std::string lang;
+    std::istringstream iss(list_str);
+    std::string item;
     
-    while (std::getline(iss, lang, ',')) {
+    while (std::getline(iss, item, ',')) {
         // Trim whitespace
-        lang.erase(0, lang.find_first_not_of(" \t"));
-        lang.erase(lang.find_last_not_of(" \t") + 1);
+        item.erase(0, item.find_first_not_of(" \t"));
+        item.erase(item.find_last_not_of(" \t") + 1);
         
-        if (!lang.empty()) {
-            languages.push_back(lang);
+        if (!item.empty()) {
+            items.push_back(item);
         }
     }
     
-    return languages;
+    return items;
 }
 
 void print_language_filter_stats(const LanguageFilterResult& result) {
@@ -128,6 +163,14 @@ void print_language_filter_stats(const LanguageFilterResult& result) {
     std::cout << "Total processed:       " << result.total_processed << "\n";
     std::cout << "Documents kept:        " << result.total_kept << "\n";
     std::cout << "Documents rejected:    " << result.total_rejected << "\n";
+    if (result.total_trimmed > 0) {
+        std::cout << "Trimmed to one language: " << result.total_trimmed << "\n";
+    }
+    if (result.total_bytes > 0) {
+        std::cout << "Text inspected:        " << result.bytes_inspected << " of " << result.total_bytes
+                  << " bytes (" << std::fixed << std::setprecision(1)
+                  << 100.0 * result.bytes_inspected / result.total_bytes << "%)\n";
+    }
     std::cout << "Kept percentage:       " << std::fixed << std::setprecision(1) 
               << result.kept_percentage() << "%\n";
     std::cout << "Average confidence:    " << std::fixed << std::setprecision(3) 
@@ -258,7 +301,14 @@ int run_language_filter(const std::vector<std::string>& args) {
     std::string min_confidence_str = get_arg_value(args, "--min-confidence");
     std::string min_length_str = get_arg_value(args, "--min-length");
     bool allow_mixed = has_flag(args, "--mixed-languages");
+    bool trim_mixed = has_flag(args, "--trim-mixed");
+    bool segment = has_flag(args, "--segment-languages") || trim_mixed;
+    std::string segment_window_str = get_arg_value(args, "--segment-window");
+    std::string segment_stride_str = get_arg_value(args, "--segment-stride");
+    std::string sample_bytes_str = get_arg_value(args, "--sample-bytes");
+    std::string max_samples_str = get_arg_value(args, "--max-samples");
     bool show_stats_only = has_flag(args, "--lang-stats");
+    std::string langid_model = get_arg_value(args, "--langid-model");
     
     if (input_file.empty()) {
         std::cerr << "Error: --input is required for language mode\n";
@@ -269,7 +319,7 @@ int run_language_filter(const std::vector<std::string>& args) {
     LanguageFilterConfig config;
     
     if (!languages_str.empty()) {
-        config.target_languages = parse_languages(languages_str);
+        config.target_languages = parse_comma_list(languages_str);
     }
     
     if (!min_confidence_str.empty()) {
@@ -281,6 +331,24 @@ int run_language_filter(const std::vector<std::string>& args) {
     }
     
     config.remove_mixed_language = !allow_mixed;
+    config.segment_languages = segment;
+    config.trim_mixed_documents = trim_mixed;
+    
+    if (!segment_window_str.empty()) {
+        config.segment_window_bytes = std::stoul(segment_window_str);
+    }
+    
+    if (!segment_stride_str.empty()) {
+        config.segment_stride_bytes = std::stoul(segment_stride_str);
+    }
+    
+    if (!sample_bytes_str.empty()) {
+        config.sample_bytes = std::stoul(sample_bytes_str);
+    }
+    
+    if (!max_samples_str.empty()) {
+        config.max_samples = std::stoul(max_samples_str);
+    }
     
     try {
         // Load documents
@@ -291,6 +359,14 @@ int run_language_filter(const std::vector<std::string>& args) {
         // Initialize language filter
         LanguageFilter filter(config);
         
+        if (!langid_model.empty()) {
+            auto detector = std::make_unique<CharNGramLanguageDetector>(langid_model);
+            if (!detector->is_ready()) {
+                return 1;
+            }
+            filter.set_detector(std::move(detector));
+        }
+        
         if (!filter.is_ready()) {
             std::cout << "Warning: Using simple language detector (fastText model not found)\n";
         }
@@ -336,39 +412,172 @@ int run_language_filter(const std::vector<std::string>& args) {
     }
 }
 
-void print_extraction_stats(const std::vector<TextExtractionResult>& results) {
-    std::cout << "\n" << std::string(60, '=') << "\n";
-    std::cout << "Text Extraction Results\n";
-    std::cout << std::string(60, '=') << "\n";
+int run_train_langid(const std::vector<std::string>& args) {
+    std::string input_file = get_arg_value(args, "--input");
+    std::string output_file = get_arg_value(args, "--output");
+    std::string bucket_bits_str = get_arg_value(args, "--bucket-bits");
+    std::string epochs_str = get_arg_value(args, "--epochs");
     
-    size_t total_docs = results.size();
-    size_t valid_docs = 0;
-    size_t total_html_length = 0;
-    size_t total_text_length = 0;
-    double total_quality = 0.0;
+    if (input_file.empty() || output_file.empty()) {
+        std::cerr << "Error: --input and --output are required for train-langid mode\n";
+        return 1;
+    }
     
-    for (const auto& result : results) {
+    try {
+        LanguageModelTrainingConfig config;
+        if (!bucket_bits_str.empty()) {
+            config.bucket_bits = static_cast<uint32_t>(std::stoul(bucket_bits_str));
+        }
+        if (!epochs_str.empty()) {
+            config.epochs = std::stoul(epochs_str);
+        }
+        
+        Timer timer;
+        CharNGramModelTrainer trainer(config);
+        std::cout << "Reading labeled corpus: " << input_file << std::endl;
+        size_t examples = trainer.add_corpus(input_file);
+        std::cout << "Loaded " << examples << " examples in " << trainer.num_languages() << " languages\n";
+        
+        CharNGramLanguageModel model = trainer.train([](size_t epoch, size_t epochs, double loss) {
+            std::cout << "Epoch " << epoch << "/" << epochs << ": loss " << std::fixed << std::setprecision(4)
+                      << loss << "\n";
+        });
+        model.save(output_file);
+        
+        std::cout << "Wrote " << model.num_languages() << "-language model (" << model.memory_bytes() / 1024
+                  << " KiB) to " << output_file << " in " << timer.elapsed_seconds() << "s\n";
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+struct ExtractionTotals {
+    size_t documents = 0;
+    size_t valid = 0;
+    size_t html_length = 0;
+    size_t text_length = 0;
+    double quality = 0.0;
+    
+    void add(const TextExtractionResult& result) {
+        documents++;
         if (result.is_valid()) {
-            valid_docs++;
+            valid++;
         }
-        total_html_length += result.original_html_length;
-        total_text_length += result.extracted_text_length;
-        total_quality += result.quality_score();
+        html_length += result.original_html_length;
+        text_length += result.extracted_text_length;
+        quality += result.quality_score();
     }
+};
+
+void print_extraction_stats(const ExtractionTotals& totals) {
+    std::cout << "\n" << std::string(60, '=') << "\n";
+    std::cout << "Text Extraction Results\n";
+    std::cout << std::string(60, '=') << "\n";
     
-    std::cout << "Total documents:       " << total_docs << "\n";
-    std::cout << "Valid extractions:     " << valid_docs << " (" 
+    std::cout << "Total documents:       " << totals.documents << "\n";
+    std::cout << "Valid extractions:     " << totals.valid << " (" 
               << std::fixed << std::setprecision(1) 
-              << (100.0 * valid_docs / total_docs) << "%)\n";
-    std::cout << "Total HTML size:       " << total_html_length << " chars\n";
-    std::cout << "Total text extracted:  " << total_text_length << " chars\n";
+              << (100.0 * totals.valid / totals.documents) << "%)\n";
+    std::cout << "Total HTML size:       " << totals.html_length << " chars\n";
+    std::cout << "Total text extracted:  " << totals.text_length << " chars\n";
     std::cout << "Overall text ratio:    " << std::fixed << std::setprecision(3)
-              << (total_html_length > 0 ? double(total_text_length) / total_html_length : 0.0) << "\n";
+              << (totals.html_length > 0 ? double(totals.text_length) / totals.html_length : 0.0) << "\n";
     std::cout << "Average quality:       " << std::fixed << std::setprecision(3)
-              << (total_docs > 0 ? total_quality / total_docs : 0.0) << "\n";
+              << (totals.documents > 0 ? totals.quality / totals.documents : 0.0) << "\n";
     std::cout << std::string(60, '=') << "\n\n";
 }
 
+void print_extraction_stats(const std::vector<TextExtractionResult>& results) {
+    ExtractionTotals totals;
+    for (const auto& result : results) {
+        totals.add(result);
+    }
+    print_extraction_stats(totals);
+}
+
+bool is_warc_path(const std::string& path) {
+    auto ends_with = [&](const std::string& suffix) {
+        return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    return ends_with(".warc") || ends_with(".warc.gz") || ends_with(".wet") || ends_with(".wet.gz");
+}
+
+// Streams a WARC or WET through extraction; results are written as they arrive,
+// so memory stays bounded whatever the file size
+int run_warc_extraction(const std::string& input_file, const std::string& output_file,
+                        const TextExtractionConfig& config, double quality_threshold) {
+    try {
+        std::ifstream input(input_file, std::ios::binary);
+        if (!input.is_open()) {
+            throw std::runtime_error("Could not open file: " + input_file);
+        }
+        
+        std::ofstream output;
+        bool csv_output = false;
+        if (!output_file.empty()) {
+            std::string extension = std::filesystem::path(output_file).extension().string();
+            if (extension != ".txt" && extension != ".csv") {
+                throw std::runtime_error("Unsupported output format: " + extension);
+            }
+            csv_output = extension == ".csv";
+            output.open(output_file);
+            if (!output.is_open()) {
+                throw std::runtime_error("Could not create file: " + output_file);
+            }
+            if (csv_output) output << "text\n";
+        }
+        
+        std::cout << "Streaming WARC records from: " << input_file << std::endl;
+        
+        TextExtractor extractor(config);
+        ExtractionTotals totals;
+        size_t kept = 0;
+        Timer timer;
+        
+        auto stats = extract_warc(input, extractor, [&](const TextExtractionResult& result) {
+            totals.add(result);
+            if (quality_threshold > 0.0 && result.quality_score() < quality_threshold) return;
+            kept++;
+            if (output.is_open()) {
+                if (csv_output) output << "\"" << result.extracted_text << "\"\n";
+                else output << result.extracted_text << '\n';
+            }
+            if (totals.documents % 1000 == 0) {
+                std::cout << "\rExtracted " << totals.documents << " documents" << std::flush;
+            }
+        });
+        
+        double seconds = timer.elapsed_seconds();
+        std::cout << "\rRead " << stats.records_read << " records ("
+                  << std::fixed << std::setprecision(1) << stats.bytes_read / (1024.0 * 1024.0) << " MiB) in "
+                  << seconds << "s";
+        if (seconds > 0) {
+            std::cout << ", " << stats.bytes_read / (1024.0 * 1024.0) / seconds << " MiB/s";
+        }
+        std::cout << "\n";
+        if (stats.records_skipped > 0) {
+            std::cout << "Skipped " << stats.records_skipped << " oversized records\n";
+        }
+        if (quality_threshold > 0.0) {
+            std::cout << "Quality filtering: kept " << kept << " of " << totals.documents << " documents\n";
+        }
+        
+        print_extraction_stats(totals);
+        
+        if (output.is_open()) {
+            std::cout << "Extracted text saved to: " << output_file << std::endl;
+        }
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
 int run_text_extraction(const std::vector<std::string>& args) {
     std::string input_file = get_arg_value(args, "--input");
     std::string output_file = get_arg_value(args, "--output");
@@ -379,6 +588,7 @@ int run_text_extraction(const std::vector<std::string>& args) {
     bool html_input = has_flag(args, "--html-input");
     bool extract_titles = has_flag(args, "--extract-title");
     bool remove_boilerplate = !has_flag(args, "--no-remove-boilerplate"); // Default true
+    bool streaming = has_flag(args, "--streaming");
     
     if (input_file.empty()) {
         std::cerr << "Error: --input is required for extract mode\n";
@@ -392,6 +602,7 @@ int run_text_extraction(const std::vector<std::string>& args) {
     config.remove_ads = remove_boilerplate;
     config.remove_headers_footers = remove_boilerplate;
     config.preserve_headings = extract_titles;
+    config.streaming_extraction = streaming;
     
     if (!min_ratio_str.empty()) {
         config.min_text_ratio = std::stod(min_ratio_str);
@@ -402,6 +613,13 @@ int run_text_extraction(const std::vector<std::string>& args) {
         quality_threshold = std::stod(quality_threshold_str);
     }
     
+    if (is_warc_path(input_file)) {
+        if (!report_file.empty()) {
+            std::cerr << "Warning: --extraction-report is not supported for WARC or WET input\n";
+        }
+        return run_warc_extraction(input_file, output_file, config, quality_threshold);
+    }
+    
     try {
         std::cout << "Loading documents from: " << input_file << std::endl;
         
@@ -494,6 +712,121 @@ int run_text_extraction(const std::vector<std::string>& args) {
     }
 }
 
+dedup::DecontaminationConfig make_decontamination_config(const std::vector<std::string>& args) {
+    auto config = dedup::decontamination_utils::create_default_config();
+    
+    std::string ngram_size_str = get_arg_value(args, "--ngram-size");
+    if (!ngram_size_str.empty()) {
+        config.ngram_size = std::stoul(ngram_size_str);
+    }
+    config.full_report = has_flag(args, "--full-report");
+    
+    std::string max_memory_str = get_arg_value(args, "--max-memory-mb");
+    if (!max_memory_str.empty()) {
+        config.max_memory_mb = std::stoul(max_memory_str);
+    }
+    std::string partitions_str = get_arg_value(args, "--partitions");
+    if (!partitions_str.empty()) {
+        config.index_partitions = std::stoul(partitions_str);
+    }
+    
+    return config;
+}
+
+int run_build_index(const std::vector<std::string>& args) {
+    auto benchmarks = parse_comma_list(get_arg_value(args, "--benchmarks"));
+    std::string index_file = get_arg_value(args, "--index");
+    std::string index_dir = get_arg_value(args, "--index-dir");
+    
+    if (benchmarks.empty() || (index_file.empty() && index_dir.empty())) {
+        std::cerr << "Error: --benchmarks and --index (or --index-dir) are required for build-index mode\n";
+        return 1;
+    }
+    
+    try {
+        auto config = make_decontamination_config(args);
+        for (const auto& path : benchmarks) {
+            if (std::filesystem::is_directory(path)) {
+                config.benchmark_directories.push_back(path);
+            } else {
+                config.benchmark_files.push_back(path);
+            }
+        }
+        
+        Timer timer;
+        dedup::DecontaminationFilter filter(config);
+        
+        // Partitioned indexes are written straight to disk without loading the benchmarks
+        if (!index_dir.empty()) {
+            size_t records = filter.build_partitioned_index(index_dir);
+            std::cout << "Wrote " << records << " n-gram records to " << index_dir
+                      << " in " << timer.elapsed_seconds() << "s\n";
+            return 0;
+        }
+        
+        filter.load_benchmark_datasets();
+        filter.save_index(index_file);
+        
+        std::cout << "Wrote " << filter.get_benchmark_ngrams_count() << " n-grams from "
+                  << filter.get_benchmark_datasets().size() << " datasets to " << index_file
+                  << " in " << timer.elapsed_seconds() << "s\n";
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int run_decontamination(const std::vector<std::string>& args) {
+    std::string input_file = get_arg_value(args, "--input");
+    std::string output_file = get_arg_value(args, "--output");
+    std::string index_file = get_arg_value(args, "--index");
+    std::string index_dir = get_arg_value(args, "--index-dir");
+    
+    if (input_file.empty() || (index_file.empty() && index_dir.empty())) {
+        std::cerr << "Error: --input and --index (or --index-dir) are required for decontaminate mode\n";
+        return 1;
+    }
+    
+    try {
+        auto config = make_decontamination_config(args);
+        
+        dedup::DecontaminationFilter filter(config);
+        if (!index_dir.empty()) {
+            filter.load_partitioned_index(index_dir);
+        } else {
+            filter.load_index(index_file);
+        }
+        
+        std::cout << "Loading documents from: " << input_file << std::endl;
+        auto documents = io_utils::load_documents_from_file(input_file);
+        std::cout << "Loaded " << documents.size() << " documents\n\n";
+        
+        auto decisions = filter.evaluate_batch(documents);
+        
+        std::vector<Document> clean_documents;
+        for (size_t i = 0; i < documents.size(); ++i) {
+            if (decisions[i].result != dedup::FilterResult::REJECT) {
+                clean_documents.push_back(documents[i]);
+            }
+        }
+        
+        filter.print_contamination_report();
+        
+        if (!output_file.empty()) {
+            io_utils::save_documents_to_file(clean_documents, output_file);
+            std::cout << "Clean documents saved to: " << output_file << std::endl;
+        }
+        
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
 int run_benchmark(const std::vector<std::string>& args) {
     std::string input_file = get_arg_value(args, "--input");
     
@@ -579,13 +912,20 @@ int main(int argc, char* argv[]) {
         return run_near_dedup(args);
     } else if (mode == "language") {
         return run_language_filter(args);
+    } else if (mode == "train-langid") {
+        return run_train_langid(args);
     } else if (mode == "extract") {
         return run_text_extraction(args);
+    } else if (mode == "build-index") {
+        return run_build_index(args);
+    } else if (mode == "decontaminate") {
+        return run_decontamination(args);
     } else if (mode == "benchmark") {
         return run_benchmark(args);
     } else {
         std::cerr << "Error: Unknown mode '" << mode << "'\n";
-        std::cerr << "Available modes: exact, near, language, extract, benchmark\n";
+        std::cerr << "Available modes: exact, near, language, train-langid, extract, build-index, decontaminate, "
+                     "benchmark\n";
         return 1;
     }
 } 
\ No newline at end of file
@@ -0,0 +1,559 @@
+#include "rapidsift/ngram_language_model.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+namespace rapidsift {
+
+namespace {
+
+// Features summed in int16 lanes before widening; 256 * 127 stays below 2^15
+constexpr size_t FEATURE_CHUNK = 256;
+constexpr int QUANTIZED_MAX = 127;
+
+// ASCII letters fold to lower case and any other ASCII byte is a word
+// boundary; bytes of multi-byte UTF-8 sequences pass through unchanged
+struct ByteNormalizer {
+    uint8_t table[256];
+
+    ByteNormalizer() {
+        for (int c = 0; c < 256; ++c) {
+            if (c >= 'A' && c <= 'Z') table[c] = static_cast<uint8_t>(c - 'A' + 'a');
+            else if ((c >= 'a' && c <= 'z') || c >= 0x80) table[c] = static_cast<uint8_t>(c);
+            else table[c] = ' ';
+        }
+    }
+};
+
+const uint8_t* normalized_bytes() {
+    static const ByteNormalizer normalizer;
+    return normalizer.table;
+}
+
+inline uint32_t feature_bucket(uint32_t gram, uint32_t length, uint32_t bucket_bits) {
+    uint64_t key = (static_cast<uint64_t>(gram) << 3) | length;
+    return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ull) >> (64 - bucket_bits));
+}
+
+// Slides a 4-byte window over the normalized text, calling visit with the
+// window ending at each byte and that byte's offset. The text is framed by
+// boundaries so word starts and ends show up in n-grams; bytes before the
+// text read as zero
+template<typename Visit>
+size_t for_each_window(const char* text, size_t length, Visit&& visit) {
+    const uint8_t* table = normalized_bytes();
+    uint32_t window = ' ';
+    uint8_t previous = ' ';
+    size_t windows = 0;
+
+    for (size_t i = 0; i < length; ++i) {
+        uint8_t byte = table[static_cast<uint8_t>(text[i])];
+        if (byte == ' ' && previous == ' ') continue;
+        previous = byte;
+        window = (window << 8) | byte;
+        visit(window, i);
+        ++windows;
+    }
+    if (previous != ' ') {
+        visit((window << 8) | ' ', length);
+        ++windows;
+    }
+    return windows;
+}
+
+// The 1- to 4-gram features of a window
+inline void window_buckets(uint32_t window, uint32_t bucket_bits, uint32_t* out) {
+    out[0] = feature_bucket(window & 0xFFu, 1, bucket_bits);
+    out[1] = feature_bucket(window & 0xFFFFu, 2, bucket_bits);
+    out[2] = feature_bucket(window & 0xFFFFFFu, 3, bucket_bits);
+    out[3] = feature_bucket(window, 4, bucket_bits);
+}
+
+// totals[l] += sum of the buckets' weight rows. Works one SIMD slice of
+// languages at a time so the sums stay in int16 registers for the whole chunk
+void accumulate_chunk(const int8_t* weights, size_t lanes, const uint32_t* buckets, size_t count, int32_t* totals) {
+#if defined(__AVX2__)
+    for (size_t l = 0; l < lanes; l += 32) {
+        __m256i low = _mm256_setzero_si256();
+        __m256i high = _mm256_setzero_si256();
+        for (size_t i = 0; i < count; ++i) {
+            __m256i row = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(weights + static_cast<size_t>(buckets[i]) * lanes + l));
+            low = _mm256_add_epi16(low, _mm256_cvtepi8_epi16(_mm256_castsi256_si128(row)));
+            high = _mm256_add_epi16(high, _mm256_cvtepi8_epi16(_mm256_extracti128_si256(row, 1)));
+        }
+
+        __m256i* out = reinterpret_cast<__m256i*>(totals + l);
+        const __m256i sums[4] = {
+            _mm256_cvtepi16_epi32(_mm256_castsi256_si128(low)), _mm256_cvtepi16_epi32(_mm256_extracti128_si256(low, 1)),
+            _mm256_cvtepi16_epi32(_mm256_castsi256_si128(high)), _mm256_cvtepi16_epi32(_mm256_extracti128_si256(high, 1))
+        };
+        for (int k = 0; k < 4; ++k) {
+            _mm256_storeu_si256(out + k, _mm256_add_epi32(_mm256_loadu_si256(out + k), sums[k]));
+        }
+    }
+#elif defined(__SSE4_1__)
+    for (size_t l = 0; l < lanes; l += 16) {
+        __m128i low = _mm_setzero_si128();
+        __m128i high = _mm_setzero_si128();
+        for (size_t i = 0; i < count; ++i) {
+            __m128i row = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(weights + static_cast<size_t>(buckets[i]) * lanes + l));
+            low = _mm_add_epi16(low, _mm_cvtepi8_epi16(row));
+            high = _mm_add_epi16(high, _mm_cvtepi8_epi16(_mm_srli_si128(row, 8)));
+        }
+
+        __m128i* out = reinterpret_cast<__m128i*>(totals + l);
+        const __m128i sums[4] = {
+            _mm_cvtepi16_epi32(low), _mm_cvtepi16_epi32(_mm_srli_si128(low, 8)),
+            _mm_cvtepi16_epi32(high), _mm_cvtepi16_epi32(_mm_srli_si128(high, 8))
+        };
+        for (int k = 0; k < 4; ++k) {
+            _mm_storeu_si128(out + k, _mm_add_epi32(_mm_loadu_si128(out + k), sums[k]));
+        }
+    }
+#else
+    for (size_t i = 0; i < count; ++i) {
+        const int8_t* row = weights + static_cast<size_t>(buckets[i]) * lanes;
+        for (size_t l = 0; l < lanes; ++l) {
+            totals[l] += row[l];
+        }
+    }
+#endif
+}
+
+size_t pad_languages(size_t languages) {
+    const size_t lanes = CharNGramLanguageModel::LANGUAGE_LANES;
+    return (languages + lanes - 1) / lanes * lanes;
+}
+
+uint64_t align_section(uint64_t offset) {
+    const uint64_t alignment = LanguageModelHeader::SECTION_ALIGNMENT;
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+void write_padding(std::ofstream& file, uint64_t target_offset) {
+    static const char zeros[LanguageModelHeader::SECTION_ALIGNMENT] = {};
+    uint64_t position = static_cast<uint64_t>(file.tellp());
+    file.write(zeros, static_cast<std::streamsize>(target_offset - position));
+}
+
+} // anonymous namespace
+
+// ==============================================================================
+// Model
+// ==============================================================================
+
+CharNGramLanguageModel::CharNGramLanguageModel(std::vector<std::string> languages, uint32_t bucket_bits,
+                                               const std::vector<float>& weights, const std::vector<float>& biases)
+    : languages_(std::move(languages)), bucket_bits_(bucket_bits), padded_languages_(pad_languages(languages_.size())) {
+    const size_t num_languages = languages_.size();
+    if (num_languages == 0 || bucket_bits < MIN_BUCKET_BITS || bucket_bits > MAX_BUCKET_BITS ||
+        weights.size() != num_buckets() * num_languages || biases.size() != num_languages) {
+        throw std::runtime_error("Invalid language model geometry");
+    }
+
+    float max_weight = 0.0f;
+    for (float w : weights) {
+        max_weight = std::max(max_weight, std::fabs(w));
+    }
+    weight_scale_ = max_weight > 0.0f ? max_weight / QUANTIZED_MAX : 1.0f;
+
+    owned_weights_.assign(num_buckets() * padded_languages_, 0);
+    for (size_t bucket = 0; bucket < num_buckets(); ++bucket) {
+        for (size_t l = 0; l < num_languages; ++l) {
+            long q = std::lround(weights[bucket * num_languages + l] / weight_scale_);
+            owned_weights_[bucket * padded_languages_ + l] =
+                static_cast<int8_t>(std::max<long>(-QUANTIZED_MAX, std::min<long>(QUANTIZED_MAX, q)));
+        }
+    }
+    weights_ = owned_weights_.data();
+
+    biases_.assign(padded_languages_, 0.0f);
+    std::copy(biases.begin(), biases.end(), biases_.begin());
+}
+
+CharNGramLanguageModel::~CharNGramLanguageModel() = default;
+CharNGramLanguageModel::CharNGramLanguageModel(CharNGramLanguageModel&&) noexcept = default;
+CharNGramLanguageModel& CharNGramLanguageModel::operator=(CharNGramLanguageModel&&) noexcept = default;
+
+void CharNGramLanguageModel::save(const std::string& filename) const {
+    if (!is_loaded()) {
+        throw std::runtime_error("Cannot save an empty language model");
+    }
+
+    std::string language_blob;
+    for (const auto& code : languages_) {
+        uint32_t length = static_cast<uint32_t>(code.size());
+        language_blob.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        language_blob.append(code);
+    }
+
+    LanguageModelHeader header = {};
+    std::memcpy(header.magic, LanguageModelHeader::MAGIC, sizeof(header.magic));
+    header.version = LanguageModelHeader::CURRENT_VERSION;
+    header.endian_marker = LanguageModelHeader::ENDIAN_MARKER;
+    header.bucket_bits = bucket_bits_;
+    header.max_ngram = MAX_NGRAM;
+    header.num_languages = languages_.size();
+    header.padded_languages = padded_languages_;
+    header.weight_scale = weight_scale_;
+    header.biases_offset = align_section(sizeof(LanguageModelHeader));
+    header.weights_offset = align_section(header.biases_offset + padded_languages_ * sizeof(float));
+    header.languages_offset = align_section(header.weights_offset + num_buckets() * padded_languages_);
+    header.languages_size = language_blob.size();
+    header.file_size = header.languages_offset + header.languages_size;
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not create language model file: " + filename);
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_padding(file, header.biases_offset);
+    file.write(reinterpret_cast<const char*>(biases_.data()),
+               static_cast<std::streamsize>(padded_languages_ * sizeof(float)));
+    write_padding(file, header.weights_offset);
+    file.write(reinterpret_cast<const char*>(weights_), static_cast<std::streamsize>(num_buckets() * padded_languages_));
+    write_padding(file, header.languages_offset);
+    file.write(language_blob.data(), static_cast<std::streamsize>(language_blob.size()));
+
+    if (!file) {
+        throw std::runtime_error("Failed writing language model file: " + filename);
+    }
+}
+
+void CharNGramLanguageModel::load(const std::string& filename) {
+    auto mapped = std::make_unique<io_utils::MappedFile>(filename);
+    const char* base = mapped->data();
+
+    LanguageModelHeader header;
+    if (mapped->size() < sizeof(header)) {
+        throw std::runtime_error("Not a language model: " + filename);
+    }
+    std::memcpy(&header, base, sizeof(header));
+
+    if (std::memcmp(header.magic, LanguageModelHeader::MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("Not a language model: " + filename);
+    }
+    if (header.version != LanguageModelHeader::CURRENT_VERSION ||
+        header.endian_marker != LanguageModelHeader::ENDIAN_MARKER || header.max_ngram != MAX_NGRAM) {
+        throw std::runtime_error("Unsupported language model version in " + filename);
+    }
+    if (header.bucket_bits < MIN_BUCKET_BITS || header.bucket_bits > MAX_BUCKET_BITS || header.num_languages == 0 ||
+        header.padded_languages != pad_languages(header.num_languages) || !(header.weight_scale > 0.0f) ||
+        !std::isfinite(header.weight_scale)) {
+        throw std::runtime_error("Corrupt language model header: " + filename);
+    }
+
+    const uint64_t buckets = uint64_t{1} << header.bucket_bits;
+    auto section_ok = [&](uint64_t offset, uint64_t bytes) {
+        return offset % LanguageModelHeader::SECTION_ALIGNMENT == 0 && offset <= mapped->size() &&
+               bytes <= mapped->size() - offset;
+    };
+    if (header.file_size != mapped->size() ||
+        !section_ok(header.biases_offset, header.padded_languages * sizeof(float)) ||
+        !section_ok(header.weights_offset, buckets * header.padded_languages) ||
+        !section_ok(header.languages_offset, header.languages_size)) {
+        throw std::runtime_error("Truncated or corrupt language model: " + filename);
+    }
+
+    std::vector<std::string> languages;
+    languages.reserve(header.num_languages);
+    const char* cursor = base + header.languages_offset;
+    const char* end = cursor + header.languages_size;
+    for (uint64_t i = 0; i < header.num_languages; ++i) {
+        uint32_t length;
+        if (static_cast<size_t>(end - cursor) < sizeof(length)) {
+            throw std::runtime_error("Corrupt language table in model: " + filename);
+        }
+        std::memcpy(&length, cursor, sizeof(length));
+        cursor += sizeof(length);
+        if (static_cast<size_t>(end - cursor) < length) {
+            throw std::runtime_error("Corrupt language table in model: " + filename);
+        }
+        languages.emplace_back(cursor, length);
+        cursor += length;
+    }
+
+    languages_ = std::move(languages);
+    bucket_bits_ = header.bucket_bits;
+    padded_languages_ = static_cast<size_t>(header.padded_languages);
+    weight_scale_ = header.weight_scale;
+    biases_.assign(padded_languages_, 0.0f);
+    std::memcpy(biases_.data(), base + header.biases_offset, padded_languages_ * sizeof(float));
+    owned_weights_.clear();
+    owned_weights_.shrink_to_fit();
+    weights_ = reinterpret_cast<const int8_t*>(base + header.weights_offset);
+    mapped_ = std::move(mapped);
+}
+
+size_t CharNGramLanguageModel::for_each_feature(const char* text, size_t length, uint32_t bucket_bits,
+                                                const std::function<void(uint32_t)>& visit) {
+    uint32_t buckets[MAX_NGRAM];
+    size_t windows = for_each_window(text, length, [&](uint32_t window, size_t) {
+        window_buckets(window, bucket_bits, buckets);
+        for (uint32_t bucket : buckets) visit(bucket);
+    });
+    return windows * MAX_NGRAM;
+}
+
+size_t CharNGramLanguageModel::accumulate(const char* text, size_t length, std::vector<int32_t>& totals) const {
+    totals.assign(padded_languages_, 0);
+
+    uint32_t buckets[FEATURE_CHUNK];
+    size_t pending = 0;
+
+    size_t windows = for_each_window(text, length, [&](uint32_t window, size_t) {
+        window_buckets(window, bucket_bits_, buckets + pending);
+        pending += MAX_NGRAM;
+        if (pending == FEATURE_CHUNK) {
+            accumulate_chunk(weights_, padded_languages_, buckets, pending, totals.data());
+            pending = 0;
+        }
+    });
+    accumulate_chunk(weights_, padded_languages_, buckets, pending, totals.data());
+
+    return windows * MAX_NGRAM;
+}
+
+void CharNGramLanguageModel::block_totals(const char* text, size_t length, const std::vector<size_t>& block_starts,
+                                          std::vector<int32_t>& totals, std::vector<size_t>& counts) const {
+    const size_t blocks = std::max<size_t>(block_starts.size(), 1);
+    totals.assign(blocks * padded_languages_, 0);
+    counts.assign(blocks, 0);
+    if (!is_loaded()) {
+        return;
+    }
+
+    uint32_t buckets[FEATURE_CHUNK];
+    size_t pending = 0;
+    size_t block = 0;
+
+    auto flush = [&]() {
+        accumulate_chunk(weights_, padded_languages_, buckets, pending, &totals[block * padded_languages_]);
+        counts[block] += pending;
+        pending = 0;
+    };
+
+    // A feature belongs to the block holding its last byte
+    for_each_window(text, length, [&](uint32_t window, size_t position) {
+        if (block + 1 < blocks && position >= block_starts[block + 1]) {
+            flush();
+            while (block + 1 < blocks && position >= block_starts[block + 1]) ++block;
+        }
+        window_buckets(window, bucket_bits_, buckets + pending);
+        pending += MAX_NGRAM;
+        if (pending == FEATURE_CHUNK) {
+            flush();
+        }
+    });
+    flush();
+}
+
+void CharNGramLanguageModel::softmax(const int32_t* totals, size_t features, std::vector<float>& out) const {
+    const size_t num_languages = languages_.size();
+
+    // The model is linear in the mean feature vector, so sums are scaled by 1/features
+    const float factor = weight_scale_ / static_cast<float>(features);
+    float max_logit = -INFINITY;
+    for (size_t l = 0; l < num_languages; ++l) {
+        out[l] = biases_[l] + factor * static_cast<float>(totals[l]);
+        max_logit = std::max(max_logit, out[l]);
+    }
+
+    float sum = 0.0f;
+    for (size_t l = 0; l < num_languages; ++l) {
+        out[l] = std::exp(out[l] - max_logit);
+        sum += out[l];
+    }
+    for (size_t l = 0; l < num_languages; ++l) {
+        out[l] /= sum;
+    }
+}
+
+size_t CharNGramLanguageModel::probabilities(const char* text, size_t length, std::vector<float>& out) const {
+    const size_t num_languages = languages_.size();
+    out.assign(num_languages, num_languages > 0 ? 1.0f / num_languages : 0.0f);
+    if (!is_loaded()) {
+        return 0;
+    }
+
+    thread_local std::vector<int32_t> totals;
+    size_t count = accumulate(text, length, totals);
+    if (count > 0) {
+        softmax(totals.data(), count, out);
+    }
+    return count;
+}
+
+CharNGramLanguageModel::Prediction CharNGramLanguageModel::predict_totals(const int32_t* totals, size_t features) const {
+    Prediction prediction;
+    prediction.features = features;
+    if (features == 0 || !is_loaded()) {
+        prediction.features = 0;
+        return prediction;
+    }
+
+    thread_local std::vector<float> scores;
+    scores.resize(languages_.size());
+    softmax(totals, features, scores);
+
+    auto best = std::max_element(scores.begin(), scores.end());
+    prediction.language = static_cast<uint32_t>(best - scores.begin());
+    prediction.probability = *best;
+    return prediction;
+}
+
+CharNGramLanguageModel::Prediction CharNGramLanguageModel::predict(const char* text, size_t length) const {
+    thread_local std::vector<int32_t> totals;
+    size_t count = is_loaded() ? accumulate(text, length, totals) : 0;
+    return predict_totals(totals.data(), count);
+}
+
+// ==============================================================================
+// Trainer
+// ==============================================================================
+
+CharNGramModelTrainer::CharNGramModelTrainer(const LanguageModelTrainingConfig& config)
+    : config_(config) {
+    if (config_.bucket_bits < CharNGramLanguageModel::MIN_BUCKET_BITS ||
+        config_.bucket_bits > CharNGramLanguageModel::MAX_BUCKET_BITS) {
+        throw std::runtime_error("Language model bucket bits must be between " +
+                                 std::to_string(CharNGramLanguageModel::MIN_BUCKET_BITS) + " and " +
+                                 std::to_string(CharNGramLanguageModel::MAX_BUCKET_BITS));
+    }
+}
+
+void CharNGramModelTrainer::add_example(const std::string& language, const std::string& text) {
+    size_t length = std::min(text.size(), config_.max_bytes_per_example);
+
+    std::vector<uint32_t> buckets;
+    size_t total = CharNGramLanguageModel::for_each_feature(text.data(), length, config_.bucket_bits,
+                                                            [&](uint32_t bucket) { buckets.push_back(bucket); });
+    if (total == 0) {
+        return;
+    }
+
+    auto inserted = language_ids_.emplace(language, static_cast<uint32_t>(languages_.size()));
+    if (inserted.second) {
+        languages_.push_back(language);
+    }
+
+    Example example;
+    example.language = inserted.first->second;
+    std::sort(buckets.begin(), buckets.end());
+    for (size_t i = 0; i < buckets.size();) {
+        size_t run = i;
+        while (run < buckets.size() && buckets[run] == buckets[i]) ++run;
+        example.features.emplace_back(buckets[i], static_cast<float>(run - i) / static_cast<float>(total));
+        i = run;
+    }
+    examples_.push_back(std::move(example));
+}
+
+size_t CharNGramModelTrainer::add_corpus(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open training corpus: " + filename);
+    }
+
+    static const std::string LABEL_PREFIX = "__label__";
+    size_t added = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        std::string language;
+        size_t text_start;
+        if (line.compare(0, LABEL_PREFIX.size(), LABEL_PREFIX) == 0) {
+            size_t space = line.find(' ');
+            if (space == std::string::npos) continue;
+            language = line.substr(LABEL_PREFIX.size(), space - LABEL_PREFIX.size());
+            text_start = space + 1;
+        } else {
+            size_t tab = line.find('\t');
+            if (tab == std::string::npos || tab == 0) continue;
+            language = line.substr(0, tab);
+            text_start = tab + 1;
+        }
+        if (language.empty()) continue;
+
+        size_t before = examples_.size();
+        add_example(language, line.substr(text_start));
+        added += examples_.size() - before;
+    }
+
+    return added;
+}
+
+CharNGramLanguageModel CharNGramModelTrainer::train(
+    std::function<void(size_t epoch, size_t epochs, double loss)> progress_callback) const {
+    if (examples_.empty()) {
+        throw std::runtime_error("No labeled training examples");
+    }
+
+    const size_t num_languages = languages_.size();
+    const size_t num_buckets = size_t{1} << config_.bucket_bits;
+    std::vector<float> weights(num_buckets * num_languages, 0.0f);
+    std::vector<float> biases(num_languages, 0.0f);
+    std::vector<float> gradient(num_languages);
+
+    std::vector<size_t> order(examples_.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::mt19937_64 rng(config_.seed);
+
+    const double total_steps = static_cast<double>(config_.epochs * examples_.size());
+    size_t step = 0;
+
+    for (size_t epoch = 0; epoch < config_.epochs; ++epoch) {
+        std::shuffle(order.begin(), order.end(), rng);
+        double loss = 0.0;
+
+        for (size_t index : order) {
+            const Example& example = examples_[index];
+            float rate = static_cast<float>(config_.learning_rate * (1.0 - step / total_steps));
+            ++step;
+
+            // Forward: softmax over the logits of the mean feature vector
+            std::copy(biases.begin(), biases.end(), gradient.begin());
+            for (const auto& [bucket, value] : example.features) {
+                const float* row = &weights[bucket * num_languages];
+                for (size_t l = 0; l < num_languages; ++l) gradient[l] += value * row[l];
+            }
+            float max_logit = *std::max_element(gradient.begin(), gradient.end());
+            float sum = 0.0f;
+            for (float& g : gradient) {
+                g = std::exp(g - max_logit);
+                sum += g;
+            }
+            for (float& g : gradient) g /= sum;
+            loss -= std::log(std::max(gradient[example.language], 1e-12f));
+
+            // Backward: d(loss)/d(logit) = p - one_hot(label)
+            gradient[example.language] -= 1.0f;
+            for (size_t l = 0; l < num_languages; ++l) biases[l] -= rate * gradient[l];
+            for (const auto& [bucket, value] : example.features) {
+                float* row = &weights[bucket * num_languages];
+                for (size_t l = 0; l < num_languages; ++l) row[l] -= rate * value * gradient[l];
+            }
+        }
+
+        if (progress_callback) {
+            progress_callback(epoch + 1, config_.epochs, loss / examples_.size());
+        }
+    }
+
+    return CharNGramLanguageModel(languages_, config_.bucket_bits, weights, biases);
+}
+
+} // namespace rapidsift
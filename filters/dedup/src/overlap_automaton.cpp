@@ -0,0 +1,167 @@
+#include "rapidsift/overlap_automaton.hpp"
+#include <algorithm>
+
+namespace rapidsift {
+namespace dedup {
+
+OverlapAutomaton::OverlapAutomaton() {
+    clear();
+}
+
+void OverlapAutomaton::clear() {
+    states_.assign(1, State{});  // Root: the empty string
+    vocabulary_.clear();
+    num_texts_ = 0;
+    num_transitions_ = 0;
+    vocabulary_chars_ = 0;
+}
+
+size_t OverlapAutomaton::memory_bytes() const {
+    // Vocabulary entries cost a hash node (key, value, next pointer) and a
+    // bucket slot; strings longer than the small-string buffer own their bytes
+    size_t vocabulary_node = sizeof(std::string) + sizeof(uint32_t) + 2 * sizeof(void*);
+    return states_.capacity() * sizeof(State) + num_transitions_ * sizeof(std::pair<uint32_t, uint32_t>) +
+           vocabulary_.size() * vocabulary_node + vocabulary_chars_;
+}
+
+void OverlapAutomaton::add_text(const std::vector<std::string>& tokens, uint32_t dataset_id) {
+    if (tokens.empty()) return;
+
+    uint32_t last = 0;
+    for (const auto& token : tokens) {
+        auto inserted = vocabulary_.emplace(token, static_cast<uint32_t>(vocabulary_.size()));
+        if (inserted.second) vocabulary_chars_ += token.size();
+        last = extend(last, inserted.first->second, dataset_id);
+    }
+    num_texts_++;
+}
+
+std::vector<OverlapAutomaton::Overlap> OverlapAutomaton::find_overlaps(
+    const std::vector<std::string>& tokens, size_t min_length, size_t max_overlaps) const {
+
+    std::vector<Overlap> overlaps;
+    if (empty() || max_overlaps == 0) return overlaps;
+    min_length = std::max<size_t>(min_length, 1);
+
+    uint32_t state = 0;
+    size_t length = 0;
+
+    // A match ending at i is maximal unless the match ending at i + 1 extends it
+    auto emit = [&](size_t end, size_t match_length, uint32_t match_state) {
+        if (match_length >= min_length) {
+            overlaps.push_back({end + 1 - match_length, match_length, states_[match_state].dataset_id});
+        }
+    };
+
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        size_t previous_length = length;
+        uint32_t previous_state = state;
+
+        auto it = vocabulary_.find(tokens[i]);
+        if (it == vocabulary_.end()) {
+            state = 0;
+            length = 0;
+        } else {
+            uint32_t symbol = it->second;
+            while (state != 0 && transition(state, symbol) == NO_STATE) {
+                state = states_[state].link;
+                length = states_[state].length;
+            }
+            uint32_t target = transition(state, symbol);
+            if (target != NO_STATE) {
+                state = target;
+                length++;
+            } else {
+                state = 0;
+                length = 0;
+            }
+        }
+
+        if (i > 0 && length != previous_length + 1) {
+            emit(i - 1, previous_length, previous_state);
+            if (overlaps.size() >= max_overlaps) return overlaps;
+        }
+    }
+
+    if (!tokens.empty()) {
+        emit(tokens.size() - 1, length, state);
+    }
+    if (overlaps.size() > max_overlaps) overlaps.resize(max_overlaps);
+
+    return overlaps;
+}
+
+uint32_t OverlapAutomaton::transition(uint32_t state, uint32_t symbol) const {
+    const auto& next = states_[state].next;
+    auto it = std::lower_bound(next.begin(), next.end(), std::make_pair(symbol, uint32_t(0)));
+    return (it != next.end() && it->first == symbol) ? it->second : NO_STATE;
+}
+
+void OverlapAutomaton::set_transition(uint32_t state, uint32_t symbol, uint32_t target) {
+    auto& next = states_[state].next;
+    auto it = std::lower_bound(next.begin(), next.end(), std::make_pair(symbol, uint32_t(0)));
+    if (it != next.end() && it->first == symbol) {
+        it->second = target;
+    } else {
+        next.insert(it, {symbol, target});
+        num_transitions_++;
+    }
+}
+
+uint32_t OverlapAutomaton::clone_state(uint32_t state, uint32_t length) {
+    State clone = states_[state];
+    clone.length = length;
+    num_transitions_ += clone.next.size();
+    states_.push_back(std::move(clone));
+    return static_cast<uint32_t>(states_.size() - 1);
+}
+
+uint32_t OverlapAutomaton::extend(uint32_t last, uint32_t symbol, uint32_t dataset_id) {
+    // Generalized construction: a later text may already have this transition
+    uint32_t existing = transition(last, symbol);
+    if (existing != NO_STATE) {
+        if (states_[last].length + 1 == states_[existing].length) {
+            return existing;
+        }
+        uint32_t clone = clone_state(existing, states_[last].length + 1);
+        for (uint32_t p = last; p != NO_STATE && transition(p, symbol) == existing; p = states_[p].link) {
+            set_transition(p, symbol, clone);
+        }
+        states_[existing].link = clone;
+        return clone;
+    }
+
+    State fresh;
+    fresh.length = states_[last].length + 1;
+    fresh.dataset_id = dataset_id;
+    states_.push_back(std::move(fresh));
+    uint32_t current = static_cast<uint32_t>(states_.size() - 1);
+
+    uint32_t p = last;
+    while (p != NO_STATE && transition(p, symbol) == NO_STATE) {
+        set_transition(p, symbol, current);
+        p = states_[p].link;
+    }
+
+    if (p == NO_STATE) {
+        states_[current].link = 0;
+        return current;
+    }
+
+    uint32_t q = transition(p, symbol);
+    if (states_[p].length + 1 == states_[q].length) {
+        states_[current].link = q;
+        return current;
+    }
+
+    uint32_t clone = clone_state(q, states_[p].length + 1);
+    for (; p != NO_STATE && transition(p, symbol) == q; p = states_[p].link) {
+        set_transition(p, symbol, clone);
+    }
+    states_[q].link = clone;
+    states_[current].link = clone;
+    return current;
+}
+
+} // namespace dedup
+} // namespace rapidsift
@@ -0,0 +1,493 @@
+#include "rapidsift/partitioned_index.hpp"
+#include "rapidsift/decontamination_filter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <queue>
+#include <stdexcept>
+
+namespace rapidsift {
+namespace dedup {
+
+namespace {
+
+bool record_less(const PartitionRecord& a, const PartitionRecord& b) {
+    if (a.key != b.key) return hash_less(a.key, b.key);
+    return a.dataset_id < b.dataset_id;
+}
+
+bool same_record(const PartitionRecord& a, const PartitionRecord& b) {
+    return a.key == b.key && a.dataset_id == b.dataset_id;
+}
+
+uint64_t align_section(uint64_t offset) {
+    const uint64_t alignment = PartitionedIndexHeader::SECTION_ALIGNMENT;
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+void write_padding(std::ofstream& file, uint64_t target_offset) {
+    static const char zeros[PartitionedIndexHeader::SECTION_ALIGNMENT] = {};
+    uint64_t position = static_cast<uint64_t>(file.tellp());
+    file.write(zeros, static_cast<std::streamsize>(target_offset - position));
+}
+
+size_t round_up_power_of_two(size_t value) {
+    size_t result = 1;
+    while (result < value) result <<= 1;
+    return result;
+}
+
+// Sequential reader over one sorted run inside a partition's run file
+class RunReader {
+public:
+    RunReader(const std::string& path, uint64_t offset, uint64_t length, size_t buffer_records)
+        : file_(path, std::ios::binary), remaining_(length), buffer_(std::max<size_t>(buffer_records, 1)) {
+        file_.seekg(static_cast<std::streamoff>(offset * sizeof(PartitionRecord)));
+        refill();
+    }
+
+    bool done() const { return position_ == filled_; }
+    const PartitionRecord& current() const { return buffer_[position_]; }
+
+    void advance() {
+        if (++position_ == filled_) refill();
+    }
+
+private:
+    std::ifstream file_;
+    uint64_t remaining_;
+    std::vector<PartitionRecord> buffer_;
+    size_t position_ = 0;
+    size_t filled_ = 0;
+
+    void refill() {
+        position_ = 0;
+        filled_ = static_cast<size_t>(std::min<uint64_t>(remaining_, buffer_.size()));
+        if (filled_ == 0) return;
+        if (!file_.read(reinterpret_cast<char*>(buffer_.data()),
+                        static_cast<std::streamsize>(filled_ * sizeof(PartitionRecord)))) {
+            throw std::runtime_error("Failed reading partition run");
+        }
+        remaining_ -= filled_;
+    }
+};
+
+} // anonymous namespace
+
+// PartitionedIndexBuilder
+
+PartitionedIndexBuilder::PartitionedIndexBuilder(const std::string& directory, size_t num_partitions,
+                                                 size_t memory_budget_bytes, double bloom_false_positive_rate,
+                                                 uint64_t config_fingerprint)
+    : directory_(directory),
+      num_partitions_(std::min<size_t>(round_up_power_of_two(std::max<size_t>(num_partitions, 1)), 1 << 16)),
+      memory_budget_(std::max<size_t>(memory_budget_bytes, 1 << 20)),
+      bloom_false_positive_rate_(bloom_false_positive_rate),
+      config_fingerprint_(config_fingerprint) {
+
+    // Three quarters of the budget buffer records; sorting is in place
+    buffer_capacity_ = std::max<size_t>(memory_budget_ / 4 * 3 / sizeof(PartitionRecord), 4096);
+    run_lengths_.resize(num_partitions_);
+
+    std::filesystem::create_directories(directory_);
+    for (size_t p = 0; p < num_partitions_; ++p) {
+        std::remove(run_path(p).c_str());
+    }
+}
+
+PartitionedIndexBuilder::~PartitionedIndexBuilder() {
+    if (!finished_) {
+        for (size_t p = 0; p < num_partitions_; ++p) {
+            std::remove(run_path(p).c_str());
+        }
+    }
+}
+
+uint32_t PartitionedIndexBuilder::intern_dataset(const std::string& name) {
+    auto it = dataset_lookup_.find(name);
+    if (it != dataset_lookup_.end()) {
+        return it->second;
+    }
+
+    uint32_t id = static_cast<uint32_t>(datasets_.size());
+    datasets_.push_back(name);
+    dataset_lookup_.emplace(name, id);
+    return id;
+}
+
+void PartitionedIndexBuilder::add(const Hash128& hash, uint32_t dataset_id) {
+    if (finished_) {
+        throw std::runtime_error("Partitioned index builder already finished");
+    }
+    if (buffer_.capacity() < buffer_capacity_) {
+        buffer_.reserve(buffer_capacity_);
+    }
+
+    PartitionRecord record;
+    record.key = hash;
+    record.dataset_id = dataset_id;
+    buffer_.push_back(record);
+
+    if (buffer_.size() >= buffer_capacity_) {
+        spill();
+    }
+}
+
+void PartitionedIndexBuilder::spill() {
+    if (buffer_.empty()) return;
+
+    // Hash order is also partition order, so one sort yields every partition's run
+    std::sort(buffer_.begin(), buffer_.end(), record_less);
+    buffer_.erase(std::unique(buffer_.begin(), buffer_.end(), same_record), buffer_.end());
+
+    auto begin = buffer_.begin();
+    while (begin != buffer_.end()) {
+        size_t partition = PartitionedNGramIndex::partition_of(begin->key, num_partitions_);
+        auto end = std::find_if(begin, buffer_.end(), [&](const PartitionRecord& record) {
+            return PartitionedNGramIndex::partition_of(record.key, num_partitions_) != partition;
+        });
+
+        std::ofstream run(run_path(partition), std::ios::binary | std::ios::app);
+        run.write(reinterpret_cast<const char*>(&*begin),
+                  static_cast<std::streamsize>((end - begin) * sizeof(PartitionRecord)));
+        if (!run) {
+            throw std::runtime_error("Failed writing partition run: " + run_path(partition));
+        }
+        run_lengths_[partition].push_back(static_cast<uint64_t>(end - begin));
+        begin = end;
+    }
+
+    spilled_records_ += buffer_.size();
+    buffer_.clear();
+}
+
+size_t PartitionedIndexBuilder::finish() {
+    if (finished_) {
+        throw std::runtime_error("Partitioned index builder already finished");
+    }
+    spill();
+    std::vector<PartitionRecord>().swap(buffer_);
+
+    // Half the budget goes to the resident Bloom filter; loosen the target rate
+    // if the requested one would not fit
+    const size_t bloom_budget = memory_budget_ / 2;
+    const size_t expected = static_cast<size_t>(std::max<uint64_t>(spilled_records_, 1));
+    const double ln2_squared = std::log(2.0) * std::log(2.0);
+    double fit_rate = std::exp(-static_cast<double>(bloom_budget) * 8.0 * ln2_squared / expected);
+    double bloom_rate = std::min(std::max(bloom_false_positive_rate_, fit_rate * 1.05), 0.5);
+    auto bloom_filter = std::make_unique<NGramBloomFilter>(expected, bloom_rate);
+    while (bloom_filter->data_size_bytes() > bloom_budget && bloom_rate < 0.5) {
+        bloom_rate = std::min(bloom_rate * 2, 0.5);
+        bloom_filter = std::make_unique<NGramBloomFilter>(expected, bloom_rate);
+    }
+    NGramBloomFilter& bloom = *bloom_filter;
+
+    // An eighth of the budget goes to fence keys
+    const size_t fence_budget = std::max<size_t>(memory_budget_ / 8 / sizeof(Hash128), 1);
+    const uint64_t fence_interval =
+        std::max<uint64_t>(MIN_FENCE_INTERVAL, (spilled_records_ + fence_budget - 1) / fence_budget);
+
+    // The remaining quarter holds merge buffers, shared by a partition's runs
+    // in proportion to their lengths and never larger than the run
+    const size_t merge_buffer_records = std::max<size_t>(memory_budget_ / 4 / sizeof(PartitionRecord), 64);
+
+    std::vector<PartitionTableEntry> partitions(num_partitions_);
+    std::vector<Hash128> fences;
+    uint64_t record_count = 0;
+
+    for (size_t p = 0; p < num_partitions_; ++p) {
+        std::ofstream segment(PartitionedNGramIndex::segment_path(directory_, p), std::ios::binary | std::ios::trunc);
+        if (!segment.is_open()) {
+            throw std::runtime_error("Could not create index segment in " + directory_);
+        }
+
+        uint64_t partition_records = 0;
+        for (uint64_t length : run_lengths_[p]) partition_records += length;
+
+        std::vector<std::unique_ptr<RunReader>> readers;
+        uint64_t offset = 0;
+        for (uint64_t length : run_lengths_[p]) {
+            double share = static_cast<double>(merge_buffer_records) * length / partition_records;
+            size_t buffer_records = static_cast<size_t>(
+                std::min<uint64_t>(length, std::max<uint64_t>(static_cast<uint64_t>(share), 64)));
+            readers.push_back(std::make_unique<RunReader>(run_path(p), offset, length, buffer_records));
+            offset += length;
+        }
+
+        auto heap_greater = [&](size_t a, size_t b) {
+            return record_less(readers[b]->current(), readers[a]->current());
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(heap_greater)> heap(heap_greater);
+        for (size_t r = 0; r < readers.size(); ++r) {
+            if (!readers[r]->done()) heap.push(r);
+        }
+
+        PartitionTableEntry& entry = partitions[p];
+        entry.fence_start = fences.size();
+        std::vector<PartitionRecord> out;
+        out.reserve(4096);
+        PartitionRecord last;
+        bool have_last = false;
+
+        while (!heap.empty()) {
+            size_t r = heap.top();
+            heap.pop();
+            PartitionRecord record = readers[r]->current();
+            readers[r]->advance();
+            if (!readers[r]->done()) heap.push(r);
+
+            if (have_last && same_record(record, last)) continue;
+            if (!have_last || record.key != last.key) {
+                bloom.add_hash(record.key);
+            }
+            if (entry.record_count % fence_interval == 0) {
+                fences.push_back(record.key);
+            }
+            out.push_back(record);
+            entry.record_count++;
+            last = record;
+            have_last = true;
+
+            if (out.size() == out.capacity()) {
+                segment.write(reinterpret_cast<const char*>(out.data()),
+                              static_cast<std::streamsize>(out.size() * sizeof(PartitionRecord)));
+                out.clear();
+            }
+        }
+        segment.write(reinterpret_cast<const char*>(out.data()),
+                      static_cast<std::streamsize>(out.size() * sizeof(PartitionRecord)));
+        if (!segment) {
+            throw std::runtime_error("Failed writing index segment in " + directory_);
+        }
+
+        entry.fence_count = fences.size() - entry.fence_start;
+        record_count += entry.record_count;
+        readers.clear();
+        std::remove(run_path(p).c_str());
+    }
+
+    std::string dataset_blob;
+    for (const auto& name : datasets_) {
+        uint32_t length = static_cast<uint32_t>(name.size());
+        dataset_blob.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        dataset_blob.append(name);
+    }
+
+    PartitionedIndexHeader header = {};
+    std::memcpy(header.magic, PartitionedIndexHeader::MAGIC, sizeof(header.magic));
+    header.version = PartitionedIndexHeader::CURRENT_VERSION;
+    header.endian_marker = PartitionedIndexHeader::ENDIAN_MARKER;
+    header.config_fingerprint = config_fingerprint_;
+    header.record_count = record_count;
+    header.num_partitions = num_partitions_;
+    header.fence_interval = fence_interval;
+    header.partitions_offset = align_section(sizeof(PartitionedIndexHeader));
+    header.fences_offset = align_section(header.partitions_offset + num_partitions_ * sizeof(PartitionTableEntry));
+    header.fence_count = fences.size();
+    header.bloom_num_blocks = bloom.get_num_blocks();
+    header.bloom_hash_functions = bloom.get_hash_functions();
+    header.bloom_expected_elements = bloom.get_expected_elements();
+    header.bloom_offset = align_section(header.fences_offset + fences.size() * sizeof(Hash128));
+    header.dataset_count = datasets_.size();
+    header.datasets_offset = align_section(header.bloom_offset + bloom.data_size_bytes());
+    header.datasets_size = dataset_blob.size();
+    header.file_size = header.datasets_offset + header.datasets_size;
+
+    std::string manifest = PartitionedNGramIndex::manifest_path(directory_);
+    std::ofstream file(manifest, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not create index manifest: " + manifest);
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_padding(file, header.partitions_offset);
+    file.write(reinterpret_cast<const char*>(partitions.data()),
+               static_cast<std::streamsize>(partitions.size() * sizeof(PartitionTableEntry)));
+    write_padding(file, header.fences_offset);
+    file.write(reinterpret_cast<const char*>(fences.data()),
+               static_cast<std::streamsize>(fences.size() * sizeof(Hash128)));
+    write_padding(file, header.bloom_offset);
+    file.write(static_cast<const char*>(bloom.data()), static_cast<std::streamsize>(bloom.data_size_bytes()));
+    write_padding(file, header.datasets_offset);
+    file.write(dataset_blob.data(), static_cast<std::streamsize>(dataset_blob.size()));
+    if (!file) {
+        throw std::runtime_error("Failed writing index manifest: " + manifest);
+    }
+
+    finished_ = true;
+    return static_cast<size_t>(record_count);
+}
+
+std::string PartitionedIndexBuilder::run_path(size_t partition) const {
+    return PartitionedNGramIndex::segment_path(directory_, partition) + ".run";
+}
+
+// PartitionedNGramIndex
+
+PartitionedNGramIndex::PartitionedNGramIndex(const std::string& directory, size_t memory_budget_bytes,
+                                             uint64_t config_fingerprint) {
+    const std::string manifest = manifest_path(directory);
+    manifest_ = std::make_unique<io_utils::MappedFile>(manifest);
+    const char* base = manifest_->data();
+
+    if (manifest_->size() < sizeof(header_)) {
+        throw std::runtime_error("Not a partitioned decontamination index: " + directory);
+    }
+    std::memcpy(&header_, base, sizeof(header_));
+
+    if (std::memcmp(header_.magic, PartitionedIndexHeader::MAGIC, sizeof(header_.magic)) != 0) {
+        throw std::runtime_error("Not a partitioned decontamination index: " + directory);
+    }
+    if (header_.version != PartitionedIndexHeader::CURRENT_VERSION ||
+        header_.endian_marker != PartitionedIndexHeader::ENDIAN_MARKER) {
+        throw std::runtime_error("Unsupported partitioned index version in " + directory +
+                                 "; rebuild it with --mode build-index");
+    }
+    if (header_.config_fingerprint != config_fingerprint) {
+        throw std::runtime_error("Stale partitioned index " + directory +
+                                 ": built with different n-gram settings; rebuild it with --mode build-index");
+    }
+
+    // Counts come from the file, so they are divided into the space left
+    // rather than multiplied out, which could overflow past the check
+    auto section_ok = [&](uint64_t offset, uint64_t count, uint64_t element_size) {
+        return offset % PartitionedIndexHeader::SECTION_ALIGNMENT == 0 && offset <= manifest_->size() &&
+               count <= (manifest_->size() - offset) / element_size;
+    };
+    if (header_.file_size != manifest_->size() || header_.num_partitions == 0 ||
+        (header_.num_partitions & (header_.num_partitions - 1)) != 0 || header_.fence_interval == 0 ||
+        !section_ok(header_.partitions_offset, header_.num_partitions, sizeof(PartitionTableEntry)) ||
+        !section_ok(header_.fences_offset, header_.fence_count, sizeof(Hash128)) ||
+        !section_ok(header_.bloom_offset, header_.bloom_num_blocks, NGramBloomFilter::BLOCK_BITS / 8) ||
+        !section_ok(header_.datasets_offset, header_.datasets_size, 1)) {
+        throw std::runtime_error("Truncated or corrupt partitioned index manifest: " + manifest);
+    }
+
+    // Everything except the segments stays resident
+    resident_bytes_ = static_cast<size_t>(header_.num_partitions * sizeof(PartitionTableEntry) +
+                                          header_.fence_count * sizeof(Hash128) +
+                                          header_.bloom_num_blocks * (NGramBloomFilter::BLOCK_BITS / 8));
+    if (resident_bytes_ > memory_budget_bytes) {
+        throw std::runtime_error("Partitioned index " + directory + " needs " +
+                                 std::to_string(resident_bytes_ >> 20) + " MB resident, above max_memory_mb; "
+                                 "rebuild it with the same memory budget");
+    }
+
+    partitions_ = reinterpret_cast<const PartitionTableEntry*>(base + header_.partitions_offset);
+    fences_ = reinterpret_cast<const Hash128*>(base + header_.fences_offset);
+    bloom_ = std::make_unique<NGramBloomFilter>(base + header_.bloom_offset, header_.bloom_num_blocks,
+                                                header_.bloom_hash_functions, header_.bloom_expected_elements);
+
+    const char* cursor = base + header_.datasets_offset;
+    const char* end = cursor + header_.datasets_size;
+    for (uint64_t i = 0; i < header_.dataset_count; ++i) {
+        uint32_t length;
+        if (static_cast<size_t>(end - cursor) < sizeof(length)) {
+            throw std::runtime_error("Corrupt dataset table in partitioned index: " + directory);
+        }
+        std::memcpy(&length, cursor, sizeof(length));
+        cursor += sizeof(length);
+        if (static_cast<size_t>(end - cursor) < length) {
+            throw std::runtime_error("Corrupt dataset table in partitioned index: " + directory);
+        }
+        datasets_.emplace_back(cursor, length);
+        cursor += length;
+    }
+
+    segments_.resize(header_.num_partitions);
+    uint64_t fence_total = 0;
+    for (size_t p = 0; p < header_.num_partitions; ++p) {
+        const PartitionTableEntry& entry = partitions_[p];
+        uint64_t expected_fences = (entry.record_count + header_.fence_interval - 1) / header_.fence_interval;
+        if (entry.fence_count != expected_fences || entry.fence_start != fence_total) {
+            throw std::runtime_error("Corrupt partition table in partitioned index: " + directory);
+        }
+        fence_total += entry.fence_count;
+        if (entry.record_count == 0) continue;
+
+        segments_[p] = std::make_unique<io_utils::MappedFile>(segment_path(directory, p));
+        if (segments_[p]->size() != entry.record_count * sizeof(PartitionRecord)) {
+            throw std::runtime_error("Truncated index segment: " + segment_path(directory, p));
+        }
+    }
+    if (fence_total != header_.fence_count) {
+        throw std::runtime_error("Corrupt partition table in partitioned index: " + directory);
+    }
+}
+
+PartitionedNGramIndex::~PartitionedNGramIndex() = default;
+
+void PartitionedNGramIndex::lookup_batch(std::vector<Probe>& probes, std::vector<Hit>& hits) const {
+    hits.clear();
+
+    probes.erase(std::remove_if(probes.begin(), probes.end(),
+                                [&](const Probe& probe) { return !bloom_->might_contain_hash(probe.hash); }),
+                 probes.end());
+    std::sort(probes.begin(), probes.end(),
+              [](const Probe& a, const Probe& b) { return hash_less(a.hash, b.hash); });
+
+    auto key_less = [](const PartitionRecord& record, const Hash128& key) { return hash_less(record.key, key); };
+    const uint64_t interval = header_.fence_interval;
+
+    // Partitions are hash ranges, so sorted probes come grouped by partition;
+    // within one, each search starts where the previous probe's ended
+    for (size_t first = 0; first < probes.size();) {
+        size_t p = partition_of(probes[first].hash, num_partitions());
+        size_t last = first + 1;
+        while (last < probes.size() && partition_of(probes[last].hash, num_partitions()) == p) ++last;
+
+        const PartitionTableEntry& entry = partitions_[p];
+        if (entry.record_count > 0) {
+            const PartitionRecord* records = reinterpret_cast<const PartitionRecord*>(segments_[p]->data());
+            const Hash128* fences = fences_ + entry.fence_start;
+            uint64_t block = 0;
+            uint64_t cursor = 0;
+
+            for (size_t i = first; i < last; ++i) {
+                const Probe& probe = probes[i];
+
+                // The first block whose fence is not below the key; the key's
+                // first record is in the block before it or is that block's first
+                block = static_cast<uint64_t>(
+                    std::lower_bound(fences + block, fences + entry.fence_count, probe.hash, hash_less) - fences);
+                uint64_t begin = std::max(cursor, (block == 0 ? 0 : block - 1) * interval);
+                uint64_t end = std::min(entry.record_count, block * interval + 1);
+
+                const PartitionRecord* record = std::lower_bound(records + begin, records + end, probe.hash, key_less);
+                cursor = static_cast<uint64_t>(record - records);
+                for (; record != records + entry.record_count && record->key == probe.hash; ++record) {
+                    hits.push_back({probe.document, probe.position, record->dataset_id});
+                }
+            }
+        }
+        first = last;
+    }
+
+    std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) {
+        if (a.document != b.document) return a.document < b.document;
+        return a.position != b.position ? a.position < b.position : a.dataset_id < b.dataset_id;
+    });
+}
+
+std::string PartitionedNGramIndex::manifest_path(const std::string& directory) {
+    return (std::filesystem::path(directory) / "manifest.bin").string();
+}
+
+std::string PartitionedNGramIndex::segment_path(const std::string& directory, size_t partition) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "part-%05zu.seg", partition);
+    return (std::filesystem::path(directory) / name).string();
+}
+
+size_t PartitionedNGramIndex::partition_of(const Hash128& hash, size_t num_partitions) {
+    // Top bits of the high word, so partitions are contiguous hash ranges
+    if (num_partitions <= 1) return 0;
+    size_t bits = 0;
+    while ((size_t(1) << bits) < num_partitions) ++bits;
+    return static_cast<size_t>(hash.high >> (64 - bits));
+}
+
+} // namespace dedup
+} // namespace rapidsift
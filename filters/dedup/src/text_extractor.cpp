@@ -6,240 +6,709 @@
 #include <cmath>
 #include <fstream>
 #include <filesystem>
+#include <exception>
 
 namespace rapidsift {
 
+namespace {
+
+bool is_html_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+// std::isspace in the C locale: HTML whitespace plus vertical tab
+bool is_text_space(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+bool is_tag_name_char(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_' || c == ':';
+}
+
+bool is_heading_tag(std::string_view tag) {
+    return tag.size() == 2 && tag[0] == 'h' && tag[1] >= '1' && tag[1] <= '6';
+}
+
+// Elements that never have children or an end tag
+bool is_void_tag(std::string_view tag) {
+    static const std::unordered_set<std::string> void_tags = {
+        "area", "base", "br", "col", "embed", "hr", "img", "input",
+        "link", "meta", "param", "source", "track", "wbr"
+    };
+    return void_tags.count(std::string(tag)) > 0;
+}
+
+// Elements that never hold extractable text
+bool is_non_content_tag(std::string_view tag) {
+    return tag == "head" || tag == "script" || tag == "style" || tag == "noscript" || tag == "template";
+}
+
+// Elements allowed in <head>; any other start tag means the head was left unclosed
+bool belongs_in_head(std::string_view tag) {
+    return tag == "title" || tag == "meta" || tag == "link" || tag == "style" || tag == "script" ||
+           tag == "base" || tag == "noscript" || tag == "template";
+}
+
+// Elements whose text forms its own block in streaming extraction
+bool is_block_tag(std::string_view tag) {
+    static const std::unordered_set<std::string> block_tags = {
+        "html", "body", "p", "div", "br", "li", "ul", "ol", "dl", "dt", "dd", "table", "tr", "td", "th",
+        "pre", "blockquote", "section", "article", "aside", "header", "footer", "nav", "main", "form",
+        "hr", "figure", "figcaption", "address", "details", "summary",
+        "h1", "h2", "h3", "h4", "h5", "h6"
+    };
+    return block_tags.count(std::string(tag)) > 0;
+}
+
+// Elements whose start tag ends an open <p>
+bool closes_paragraph(std::string_view tag) {
+    static const std::unordered_set<std::string> block_tags = {
+        "p", "div", "ul", "ol", "table", "pre", "blockquote", "section", "article",
+        "aside", "header", "footer", "nav", "main", "form", "hr",
+        "h1", "h2", "h3", "h4", "h5", "h6"
+    };
+    return block_tags.count(std::string(tag)) > 0;
+}
+
+// HTML5's implied end tags: a start tag closes the nearest open target,
+// along with the elements still open inside it, unless one of the rule's
+// scope elements comes first, so nested lists and tables are left alone
+struct ImpliedEndRule {
+    std::vector<std::string_view> targets;
+    std::vector<std::string_view> scopes;
+    bool blocks_scope = false;      // Any block that ends a <p> scopes the rule too
+    
+    bool is_target(std::string_view tag) const {
+        return std::find(targets.begin(), targets.end(), tag) != targets.end();
+    }
+    bool is_scope(std::string_view tag) const {
+        return (blocks_scope && closes_paragraph(tag)) || std::find(scopes.begin(), scopes.end(), tag) != scopes.end();
+    }
+};
+
+const std::vector<ImpliedEndRule>& implied_end_rules() {
+    static const std::vector<ImpliedEndRule> rules = {
+        // An open block never has an open <p> above it, so the nearest one ends the search
+        {{"p"}, {"html", "body", "td", "th", "caption", "button", "object", "template"}, true},
+        {{"li"}, {"ul", "ol", "menu", "table", "td", "th", "template"}},
+        {{"dd", "dt"}, {"dl", "table", "td", "th", "template"}},
+        {{"td", "th"}, {"table", "template"}},
+        {{"tr"}, {"table", "template"}},
+        {{"thead", "tbody", "tfoot"}, {"table", "template"}},
+        {{"option"}, {"select", "datalist", "optgroup"}},
+        {{"option", "optgroup"}, {"select"}},
+    };
+    return rules;
+}
+
+// Index into implied_end_rules of the rule a start tag applies, or -1
+int implied_end_rule(std::string_view tag) {
+    if (closes_paragraph(tag)) return 0;
+    if (tag == "li") return 1;
+    if (tag == "dd" || tag == "dt") return 2;
+    if (tag == "td" || tag == "th") return 3;
+    if (tag == "tr") return 4;
+    if (tag == "thead" || tag == "tbody" || tag == "tfoot") return 5;
+    if (tag == "option") return 6;
+    if (tag == "optgroup") return 7;
+    return -1;
+}
+
+// How many open elements (tag_at(0) outermost, depth of them) a start tag
+// implicitly closes: body content ends an open <head>, otherwise the tag's
+// implied end rule applies
+template <typename TagAt>
+size_t implicitly_closed(std::string_view tag, size_t depth, TagAt tag_at) {
+    // A tag that cannot be in <head> ends an unclosed one, which only sits at the top
+    if (!belongs_in_head(tag)) {
+        for (size_t i = 0; i < std::min<size_t>(depth, 2); ++i) {
+            if (tag_at(i) == "head") return depth - i;
+        }
+    }
+    
+    int rule = implied_end_rule(tag);
+    if (rule < 0) return 0;
+    const ImpliedEndRule& implied = implied_end_rules()[rule];
+    for (size_t i = depth; i-- > 0;) {
+        std::string_view open_tag = tag_at(i);
+        if (implied.is_target(open_tag)) return depth - i;
+        if (implied.is_scope(open_tag)) return 0;
+    }
+    return 0;
+}
+
+// Elements still open past the depth cap. They are not in the parse stack,
+// but their end tags must close them rather than a kept element of the same
+// name. All of them sit inside the innermost kept element, so closing any
+// kept element closes them too. Their order is not kept, only counts per
+// name and of the scope elements each implied end rule would stop at, so
+// every token costs O(1) however many elements were dropped
+class DroppedElements {
+public:
+    DroppedElements() : scopes_(implied_end_rules().size(), 0) {}
+    
+    bool empty() const { return size_ == 0; }
+    
+    void clear() {
+        if (size_ == 0) return;
+        counts_.clear();
+        std::fill(scopes_.begin(), scopes_.end(), 0);
+        size_ = 0;
+    }
+    
+    void open(std::string_view tag) {
+        counts_[std::string(tag)]++;
+        size_++;
+        count_scopes(tag, true);
+    }
+    
+    // Whether an end tag closed a dropped element
+    bool close(std::string_view tag) {
+        if (size_ == 0) return false;
+        auto it = counts_.find(std::string(tag));
+        if (it == counts_.end()) return false;
+        remove(it);
+        return true;
+    }
+    
+    // Applies a start tag's implied end tags across the kept elements
+    // (kept_tag_at, kept of them) and the dropped ones; returns how many kept
+    // elements it closes. A dropped scope element stops the rule, otherwise a
+    // dropped target closes before any kept one
+    template <typename TagAt>
+    size_t close_implied(std::string_view tag, size_t kept, TagAt kept_tag_at) {
+        if (size_ > 0) {
+            int rule = implied_end_rule(tag);
+            if (rule >= 0) {
+                if (scopes_[rule] > 0) return 0;
+                for (std::string_view target : implied_end_rules()[rule].targets) {
+                    auto it = counts_.find(std::string(target));
+                    if (it != counts_.end()) {
+                        remove(it);
+                        return 0;
+                    }
+                }
+            }
+        }
+        size_t closed = implicitly_closed(tag, kept, kept_tag_at);
+        if (closed > 0) clear();
+        return closed;
+    }
+    
+private:
+    std::unordered_map<std::string, size_t> counts_;
+    std::vector<size_t> scopes_;        // Per implied end rule
+    size_t size_ = 0;
+    
+    void count_scopes(std::string_view tag, bool opened) {
+        const auto& rules = implied_end_rules();
+        for (size_t rule = 0; rule < rules.size(); ++rule) {
+            if (!rules[rule].is_scope(tag)) continue;
+            if (opened) scopes_[rule]++;
+            else scopes_[rule]--;
+        }
+    }
+    
+    void remove(std::unordered_map<std::string, size_t>::iterator it) {
+        count_scopes(it->first, false);
+        if (--it->second == 0) counts_.erase(it);
+        size_--;
+    }
+};
+
+bool equals_ignore_case(std::string_view text, std::string_view lower) {
+    if (text.size() != lower.size()) return false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(text[i])) != lower[i]) return false;
+    }
+    return true;
+}
+
+std::string lower_case(std::string_view text) {
+    std::string result(text);
+    for (char& c : result) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return result;
+}
+
+} // anonymous namespace
+
 // ==============================================================================
-// HTML Parser Implementation
+// HTML Tokenizer Implementation
 // ==============================================================================
 
-void HtmlParser::skip_whitespace() {
-    while (pos_ < html_.length() && std::isspace(html_[pos_])) {
-        pos_++;
+std::string_view HtmlToken::attribute(std::string_view attribute_name) const {
+    for (const auto& attr : attributes) {
+        if (attr.name == attribute_name) return attr.value;
     }
+    return {};
 }
 
-std::string HtmlParser::parse_tag_name() {
-    std::string tag_name;
-    while (pos_ < html_.length() && 
-           (std::isalnum(html_[pos_]) || html_[pos_] == '-' || html_[pos_] == '_')) {
-        tag_name += std::tolower(html_[pos_]);
-        pos_++;
+void HtmlMetadata::observe(const HtmlToken& token) {
+    if (token.type == HtmlToken::Type::TEXT) {
+        if (in_title_) title.append(token.text);
+        return;
+    }
+    if (token.name == "title") {
+        in_title_ = token.type == HtmlToken::Type::START_TAG && !title_seen_;
+        title_seen_ = true;
+        return;
+    }
+    if (token.type == HtmlToken::Type::END_TAG) return;
+    in_title_ = false;
+    
+    if (token.name == "html") {
+        std::string_view lang = token.attribute("lang");
+        if (!lang.empty() && !html_language_) {
+            language = lang;
+            html_language_ = true;
+        }
+        return;
+    }
+    if (token.name != "meta") return;
+    
+    std::string_view declared = token.attribute("charset");
+    if (!declared.empty() && charset.empty()) charset = lower_case(declared);
+    
+    std::string_view key = token.attribute("name");
+    if (key.empty()) key = token.attribute("property");
+    if (key.empty()) key = token.attribute("http-equiv");
+    if (key.empty()) return;
+    
+    std::string_view content = token.attribute("content");
+    auto [entry, inserted] = meta.emplace(lower_case(key), std::string(content));
+    if (!inserted) return;
+    
+    if (entry->first == "content-type" && charset.empty()) {
+        // text/html; charset=...
+        std::string lowered = lower_case(content);
+        size_t pos = lowered.find("charset");
+        if (pos != std::string::npos) pos = lowered.find_first_not_of(" \t", pos + 7);
+        if (pos != std::string::npos && lowered[pos] == '=') {
+            pos = lowered.find_first_not_of(" \t\"'", pos + 1);
+            if (pos != std::string::npos) charset = lowered.substr(pos, lowered.find_first_of(" \t\"';", pos) - pos);
+        }
+    } else if ((entry->first == "content-language" || entry->first == "language") && language.empty()) {
+        language = content;
     }
-    return tag_name;
 }
 
-std::unordered_map<std::string, std::string> HtmlParser::parse_attributes() {
-    std::unordered_map<std::string, std::string> attributes;
-    
-    while (pos_ < html_.length() && html_[pos_] != '>' && html_[pos_] != '/') {
-        skip_whitespace();
-        if (pos_ >= html_.length() || html_[pos_] == '>' || html_[pos_] == '/') break;
-        
-        // Parse attribute name
-        std::string attr_name;
-        while (pos_ < html_.length() && 
-               (std::isalnum(html_[pos_]) || html_[pos_] == '-' || html_[pos_] == '_')) {
-            attr_name += std::tolower(html_[pos_]);
+void HtmlMetadata::clear() {
+    title.clear();
+    language.clear();
+    charset.clear();
+    meta.clear();
+    in_title_ = false;
+    title_seen_ = false;
+    html_language_ = false;
+}
+
+std::string_view HtmlTokenizer::lowered(std::string_view name) {
+    if (std::none_of(name.begin(), name.end(), [](char c) { return c >= 'A' && c <= 'Z'; })) {
+        return name;
+    }
+    if (lowered_used_ == lowered_.size()) {
+        lowered_.emplace_back();
+    }
+    std::string& buffer = lowered_[lowered_used_++];
+    buffer.assign(name);
+    std::transform(buffer.begin(), buffer.end(), buffer.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return buffer;
+}
+
+void HtmlTokenizer::parse_start_tag(HtmlToken& token) {
+    const size_t length = html_.size();
+    size_t name_end = pos_ + 1;
+    while (name_end < length && is_tag_name_char(html_[name_end])) name_end++;
+    token.type = HtmlToken::Type::START_TAG;
+    token.name = lowered(html_.substr(pos_ + 1, name_end - pos_ - 1));
+    pos_ = name_end;
+    
+    while (pos_ < length && html_[pos_] != '>') {
+        if (is_html_space(html_[pos_])) {
             pos_++;
+            continue;
+        }
+        if (html_[pos_] == '/') {
+            token.self_closing = pos_ + 1 < length && html_[pos_ + 1] == '>';
+            pos_++;
+            continue;
         }
         
-        skip_whitespace();
-        std::string attr_value;
+        size_t attr_begin = pos_;
+        while (pos_ < length && !is_html_space(html_[pos_]) && html_[pos_] != '>' && html_[pos_] != '=' &&
+               html_[pos_] != '/') {
+            pos_++;
+        }
+        if (pos_ == attr_begin) {
+            pos_++;    // Stray '=': skip it so the loop always advances
+            continue;
+        }
+        FlatHtmlAttribute attribute;
+        attribute.name = lowered(html_.substr(attr_begin, pos_ - attr_begin));
         
-        if (pos_ < html_.length() && html_[pos_] == '=') {
-            pos_++; // Skip '='
-            skip_whitespace();
-            
-            if (pos_ < html_.length() && (html_[pos_] == '"' || html_[pos_] == '\'')) {
-                char quote = html_[pos_];
-                pos_++; // Skip opening quote
-                
-                while (pos_ < html_.length() && html_[pos_] != quote) {
-                    attr_value += html_[pos_];
-                    pos_++;
-                }
-                
-                if (pos_ < html_.length()) pos_++; // Skip closing quote
+        while (pos_ < length && is_html_space(html_[pos_])) pos_++;
+        if (pos_ < length && html_[pos_] == '=') {
+            pos_++;
+            while (pos_ < length && is_html_space(html_[pos_])) pos_++;
+            if (pos_ < length && (html_[pos_] == '"' || html_[pos_] == '\'')) {
+                char quote = html_[pos_++];
+                size_t value_end = html_.find(quote, pos_);
+                if (value_end == std::string_view::npos) value_end = length;
+                attribute.value = html_.substr(pos_, value_end - pos_);
+                pos_ = std::min(length, value_end + 1);
             } else {
-                // Unquoted attribute value
-                while (pos_ < html_.length() && !std::isspace(html_[pos_]) && 
-                       html_[pos_] != '>' && html_[pos_] != '/') {
-                    attr_value += html_[pos_];
-                    pos_++;
-                }
+                size_t value_begin = pos_;
+                while (pos_ < length && !is_html_space(html_[pos_]) && html_[pos_] != '>') pos_++;
+                attribute.value = html_.substr(value_begin, pos_ - value_begin);
             }
         }
+        token.attributes.push_back(attribute);
+    }
+    if (pos_ < length) pos_++;    // Skip '>'
+    
+    // Script and style content is raw text up to the matching end tag
+    if (!token.self_closing && (token.name == "script" || token.name == "style")) {
+        raw_text_tag_ = token.name == "script" ? "script" : "style";
+        size_t end = pos_;
+        while ((end = html_.find("</", end)) != std::string_view::npos &&
+               !equals_ignore_case(html_.substr(end + 2, raw_text_tag_.size()), raw_text_tag_)) {
+            end += 2;
+        }
+        raw_text_end_ = end == std::string_view::npos ? length : end;
+    }
+}
+
+bool HtmlTokenizer::next(HtmlToken& token) {
+    token.name = {};
+    token.text = {};
+    token.self_closing = false;
+    token.attributes.clear();
+    lowered_used_ = 0;
+    
+    const size_t length = html_.size();
+    
+    // Inside script or style: the content, then its end tag
+    if (!raw_text_tag_.empty()) {
+        if (pos_ < raw_text_end_) {
+            token.type = HtmlToken::Type::TEXT;
+            token.text = html_.substr(pos_, raw_text_end_ - pos_);
+            pos_ = raw_text_end_;
+            return true;
+        }
+        token.type = HtmlToken::Type::END_TAG;
+        token.name = raw_text_tag_;
+        raw_text_tag_ = {};
+        size_t end = html_.find('>', pos_);
+        pos_ = end == std::string_view::npos ? length : end + 1;
+        return true;
+    }
+    
+    while (pos_ < length) {
+        if (html_[pos_] != '<') {
+            size_t end = html_.find('<', pos_);
+            if (end == std::string_view::npos) end = length;
+            token.type = HtmlToken::Type::TEXT;
+            token.text = html_.substr(pos_, end - pos_);
+            pos_ = end;
+            return true;
+        }
+        
+        // Comments, doctypes and processing instructions
+        if (html_.compare(pos_, 4, "<!--") == 0) {
+            size_t end = html_.find("-->", pos_ + 4);
+            pos_ = end == std::string_view::npos ? length : end + 3;
+            continue;
+        }
+        if (pos_ + 1 < length && (html_[pos_ + 1] == '!' || html_[pos_ + 1] == '?')) {
+            size_t end = html_.find('>', pos_);
+            pos_ = end == std::string_view::npos ? length : end + 1;
+            continue;
+        }
+        
+        if (pos_ + 2 < length && html_[pos_ + 1] == '/' && is_tag_name_char(html_[pos_ + 2])) {
+            size_t name_end = pos_ + 2;
+            while (name_end < length && is_tag_name_char(html_[name_end])) name_end++;
+            token.type = HtmlToken::Type::END_TAG;
+            token.name = lowered(html_.substr(pos_ + 2, name_end - pos_ - 2));
+            size_t end = html_.find('>', name_end);
+            pos_ = end == std::string_view::npos ? length : end + 1;
+            return true;
+        }
         
-        if (!attr_name.empty()) {
-            attributes[attr_name] = attr_value;
+        if (pos_ + 1 < length && std::isalpha(static_cast<unsigned char>(html_[pos_ + 1]))) {
+            parse_start_tag(token);
+            return true;
         }
+        
+        // A '<' that starts no tag is text
+        size_t end = html_.find('<', pos_ + 1);
+        if (end == std::string_view::npos) end = length;
+        token.type = HtmlToken::Type::TEXT;
+        token.text = html_.substr(pos_, end - pos_);
+        pos_ = end;
+        return true;
     }
     
-    return attributes;
+    return false;
 }
 
-std::string HtmlParser::parse_text() {
+// ==============================================================================
+// Flat HTML Document Implementation
+// ==============================================================================
+
+std::string_view FlatHtmlDocument::attribute(uint32_t id, std::string_view name) const {
+    const FlatHtmlNode& n = nodes_[id];
+    for (uint32_t a = n.attributes_begin; a < n.attributes_end; ++a) {
+        if (attributes_[a].name == name) {
+            return attributes_[a].value;
+        }
+    }
+    return {};
+}
+
+bool FlatHtmlDocument::has_attribute(uint32_t id, std::string_view name) const {
+    const FlatHtmlNode& n = nodes_[id];
+    for (uint32_t a = n.attributes_begin; a < n.attributes_end; ++a) {
+        if (attributes_[a].name == name) return true;
+    }
+    return false;
+}
+
+bool FlatHtmlDocument::has_class(uint32_t id, std::string_view class_name) const {
+    return attribute(id, "class").find(class_name) != std::string_view::npos;
+}
+
+bool FlatHtmlDocument::has_id(uint32_t id, std::string_view id_value) const {
+    return has_attribute(id, "id") && attribute(id, "id") == id_value;
+}
+
+std::string FlatHtmlDocument::text_content(uint32_t id) const {
     std::string text;
-    while (pos_ < html_.length() && html_[pos_] != '<') {
-        text += html_[pos_];
-        pos_++;
+    for (uint32_t i = id; i < nodes_[id].end; ++i) {
+        if (nodes_[i].is_text()) {
+            text.append(nodes_[i].text);
+        }
     }
     return text;
 }
 
-std::shared_ptr<HtmlElement> HtmlParser::parse_element() {
-    if (pos_ >= html_.length()) return nullptr;
+void FlatHtmlDocument::clear() {
+    source_ = {};
+    nodes_.clear();
+    attributes_.clear();
+    lowered_names_.clear();
+    open_elements_.clear();
+    metadata_.clear();
+}
+
+// ==============================================================================
+// HTML Parser Implementation
+// ==============================================================================
+
+std::shared_ptr<HtmlElement> HtmlParser::parse() {
+    auto root = std::make_shared<HtmlElement>();
+    root->tag = "document";
     
-    auto element = std::make_shared<HtmlElement>();
+    // Open elements, innermost last; the root stays open
+    std::vector<std::shared_ptr<HtmlElement>> open = {root};
+    auto open_tag = [&](size_t depth) -> std::string_view { return open[depth + 1]->tag; };
     
-    if (html_[pos_] == '<') {
-        pos_++; // Skip '<'
-        skip_whitespace();
+    DroppedElements dropped;
+    
+    metadata_.clear();
+    HtmlTokenizer tokenizer(html_);
+    HtmlToken token;
+    
+    while (tokenizer.next(token)) {
+        metadata_.observe(token);
         
-        // Check for closing tag
-        if (pos_ < html_.length() && html_[pos_] == '/') {
-            return nullptr; // This is a closing tag, handled by parent
+        if (token.type == HtmlToken::Type::TEXT) {
+            // Text joins its element with leading whitespace dropped; text
+            // outside any element becomes a node of its own
+            size_t start = 0;
+            while (start < token.text.size() && is_text_space(token.text[start])) ++start;
+            if (start == token.text.size()) continue;
+            
+            if (open.size() == 1) {
+                auto text_node = std::make_shared<HtmlElement>();
+                text_node->text = token.text.substr(start);
+                text_node->parent = root;
+                root->children.push_back(std::move(text_node));
+            } else {
+                open.back()->text += token.text.substr(start);
+            }
+            continue;
         }
         
-        // Parse tag name
-        element->tag = parse_tag_name();
-        skip_whitespace();
+        // End tag: closes the innermost open element of that name, if any
+        if (token.type == HtmlToken::Type::END_TAG) {
+            if (dropped.close(token.name)) continue;
+            for (size_t depth = open.size(); depth-- > 1;) {
+                if (open[depth]->tag == token.name) {
+                    open.resize(depth);
+                    dropped.clear();
+                    break;
+                }
+            }
+            continue;
+        }
         
-        // Parse attributes
-        element->attributes = parse_attributes();
-        skip_whitespace();
+        open.resize(open.size() - dropped.close_implied(token.name, open.size() - 1, open_tag));
         
-        // Check for self-closing tag
-        bool self_closing = false;
-        if (pos_ < html_.length() && html_[pos_] == '/') {
-            self_closing = true;
-            pos_++;
+        // Past the depth cap, elements are dropped and their text goes to the deepest one kept
+        if (open.size() > max_depth_) {
+            if (!token.self_closing && !is_void_tag(token.name)) dropped.open(token.name);
+            continue;
         }
         
-        if (pos_ < html_.length() && html_[pos_] == '>') {
-            pos_++; // Skip '>'
+        auto element = std::make_shared<HtmlElement>();
+        element->tag = token.name;
+        for (const auto& attribute : token.attributes) {
+            element->attributes.emplace(attribute.name, attribute.value);
         }
+        element->parent = open.back();
+        open.back()->children.push_back(element);
         
-        if (!self_closing) {
-            // Parse content and children
-            while (pos_ < html_.length()) {
-                skip_whitespace();
-                if (pos_ >= html_.length()) break;
-                
-                if (html_[pos_] == '<') {
-                    // Check for closing tag
-                    size_t saved_pos = pos_;
-                    pos_++; // Skip '<'
-                    skip_whitespace();
-                    
-                    if (pos_ < html_.length() && html_[pos_] == '/') {
-                        pos_++; // Skip '/'
-                        skip_whitespace();
-                        std::string closing_tag = parse_tag_name();
-                        
-                        if (closing_tag == element->tag) {
-                            // Found matching closing tag
-                            while (pos_ < html_.length() && html_[pos_] != '>') pos_++;
-                            if (pos_ < html_.length()) pos_++; // Skip '>'
-                            break;
-                        } else {
-                            // Not our closing tag, restore position
-                            pos_ = saved_pos;
-                        }
-                    } else {
-                        // Not a closing tag, restore position
-                        pos_ = saved_pos;
-                    }
-                    
-                    // Parse child element
-                    auto child = parse_element();
-                    if (child) {
-                        child->parent = element;
-                        element->children.push_back(child);
-                    }
-                } else {
-                    // Parse text content
-                    std::string text = parse_text();
-                    if (!text.empty()) {
-                        element->text += text;
-                    }
-                }
-            }
+        if (!token.self_closing && !is_void_tag(element->tag)) {
+            open.push_back(std::move(element));
         }
-    } else {
-        // Text node
-        element->text = parse_text();
     }
     
-    return element;
+    return root;
 }
 
-std::shared_ptr<HtmlElement> HtmlParser::parse() {
-    pos_ = 0;
-    auto root = std::make_shared<HtmlElement>();
-    root->tag = "document";
+void HtmlParser::parse_flat(std::string_view html, FlatHtmlDocument& document, size_t max_depth) {
+    document.clear();
+    document.source_ = html;
+    auto& nodes = document.nodes_;
+    auto& open = document.open_elements_;
+    
+    FlatHtmlNode root;
+    root.tag = "document";
+    nodes.push_back(root);
+    open.push_back(0);
+    
+    HtmlTokenizer tokenizer(html);
+    HtmlToken token;
+    
+    // Names lower-cased by the tokenizer are copied to outlive the token
+    auto keep = [&](std::string_view name) -> std::string_view {
+        if (tokenizer.in_source(name)) return name;
+        document.lowered_names_.emplace_back(name);
+        return document.lowered_names_.back();
+    };
     
-    while (pos_ < html_.length()) {
-        skip_whitespace();
-        if (pos_ >= html_.length()) break;
+    DroppedElements dropped;
+    auto close_top = [&]() {
+        nodes[open.back()].end = static_cast<uint32_t>(nodes.size());
+        open.pop_back();
+        dropped.clear();
+    };
+    
+    while (tokenizer.next(token)) {
+        document.metadata_.observe(token);
         
-        auto element = parse_element();
-        if (element) {
-            element->parent = root;
-            root->children.push_back(element);
+        if (token.type == HtmlToken::Type::TEXT) {
+            if (std::all_of(token.text.begin(), token.text.end(), is_html_space)) continue;
+            FlatHtmlNode node;
+            node.text = token.text;
+            node.parent = open.back();
+            node.end = static_cast<uint32_t>(nodes.size() + 1);
+            nodes.push_back(node);
+            continue;
+        }
+        
+        // End tag: closes the innermost open element of that name, if any
+        if (token.type == HtmlToken::Type::END_TAG) {
+            if (dropped.close(token.name)) continue;
+            for (size_t depth = open.size(); depth-- > 1;) {
+                if (nodes[open[depth]].tag == token.name) {
+                    while (open.size() > depth) close_top();
+                    break;
+                }
+            }
+            continue;
+        }
+        
+        FlatHtmlNode element;
+        element.tag = keep(token.name);
+        element.attributes_begin = static_cast<uint32_t>(document.attributes_.size());
+        for (const auto& attribute : token.attributes) {
+            document.attributes_.push_back({keep(attribute.name), attribute.value});
+        }
+        element.attributes_end = static_cast<uint32_t>(document.attributes_.size());
+        
+        // Implied end tags
+        size_t closed = dropped.close_implied(element.tag, open.size() - 1,
+                                              [&](size_t depth) { return nodes[open[depth + 1]].tag; });
+        while (closed-- > 0) close_top();
+        
+        // Past the depth cap, elements are dropped and their text goes to the deepest one kept
+        if (open.size() > max_depth) {
+            document.attributes_.resize(element.attributes_begin);
+            if (!token.self_closing && !is_void_tag(element.tag)) dropped.open(element.tag);
+            continue;
+        }
+        
+        element.parent = open.back();
+        const uint32_t id = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(element);
+        
+        if (token.self_closing || is_void_tag(element.tag)) {
+            nodes[id].end = id + 1;
+        } else {
+            open.push_back(id);
         }
     }
     
-    return root;
+    while (!open.empty()) close_top();
 }
 
 std::string HtmlParser::extract_title(const std::string& html) {
-    std::regex title_regex(R"(<title[^>]*>(.*?)</title>)", std::regex_constants::icase);
-    std::smatch match;
+    HtmlTokenizer tokenizer(html);
+    HtmlToken token;
+    HtmlMetadata metadata;
     
-    if (std::regex_search(html, match, title_regex)) {
-        return match[1].str();
+    while (tokenizer.next(token)) {
+        metadata.observe(token);
+        if (token.name == "title" && token.type == HtmlToken::Type::END_TAG) break;
     }
     
-    return "";
+    return metadata.title;
 }
 
 std::string HtmlParser::extract_meta_content(const std::string& html, const std::string& name) {
-    std::string pattern = R"(<meta[^>]+name\s*=\s*["\'])" + name + R"(["\'][^>]+content\s*=\s*["\']([^"\']*)["\'])";
-    std::regex meta_regex(pattern, std::regex_constants::icase);
-    std::smatch match;
+    HtmlTokenizer tokenizer(html);
+    HtmlToken token;
+    HtmlMetadata metadata;
     
-    if (std::regex_search(html, match, meta_regex)) {
-        return match[1].str();
+    while (tokenizer.next(token)) {
+        metadata.observe(token);
     }
     
-    return "";
+    auto it = metadata.meta.find(lower_case(name));
+    return it != metadata.meta.end() ? it->second : "";
 }
 
 std::vector<std::string> HtmlParser::extract_meta_tags(const std::string& html) {
     std::vector<std::string> meta_tags;
-    std::regex meta_regex(R"(<meta[^>]*>)", std::regex_constants::icase);
-    std::sregex_iterator iter(html.begin(), html.end(), meta_regex);
-    std::sregex_iterator end;
     
-    for (; iter != end; ++iter) {
-        meta_tags.push_back(iter->str());
+    // Every "<meta" up to the next '>', as written in the source
+    for (size_t pos = html.find('<'); pos != std::string::npos; pos = html.find('<', pos + 1)) {
+        if (!equals_ignore_case(std::string_view(html).substr(pos + 1, 4), "meta")) continue;
+        size_t end = html.find('>', pos);
+        if (end == std::string::npos) break;
+        meta_tags.push_back(html.substr(pos, end + 1 - pos));
+        pos = end;
     }
     
     return meta_tags;
 }
 
 std::string HtmlParser::detect_encoding(const std::string& html) {
-    // Look for charset in meta tags
-    std::regex charset_regex(R"(charset\s*=\s*["\']?([^"\'>\s]+))", std::regex_constants::icase);
-    std::smatch match;
-    
-    if (std::regex_search(html, match, charset_regex)) {
-        return match[1].str();
-    }
-    
-    return "utf-8"; // Default
+    std::string charset = extraction_utils::sniff_charset(html);
+    return charset.empty() ? "utf-8" : charset; // Default
 }
 
 // ==============================================================================
@@ -270,40 +739,31 @@ void BoilerplateRemover::initialize_patterns() {
         "nav", "navigation", "menu", "sidebar", "footer", "header",
         "ad", "ads", "banner", "popup", "modal", "comments"
     };
-    
-    // Regex patterns for boilerplate detection
-    boilerplate_patterns_ = {
-        std::regex(R"(\b(cookie|privacy|terms|policy)\b)", std::regex_constants::icase),
-        std::regex(R"(\b(subscribe|newsletter|signup)\b)", std::regex_constants::icase),
-        std::regex(R"(\b(copyright|©|all rights reserved)\b)", std::regex_constants::icase),
-        std::regex(R"(\b(click here|read more|continue reading)\b)", std::regex_constants::icase)
-    };
 }
 
-bool BoilerplateRemover::is_boilerplate_element(const std::shared_ptr<HtmlElement>& element) const {
-    if (!element) return true;
-    
+bool BoilerplateRemover::boilerplate_match(std::string_view tag, std::string_view class_attr,
+                                           std::string_view id_attr) const {
     // Check tag name
-    if (boilerplate_tags_.find(element->tag) != boilerplate_tags_.end()) {
+    if (boilerplate_tags_.find(std::string(tag)) != boilerplate_tags_.end()) {
         return true;
     }
     
     // Check class attribute
-    std::string class_attr = element->get_attribute("class");
     if (!class_attr.empty()) {
-        std::transform(class_attr.begin(), class_attr.end(), class_attr.begin(), ::tolower);
+        std::string lowered(class_attr);
+        std::transform(lowered.begin(), lowered.end(), lowered.begin(), ::tolower);
         for (const auto& pattern : boilerplate_classes_) {
-            if (class_attr.find(pattern) != std::string::npos) {
+            if (lowered.find(pattern) != std::string::npos) {
                 return true;
             }
         }
     }
     
     // Check id attribute
-    std::string id_attr = element->get_attribute("id");
     if (!id_attr.empty()) {
-        std::transform(id_attr.begin(), id_attr.end(), id_attr.begin(), ::tolower);
-        if (boilerplate_ids_.find(id_attr) != boilerplate_ids_.end()) {
+        std::string lowered(id_attr);
+        std::transform(lowered.begin(), lowered.end(), lowered.begin(), ::tolower);
+        if (boilerplate_ids_.find(lowered) != boilerplate_ids_.end()) {
             return true;
         }
     }
@@ -311,28 +771,22 @@ bool BoilerplateRemover::is_boilerplate_element(const std::shared_ptr<HtmlElemen
     return false;
 }
 
-bool BoilerplateRemover::is_navigation_element(const std::shared_ptr<HtmlElement>& element) const {
-    if (!element) return false;
-    
-    return element->tag == "nav" || 
-           element->has_class("nav") || 
-           element->has_class("navigation") ||
-           element->has_class("menu") ||
-           element->has_id("nav") ||
-           element->has_id("navigation");
+bool BoilerplateRemover::navigation_match(std::string_view tag, std::string_view class_attr,
+                                          std::string_view id_attr) const {
+    return tag == "nav" || 
+           class_attr.find("nav") != std::string_view::npos ||
+           class_attr.find("navigation") != std::string_view::npos ||
+           class_attr.find("menu") != std::string_view::npos ||
+           id_attr == "nav" ||
+           id_attr == "navigation";
 }
 
-bool BoilerplateRemover::is_advertisement_element(const std::shared_ptr<HtmlElement>& element) const {
-    if (!element) return false;
-    
-    std::string class_attr = element->get_attribute("class");
-    std::string id_attr = element->get_attribute("id");
-    
-    std::vector<std::string> ad_patterns = {"ad", "ads", "advertisement", "banner", "sponsor"};
+bool BoilerplateRemover::advertisement_match(std::string_view class_attr, std::string_view id_attr) const {
+    static const std::vector<std::string> ad_patterns = {"ad", "ads", "advertisement", "banner", "sponsor"};
     
     for (const auto& pattern : ad_patterns) {
-        if (class_attr.find(pattern) != std::string::npos ||
-            id_attr.find(pattern) != std::string::npos) {
+        if (class_attr.find(pattern) != std::string_view::npos ||
+            id_attr.find(pattern) != std::string_view::npos) {
             return true;
         }
     }
@@ -340,26 +794,23 @@ bool BoilerplateRemover::is_advertisement_element(const std::shared_ptr<HtmlElem
     return false;
 }
 
-bool BoilerplateRemover::is_content_element(const std::shared_ptr<HtmlElement>& element) const {
-    if (!element) return false;
-    
+bool BoilerplateRemover::content_match(std::string_view tag, std::string_view class_attr) const {
     // Content tags
-    std::unordered_set<std::string> content_tags = {
+    static const std::unordered_set<std::string> content_tags = {
         "article", "main", "section", "div", "p", "h1", "h2", "h3", "h4", "h5", "h6"
     };
     
-    if (content_tags.find(element->tag) != content_tags.end()) {
+    if (content_tags.find(std::string(tag)) != content_tags.end()) {
         return true;
     }
     
     // Content class patterns
-    std::string class_attr = element->get_attribute("class");
-    std::vector<std::string> content_patterns = {
+    static const std::vector<std::string> content_patterns = {
         "content", "article", "main", "body", "text", "post", "entry"
     };
     
     for (const auto& pattern : content_patterns) {
-        if (class_attr.find(pattern) != std::string::npos) {
+        if (class_attr.find(pattern) != std::string_view::npos) {
             return true;
         }
     }
@@ -367,36 +818,75 @@ bool BoilerplateRemover::is_content_element(const std::shared_ptr<HtmlElement>&
     return false;
 }
 
-double BoilerplateRemover::calculate_content_score(const std::shared_ptr<HtmlElement>& element) const {
-    if (!element) return 0.0;
-    
+double BoilerplateRemover::content_score(std::string_view tag, std::string_view class_attr, std::string_view id_attr,
+                                         size_t text_length, size_t link_count) const {
     double score = 0.0;
     
     // Positive scoring for content elements
-    if (is_content_element(element)) {
+    if (content_match(tag, class_attr)) {
         score += 10.0;
     }
     
     // Negative scoring for boilerplate elements
-    if (is_boilerplate_element(element)) {
+    if (boilerplate_match(tag, class_attr, id_attr)) {
         score -= 20.0;
     }
     
-    if (is_navigation_element(element)) {
+    if (navigation_match(tag, class_attr, id_attr)) {
         score -= 15.0;
     }
     
-    if (is_advertisement_element(element)) {
+    if (advertisement_match(class_attr, id_attr)) {
         score -= 25.0;
     }
     
     // Text content scoring
-    size_t text_length = element->text.length();
     if (text_length > 0) {
         score += std::min(text_length / 10.0, 20.0); // Cap at 20 points
     }
     
     // Link density penalty
+    if (text_length > 0) {
+        double link_density = (double(link_count) / text_length) * 100.0;
+        if (link_density > 5.0) {
+            score -= link_density;
+        }
+    }
+    
+    return score;
+}
+
+bool BoilerplateRemover::is_boilerplate_element(const std::shared_ptr<HtmlElement>& element) const {
+    if (!element) return true;
+    
+    return boilerplate_match(element->tag, element->get_attribute("class"), element->get_attribute("id"));
+}
+
+bool BoilerplateRemover::is_navigation_element(const std::shared_ptr<HtmlElement>& element) const {
+    if (!element) return false;
+    
+    auto class_it = element->attributes.find("class");
+    auto id_it = element->attributes.find("id");
+    return navigation_match(element->tag,
+                            class_it != element->attributes.end() ? std::string_view(class_it->second) : "",
+                            id_it != element->attributes.end() ? std::string_view(id_it->second) : "");
+}
+
+bool BoilerplateRemover::is_advertisement_element(const std::shared_ptr<HtmlElement>& element) const {
+    if (!element) return false;
+    
+    return advertisement_match(element->get_attribute("class"), element->get_attribute("id"));
+}
+
+bool BoilerplateRemover::is_content_element(const std::shared_ptr<HtmlElement>& element) const {
+    if (!element) return false;
+    
+    return content_match(element->tag, element->get_attribute("class"));
+}
+
+double BoilerplateRemover::calculate_content_score(const std::shared_ptr<HtmlElement>& element) const {
+    if (!element) return 0.0;
+    
     size_t link_count = 0;
     for (const auto& child : element->children) {
         if (child->tag == "a") {
@@ -404,14 +894,39 @@ double BoilerplateRemover::calculate_content_score(const std::shared_ptr<HtmlEle
         }
     }
     
-    if (text_length > 0) {
-        double link_density = (double(link_count) / text_length) * 100.0;
-        if (link_density > 5.0) {
-            score -= link_density;
+    return content_score(element->tag, element->get_attribute("class"), element->get_attribute("id"),
+                         element->text.length(), link_count);
+}
+
+bool BoilerplateRemover::is_boilerplate_element(const HtmlToken& start_tag) const {
+    return boilerplate_match(start_tag.name, start_tag.attribute("class"), start_tag.attribute("id"));
+}
+
+bool BoilerplateRemover::is_boilerplate_element(const FlatHtmlDocument& document, uint32_t node) const {
+    const FlatHtmlNode& n = document.node(node);
+    if (n.is_text()) return false;
+    
+    return boilerplate_match(n.tag, document.attribute(node, "class"), document.attribute(node, "id"));
+}
+
+double BoilerplateRemover::calculate_content_score(const FlatHtmlDocument& document, uint32_t node) const {
+    const FlatHtmlNode& n = document.node(node);
+    if (n.is_text()) return 0.0;
+    
+    size_t text_length = 0;
+    size_t link_count = 0;
+    for (uint32_t child = document.first_child(node); child != FlatHtmlDocument::NO_NODE;
+         child = document.next_sibling(child)) {
+        const FlatHtmlNode& c = document.node(child);
+        if (c.is_text()) {
+            text_length += c.text.size();
+        } else if (c.tag == "a") {
+            link_count++;
         }
     }
     
-    return score;
+    return content_score(n.tag, document.attribute(node, "class"), document.attribute(node, "id"),
+                         text_length, link_count);
 }
 
 double BoilerplateRemover::calculate_text_density(const std::shared_ptr<HtmlElement>& element) const {
@@ -484,81 +999,393 @@ std::vector<std::shared_ptr<HtmlElement>> BoilerplateRemover::find_main_content(
     return content_elements;
 }
 
+std::vector<bool> BoilerplateRemover::boilerplate_mask(const FlatHtmlDocument& document) const {
+    std::vector<bool> removed(document.size(), false);
+    
+    // Parents precede their children, so one forward pass inherits the mark
+    for (uint32_t i = 1; i < document.size(); ++i) {
+        removed[i] = removed[document.node(i).parent] || is_boilerplate_element(document, i);
+    }
+    
+    return removed;
+}
+
+std::vector<uint32_t> BoilerplateRemover::find_main_content(const FlatHtmlDocument& document,
+                                                           const std::vector<bool>& removed) const {
+    std::vector<double> totals(document.size(), 0.0);
+    
+    for (uint32_t i = 0; i < document.size(); ++i) {
+        const FlatHtmlNode& n = document.node(i);
+        if (removed[i] || n.is_text()) continue;
+        
+        // Only elements with text of their own contribute
+        bool has_text = false;
+        for (uint32_t child = document.first_child(i); child != FlatHtmlDocument::NO_NODE && !has_text;
+             child = document.next_sibling(child)) {
+            has_text = document.node(child).is_text();
+        }
+        if (!has_text) continue;
+        
+        double score = calculate_content_score(document, i);
+        if (score <= 5.0) continue;
+        
+        totals[i] += score;
+        if (i != document.root()) {
+            totals[n.parent] += score;
+            if (n.parent != document.root()) {
+                totals[document.node(n.parent).parent] += score / 2.0;
+            }
+        }
+    }
+    
+    std::vector<uint32_t> content_nodes;
+    for (uint32_t i = 0; i < document.size(); ++i) {
+        if (totals[i] > 5.0 && !removed[i]) {
+            content_nodes.push_back(i);
+        }
+    }
+    
+    // Sort by content score (descending)
+    std::stable_sort(content_nodes.begin(), content_nodes.end(),
+        [&totals](uint32_t a, uint32_t b) { return totals[a] > totals[b]; });
+    
+    return content_nodes;
+}
+
+double BoilerplateRemover::calculate_text_density(const FlatHtmlDocument& document, uint32_t node) const {
+    size_t text_length = 0;
+    size_t tag_count = 0;
+    
+    for (uint32_t i = node; i < document.node(node).end; ++i) {
+        const FlatHtmlNode& n = document.node(i);
+        if (n.is_text()) {
+            text_length += n.text.size();
+        } else {
+            tag_count++;
+        }
+    }
+    
+    return tag_count > 0 ? double(text_length) / tag_count : 0.0;
+}
+
 // ==============================================================================
-// Text Cleaner Implementation  
+// Block Classifier Implementation
 // ==============================================================================
 
-TextCleaner::TextCleaner(const TextExtractionConfig& config) : config_(config) {
-    initialize_patterns();
-    initialize_html_entities();
-}
-
-void TextCleaner::initialize_patterns() {
-    // Common cleaning patterns
-    cleaning_patterns_ = {
-        // Remove extra whitespace
-        {std::regex(R"(\s+)"), " "},
-        // Remove leading/trailing whitespace from lines
-        {std::regex(R"(^\s+|\s+$)", std::regex_constants::multiline), ""},
-        // Remove excessive newlines
-        {std::regex(R"(\n\s*\n\s*\n+)"), "\n\n"},
-        // Remove remaining HTML tags
-        {std::regex(R"(<[^>]*>)"), ""},
-        // Remove script/style content that might remain
-        {std::regex(R"(<script[^>]*>.*?</script>)", std::regex_constants::icase), ""},
-        {std::regex(R"(<style[^>]*>.*?</style>)", std::regex_constants::icase), ""},
+namespace {
+
+// Tag path bits a node inherits from its ancestors
+enum PathBit : uint16_t {
+    PATH_NAV = 1 << 0,
+    PATH_HEADER_FOOTER = 1 << 1,
+    PATH_ASIDE = 1 << 2,
+    PATH_LIST = 1 << 3,
+    PATH_TABLE = 1 << 4,
+    PATH_FORM = 1 << 5,
+    PATH_ARTICLE = 1 << 6,
+    PATH_LINK = 1 << 7
+};
+
+struct BlockContext {
+    uint16_t path = 0;
+    uint8_t boilerplate_classes = 0;
+    uint8_t ad_classes = 0;
+    uint8_t content_classes = 0;
+};
+
+uint16_t path_bits(std::string_view tag, uint16_t inherited) {
+    if (tag == "a") return PATH_LINK;
+    if (tag == "nav" || tag == "menu") return PATH_NAV;
+    // A header or footer inside an article belongs to the article
+    if (tag == "header" || tag == "footer") return (inherited & PATH_ARTICLE) ? 0 : PATH_HEADER_FOOTER;
+    if (tag == "aside") return PATH_ASIDE;
+    if (tag == "ul" || tag == "ol" || tag == "li" || tag == "dl") return PATH_LIST;
+    if (tag == "table" || tag == "td" || tag == "th") return PATH_TABLE;
+    if (tag == "form" || tag == "button" || tag == "select" || tag == "label") return PATH_FORM;
+    if (tag == "article" || tag == "main") return PATH_ARTICLE;
+    return 0;
+}
+
+constexpr uint8_t MAX_CLASS_COUNT = 3;
+
+// Splits a class or id value into lower-case alphanumeric tokens and counts
+// the ones naming boilerplate, ads or content
+void count_class_tokens(std::string_view value, BlockContext& context) {
+    static const std::unordered_set<std::string_view> boilerplate_tokens = {
+        "nav", "navbar", "navigation", "menu", "topnav", "sidenav", "breadcrumb", "breadcrumbs",
+        "footer", "header", "masthead", "sidebar", "widget", "widgets", "share", "sharing", "social",
+        "comment", "comments", "related", "recommended", "pagination", "pager", "cookie", "cookies",
+        "consent", "gdpr", "popup", "modal", "newsletter", "subscribe", "signup", "login", "copyright",
+        "disclaimer", "tags", "tagcloud", "toolbar", "skip", "hidden"
+    };
+    static const std::unordered_set<std::string_view> ad_tokens = {
+        "ad", "ads", "advert", "adverts", "advertisement", "advertising", "sponsor", "sponsored",
+        "promo", "promotion", "banner", "adsense", "dfp", "outbrain", "taboola"
     };
+    static const std::unordered_set<std::string_view> content_tokens = {
+        "content", "article", "post", "entry", "body", "text", "main", "story", "blog", "prose"
+    };
+    
+    char token[32];
+    size_t i = 0;
+    while (i < value.size()) {
+        while (i < value.size() && !std::isalnum(static_cast<unsigned char>(value[i]))) ++i;
+        size_t length = 0;
+        for (; i < value.size() && std::isalnum(static_cast<unsigned char>(value[i])); ++i, ++length) {
+            if (length < sizeof(token)) token[length] = static_cast<char>(std::tolower(static_cast<unsigned char>(value[i])));
+        }
+        if (length == 0 || length > sizeof(token)) continue;
+        
+        std::string_view word(token, length);
+        if (boilerplate_tokens.count(word)) {
+            context.boilerplate_classes = std::min<uint8_t>(context.boilerplate_classes + 1, MAX_CLASS_COUNT);
+        } else if (ad_tokens.count(word)) {
+            context.ad_classes = std::min<uint8_t>(context.ad_classes + 1, MAX_CLASS_COUNT);
+        } else if (content_tokens.count(word)) {
+            context.content_classes = std::min<uint8_t>(context.content_classes + 1, MAX_CLASS_COUNT);
+        }
+    }
 }
 
-void TextCleaner::initialize_html_entities() {
-    html_entities_ = {
-        {"&amp;", "&"},
-        {"&lt;", "<"},
-        {"&gt;", ">"},
-        {"&quot;", "\""},
-        {"&apos;", "'"},
-        {"&nbsp;", " "},
-        {"&copy;", "©"},
-        {"&reg;", "®"},
-        {"&trade;", "™"},
-        {"&mdash;", "—"},
-        {"&ndash;", "–"},
-        {"&hellip;", "…"},
-        {"&laquo;", "«"},
-        {"&raquo;", "»"},
-        {"&ldquo;", "\""},
-        {"&rdquo;", "\""},
-        {"&lsquo;", "'"},
-        {"&rsquo;", "'"}
+// The most frequent function words of English, German, French, Spanish,
+// Italian, Portuguese and Dutch
+bool is_stopword(std::string_view word) {
+    static const std::unordered_set<std::string_view> stopwords = {
+        "the", "a", "an", "and", "or", "but", "of", "to", "in", "on", "at", "by", "for", "with", "from",
+        "as", "is", "are", "was", "were", "be", "been", "it", "its", "this", "that", "these", "those",
+        "he", "she", "they", "we", "you", "i", "his", "her", "their", "our", "your", "not", "no", "so",
+        "if", "than", "then", "there", "which", "who", "what", "when", "where", "how", "all", "any",
+        "can", "will", "would", "should", "could", "has", "have", "had", "do", "does", "did", "about",
+        "into", "over", "also", "more", "most", "some", "such", "only", "other", "out", "up", "just", "may",
+        "der", "die", "das", "und", "ist", "nicht", "ein", "eine", "zu", "den", "von", "mit", "sich",
+        "auf", "f\xC3\xBCr", "im", "dem", "des", "auch", "es", "an", "als", "wie", "bei", "oder", "aus",
+        "wird", "sind", "le", "la", "les", "et", "est", "un", "une", "du", "en", "que", "qui", "dans",
+        "pour", "pas", "sur", "au", "avec", "ce", "il", "elle", "ne", "se", "plus", "par", "sont",
+        "el", "los", "las", "y", "es", "una", "del", "por", "con", "para", "su", "al", "lo", "como",
+        "m\xC3\xA1s", "pero", "sus", "di", "che", "e", "per", "non", "sono", "della", "si",
+        "o", "os", "as", "um", "uma", "do", "da", "em", "com", "n\xC3\xA3o",
+        "het", "een", "van", "dat", "op", "te", "zijn", "met", "voor", "niet"
     };
+    return stopwords.count(word) > 0;
 }
 
-std::string TextCleaner::decode_html_entities(const std::string& text) const {
-    std::string result = text;
-    
-    for (const auto& [entity, replacement] : html_entities_) {
-        size_t pos = 0;
-        while ((pos = result.find(entity, pos)) != std::string::npos) {
-            result.replace(pos, entity.length(), replacement);
-            pos += replacement.length();
+bool is_boilerplate_word(std::string_view word) {
+    static const std::unordered_set<std::string_view> words = {
+        "cookie", "cookies", "privacy", "policy", "terms", "copyright", "\xC2\xA9", "rights", "reserved",
+        "subscribe", "unsubscribe", "newsletter", "login", "signup", "register", "password", "share",
+        "follow", "advertisement", "sponsored", "consent", "accept", "javascript", "skip"
+    };
+    return words.count(word) > 0;
+}
+
+// Running counts for one block's text
+struct BlockText {
+    size_t chars = 0;           // Non-space bytes
+    size_t link_chars = 0;
+    size_t words = 0;
+    size_t stopwords = 0;
+    size_t boilerplate_words = 0;
+    char last = 0;              // Last non-space byte
+    
+    void add(std::string_view text, bool in_link) {
+        char word[32];
+        size_t length = 0;
+        auto end_word = [&]() {
+            if (length == 0) return;
+            words++;
+            if (length <= sizeof(word)) {
+                std::string_view lowered(word, length);
+                if (is_stopword(lowered)) stopwords++;
+                else if (is_boilerplate_word(lowered)) boilerplate_words++;
+            }
+            length = 0;
+        };
+        
+        size_t added = 0;
+        for (char c : text) {
+            if (is_text_space(c)) {
+                end_word();
+                continue;
+            }
+            added++;
+            last = c;
+            unsigned char byte = static_cast<unsigned char>(c);
+            if (std::isalnum(byte) || byte >= 0x80) {
+                if (length < sizeof(word)) word[length] = static_cast<char>(std::tolower(byte));
+                length++;
+            } else {
+                end_word();
+            }
         }
+        end_word();
+        chars += added;
+        if (in_link) link_chars += added;
+    }
+};
+
+} // anonymous namespace
+
+double BoilerplateModel::probability(const BlockFeatures& block) const {
+    double score = bias;
+    for (size_t i = 0; i < BlockFeatures::COUNT; ++i) {
+        score += weights[i] * block.values[i];
+    }
+    return 1.0 / (1.0 + std::exp(-score));
+}
+
+const BoilerplateModel& BoilerplateModel::bundled() {
+    static const BoilerplateModel model = [] {
+        BoilerplateModel m;
+        m.bias = -1.0f;
+        m.weights[BlockFeatures::LOG_TEXT_LENGTH] = 0.9f;
+        m.weights[BlockFeatures::LINK_RATIO] = -5.0f;
+        m.weights[BlockFeatures::STOPWORD_DENSITY] = 6.0f;
+        m.weights[BlockFeatures::BOILERPLATE_WORDS] = -6.0f;
+        m.weights[BlockFeatures::ENDS_SENTENCE] = 0.8f;
+        m.weights[BlockFeatures::IN_NAV] = -4.0f;
+        m.weights[BlockFeatures::IN_HEADER_FOOTER] = -4.5f;
+        m.weights[BlockFeatures::IN_ASIDE] = -3.0f;
+        m.weights[BlockFeatures::IN_LIST] = -0.7f;
+        m.weights[BlockFeatures::IN_TABLE] = -0.3f;
+        m.weights[BlockFeatures::IN_FORM] = -2.0f;
+        m.weights[BlockFeatures::IN_ARTICLE] = 1.5f;
+        m.weights[BlockFeatures::IS_HEADING] = 1.0f;
+        m.weights[BlockFeatures::IS_PARAGRAPH] = 0.8f;
+        m.weights[BlockFeatures::BOILERPLATE_CLASSES] = -3.5f;
+        m.weights[BlockFeatures::AD_CLASSES] = -4.0f;
+        m.weights[BlockFeatures::CONTENT_CLASSES] = 1.5f;
+        return m;
+    }();
+    return model;
+}
+
+void BlockClassifier::compute_features(const FlatHtmlDocument& document, std::vector<BlockFeatures>& blocks) const {
+    std::vector<uint32_t> owners;
+    compute_features(document, blocks, owners);
+}
+
+void BlockClassifier::compute_features(const FlatHtmlDocument& document, std::vector<BlockFeatures>& blocks,
+                                       std::vector<uint32_t>& owners) const {
+    blocks.clear();
+    const uint32_t count = static_cast<uint32_t>(document.size());
+    owners.assign(count, 0);
+    if (count == 0) return;
+    
+    // Parents precede their children, so each node extends its parent's context
+    std::vector<BlockContext> contexts(count);
+    std::vector<uint32_t> block_of(count, FlatHtmlDocument::NO_NODE);
+    std::vector<BlockText> texts;
+    std::vector<uint32_t> block_nodes;
+    
+    for (uint32_t i = 1; i < count; ++i) {
+        const FlatHtmlNode& n = document.node(i);
+        const uint32_t parent = n.parent;
+        
+        if (n.is_text()) {
+            const uint32_t owner = owners[parent];
+            owners[i] = owner;
+            if (block_of[owner] == FlatHtmlDocument::NO_NODE) {
+                block_of[owner] = static_cast<uint32_t>(block_nodes.size());
+                block_nodes.push_back(owner);
+                texts.emplace_back();
+            }
+            texts[block_of[owner]].add(n.text, contexts[parent].path & PATH_LINK);
+            continue;
+        }
+        
+        // Script, style and the like hold no visible text
+        if (is_non_content_tag(n.tag)) {
+            i = n.end - 1;
+            continue;
+        }
+        
+        BlockContext context = contexts[parent];
+        context.path |= path_bits(n.tag, context.path);
+        count_class_tokens(document.attribute(i, "class"), context);
+        count_class_tokens(document.attribute(i, "id"), context);
+        contexts[i] = context;
+        owners[i] = is_block_tag(n.tag) ? i : owners[parent];
     }
     
-    // Handle numeric entities
-    std::regex numeric_entity(R"(&#(\d+);)");
-    std::smatch match;
+    blocks.resize(block_nodes.size());
+    for (size_t b = 0; b < block_nodes.size(); ++b) {
+        const uint32_t node = block_nodes[b];
+        const BlockText& text = texts[b];
+        const BlockContext& context = contexts[node];
+        const std::string_view tag = document.node(node).tag;
+        float* values = blocks[b].values;
+        
+        blocks[b].node = node;
+        values[BlockFeatures::LOG_TEXT_LENGTH] = static_cast<float>(std::log1p(double(text.chars)));
+        values[BlockFeatures::LINK_RATIO] = text.chars > 0 ? float(text.link_chars) / text.chars : 0.0f;
+        values[BlockFeatures::STOPWORD_DENSITY] = text.words > 0 ? float(text.stopwords) / text.words : 0.0f;
+        values[BlockFeatures::BOILERPLATE_WORDS] = text.words > 0 ? float(text.boilerplate_words) / text.words : 0.0f;
+        values[BlockFeatures::ENDS_SENTENCE] = text.last == '.' || text.last == '!' || text.last == '?';
+        values[BlockFeatures::IN_NAV] = (context.path & PATH_NAV) != 0;
+        values[BlockFeatures::IN_HEADER_FOOTER] = (context.path & PATH_HEADER_FOOTER) != 0;
+        values[BlockFeatures::IN_ASIDE] = (context.path & PATH_ASIDE) != 0;
+        values[BlockFeatures::IN_LIST] = (context.path & PATH_LIST) != 0;
+        values[BlockFeatures::IN_TABLE] = (context.path & PATH_TABLE) != 0;
+        values[BlockFeatures::IN_FORM] = (context.path & PATH_FORM) != 0;
+        values[BlockFeatures::IN_ARTICLE] = (context.path & PATH_ARTICLE) != 0;
+        values[BlockFeatures::IS_HEADING] = is_heading_tag(tag);
+        values[BlockFeatures::IS_PARAGRAPH] = tag == "p" || tag == "blockquote" || tag == "pre";
+        values[BlockFeatures::BOILERPLATE_CLASSES] = context.boilerplate_classes;
+        values[BlockFeatures::AD_CLASSES] = context.ad_classes;
+        values[BlockFeatures::CONTENT_CLASSES] = context.content_classes;
+    }
     
-    while (std::regex_search(result, match, numeric_entity)) {
-        int code = std::stoi(match[1].str());
-        if (code >= 32 && code <= 126) { // Printable ASCII
-            char ch = static_cast<char>(code);
-            result.replace(match.position(), match.length(), 1, ch);
-        } else {
-            result.replace(match.position(), match.length(), "");
+    // Blocks were found in the order their text starts
+    std::sort(blocks.begin(), blocks.end(),
+              [](const BlockFeatures& a, const BlockFeatures& b) { return a.node < b.node; });
+}
+
+std::vector<bool> BlockClassifier::boilerplate_mask(const FlatHtmlDocument& document) const {
+    const uint32_t count = static_cast<uint32_t>(document.size());
+    std::vector<bool> removed(count, false);
+    
+    std::vector<BlockFeatures> blocks;
+    std::vector<uint32_t> owners;
+    compute_features(document, blocks, owners);
+    
+    // +1 for a content block, -1 for a boilerplate one, 0 for nodes holding no text
+    std::vector<int8_t> verdicts(count, 0);
+    for (const auto& block : blocks) {
+        verdicts[block.node] = model_.probability(block) >= model_.threshold ? 1 : -1;
+    }
+    
+    // Backward pass: children follow their parents, so content propagates up
+    std::vector<bool> holds_content(count, false);
+    for (uint32_t i = count; i-- > 1;) {
+        if (verdicts[i] > 0) holds_content[i] = true;
+        if (holds_content[i]) holds_content[document.node(i).parent] = true;
+    }
+    
+    // Skip non-content subtrees, and whatever belongs to a boilerplate block
+    // short of the content nested in it
+    for (uint32_t i = 1; i < count; ++i) {
+        const FlatHtmlNode& n = document.node(i);
+        bool skip = !n.is_text() && is_non_content_tag(n.tag);
+        if (!skip && verdicts[owners[i]] < 0) {
+            skip = n.is_text() || !holds_content[i];
+        }
+        if (skip) {
+            removed[i] = true;
+            i = n.end - 1;
         }
     }
     
-    return result;
+    return removed;
+}
+
+// ==============================================================================
+// Text Cleaner Implementation  
+// ==============================================================================
+
+TextCleaner::TextCleaner(const TextExtractionConfig& config) : config_(config) {}
+
+std::string TextCleaner::decode_html_entities(const std::string& text) const {
+    return extraction_utils::decode_html_entities(text);
 }
 
 std::string TextCleaner::normalize_unicode(const std::string& text) const {
@@ -590,99 +1417,150 @@ std::string TextCleaner::normalize_unicode(const std::string& text) const {
 }
 
 std::string TextCleaner::normalize_whitespace(const std::string& text) const {
-    std::string result = text;
-    
-    // Replace tabs and multiple spaces with single space
-    result = std::regex_replace(result, std::regex(R"([\t ]+)"), " ");
-    
-    // Normalize line endings
-    result = std::regex_replace(result, std::regex(R"(\r\n|\r)"), "\n");
+    // Runs of tabs and spaces become one space; \r\n and lone \r become \n
+    std::string result;
+    result.reserve(text.size());
+    
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (c == ' ' || c == '\t') {
+            result += ' ';
+            while (i + 1 < text.size() && (text[i + 1] == ' ' || text[i + 1] == '\t')) ++i;
+        } else if (c == '\r') {
+            result += '\n';
+            if (i + 1 < text.size() && text[i + 1] == '\n') ++i;
+        } else {
+            result += c;
+        }
+    }
     
     return result;
 }
 
 std::string TextCleaner::fix_mojibake(const std::string& text) const {
-    std::string result = text;
-    
-    // Common mojibake patterns (simplified)
-    std::vector<std::pair<std::string, std::string>> mojibake_fixes = {
-        {"Ã¡", "á"}, {"Ã©", "é"}, {"Ã­", "í"}, {"Ã³", "ó"}, {"Ãº", "ú"},
-        {"Ã ", "à"}, {"Ã¨", "è"}, {"Ã¬", "ì"}, {"Ã²", "ò"}, {"Ã¹", "ù"},
-        {"Ã¢", "â"}, {"Ãª", "ê"}, {"Ã®", "î"}, {"Ã´", "ô"}, {"Ã»", "û"},
-        {"Ã£", "ã"}, {"Ã±", "ñ"}, {"Ã§", "ç"}
-    };
-    
-    for (const auto& [mojibake, correct] : mojibake_fixes) {
-        size_t pos = 0;
-        while ((pos = result.find(mojibake, pos)) != std::string::npos) {
-            result.replace(pos, mojibake.length(), correct);
-            pos += correct.length();
+    return extraction_utils::fix_mojibake(text);
+}
+
+std::string TextCleaner::remove_extra_newlines(const std::string& text) const {
+    // In every whitespace run holding three or more newlines, the span from
+    // its first newline to its last becomes a blank line; the whitespace
+    // around that span is kept
+    std::string result;
+    result.reserve(text.size());
+    
+    size_t i = 0;
+    while (i < text.size()) {
+        if (!is_text_space(text[i])) {
+            size_t end = i + 1;
+            while (end < text.size() && !is_text_space(text[end])) ++end;
+            result.append(text, i, end - i);
+            i = end;
+            continue;
+        }
+        
+        size_t end = i;
+        size_t newlines = 0;
+        size_t first_newline = 0;
+        size_t last_newline = 0;
+        for (; end < text.size() && is_text_space(text[end]); ++end) {
+            if (text[end] != '\n') continue;
+            if (newlines++ == 0) first_newline = end;
+            last_newline = end;
+        }
+        
+        if (newlines >= 3) {
+            result.append(text, i, first_newline - i);
+            result += "\n\n";
+            result.append(text, last_newline + 1, end - last_newline - 1);
+        } else {
+            result.append(text, i, end - i);
         }
+        i = end;
     }
     
+    // Remove leading and trailing newlines
+    size_t leading = result.find_first_not_of('\n');
+    if (leading == std::string::npos) return "";
+    result.erase(result.find_last_not_of('\n') + 1);
+    result.erase(0, leading);
+    
     return result;
 }
 
-std::string TextCleaner::remove_extra_newlines(const std::string& text) const {
-    std::string result = text;
-    
-    // Replace multiple consecutive newlines with double newline
-    result = std::regex_replace(result, std::regex(R"(\n\s*\n\s*\n+)"), "\n\n");
+std::string TextCleaner::collapse_and_strip_tags(const std::string& text) const {
+    std::string result;
+    result.reserve(text.size());
+    
+    size_t next_close = text.find('>');
+    bool pending_space = false;
+    bool at_start = true;
+    size_t i = 0;
+    
+    while (i < text.size()) {
+        char c = text[i];
+        if (is_text_space(c)) {
+            pending_space = true;
+            ++i;
+            continue;
+        }
+        
+        // A whitespace run is one space, except before the first visible
+        // character, where it is dropped. Spaces on either side of a removed
+        // tag are not merged
+        if (pending_space) {
+            if (!at_start && !(result.empty() && config_.trim_lines)) result += ' ';
+            pending_space = false;
+        }
+        at_start = false;
+        
+        if (c == '<') {
+            if (next_close != std::string::npos && next_close < i) next_close = text.find('>', i);
+            if (next_close != std::string::npos) {
+                // Tag: everything through the next '>'
+                i = next_close + 1;
+                continue;
+            }
+        }
+        
+        size_t end = i + 1;
+        while (end < text.size() && text[end] != '<' && !is_text_space(text[end])) ++end;
+        result.append(text, i, end - i);
+        i = end;
+    }
     
-    // Remove leading and trailing newlines
-    result = std::regex_replace(result, std::regex(R"(^\n+|\n+$)"), "");
+    // Trailing whitespace is dropped; with trim_lines, so are spaces left in
+    // front of a removed trailing tag
+    if (config_.trim_lines) {
+        while (!result.empty() && result.back() == ' ') result.pop_back();
+    }
     
     return result;
 }
 
 std::string TextCleaner::clean_text(const std::string& text) const {
-    std::string result = text;
+    // Byte-sequence rewrites first; the whitespace, tag and newline steps
+    // then run as the single scan of collapse_and_strip_tags. Every newline
+    // collapses to a space there, so normalize_whitespace and
+    // remove_extra_newlines would not change its output
+    const std::string* source = &text;
+    std::string staged;
     
     if (config_.decode_html_entities) {
-        result = decode_html_entities(result);
+        staged = decode_html_entities(*source);
+        source = &staged;
     }
     
     if (config_.normalize_unicode) {
-        result = normalize_unicode(result);
+        staged = normalize_unicode(*source);
+        source = &staged;
     }
     
     if (config_.fix_mojibake) {
-        result = fix_mojibake(result);
-    }
-    
-    if (config_.normalize_whitespace) {
-        result = normalize_whitespace(result);
-    }
-    
-    // Apply cleaning patterns
-    for (const auto& [pattern, replacement] : cleaning_patterns_) {
-        result = std::regex_replace(result, pattern, replacement);
-    }
-    
-    if (config_.remove_extra_newlines) {
-        result = remove_extra_newlines(result);
-    }
-    
-    if (config_.trim_lines) {
-        std::istringstream iss(result);
-        std::ostringstream oss;
-        std::string line;
-        bool first = true;
-        
-        while (std::getline(iss, line)) {
-            if (!first) oss << "\n";
-            first = false;
-            
-            // Trim line
-            line.erase(0, line.find_first_not_of(" \t"));
-            line.erase(line.find_last_not_of(" \t") + 1);
-            oss << line;
-        }
-        
-        result = oss.str();
+        staged = fix_mojibake(*source);
+        source = &staged;
     }
     
-    return result;
+    return collapse_and_strip_tags(*source);
 }
 
 // ==============================================================================
@@ -690,22 +1568,22 @@ std::string TextCleaner::clean_text(const std::string& text) const {
 // ==============================================================================
 
 TextExtractor::TextExtractor(const TextExtractionConfig& config) : config_(config) {
-    parser_ = std::make_unique<HtmlParser>("");
     boilerplate_remover_ = std::make_unique<BoilerplateRemover>(config);
+    block_classifier_ = std::make_unique<BlockClassifier>();
     text_cleaner_ = std::make_unique<TextCleaner>(config);
 }
 
 TextExtractor::TextExtractor(TextExtractor&& other) noexcept
     : config_(std::move(other.config_)),
-      parser_(std::move(other.parser_)),
       boilerplate_remover_(std::move(other.boilerplate_remover_)),
+      block_classifier_(std::move(other.block_classifier_)),
       text_cleaner_(std::move(other.text_cleaner_)) {}
 
 TextExtractor& TextExtractor::operator=(TextExtractor&& other) noexcept {
     if (this != &other) {
         config_ = std::move(other.config_);
-        parser_ = std::move(other.parser_);
         boilerplate_remover_ = std::move(other.boilerplate_remover_);
+        block_classifier_ = std::move(other.block_classifier_);
         text_cleaner_ = std::move(other.text_cleaner_);
     }
     return *this;
@@ -800,6 +1678,85 @@ std::vector<std::string> TextExtractor::extract_links(const std::shared_ptr<Html
     return links;
 }
 
+std::string TextExtractor::extract_text_from_node(const FlatHtmlDocument& document, uint32_t node,
+                                                  const std::vector<bool>& removed) const {
+    std::string text;
+    std::vector<uint32_t> pending_breaks;   // Open paragraphs and headings, innermost last
+    
+    const uint32_t end = document.node(node).end;
+    uint32_t i = node;
+    while (i < end) {
+        while (!pending_breaks.empty() && document.node(pending_breaks.back()).end <= i) {
+            text += '\n';
+            pending_breaks.pop_back();
+        }
+        
+        const FlatHtmlNode& n = document.node(i);
+        if (removed[i]) {
+            i = n.end;
+            continue;
+        }
+        
+        if (n.is_text()) {
+            text.append(n.text);
+        } else {
+            // Add paragraph breaks for block elements
+            bool heading = is_heading_tag(n.tag);
+            if (n.tag == "p" || n.tag == "div" || n.tag == "br" || heading) {
+                text += '\n';
+            }
+            
+            // Extra break after paragraphs and headings
+            if (n.tag == "p" || heading) {
+                pending_breaks.push_back(i);
+            }
+        }
+        ++i;
+    }
+    text.append(pending_breaks.size(), '\n');
+    
+    return text;
+}
+
+std::vector<std::string> TextExtractor::extract_headings(const FlatHtmlDocument& document, uint32_t node,
+                                                         const std::vector<bool>& removed) const {
+    std::vector<std::string> headings;
+    
+    for (uint32_t i = node; i < document.node(node).end; ++i) {
+        const FlatHtmlNode& n = document.node(i);
+        if (removed[i]) {
+            i = n.end - 1;
+        } else if (is_heading_tag(n.tag)) {
+            std::string heading = document.text_content(i);
+            if (!heading.empty()) {
+                headings.push_back(std::move(heading));
+            }
+            i = n.end - 1;
+        }
+    }
+    
+    return headings;
+}
+
+std::vector<std::string> TextExtractor::extract_links(const FlatHtmlDocument& document, uint32_t node,
+                                                      const std::vector<bool>& removed) const {
+    std::vector<std::string> links;
+    
+    for (uint32_t i = node; i < document.node(node).end; ++i) {
+        const FlatHtmlNode& n = document.node(i);
+        if (removed[i]) {
+            i = n.end - 1;
+        } else if (n.tag == "a") {
+            std::string_view href = document.attribute(i, "href");
+            if (!href.empty()) {
+                links.emplace_back(href);
+            }
+        }
+    }
+    
+    return links;
+}
+
 void TextExtractor::calculate_quality_metrics(TextExtractionResult& result) const {
     result.text_ratio = result.original_html_length > 0 ? 
         double(result.extracted_text_length) / result.original_html_length : 0.0;
@@ -814,23 +1771,80 @@ void TextExtractor::calculate_quality_metrics(TextExtractionResult& result) cons
     }
 }
 
+TextExtractionResult TextExtractor::from_text(const std::string& text, const std::string& url) const {
+    TextExtractionResult result;
+    result.url = url;
+    result.extracted_text = text;
+    result.original_html_length = text.length();
+    result.extracted_text_length = text.length();
+    calculate_quality_metrics(result);
+    return result;
+}
+
 TextExtractionResult TextExtractor::extract(const std::string& html, const std::string& url) const {
+    if (config_.streaming_extraction) {
+        return extract_streaming(html, url);
+    }
+    
     TextExtractionResult result;
     result.url = url;
     result.original_html_length = html.length();
     
+    // Legacy charsets are decoded up front; valid UTF-8 is read in place
+    std::string transcoded;
+    const std::string& source = config_.auto_detect_encoding &&
+        extraction_utils::transcode_to_utf8(html, transcoded, config_.default_encoding) ? transcoded : html;
+    
+    if (config_.use_flat_dom) {
+        // The arena is reused by every document this thread extracts
+        thread_local FlatHtmlDocument document;
+        HtmlParser::parse_flat(source, document, config_.max_dom_depth);
+        apply_metadata(document.metadata(), result);
+        
+        uint32_t root = document.root();
+        std::vector<bool> removed(document.size(), false);
+        
+        // Remove boilerplate
+        if (config_.extract_main_content && config_.classify_blocks) {
+            removed = block_classifier_->boilerplate_mask(document);
+        } else if (config_.extract_main_content) {
+            removed = boilerplate_remover_->boilerplate_mask(document);
+            auto content_nodes = boilerplate_remover_->find_main_content(document, removed);
+            
+            if (!content_nodes.empty()) {
+                // Use the highest-scoring content element
+                root = content_nodes[0];
+            }
+        }
+        
+        std::string raw_text = extract_text_from_node(document, root, removed);
+        result.extracted_text = text_cleaner_->clean_text(raw_text);
+        result.extracted_text_length = result.extracted_text.length();
+        
+        if (config_.preserve_headings) {
+            result.headings = extract_headings(document, root, removed);
+        }
+        
+        std::vector<std::string> links = extract_links(document, root, removed);
+        result.link_count = links.size();
+        if (config_.preserve_links) {
+            result.links = std::move(links);
+        }
+        
+        document.clear();
+        calculate_quality_metrics(result);
+        return result;
+    }
+    
     // Parse HTML
-    HtmlParser parser(html);
+    HtmlParser parser(source, config_.max_dom_depth);
     auto root = parser.parse();
+    apply_metadata(parser.metadata(), result);
     
     if (!root) {
         return result; // Failed to parse
     }
     
-    // Extract metadata
-    result.title = text_cleaner_->clean_text(HtmlParser::extract_title(html));
-    result.language = HtmlParser::extract_meta_content(html, "language");
-    
     // Remove boilerplate
     if (config_.extract_main_content) {
         root = boilerplate_remover_->remove_boilerplate(root);
@@ -864,6 +1878,183 @@ TextExtractionResult TextExtractor::extract(const std::string& html, const std::
     return result;
 }
 
+void TextExtractor::apply_metadata(const HtmlMetadata& metadata, TextExtractionResult& result) const {
+    result.title = text_cleaner_->clean_text(metadata.title);
+    result.language = metadata.language;
+    result.encoding = metadata.charset;
+    result.metadata = metadata.meta;
+}
+
+std::string TextExtractor::clean_block(const std::string& block) const {
+    std::string text = block;
+    
+    if (config_.decode_html_entities && text.find('&') != std::string::npos) {
+        text = text_cleaner_->decode_html_entities(text);
+    }
+    
+    // The Unicode fixes only rewrite non-ASCII sequences
+    bool ascii = std::all_of(text.begin(), text.end(), [](char c) { return (c & 0x80) == 0; });
+    if (!ascii && config_.normalize_unicode) {
+        text = text_cleaner_->normalize_unicode(text);
+    }
+    if (!ascii && config_.fix_mojibake) {
+        text = text_cleaner_->fix_mojibake(text);
+    }
+    
+    return text;
+}
+
+TextExtractionResult TextExtractor::extract_streaming(const std::string& html, const std::string& url) const {
+    TextExtractionResult result;
+    result.url = url;
+    result.original_html_length = html.length();
+    
+    // Legacy charsets are decoded up front; valid UTF-8 is read in place
+    std::string transcoded;
+    const std::string& source = config_.auto_detect_encoding &&
+        extraction_utils::transcode_to_utf8(html, transcoded, config_.default_encoding) ? transcoded : html;
+    
+    HtmlTokenizer tokenizer(source);
+    HtmlToken token;
+    HtmlMetadata metadata;
+    
+    std::vector<std::string> open_tags;     // Innermost last
+    size_t skip_depth = 0;                   // Depth of the skipped subtree's root; 0 when not skipping
+    size_t link_depth = 0;                   // Open <a> elements
+    DroppedElements dropped;
+    
+    // Text of the current block, whitespace collapsed, with its counters
+    std::string block;
+    size_t block_chars = 0;
+    size_t link_chars = 0;
+    bool pending_space = false;
+    bool heading = false;
+    std::vector<std::string_view> block_links;
+    std::string output;
+    
+    auto flush_block = [&]() {
+        if (block_chars > 0 &&
+            (!config_.extract_main_content || double(link_chars) / block_chars <= config_.max_block_link_ratio)) {
+            std::string text = clean_block(block);
+            if (heading && config_.preserve_headings) {
+                result.headings.push_back(text);
+            }
+            output += text;
+            output += '\n';
+            result.link_count += block_links.size();
+            if (config_.preserve_links) {
+                result.links.insert(result.links.end(), block_links.begin(), block_links.end());
+            }
+        }
+        block.clear();
+        block_chars = 0;
+        link_chars = 0;
+        pending_space = false;
+        block_links.clear();
+    };
+    
+    auto pop = [&]() {
+        const std::string& tag = open_tags.back();
+        if (skip_depth == open_tags.size()) {
+            skip_depth = 0;
+        } else if (skip_depth == 0 && is_block_tag(tag)) {
+            flush_block();
+            if (is_heading_tag(tag)) heading = false;
+        }
+        if (tag == "a") link_depth--;
+        open_tags.pop_back();
+        dropped.clear();
+    };
+    
+    while (tokenizer.next(token)) {
+        metadata.observe(token);
+        
+        switch (token.type) {
+            case HtmlToken::Type::TEXT: {
+                if (skip_depth != 0) break;
+                for (char c : token.text) {
+                    if (is_html_space(c)) {
+                        pending_space = !block.empty();
+                        continue;
+                    }
+                    if (pending_space) {
+                        block += ' ';
+                        pending_space = false;
+                    }
+                    block += c;
+                    block_chars++;
+                    if (link_depth > 0) link_chars++;
+                }
+                break;
+            }
+            
+            case HtmlToken::Type::END_TAG: {
+                // Closes the innermost open element of that name, if any
+                if (dropped.close(token.name)) break;
+                for (size_t depth = open_tags.size(); depth-- > 0;) {
+                    if (open_tags[depth] == token.name) {
+                        while (open_tags.size() > depth) pop();
+                        break;
+                    }
+                }
+                break;
+            }
+            
+            case HtmlToken::Type::START_TAG: {
+                // Implied end tags
+                if (skip_depth != 0 && open_tags[skip_depth - 1] == "head" && !belongs_in_head(token.name)) {
+                    const size_t head_depth = skip_depth;
+                    while (open_tags.size() >= head_depth) pop();
+                }
+                size_t closed = dropped.close_implied(token.name, open_tags.size(),
+                                                      [&](size_t depth) -> std::string_view { return open_tags[depth]; });
+                while (closed-- > 0) pop();
+                
+                // Past the depth cap, start tags open nothing
+                bool opens = !token.self_closing && !is_void_tag(token.name);
+                if (opens && open_tags.size() >= config_.max_dom_depth) {
+                    dropped.open(token.name);
+                    opens = false;
+                }
+                bool skip = false;
+                if (skip_depth == 0) {
+                    skip = is_non_content_tag(token.name) ||
+                           (config_.extract_main_content && boilerplate_remover_->is_boilerplate_element(token));
+                }
+                
+                if (skip_depth == 0 && !skip) {
+                    if (is_block_tag(token.name)) {
+                        flush_block();
+                        if (is_heading_tag(token.name)) heading = true;
+                    }
+                    if (token.name == "a") {
+                        std::string_view href = token.attribute("href");
+                        if (!href.empty()) block_links.push_back(href);
+                    }
+                }
+                
+                if (opens) {
+                    open_tags.emplace_back(token.name);
+                    if (token.name == "a") link_depth++;
+                    if (skip) skip_depth = open_tags.size();
+                }
+                break;
+            }
+        }
+    }
+    
+    while (!open_tags.empty()) pop();
+    flush_block();
+    
+    if (!output.empty()) output.pop_back();
+    result.extracted_text = std::move(output);
+    result.extracted_text_length = result.extracted_text.length();
+    
+    apply_metadata(metadata, result);
+    calculate_quality_metrics(result);
+    return result;
+}
+
 std::vector<TextExtractionResult> TextExtractor::extract_batch(
     const std::vector<std::string>& html_documents,
     const std::vector<std::string>& urls
@@ -876,16 +2067,47 @@ std::vector<TextExtractionResult> TextExtractor::extract_batch(
     std::function<void(size_t, size_t, const std::string&)> progress_callback,
     const std::vector<std::string>& urls
 ) const {
-    std::vector<TextExtractionResult> results;
-    results.reserve(html_documents.size());
-    
-    for (size_t i = 0; i < html_documents.size(); ++i) {
-        if (progress_callback) {
-            progress_callback(i + 1, html_documents.size(), "Extracting text");
+    const size_t count = html_documents.size();
+    std::vector<TextExtractionResult> results(count);
+    
+    // Largest documents first: with dynamic scheduling, idle threads take the
+    // next document, so a few huge pages start early instead of finishing last
+    std::vector<size_t> order(count);
+    for (size_t i = 0; i < count; ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return html_documents[a].size() > html_documents[b].size();
+    });
+    
+    // extract() only reads the shared config, patterns and cleaner; parse
+    // arenas are per thread
+    size_t completed = 0;
+    std::exception_ptr error;
+    
+#ifdef USE_OPENMP
+    #pragma omp parallel for schedule(dynamic, 1) if(config_.enable_parallel_processing && count > 1)
+#endif
+    for (size_t k = 0; k < count; ++k) {
+        size_t i = order[k];
+        try {
+            results[i] = extract(html_documents[i], i < urls.size() ? urls[i] : "");
+        } catch (...) {
+            // Exceptions must not escape the parallel region; the first is rethrown
+#ifdef USE_OPENMP
+            #pragma omp critical(text_extraction_errors)
+#endif
+            if (!error) error = std::current_exception();
         }
         
-        std::string url = (i < urls.size()) ? urls[i] : "";
-        results.push_back(extract(html_documents[i], url));
+        if (progress_callback) {
+#ifdef USE_OPENMP
+            #pragma omp critical(text_extraction_progress)
+#endif
+            progress_callback(++completed, count, "Extracting text");
+        }
+    }
+    
+    if (error) {
+        std::rethrow_exception(error);
     }
     
     return results;
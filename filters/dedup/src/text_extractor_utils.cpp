@@ -45,61 +45,6 @@ ContentType detect_content_type(const std::string& content) {
     return ContentType::PLAIN_TEXT;
 }
 
-std::string detect_encoding(const std::string& content) {
-    // Look for BOM (Byte Order Mark)
-    if (content.length() >= 3) {
-        if (content.substr(0, 3) == "\xEF\xBB\xBF") {
-            return "utf-8";
-        }
-    }
-    
-    if (content.length() >= 2) {
-        if (content.substr(0, 2) == "\xFF\xFE") {
-            return "utf-16le";
-        }
-        if (content.substr(0, 2) == "\xFE\xFF") {
-            return "utf-16be";
-        }
-    }
-    
-    // Look for charset declaration in HTML/XML
-    std::regex charset_regex(R"(charset\s*=\s*["\']?([^"\'>\s]+))", std::regex_constants::icase);
-    std::smatch match;
-    
-    if (std::regex_search(content, match, charset_regex)) {
-        std::string encoding = match[1].str();
-        std::transform(encoding.begin(), encoding.end(), encoding.begin(), ::tolower);
-        return encoding;
-    }
-    
-    // Simple heuristic: check for high-bit characters
-    size_t high_bit_chars = 0;
-    for (char c : content) {
-        if (static_cast<unsigned char>(c) > 127) {
-            high_bit_chars++;
-        }
-    }
-    
-    if (high_bit_chars == 0) {
-        return "ascii";
-    }
-    
-    // Default to UTF-8 for modern content
-    return "utf-8";
-}
-
-std::string convert_encoding(const std::string& content, const std::string& from, const std::string& to) {
-    // Simplified encoding conversion - in a full implementation,
-    // you'd use ICU or iconv
-    if (from == to) {
-        return content;
-    }
-    
-    // For now, just return the original content
-    // In production, implement proper encoding conversion
-    return content;
-}
-
 std::string extract_domain(const std::string& url) {
     std::regex url_regex(R"(^https?://([^/]+))");
     std::smatch match;
@@ -302,12 +247,18 @@ double calculate_readability_score(const std::string& text) {
 }
 
 std::string detect_language_from_html(const std::string& html) {
-    // Look for lang attribute in html tag
-    std::regex html_lang(R"(<html[^>]+lang\s*=\s*["\']([^"\']+)["\'])", std::regex_constants::icase);
-    std::smatch match;
+    // lang attribute of the <html> tag. Head elements may come before it, but
+    // once body content starts the document has no <html> tag of its own
+    static const std::unordered_set<std::string> head_tags = {
+        "head", "title", "meta", "link", "style", "script", "base", "noscript", "template"
+    };
+    HtmlTokenizer tokenizer(html);
+    HtmlToken token;
     
-    if (std::regex_search(html, match, html_lang)) {
-        return match[1].str();
+    while (tokenizer.next(token)) {
+        if (token.type != HtmlToken::Type::START_TAG) continue;
+        if (token.name == "html") return std::string(token.attribute("lang"));
+        if (head_tags.count(std::string(token.name)) == 0) break;
     }
     
     return "";
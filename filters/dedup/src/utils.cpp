@@ -7,6 +7,16 @@
 #include <iostream>
 #include <iomanip>
 #include <filesystem>
+#include <cstring>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RAPIDSIFT_HAVE_MMAP 1
+#endif
 
 namespace rapidsift {
 
@@ -76,6 +86,97 @@ std::string to_lowercase(const std::string& text) {
 
 } // namespace text_utils
 
+// Hash utility implementations (non-cryptographic, dependency free)
+namespace hash_utils {
+
+namespace {
+
+inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+inline uint64_t load64(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+} // anonymous namespace
+
+Hash128 hash128(const char* data, size_t length, uint64_t seed) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    const size_t nblocks = length / 16;
+    
+    uint64_t h1 = seed;
+    uint64_t h2 = seed;
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    
+    for (size_t i = 0; i < nblocks; ++i) {
+        uint64_t k1 = load64(bytes + i * 16);
+        uint64_t k2 = load64(bytes + i * 16 + 8);
+        
+        k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+        
+        k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+    
+    const unsigned char* tail = bytes + nblocks * 16;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    
+    switch (length & 15) {
+        case 15: k2 ^= uint64_t(tail[14]) << 48; [[fallthrough]];
+        case 14: k2 ^= uint64_t(tail[13]) << 40; [[fallthrough]];
+        case 13: k2 ^= uint64_t(tail[12]) << 32; [[fallthrough]];
+        case 12: k2 ^= uint64_t(tail[11]) << 24; [[fallthrough]];
+        case 11: k2 ^= uint64_t(tail[10]) << 16; [[fallthrough]];
+        case 10: k2 ^= uint64_t(tail[9]) << 8; [[fallthrough]];
+        case 9:  k2 ^= uint64_t(tail[8]);
+                 k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+                 [[fallthrough]];
+        case 8:  k1 ^= uint64_t(tail[7]) << 56; [[fallthrough]];
+        case 7:  k1 ^= uint64_t(tail[6]) << 48; [[fallthrough]];
+        case 6:  k1 ^= uint64_t(tail[5]) << 40; [[fallthrough]];
+        case 5:  k1 ^= uint64_t(tail[4]) << 32; [[fallthrough]];
+        case 4:  k1 ^= uint64_t(tail[3]) << 24; [[fallthrough]];
+        case 3:  k1 ^= uint64_t(tail[2]) << 16; [[fallthrough]];
+        case 2:  k1 ^= uint64_t(tail[1]) << 8; [[fallthrough]];
+        case 1:  k1 ^= uint64_t(tail[0]);
+                 k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+                 break;
+        default: break;
+    }
+    
+    h1 ^= length;
+    h2 ^= length;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+    h1 += h2;
+    h2 += h1;
+    
+    return Hash128{h1, h2};
+}
+
+Hash128 hash128(const std::string& text, uint64_t seed) {
+    return hash128(text.data(), text.size(), seed);
+}
+
+} // namespace hash_utils
+
 // I/O utility implementations
 namespace io_utils {
 
@@ -221,6 +322,59 @@ void save_results_to_csv(const DeduplicationResult& result, const std::string& f
     }
 }
 
+MappedFile::MappedFile(const std::string& filename) {
+#ifdef RAPIDSIFT_HAVE_MMAP
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open file: " + filename);
+    }
+    
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Could not stat file: " + filename);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    
+    if (size_ > 0) {
+        void* addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            data_ = static_cast<const char*>(addr);
+            mapped_ = true;
+        }
+    }
+    ::close(fd);
+    
+    if (mapped_ || size_ == 0) return;
+#endif
+    
+    // Fallback: read the whole file into an aligned buffer
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file: " + filename);
+    }
+    size_ = static_cast<size_t>(file.tellg());
+    file.seekg(0);
+    
+    char* buffer = static_cast<char*>(::operator new(std::max<size_t>(size_, 1), std::align_val_t(64)));
+    if (!file.read(buffer, static_cast<std::streamsize>(size_))) {
+        ::operator delete(buffer, std::align_val_t(64));
+        throw std::runtime_error("Could not read file: " + filename);
+    }
+    data_ = buffer;
+}
+
+MappedFile::~MappedFile() {
+    if (!data_) return;
+#ifdef RAPIDSIFT_HAVE_MMAP
+    if (mapped_) {
+        ::munmap(const_cast<char*>(data_), size_);
+        return;
+    }
+#endif
+    ::operator delete(const_cast<char*>(data_), std::align_val_t(64));
+}
+
 } // namespace io_utils
 
 // Statistics utility implementations
@@ -0,0 +1,420 @@
+#include "rapidsift/warc_reader.hpp"
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace rapidsift {
+
+namespace {
+
+bool equals_ignore_case(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool starts_with_ignore_case(std::string_view text, std::string_view prefix) {
+    return text.size() >= prefix.size() && equals_ignore_case(text.substr(0, prefix.size()), prefix);
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) text.remove_suffix(1);
+    return text;
+}
+
+// Length of a header block up to and including its blank line (CRLF CRLF,
+// or bare LFs); npos when the blank line is not in text
+size_t header_block_length(std::string_view text) {
+    size_t pos = 0;
+    while ((pos = text.find('\n', pos)) != std::string_view::npos) {
+        if (pos + 1 < text.size() && text[pos + 1] == '\n') return pos + 2;
+        if (pos + 2 < text.size() && text[pos + 1] == '\r' && text[pos + 2] == '\n') return pos + 3;
+        pos++;
+    }
+    return std::string_view::npos;
+}
+
+// Calls visit(name, value) for each "Name: value" line after the first line
+template <typename Visit>
+void for_each_header_field(std::string_view headers, Visit visit) {
+    size_t line_start = headers.find('\n');
+    while (line_start != std::string_view::npos && ++line_start < headers.size()) {
+        size_t line_end = headers.find('\n', line_start);
+        std::string_view line = headers.substr(line_start, line_end == std::string_view::npos
+                                                               ? std::string_view::npos : line_end - line_start);
+        size_t colon = line.find(':');
+        if (colon != std::string_view::npos) {
+            visit(trim(line.substr(0, colon)), trim(line.substr(colon + 1)));
+        }
+        line_start = line_end;
+    }
+}
+
+bool parse_length(std::string_view text, uint64_t& value) {
+    if (text.empty() || text.size() > 18) return false;
+    value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + static_cast<uint64_t>(c - '0');
+    }
+    return true;
+}
+
+// Fixed-capacity queue between one producer and one consumer. close() wakes
+// both sides: pop drains what is left, push refuses new items
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(std::max<size_t>(1, capacity)) {}
+
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [&] { return closed_ || items_.size() < capacity_; });
+        if (closed_) return false;
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [&] { return closed_ || !items_.empty(); });
+        if (items_.empty()) return false;
+        item = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+private:
+    size_t capacity_;
+    std::deque<T> items_;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+    bool closed_ = false;
+};
+
+} // anonymous namespace
+
+bool WarcRecord::is_html() const {
+    if (!is_response()) return false;
+    return starts_with_ignore_case(http_content_type, "text/html") ||
+           starts_with_ignore_case(http_content_type, "application/xhtml+xml");
+}
+
+#ifdef HAVE_ZLIB
+struct WarcReader::Inflater {
+    z_stream stream = {};
+    bool in_member = false;     // Inside a gzip member that has not ended yet
+
+    Inflater() {
+        // 16 + MAX_WBITS: gzip framing
+        if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+            throw std::runtime_error("Could not initialize gzip decompression");
+        }
+    }
+    ~Inflater() { inflateEnd(&stream); }
+};
+#else
+struct WarcReader::Inflater {};
+#endif
+
+WarcReader::WarcReader(std::istream& input, size_t max_record_bytes)
+    : input_(input), max_record_bytes_(max_record_bytes), buffer_(BUFFER_SIZE) {
+    // Gzip members start with 1F 8B
+    int first = input_.peek();
+    if (first == 0x1F) {
+        input_.get();
+        compressed_ = input_.peek() == 0x8B;
+        input_.unget();
+    }
+
+    if (compressed_) {
+#ifdef HAVE_ZLIB
+        inflater_ = std::make_unique<Inflater>();
+        input_buffer_.resize(BUFFER_SIZE);
+#else
+        throw std::runtime_error("Gzip-compressed WARC input needs zlib support");
+#endif
+    }
+}
+
+WarcReader::~WarcReader() = default;
+
+uint64_t WarcReader::bytes_read() const {
+#ifdef HAVE_ZLIB
+    if (compressed_) return input_consumed_ - inflater_->stream.avail_in;
+#endif
+    return input_consumed_;
+}
+
+size_t WarcReader::read_decompressed(char* out, size_t capacity) {
+    if (!compressed_) {
+        input_.read(out, static_cast<std::streamsize>(capacity));
+        size_t count = static_cast<size_t>(input_.gcount());
+        input_consumed_ += count;
+        return count;
+    }
+
+#ifdef HAVE_ZLIB
+    z_stream& stream = inflater_->stream;
+    stream.next_out = reinterpret_cast<Bytef*>(out);
+    const uInt available = static_cast<uInt>(std::min<size_t>(capacity, UINT32_MAX));
+    stream.avail_out = available;
+
+    while (stream.avail_out == available) {
+        if (stream.avail_in == 0) {
+            input_.read(input_buffer_.data(), static_cast<std::streamsize>(input_buffer_.size()));
+            size_t count = static_cast<size_t>(input_.gcount());
+            if (count == 0) {
+                if (inflater_->in_member) fail("gzip member truncated");
+                break;
+            }
+            input_consumed_ += count;
+            stream.next_in = reinterpret_cast<Bytef*>(input_buffer_.data());
+            stream.avail_in = static_cast<uInt>(count);
+        }
+
+        inflater_->in_member = true;
+        int status = inflate(&stream, Z_NO_FLUSH);
+        if (status == Z_STREAM_END) {
+            // Member done; the next one, if any, starts a new gzip stream
+            inflateReset(&stream);
+            inflater_->in_member = false;
+        } else if (status != Z_OK && status != Z_BUF_ERROR) {
+            fail(std::string("gzip data error: ") + (stream.msg ? stream.msg : "corrupt stream"));
+        }
+    }
+    return available - stream.avail_out;
+#else
+    return 0;
+#endif
+}
+
+bool WarcReader::fill(size_t needed) {
+    while (end_ - begin_ < needed) {
+        if (buffer_.size() - begin_ < needed) {
+            // Move the unparsed tail to the front, growing only for records
+            // larger than the buffer
+            std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+            end_ -= begin_;
+            begin_ = 0;
+            if (buffer_.size() < needed) buffer_.resize(std::max(needed, buffer_.size() * 2));
+        }
+
+        size_t count = read_decompressed(buffer_.data() + end_, buffer_.size() - end_);
+        if (count == 0) return false;
+        end_ += count;
+    }
+    return true;
+}
+
+void WarcReader::consume(size_t bytes) {
+    begin_ += bytes;
+    offset_ += bytes;
+}
+
+void WarcReader::discard(uint64_t bytes) {
+    while (bytes > 0) {
+        if (begin_ == end_) {
+            begin_ = end_ = 0;
+            if (!fill(1)) fail("record truncated");
+        }
+        size_t step = static_cast<size_t>(std::min<uint64_t>(bytes, end_ - begin_));
+        consume(step);
+        bytes -= step;
+    }
+}
+
+bool WarcReader::next(WarcRecord& record) {
+    consume(pending_);
+    pending_ = 0;
+
+    while (true) {
+        // Records are separated by blank lines
+        while (true) {
+            if (begin_ == end_ && !fill(1)) return false;
+            if (buffer_[begin_] != '\r' && buffer_[begin_] != '\n') break;
+            consume(1);
+        }
+
+        size_t header_length;
+        while ((header_length = header_block_length(std::string_view(buffer_.data() + begin_, end_ - begin_))) ==
+               std::string_view::npos) {
+            if (end_ - begin_ >= MAX_HEADER_BYTES) {
+                fail("record header longer than " + std::to_string(MAX_HEADER_BYTES) + " bytes");
+            }
+            if (!fill(end_ - begin_ + 1)) fail("record header truncated");
+        }
+
+        std::string_view headers(buffer_.data() + begin_, header_length);
+        if (headers.compare(0, 5, "WARC/") != 0) fail("expected a WARC version line");
+
+        uint64_t content_length = 0;
+        bool has_length = false;
+        for_each_header_field(headers, [&](std::string_view name, std::string_view value) {
+            if (equals_ignore_case(name, "Content-Length")) {
+                has_length = parse_length(value, content_length);
+            }
+        });
+        if (!has_length) fail("missing or invalid Content-Length");
+
+        records_read_++;
+        if (content_length > max_record_bytes_) {
+            records_skipped_++;
+            consume(header_length);
+            discard(content_length);
+            continue;
+        }
+
+        const size_t record_length = header_length + static_cast<size_t>(content_length);
+        if (!fill(record_length)) fail("record truncated");
+
+        // The buffer may have moved while filling; take views only now
+        headers = std::string_view(buffer_.data() + begin_, header_length);
+        record = WarcRecord{};
+        record.content_length = content_length;
+        record.block = std::string_view(buffer_.data() + begin_ + header_length, static_cast<size_t>(content_length));
+        for_each_header_field(headers, [&](std::string_view name, std::string_view value) {
+            if (equals_ignore_case(name, "WARC-Type")) record.type = value;
+            else if (equals_ignore_case(name, "WARC-Target-URI")) record.target_uri = value;
+            else if (equals_ignore_case(name, "WARC-Record-ID")) record.record_id = value;
+            else if (equals_ignore_case(name, "Content-Type")) record.content_type = value;
+        });
+
+        record.payload = record.block;
+        if (record.is_response() && starts_with_ignore_case(record.content_type, "application/http")) {
+            std::string_view http = record.block.substr(0, std::min(record.block.size(), MAX_HEADER_BYTES));
+            size_t http_length = header_block_length(http);
+            if (http_length != std::string_view::npos && starts_with_ignore_case(http, "HTTP/")) {
+                std::string_view http_headers = http.substr(0, http_length);
+                // Status line: HTTP/1.1 200 OK
+                size_t digit = http_headers.find(' ');
+                while (digit != std::string_view::npos && ++digit < http_headers.size() &&
+                       http_headers[digit] >= '0' && http_headers[digit] <= '9' && record.http_status < 1000) {
+                    record.http_status = record.http_status * 10 + (http_headers[digit] - '0');
+                }
+                for_each_header_field(http_headers, [&](std::string_view name, std::string_view value) {
+                    if (equals_ignore_case(name, "Content-Type")) record.http_content_type = value;
+                });
+                record.payload = record.block.substr(http_length);
+            } else {
+                record.payload = std::string_view();
+            }
+        }
+
+        pending_ = record_length;
+        return true;
+    }
+}
+
+void WarcReader::fail(const std::string& message) const {
+    throw std::runtime_error("Malformed WARC input at byte " + std::to_string(offset_) + ": " + message);
+}
+
+WarcExtractionStats extract_warc(std::istream& input, const TextExtractor& extractor,
+                                 const std::function<void(const TextExtractionResult&)>& visit,
+                                 const WarcExtractionOptions& options) {
+    // HTML responses and conversion text, each with its URL; is_text keeps file order
+    struct Batch {
+        std::vector<std::string> html;
+        std::vector<std::string> urls;
+        std::vector<std::string> texts;
+        std::vector<std::string> text_urls;
+        std::vector<bool> is_text;
+    };
+
+    WarcReader reader(input, options.max_record_bytes);
+    BoundedQueue<Batch> queue(options.queue_batches);
+    const size_t batch_size = std::max<size_t>(1, options.batch_size);
+    std::exception_ptr reader_error;
+
+    std::thread producer([&]() {
+        try {
+            Batch batch;
+            WarcRecord record;
+            while (reader.next(record)) {
+                if (record.payload.empty()) continue;
+                if (record.is_conversion()) {
+                    batch.texts.emplace_back(record.payload);
+                    batch.text_urls.emplace_back(record.target_uri);
+                    batch.is_text.push_back(true);
+                } else if (record.is_success() && record.is_html()) {
+                    batch.html.emplace_back(record.payload);
+                    batch.urls.emplace_back(record.target_uri);
+                    batch.is_text.push_back(false);
+                } else {
+                    continue;
+                }
+                if (batch.is_text.size() == batch_size) {
+                    if (!queue.push(std::move(batch))) return;
+                    batch = Batch{};
+                }
+            }
+            if (!batch.is_text.empty()) queue.push(std::move(batch));
+        } catch (...) {
+            reader_error = std::current_exception();
+        }
+        queue.close();
+    });
+
+    WarcExtractionStats stats;
+    try {
+        Batch batch;
+        while (queue.pop(batch)) {
+            std::vector<TextExtractionResult> results = extractor.extract_batch(batch.html, batch.urls);
+            size_t next_html = 0;
+            size_t next_text = 0;
+            for (bool is_text : batch.is_text) {
+                if (is_text) {
+                    visit(extractor.from_text(batch.texts[next_text], batch.text_urls[next_text]));
+                    next_text++;
+                } else {
+                    visit(results[next_html++]);
+                }
+                stats.documents_extracted++;
+            }
+        }
+    } catch (...) {
+        // Stop the reader before unwinding past its thread
+        queue.close();
+        producer.join();
+        throw;
+    }
+    producer.join();
+
+    if (reader_error) {
+        std::rethrow_exception(reader_error);
+    }
+
+    stats.records_read = reader.records_read();
+    stats.records_skipped = reader.records_skipped();
+    stats.bytes_read = reader.bytes_read();
+    return stats;
+}
+
+} // namespace rapidsift
@@ -0,0 +1,918 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <cstring>
+#include <cstddef>
+#include <chrono>
+
+#include "rapidsift/common.hpp"
+#include "rapidsift/decontamination_filter.hpp"
+#include "test_framework.hpp"
+
+using namespace rapidsift;
+using namespace rapidsift::dedup;
+using namespace test_framework;
+
+const std::string BENCHMARK_QUESTION =
+    "which element has the chemical symbol au and is prized for its resistance to "
+    "corrosion and its use in jewelry and coinage throughout history";
+
+std::string make_clean_text(size_t words, size_t seed) {
+    std::string text;
+    for (size_t i = 0; i < words; ++i) {
+        if (i > 0) text += " ";
+        text += "w" + std::to_string((seed * 7919 + i * 104729) % 100003);
+    }
+    return text;
+}
+
+void load_benchmark(DecontaminationFilter& filter) {
+    auto ngrams = decontamination_utils::generate_ngrams(
+        BENCHMARK_QUESTION, filter.get_config().ngram_size, false, true);
+    filter.add_benchmark_ngrams(ngrams, "TriviaQA");
+}
+
+void test_hash128() {
+    Hash128 a = hash_utils::hash128("the quick brown fox");
+    Hash128 b = hash_utils::hash128("the quick brown fox");
+    Hash128 c = hash_utils::hash128("the quick brown fax");
+
+    ASSERT_TRUE(a == b);
+    ASSERT_TRUE(a != c);
+    ASSERT_NE(a.low, a.high);
+    ASSERT_TRUE(hash_utils::hash128("abc", 1) != hash_utils::hash128("abc", 2));
+}
+
+void test_bloom_filter_no_false_negatives() {
+    NGramBloomFilter bloom(10000, 0.01);
+
+    for (size_t i = 0; i < 10000; ++i) {
+        bloom.add("ngram " + std::to_string(i));
+    }
+    for (size_t i = 0; i < 10000; ++i) {
+        ASSERT_TRUE(bloom.might_contain("ngram " + std::to_string(i)));
+    }
+}
+
+void test_bloom_filter_meets_configured_fpr() {
+    const size_t n = 50000;
+
+    for (double target : {0.01, 0.001}) {
+        NGramBloomFilter bloom(n, target);
+        ASSERT_LE(bloom.get_expected_false_positive_rate(), target);
+
+        for (size_t i = 0; i < n; ++i) {
+            bloom.add("present " + std::to_string(i));
+        }
+
+        size_t false_positives = 0;
+        const size_t probes = 200000;
+        for (size_t i = 0; i < probes; ++i) {
+            if (bloom.might_contain("absent " + std::to_string(i))) {
+                false_positives++;
+            }
+        }
+
+        double observed = static_cast<double>(false_positives) / probes;
+        ASSERT_LE(observed, target * 1.3);
+    }
+}
+
+void test_bloom_filter_sizing() {
+    NGramBloomFilter small(1000, 0.01);
+    NGramBloomFilter large(100000, 0.01);
+
+    ASSERT_EQ(small.get_size() % NGramBloomFilter::BLOCK_BITS, 0);
+    ASSERT_GT(large.get_size(), small.get_size() * 50);
+    ASSERT_GE(small.get_hash_functions(), 1);
+    ASSERT_LE(small.get_hash_functions(), NGramBloomFilter::MAX_HASH_FUNCTIONS);
+}
+
+void test_filter_sizes_bloom_from_loaded_ngrams() {
+    DecontaminationFilter filter(decontamination_utils::create_default_config());
+    load_benchmark(filter);
+
+    ASSERT_TRUE(filter.is_loaded());
+    ASSERT_GT(filter.get_benchmark_ngrams_count(), 0);
+}
+
+void test_detects_contamination() {
+    DecontaminationFilter filter(decontamination_utils::create_default_config());
+    load_benchmark(filter);
+
+    Document contaminated("Trivia time! " + BENCHMARK_QUESTION + " Answer: gold.", 1);
+    auto assessment = filter.assess_document(contaminated);
+
+    ASSERT_TRUE(assessment.is_contaminated);
+    ASSERT_GT(assessment.contaminated_ngrams, 0);
+    ASSERT_EQ(assessment.most_likely_source, "TriviaQA");
+
+    auto decision = filter.evaluate(contaminated);
+    ASSERT_TRUE(decision.result == FilterResult::REJECT);
+}
+
+void test_keeps_clean_documents() {
+    DecontaminationFilter filter(decontamination_utils::create_default_config());
+    load_benchmark(filter);
+
+    Document clean(make_clean_text(200, 42), 2);
+    auto assessment = filter.assess_document(clean);
+
+    ASSERT_FALSE(assessment.is_contaminated);
+    ASSERT_EQ(assessment.contaminated_ngrams, 0);
+    ASSERT_EQ(assessment.total_ngrams_checked, 200 - DEFAULT_NGRAM_SIZE + 1);
+}
+
+void test_bloom_filter_disabled() {
+    auto config = decontamination_utils::create_default_config();
+    config.use_bloom_filter = false;
+    DecontaminationFilter filter(config);
+    load_benchmark(filter);
+
+    Document contaminated(BENCHMARK_QUESTION, 3);
+    ASSERT_TRUE(filter.assess_document(contaminated).is_contaminated);
+}
+
+void test_early_exit_matches_full_report() {
+    auto config = decontamination_utils::create_default_config();
+    config.contamination_threshold = 0.0;  // One match is enough to reject
+    DecontaminationFilter early(config);
+    config.full_report = true;
+    DecontaminationFilter full(config);
+    load_benchmark(early);
+    load_benchmark(full);
+
+    Document leaked(BENCHMARK_QUESTION + " " + make_clean_text(2000, 7), 1);
+    auto fast = early.assess_document(leaked);
+    auto audit = full.assess_document(leaked);
+
+    ASSERT_TRUE(fast.is_contaminated);
+    ASSERT_TRUE(audit.is_contaminated);
+    ASSERT_EQ(fast.total_ngrams_checked, audit.total_ngrams_checked);
+    ASSERT_EQ(fast.contaminated_ngrams, 1);
+    ASSERT_EQ(fast.ngrams_probed, 1);
+    ASSERT_EQ(audit.ngrams_probed, audit.total_ngrams_checked);
+    ASSERT_EQ(audit.contaminated_ngrams, early.find_contaminated_ngrams(leaked).size());
+    ASSERT_GT(audit.contaminated_ngrams, 1);
+
+    // A ratio threshold becomes unreachable well before the end of a clean document
+    DecontaminationFilter ratio(decontamination_utils::create_default_config());
+    load_benchmark(ratio);
+    auto clean = ratio.assess_document(Document(make_clean_text(1000, 3), 2));
+    ASSERT_FALSE(clean.is_contaminated);
+    ASSERT_LT(clean.ngrams_probed, clean.total_ngrams_checked);
+    ASSERT_EQ(ratio.get_stats().total_ngrams_probed, clean.ngrams_probed);
+}
+
+void test_batch_assessment() {
+    DecontaminationFilter filter(decontamination_utils::create_default_config());
+    load_benchmark(filter);
+
+    std::vector<Document> docs;
+    for (size_t i = 0; i < 20; ++i) {
+        std::string text = make_clean_text(50, i);
+        if (i % 4 == 0) text += " " + BENCHMARK_QUESTION;
+        docs.emplace_back(text, i);
+    }
+
+    auto assessments = filter.assess_documents(docs);
+    auto decisions = filter.evaluate_batch(docs);
+
+    ASSERT_EQ(assessments.size(), docs.size());
+    ASSERT_EQ(decisions.size(), docs.size());
+    for (size_t i = 0; i < docs.size(); ++i) {
+        ASSERT_EQ(assessments[i].contaminated_ngrams > 0, i % 4 == 0);
+    }
+}
+
+void test_parallel_batch_matches_serial() {
+    auto config = decontamination_utils::create_default_config();
+    DecontaminationFilter parallel(config);
+    config.enable_parallel_processing = false;
+    DecontaminationFilter serial(config);
+    load_benchmark(parallel);
+    load_benchmark(serial);
+
+    std::vector<Document> docs;
+    for (size_t i = 0; i < 500; ++i) {
+        std::string text = make_clean_text(40, i);
+        if (i % 7 == 0) text = BENCHMARK_QUESTION + " " + text;
+        docs.emplace_back(text, i);
+    }
+
+    auto parallel_results = parallel.assess_documents(docs);
+    auto serial_results = serial.assess_documents(docs);
+
+    ASSERT_EQ(parallel_results.size(), serial_results.size());
+    for (size_t i = 0; i < docs.size(); ++i) {
+        ASSERT_EQ(parallel_results[i].contaminated_ngrams, serial_results[i].contaminated_ngrams);
+        ASSERT_EQ(parallel_results[i].is_contaminated, serial_results[i].is_contaminated);
+    }
+
+    // Per-thread statistics must add up to the serial totals
+    const auto& ps = parallel.get_stats();
+    const auto& ss = serial.get_stats();
+    ASSERT_EQ(ps.total_documents_processed, docs.size());
+    ASSERT_EQ(ps.contaminated_documents, ss.contaminated_documents);
+    ASSERT_EQ(ps.total_ngrams_checked, ss.total_ngrams_checked);
+    ASSERT_EQ(ps.contaminated_ngrams_found, ss.contaminated_ngrams_found);
+    ASSERT_EQ(ps.contamination_by_dataset.at("TriviaQA"), ss.contamination_by_dataset.at("TriviaQA"));
+}
+
+void test_index_round_trip() {
+    const std::string path = "test_decontamination_index.bin";
+    auto config = decontamination_utils::create_default_config();
+
+    {
+        DecontaminationFilter builder(config);
+        load_benchmark(builder);
+        builder.save_index(path);
+    }
+
+    DecontaminationFilter filter(config);
+    filter.load_index(path);
+
+    ASSERT_TRUE(filter.is_loaded());
+    ASSERT_EQ(filter.get_benchmark_ngrams_count(),
+              decontamination_utils::generate_ngrams(BENCHMARK_QUESTION, config.ngram_size, false, true).size());
+    ASSERT_EQ(filter.get_benchmark_datasets().size(), 1);
+
+    Document contaminated("Quiz: " + BENCHMARK_QUESTION, 1);
+    auto assessment = filter.assess_document(contaminated);
+    ASSERT_TRUE(assessment.is_contaminated);
+    ASSERT_EQ(assessment.most_likely_source, "TriviaQA");
+    ASSERT_FALSE(filter.assess_document(Document(make_clean_text(100, 5), 2)).is_contaminated);
+
+    // Adding to a mapped index copies it and keeps the mapped n-grams
+    filter.add_benchmark_ngrams({"an entirely separate benchmark sentence that is long enough to form grams"}, "Other");
+    ASSERT_TRUE(filter.assess_document(contaminated).is_contaminated);
+    ASSERT_EQ(filter.get_benchmark_datasets().size(), 2);
+
+    std::remove(path.c_str());
+}
+
+std::vector<uint32_t> attributed_datasets(const NGramIndex& index, const Hash128& hash) {
+    std::vector<uint32_t> ids;
+    index.for_each_dataset(index.find(hash), [&](uint32_t id) { ids.push_back(id); });
+    return ids;
+}
+
+void test_index_attributes_every_dataset() {
+    NGramIndex index;
+    uint32_t a = index.intern_dataset("A");
+    uint32_t b = index.intern_dataset("B");
+    uint32_t c = index.intern_dataset("C");
+
+    Hash128 shared = hash_utils::hash128("shared gram");
+    Hash128 other = hash_utils::hash128("other gram");
+    index.insert(shared, c);
+    index.insert(other, b);
+    index.insert(shared, a);
+    index.insert(other, c);
+    index.insert(shared, b);
+    index.insert(shared, a);  // Duplicates are ignored
+
+    ASSERT_EQ(index.size(), 2);
+    ASSERT_TRUE(attributed_datasets(index, shared) == std::vector<uint32_t>({a, b, c}));
+    ASSERT_TRUE(attributed_datasets(index, other) == std::vector<uint32_t>({b, c}));
+    ASSERT_TRUE(attributed_datasets(index, hash_utils::hash128("missing")).empty());
+
+    // Attributions survive growth of the table
+    for (size_t i = 0; i < 5000; ++i) {
+        index.insert(hash_utils::hash128("filler " + std::to_string(i)), a);
+    }
+    ASSERT_TRUE(attributed_datasets(index, shared) == std::vector<uint32_t>({a, b, c}));
+}
+
+void test_index_interns_dataset_lists() {
+    NGramIndex index;
+    uint32_t a = index.intern_dataset("A");
+    uint32_t b = index.intern_dataset("B");
+    uint32_t c = index.intern_dataset("C");
+
+    // Thousands of n-grams shared by the same pair hold one (count, a, b) list
+    const size_t ngrams = 5000;
+    for (size_t i = 0; i < ngrams; ++i) {
+        Hash128 hash = hash_utils::hash128("shared " + std::to_string(i));
+        index.insert(hash, a);
+        index.insert(hash, b);
+    }
+    ASSERT_EQ(index.dataset_sets_size(), 3);
+    ASSERT_EQ(index.find(hash_utils::hash128("shared 0")), index.find(hash_utils::hash128("shared 4999")));
+
+    // A third dataset on some of them adds one more list, not one per n-gram
+    for (size_t i = 0; i < ngrams; i += 2) {
+        index.insert(hash_utils::hash128("shared " + std::to_string(i)), c);
+    }
+    ASSERT_EQ(index.dataset_sets_size(), 3 + 4);
+    ASSERT_TRUE(attributed_datasets(index, hash_utils::hash128("shared 0")) == std::vector<uint32_t>({a, b, c}));
+    ASSERT_TRUE(attributed_datasets(index, hash_utils::hash128("shared 1")) == std::vector<uint32_t>({a, b}));
+
+    // Lists already in an attached pool are reused after it is copied
+    NGramIndex attached;
+    attached.attach(index.keys(), index.dataset_ids(), index.capacity(), index.size(),
+                    index.dataset_sets(), index.dataset_sets_size(), index.datasets());
+    Hash128 fresh = hash_utils::hash128("fresh");
+    attached.insert(fresh, a);
+    attached.insert(fresh, b);
+    ASSERT_EQ(attached.dataset_sets_size(), 3 + 4);
+    ASSERT_TRUE(attributed_datasets(attached, fresh) == std::vector<uint32_t>({a, b}));
+}
+
+void test_shared_ngrams_count_for_all_datasets() {
+    const std::string path = "test_decontamination_shared_index.bin";
+    auto config = decontamination_utils::create_default_config();
+
+    // The same question was published in two benchmarks
+    DecontaminationFilter filter(config);
+    auto ngrams = decontamination_utils::generate_ngrams(BENCHMARK_QUESTION, config.ngram_size, false, true);
+    filter.add_benchmark_ngrams(ngrams, "TriviaQA");
+    filter.add_benchmark_ngrams(ngrams, "WebQuestions");
+    filter.save_index(path);
+
+    Document leaked("Quiz: " + BENCHMARK_QUESTION, 1);
+    auto assessment = filter.assess_document(leaked);
+    ASSERT_TRUE(assessment.is_contaminated);
+    ASSERT_EQ(assessment.contaminated_datasets.size(), 2);
+    ASSERT_EQ(assessment.matches[0].source_dataset, "TriviaQA");
+    ASSERT_EQ(assessment.matches[0].other_datasets.size(), 1);
+    ASSERT_EQ(assessment.matches[0].other_datasets[0], "WebQuestions");
+    ASSERT_EQ(filter.get_stats().contamination_by_dataset.at("TriviaQA"), 1);
+    ASSERT_EQ(filter.get_stats().contamination_by_dataset.at("WebQuestions"), 1);
+
+    // The id lists are part of the mapped index
+    DecontaminationFilter mapped(config);
+    mapped.load_index(path);
+    auto mapped_assessment = mapped.assess_document(leaked);
+    ASSERT_EQ(mapped_assessment.contaminated_datasets.size(), 2);
+    ASSERT_EQ(mapped.get_stats().contamination_by_dataset.at("WebQuestions"), 1);
+
+    std::remove(path.c_str());
+}
+
+void test_index_rejects_stale_config() {
+    const std::string path = "test_decontamination_stale_index.bin";
+    auto config = decontamination_utils::create_default_config();
+
+    {
+        DecontaminationFilter builder(config);
+        load_benchmark(builder);
+        builder.save_index(path);
+    }
+
+    config.ngram_size = 8;
+    DecontaminationFilter filter(config);
+    bool rejected = false;
+    try {
+        filter.load_index(path);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    ASSERT_TRUE(rejected);
+    ASSERT_FALSE(filter.is_loaded());
+
+    // Query-time settings do not invalidate the index
+    auto query_config = decontamination_utils::create_default_config();
+    query_config.contamination_threshold = 0.5;
+    query_config.use_bloom_filter = false;
+    DecontaminationFilter relaxed(query_config);
+    relaxed.load_index(path);
+    ASSERT_TRUE(relaxed.is_loaded());
+
+    std::remove(path.c_str());
+}
+
+bool index_load_rejected(const std::string& path) {
+    DecontaminationFilter filter(decontamination_utils::create_default_config());
+    try {
+        filter.load_index(path);
+    } catch (const std::runtime_error&) {
+        return !filter.is_loaded();
+    }
+    return false;
+}
+
+void test_index_rejects_corrupt_file() {
+    const std::string path = "test_decontamination_corrupt_index.bin";
+    const std::string corrupt_path = "test_decontamination_corrupt_index_patched.bin";
+    auto config = decontamination_utils::create_default_config();
+
+    {
+        DecontaminationFilter builder(config);
+        auto ngrams = decontamination_utils::generate_ngrams(BENCHMARK_QUESTION, config.ngram_size, false, true);
+        builder.add_benchmark_ngrams(ngrams, "TriviaQA");
+        builder.add_benchmark_ngrams(ngrams, "WebQuestions");
+        builder.save_index(path);
+    }
+
+    std::string original;
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        original = buffer.str();
+    }
+    IndexFileHeader header;
+    std::memcpy(&header, original.data(), sizeof(header));
+
+    auto patched = [&](size_t offset, const void* value, size_t size) {
+        std::string bytes = original;
+        std::memcpy(&bytes[offset], value, size);
+        std::ofstream out(corrupt_path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        return corrupt_path;
+    };
+    auto first_slot = [&](auto&& wanted) {
+        const uint32_t* ids = reinterpret_cast<const uint32_t*>(original.data() + header.dataset_ids_offset);
+        for (size_t i = 0; i < header.table_capacity; ++i) {
+            if (wanted(ids[i])) return header.dataset_ids_offset + i * sizeof(uint32_t);
+        }
+        return uint64_t{0};
+    };
+
+    // A power-of-two capacity whose key and id sections both wrap to zero bytes
+    uint64_t wrapping_capacity = uint64_t{1} << 62;
+    ASSERT_TRUE(index_load_rejected(patched(offsetof(IndexFileHeader, table_capacity),
+                                            &wrapping_capacity, sizeof(wrapping_capacity))));
+
+    // Every n-gram here is shared, so each slot points into the id pool
+    uint64_t shared_slot = first_slot([](uint32_t id) { return id != NGramIndex::NOT_FOUND; });
+    ASSERT_NE(shared_slot, 0);
+    uint32_t unknown_dataset = 7;
+    ASSERT_TRUE(index_load_rejected(patched(shared_slot, &unknown_dataset, sizeof(unknown_dataset))));
+    uint32_t outside_pool = NGramIndex::MULTI_DATASET | static_cast<uint32_t>(header.dataset_sets_size);
+    ASSERT_TRUE(index_load_rejected(patched(shared_slot, &outside_pool, sizeof(outside_pool))));
+    uint32_t mid_list = NGramIndex::MULTI_DATASET | 1;
+    ASSERT_TRUE(index_load_rejected(patched(shared_slot, &mid_list, sizeof(mid_list))));
+    uint32_t unknown_in_pool = 9;
+    ASSERT_TRUE(index_load_rejected(patched(header.dataset_sets_offset + sizeof(uint32_t),
+                                            &unknown_in_pool, sizeof(unknown_in_pool))));
+    uint32_t long_list = 1000;
+    ASSERT_TRUE(index_load_rejected(patched(header.dataset_sets_offset, &long_list, sizeof(long_list))));
+
+    // The untouched file still loads
+    DecontaminationFilter filter(config);
+    filter.load_index(path);
+    ASSERT_TRUE(filter.assess_document(Document("Quiz: " + BENCHMARK_QUESTION, 1)).is_contaminated);
+
+    std::remove(path.c_str());
+    std::remove(corrupt_path.c_str());
+}
+
+void test_json_field_reader_selects_fields() {
+    std::istringstream input(
+        R"({"version": 1.1, "data": [{"title": "Gold", "paragraphs": [{"context": "Gold is \"Au\".",)"
+        R"( "qas": [{"id": "q1", "question": "caf\u00e9 \ud83d\ude00?", "is_impossible": false,)"
+        R"( "answers": [{"text": "Au", "answer_start": 9}, {"text": "gold"}]}]}]}]})");
+
+    JsonFieldReader reader(input, {"context", "question", "answers.text"});
+    std::vector<std::string> texts;
+    size_t count = reader.read([&](const std::string& text) { texts.push_back(text); });
+
+    ASSERT_EQ(count, 4);
+    ASSERT_EQ(texts[0], "Gold is \"Au\".");
+    ASSERT_EQ(texts[1], "caf\xc3\xa9 \xf0\x9f\x98\x80?");
+    ASSERT_EQ(texts[2], "Au");
+    ASSERT_EQ(texts[3], "gold");
+
+    // JSONL is a sequence of values; strings straddling buffer refills are joined
+    std::string long_value(3 * JsonFieldReader::BUFFER_SIZE, 'x');
+    std::istringstream lines("{\"premise\": \"" + long_value + "\", \"label\": null}\n{\"premise\": \"b\"}\n");
+    JsonFieldReader jsonl(lines, {"premise"});
+    texts.clear();
+    ASSERT_EQ(jsonl.read([&](const std::string& text) { texts.push_back(text); }), 2);
+    ASSERT_EQ(texts[0], long_value);
+    ASSERT_EQ(texts[1], "b");
+
+    std::istringstream malformed(R"({"question": "unterminated)");
+    JsonFieldReader broken(malformed, {"question"});
+    ASSERT_THROWS(broken.read([](const std::string&) {}), std::runtime_error);
+}
+
+void test_loads_json_benchmarks() {
+    const std::string path = "test_decontamination_squad_dev.json";
+    {
+        std::ofstream file(path);
+        file << R"({"data": [{"title": "Chemistry", "paragraphs": [{"context": "Elements and their symbols.",)"
+             << R"( "qas": [{"id": "5733be284776f41900661182", "question": ")" << BENCHMARK_QUESTION << R"(",)"
+             << R"( "answers": [{"text": "gold", "answer_start": 0}]}]}]}]})";
+    }
+
+    auto texts = decontamination_utils::load_squad_dataset(path);
+    ASSERT_EQ(texts.size(), 3);
+    ASSERT_EQ(texts[1], BENCHMARK_QUESTION);
+    ASSERT_TRUE(decontamination_utils::detect_benchmark_format(path) == BenchmarkFormat::SQUAD);
+
+    DecontaminationFilter filter(decontamination_utils::create_default_config());
+    filter.load_benchmark_file(path, "SQuAD");
+
+    // Only the question's n-grams are indexed, not JSON keys or ids
+    ASSERT_EQ(filter.get_benchmark_ngrams_count(),
+              decontamination_utils::generate_ngrams(BENCHMARK_QUESTION, DEFAULT_NGRAM_SIZE, false, true).size());
+    auto assessment = filter.assess_document(Document("Quiz: " + BENCHMARK_QUESTION, 1));
+    ASSERT_TRUE(assessment.is_contaminated);
+    ASSERT_EQ(assessment.most_likely_source, "SQuAD");
+
+    std::remove(path.c_str());
+}
+
+void test_benchmark_format_detection() {
+    using decontamination_utils::detect_benchmark_format;
+
+    // Task names count only as whole path tokens
+    ASSERT_TRUE(detect_benchmark_format("sorted.jsonl") == BenchmarkFormat::JSON);
+    ASSERT_TRUE(detect_benchmark_format("assistant_eval.json") == BenchmarkFormat::JSON);
+    ASSERT_TRUE(detect_benchmark_format("chocolate.json") == BenchmarkFormat::JSON);
+    ASSERT_TRUE(detect_benchmark_format("trivial_facts.json") == BenchmarkFormat::JSON);
+    ASSERT_TRUE(detect_benchmark_format("data/glue/rte/dev.jsonl") == BenchmarkFormat::GLUE);
+    ASSERT_TRUE(detect_benchmark_format("SST-2_dev.json") == BenchmarkFormat::GLUE);
+    ASSERT_TRUE(detect_benchmark_format("squad_v2-dev.json") == BenchmarkFormat::SQUAD);
+    ASSERT_TRUE(detect_benchmark_format("triviaqa-web-dev.json") == BenchmarkFormat::TRIVIA_QA);
+    ASSERT_TRUE(detect_benchmark_format("squad.txt") == BenchmarkFormat::PLAIN_TEXT);
+
+    // A layout the name does not reveal can be given per file
+    const std::string path = "test_decontamination_pairs.json";
+    {
+        std::ofstream file(path);
+        file << R"({"question1": ")" << BENCHMARK_QUESTION << R"(", "question2": "short", "label": 1})" << "\n";
+    }
+    auto config = decontamination_utils::create_default_config();
+    DecontaminationFilter guessed(config);
+    guessed.load_benchmark_file(path, "QQP");
+    ASSERT_EQ(guessed.get_benchmark_ngrams_count(), 0);
+
+    config.benchmark_format_map[path] = BenchmarkFormat::GLUE;
+    DecontaminationFilter explicit_format(config);
+    explicit_format.load_benchmark_file(path, "QQP");
+    ASSERT_TRUE(explicit_format.assess_document(Document("Quiz: " + BENCHMARK_QUESTION, 1)).is_contaminated);
+
+    std::remove(path.c_str());
+}
+
+void write_reference_corpus(const std::string& path, size_t lines) {
+    std::ofstream file(path);
+    for (size_t i = 0; i < lines; ++i) {
+        file << make_clean_text(20, i) << "\n";
+    }
+    file << BENCHMARK_QUESTION << "\n";
+}
+
+void test_partitioned_index_matches_in_memory() {
+    const std::string corpus = "test_decontamination_corpus.txt";
+    const std::string directory = "test_decontamination_partitioned";
+    write_reference_corpus(corpus, 5000);
+
+    // A 1 MB budget forces several sorted runs per partition during the build
+    auto config = decontamination_utils::create_default_config();
+    config.max_memory_mb = 1;
+    config.index_partitions = 16;
+    config.benchmark_files = {corpus};
+    config.dataset_name_map[corpus] = "PriorCorpus";
+    size_t records = DecontaminationFilter(config).build_partitioned_index(directory);
+
+    config.max_memory_mb = 64;
+    DecontaminationFilter in_memory(config);
+    in_memory.load_benchmark_datasets();
+    ASSERT_EQ(records, in_memory.get_benchmark_ngrams_count());
+
+    config.partitioned_index_dir = directory;
+    DecontaminationFilter partitioned(config);
+    partitioned.load_benchmark_datasets();
+    ASSERT_TRUE(partitioned.is_loaded());
+    ASSERT_EQ(partitioned.get_benchmark_ngrams_count(), records);
+    ASSERT_EQ(partitioned.get_benchmark_datasets()[0], "PriorCorpus");
+
+    for (size_t i = 0; i < 50; ++i) {
+        std::string text = (i % 3 == 0) ? make_clean_text(20, i * 97) : make_clean_text(30, 100000 + i);
+        if (i % 5 == 0) text += " " + BENCHMARK_QUESTION;
+        Document doc(text, i);
+
+        auto expected = in_memory.find_contaminated_ngrams(doc);
+        auto actual = partitioned.find_contaminated_ngrams(doc);
+        ASSERT_EQ(actual.size(), expected.size());
+        for (size_t m = 0; m < actual.size(); ++m) {
+            ASSERT_EQ(actual[m].position_in_document, expected[m].position_in_document);
+            ASSERT_EQ(actual[m].source_dataset, "PriorCorpus");
+        }
+        ASSERT_EQ(partitioned.assess_document(doc).is_contaminated, in_memory.assess_document(doc).is_contaminated);
+    }
+
+    // Batches look up every document's n-grams together and agree with
+    // documents assessed one at a time
+    config.assessment_cache_entries = 0;
+    config.batch_size = 7;
+    DecontaminationFilter batched(config);
+    batched.load_benchmark_datasets();
+    std::vector<Document> docs;
+    for (size_t i = 0; i < 50; ++i) {
+        std::string text = (i % 3 == 0) ? make_clean_text(20, i * 97) : make_clean_text(30, 100000 + i);
+        if (i % 5 == 0) text += " " + BENCHMARK_QUESTION;
+        docs.emplace_back(text, i);
+    }
+    auto batch_results = batched.assess_documents(docs);
+    ASSERT_EQ(batch_results.size(), docs.size());
+    size_t contaminated = 0;
+    for (size_t i = 0; i < docs.size(); ++i) {
+        auto single = partitioned.assess_document(docs[i]);
+        ASSERT_EQ(batch_results[i].is_contaminated, single.is_contaminated);
+        ASSERT_EQ(batch_results[i].contaminated_ngrams, single.contaminated_ngrams);
+        ASSERT_EQ(batch_results[i].ngrams_probed, single.ngrams_probed);
+        ASSERT_EQ(batch_results[i].most_likely_source, single.most_likely_source);
+        contaminated += batch_results[i].is_contaminated;
+    }
+    ASSERT_GE(contaminated, 10);
+    ASSERT_EQ(batched.get_stats().total_documents_processed, docs.size());
+
+    // Resident state is checked against the budget when the index is opened
+    config.max_memory_mb = 0;
+    DecontaminationFilter starved(config);
+    ASSERT_THROWS(starved.load_partitioned_index(directory), std::runtime_error);
+
+    // Merge buffers are sized by the runs, not the budget, so a small build
+    // under a large budget stays quick however many partitions it has
+    write_reference_corpus(corpus, 5);
+    config.max_memory_mb = 2048;
+    config.index_partitions = 64;
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_GT(DecontaminationFilter(config).build_partitioned_index(directory), 0);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    ASSERT_LT(elapsed.count(), 2000);
+
+    std::remove(corpus.c_str());
+    std::filesystem::remove_all(directory);
+}
+
+void test_probed_counts_lookups() {
+    const std::string corpus = "test_decontamination_probed.txt";
+    const std::string directory = "test_decontamination_probed_partitioned";
+    write_reference_corpus(corpus, 50);
+
+    // Unigrams, so common phrases are screened before the lookup
+    auto config = decontamination_utils::create_default_config();
+    config.ngram_size = 1;
+    config.full_report = true;
+    config.benchmark_files = {corpus};
+    config.index_partitions = 4;
+    config.max_memory_mb = 16;
+    DecontaminationFilter(config).build_partitioned_index(directory);
+
+    DecontaminationFilter in_memory(config);
+    in_memory.load_benchmark_datasets();
+    config.partitioned_index_dir = directory;
+    DecontaminationFilter partitioned(config);
+    partitioned.load_benchmark_datasets();
+
+    Document doc("the element gold and the coinage of " + make_clean_text(10, 3), 1);
+    auto expected = in_memory.assess_document(doc);
+    auto actual = partitioned.assess_document(doc);
+    ASSERT_EQ(expected.total_ngrams_checked, 17);
+    ASSERT_EQ(expected.ngrams_probed, 13);
+    ASSERT_EQ(actual.ngrams_probed, expected.ngrams_probed);
+    ASSERT_EQ(partitioned.get_stats().total_ngrams_probed, in_memory.get_stats().total_ngrams_probed);
+
+    std::remove(corpus.c_str());
+    std::filesystem::remove_all(directory);
+}
+
+void test_in_memory_index_enforces_budget() {
+    const std::string corpus = "test_decontamination_budget.txt";
+    write_reference_corpus(corpus, 5000);
+
+    auto config = decontamination_utils::create_default_config();
+    config.max_memory_mb = 1;
+    DecontaminationFilter filter(config);
+    ASSERT_THROWS(filter.load_benchmark_file(corpus), std::runtime_error);
+    ASSERT_LE(filter.get_benchmark_ngrams_count() * (sizeof(Hash128) + sizeof(uint32_t)) * 2, size_t{1} << 20);
+
+    // N-grams longer than any line leave the table empty; the overlap
+    // automaton and the MinHash index count against the same budget
+    config.ngram_size = 50;
+    config.engine = DecontaminationEngine::OVERLAP_AUTOMATON;
+    DecontaminationFilter overlap(config);
+    ASSERT_THROWS(overlap.load_benchmark_file(corpus), std::runtime_error);
+    config.engine = DecontaminationEngine::NGRAM_INDEX;
+    config.check_approximate_matches = true;
+    DecontaminationFilter approximate(config);
+    ASSERT_THROWS(approximate.load_benchmark_file(corpus), std::runtime_error);
+    config.max_memory_mb = 64;
+    DecontaminationFilter roomy(config);
+    roomy.load_benchmark_file(corpus);
+    ASSERT_TRUE(roomy.is_loaded());
+
+    std::remove(corpus.c_str());
+}
+
+void test_overlap_automaton_maximal_spans() {
+    OverlapAutomaton automaton;
+    automaton.add_text({"a", "b", "c", "d", "e"}, 0);
+    automaton.add_text({"x", "c", "d", "e", "f", "g"}, 1);
+
+    auto overlaps = automaton.find_overlaps({"q", "a", "b", "c", "d", "z", "c", "d", "e", "f", "g", "h"}, 2);
+
+    ASSERT_EQ(overlaps.size(), 2);
+    ASSERT_EQ(overlaps[0].start, 1);
+    ASSERT_EQ(overlaps[0].length, 4);
+    ASSERT_EQ(overlaps[0].dataset_id, 0);
+    ASSERT_EQ(overlaps[1].start, 6);
+    ASSERT_EQ(overlaps[1].length, 5);
+    ASSERT_EQ(overlaps[1].dataset_id, 1);
+
+    ASSERT_TRUE(automaton.find_overlaps({"a", "b", "c", "d"}, 5).empty());
+    ASSERT_TRUE(automaton.find_overlaps({"unknown", "tokens"}, 1).empty());
+}
+
+void test_overlap_engine_detects_short_items() {
+    auto config = decontamination_utils::create_default_config();
+    config.engine = DecontaminationEngine::OVERLAP_AUTOMATON;
+    config.min_overlap_tokens = 6;
+    DecontaminationFilter filter(config);
+
+    // Shorter than the 13-gram size, so the n-gram engine cannot see it
+    filter.add_benchmark_ngrams({"who painted the ceiling of the sistine chapel"}, "TriviaQA");
+    ASSERT_TRUE(filter.is_loaded());
+
+    Document contaminated("Quick quiz: who painted the ceiling of the sistine chapel in Rome?", 1);
+    auto assessment = filter.assess_document(contaminated);
+    ASSERT_TRUE(assessment.is_contaminated);
+    ASSERT_EQ(assessment.longest_overlap, 8);
+    ASSERT_EQ(assessment.matches.size(), 1);
+    ASSERT_EQ(assessment.matches[0].position_in_document, 2);
+    ASSERT_EQ(assessment.matches[0].source_dataset, "TriviaQA");
+
+    Document partial("the ceiling of the house leaked", 2);
+    ASSERT_FALSE(filter.assess_document(partial).is_contaminated);
+}
+
+void test_approximate_matches_edited_leaks() {
+    auto config = decontamination_utils::create_default_config();
+    config.check_approximate_matches = true;
+    config.approximate_match_threshold = 0.75;
+    DecontaminationFilter filter(config);
+
+    // Many unrelated items, plus the one that leaks
+    for (size_t i = 0; i < 200; ++i) {
+        filter.add_benchmark_ngrams({make_clean_text(40, 1000 + i)}, "Noise");
+    }
+    std::string item = make_clean_text(40, 7);
+    filter.add_benchmark_ngrams({item}, "MMLU");
+
+    // One word substituted: breaks every 13-gram covering it, but the
+    // shingle sets stay ~85% similar
+    std::string edited = item;
+    size_t pos = edited.find(' ', edited.size() / 2);
+    edited.insert(pos + 1, "edited");
+    edited.erase(pos + 1 + 6, edited.find(' ', pos + 1 + 6) - (pos + 1 + 6));
+
+    Document leak("prefix words before the leak " + edited + " and words after it", 1);
+    auto assessment = filter.assess_document(leak);
+    ASSERT_TRUE(assessment.is_contaminated);
+    ASSERT_GT(assessment.approximate_matches, 0);
+
+    bool found_mmlu = false;
+    for (const auto& match : assessment.matches) {
+        if (match.approximate) {
+            found_mmlu |= match.source_dataset == "MMLU";
+            ASSERT_GE(match.match_confidence, 0.75);
+        }
+    }
+    ASSERT_TRUE(found_mmlu);
+
+    Document clean(make_clean_text(120, 99999), 2);
+    auto clean_assessment = filter.assess_document(clean);
+    ASSERT_FALSE(clean_assessment.is_contaminated);
+    ASSERT_EQ(clean_assessment.approximate_matches, 0);
+}
+
+void test_approximate_index_long_items() {
+    ApproximateIndex index(0.8, 3, 16);
+    std::vector<std::string> item;
+    for (size_t i = 0; i < 100; ++i) item.push_back("t" + std::to_string(i));
+    index.add_item(item, 3);
+
+    // A 30-token window from the middle of a long item is still found
+    std::vector<std::string> doc = {"x", "y"};
+    doc.insert(doc.end(), item.begin() + 41, item.begin() + 71);
+    doc.push_back("z");
+
+    auto matches = index.find_matches(doc);
+    ASSERT_EQ(matches.size(), 1);
+    ASSERT_EQ(matches[0].dataset_id, 3);
+    // Windows reaching one token into the surrounding text still pass 0.8
+    ASSERT_GE(matches[0].start, 1);
+    ASSERT_LE(matches[0].start + matches[0].length, 33);
+    ASSERT_GE(matches[0].length, 30);
+
+    // Long documents are scanned in chunks; leaks across a chunk boundary and
+    // of a second item length are found too
+    std::vector<std::string> short_item;
+    for (size_t i = 0; i < 12; ++i) short_item.push_back("s" + std::to_string(i));
+    index.add_item(short_item, 5);
+    std::vector<std::string> long_doc;
+    auto filler = [&](size_t until) {
+        while (long_doc.size() < until) long_doc.push_back("f" + std::to_string(long_doc.size()));
+    };
+    filler(1010);
+    long_doc.insert(long_doc.end(), item.begin() + 41, item.begin() + 71);
+    filler(2040);
+    long_doc.insert(long_doc.end(), short_item.begin(), short_item.end());
+    filler(3000);
+
+    matches = index.find_matches(long_doc);
+    ASSERT_EQ(matches.size(), 2);
+    ASSERT_EQ(matches[0].dataset_id, 3);
+    ASSERT_GE(matches[0].start, 1007);
+    ASSERT_LE(matches[0].start + matches[0].length, 1043);
+    ASSERT_EQ(matches[1].dataset_id, 5);
+    ASSERT_GE(matches[1].start, 2037);
+    ASSERT_LE(matches[1].start + matches[1].length, 2055);
+}
+
+void test_assessment_cache_keyed_by_content() {
+    DecontaminationFilter filter(decontamination_utils::create_default_config());
+    load_benchmark(filter);
+
+    std::string boilerplate = make_clean_text(60, 11);
+    Document first(boilerplate, 1);
+    Document repeat(boilerplate, 2);
+    Document reused_id(BENCHMARK_QUESTION, 1);
+
+    ASSERT_FALSE(filter.assess_document(first).is_contaminated);
+    ASSERT_FALSE(filter.assess_document(repeat).is_contaminated);
+    // Same id as a clean document, different content: must not hit
+    ASSERT_TRUE(filter.assess_document(reused_id).is_contaminated);
+
+    const auto& stats = filter.get_stats();
+    ASSERT_EQ(stats.cache_hits, 1);
+    ASSERT_EQ(stats.cache_misses, 2);
+    ASSERT_EQ(stats.total_documents_processed, 3);
+
+    // Loading more benchmarks invalidates cached verdicts
+    filter.add_benchmark_ngrams(decontamination_utils::generate_ngrams(
+        boilerplate, filter.get_config().ngram_size, false, true), "Boilerplate");
+    ASSERT_TRUE(filter.assess_document(repeat).is_contaminated);
+}
+
+void test_clock_cache_is_bounded() {
+    ShardedClockCache<size_t> cache(256, 8);
+    for (size_t i = 0; i < 10000; ++i) {
+        cache.put(hash_utils::hash128("key " + std::to_string(i)), i);
+    }
+    ASSERT_LE(cache.size(), cache.capacity());
+    ASSERT_LE(cache.capacity(), 256 + 8);
+
+    // Recently inserted keys are resident; referenced ones survive a sweep
+    size_t value = 0;
+    ASSERT_TRUE(cache.get(hash_utils::hash128("key 9999"), value));
+    ASSERT_EQ(value, 9999);
+    ASSERT_FALSE(cache.get(hash_utils::hash128("key 0"), value));
+
+    cache.clear();
+    ASSERT_EQ(cache.size(), 0);
+}
+
+int main() {
+    std::cout << "🧼 RapidSift Decontamination Filter Test Suite" << std::endl;
+    std::cout << "==============================================" << std::endl << std::endl;
+
+    TestSuite suite("Decontamination Filter Tests");
+
+    suite.add_test("128-bit hash", test_hash128);
+    suite.add_test("Bloom filter has no false negatives", test_bloom_filter_no_false_negatives);
+    suite.add_test("Bloom filter meets configured FPR", test_bloom_filter_meets_configured_fpr);
+    suite.add_test("Bloom filter sizing", test_bloom_filter_sizing);
+    suite.add_test("Bloom filter sized from loaded n-grams", test_filter_sizes_bloom_from_loaded_ngrams);
+    suite.add_test("Detects contamination", test_detects_contamination);
+    suite.add_test("Keeps clean documents", test_keeps_clean_documents);
+    suite.add_test("Bloom filter disabled", test_bloom_filter_disabled);
+    suite.add_test("Early exit agrees with full report", test_early_exit_matches_full_report);
+    suite.add_test("Batch assessment", test_batch_assessment);
+    suite.add_test("Parallel batch matches serial", test_parallel_batch_matches_serial);
+    suite.add_test("Prebuilt index round trip", test_index_round_trip);
+    suite.add_test("Prebuilt index rejects stale config", test_index_rejects_stale_config);
+    suite.add_test("Prebuilt index rejects corrupt files", test_index_rejects_corrupt_file);
+    suite.add_test("Index attributes every dataset", test_index_attributes_every_dataset);
+    suite.add_test("Index interns dataset lists", test_index_interns_dataset_lists);
+    suite.add_test("Shared n-grams count for all datasets", test_shared_ngrams_count_for_all_datasets);
+    suite.add_test("JSON field reader selects fields", test_json_field_reader_selects_fields);
+    suite.add_test("Loads JSON benchmarks", test_loads_json_benchmarks);
+    suite.add_test("Benchmark format detection", test_benchmark_format_detection);
+    suite.add_test("Partitioned index matches in-memory index", test_partitioned_index_matches_in_memory);
+    suite.add_test("Probed counts match across index layouts", test_probed_counts_lookups);
+    suite.add_test("In-memory index enforces max_memory_mb", test_in_memory_index_enforces_budget);
+    suite.add_test("Overlap automaton maximal spans", test_overlap_automaton_maximal_spans);
+    suite.add_test("Overlap engine detects short items", test_overlap_engine_detects_short_items);
+    suite.add_test("Approximate matches catch edited leaks", test_approximate_matches_edited_leaks);
+    suite.add_test("Approximate index chunks long items", test_approximate_index_long_items);
+    suite.add_test("Assessment cache keyed by content", test_assessment_cache_keyed_by_content);
+    suite.add_test("CLOCK cache is bounded", test_clock_cache_is_bounded);
+
+    suite.run_all();
+
+    return 0;
+}
@@ -1,9 +1,14 @@
 #include <iostream>
 #include <vector>
 #include <chrono>
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
+#include <memory>
 
 #include "rapidsift/common.hpp"
 #include "rapidsift/language_filter.hpp"
+#include "rapidsift/ngram_language_model.hpp"
 #include "test_framework.hpp"
 
 using namespace rapidsift;
@@ -34,6 +39,49 @@ void test_simple_language_detector() {
     ASSERT_EQ(result.language, "unknown");
 }
 
+void test_simple_detector_scripts() {
+    SimpleLanguageDetector detector;
+    
+    // Non-Latin scripts decide the language without stopwords
+    std::vector<std::pair<std::string, std::string>> cases = {
+        {"Сегодня хорошая погода, и мы идём гулять в парк.", "ru"},
+        {"Σήμερα ο καιρός είναι πολύ καλός για περίπατο.", "el"},
+        {"اليوم الطقس جميل جدا ونحن ذاهبون إلى الحديقة", "ar"},
+        {"今日はとても良い天気なので、公園に行きます。", "ja"},
+        {"今天天气很好，我们去公园散步吧。", "zh"},
+        {"오늘은 날씨가 아주 좋아서 공원에 갑니다.", "ko"}
+    };
+    for (const auto& [text, expected] : cases) {
+        LanguageDetection result = detector.detect(text);
+        ASSERT_EQ(result.language, expected);
+        ASSERT_GT(result.confidence, 0.5);
+    }
+    
+    // A long single-script text is decided from its first letters
+    std::string long_russian;
+    for (int i = 0; i < 200; ++i) long_russian += "это очень длинный текст ";
+    ASSERT_EQ(detector.detect(long_russian).language, "ru");
+    ASSERT_EQ(detector.detect(long_russian).confidence, 1.0);
+    
+    // Latin text with a few foreign words still goes to stopwords
+    LanguageDetection result = detector.detect("The Москва river and the city of Athens (Αθήνα) are in this English text.");
+    ASSERT_EQ(result.language, "en");
+    
+    // Case and punctuation do not hide stopwords
+    result = detector.detect("THE, AND; IS: IN... TO! OF? WITH");
+    ASSERT_EQ(result.language, "en");
+    ASSERT_EQ(result.confidence, 1.0);
+    
+    // Text without letters or stopwords is unknown
+    result = detector.detect("12345 67890 !!! ???");
+    ASSERT_EQ(result.language, "unknown");
+    ASSERT_EQ(result.confidence, 0.0);
+    
+    auto languages = detector.get_supported_languages();
+    ASSERT_TRUE(std::find(languages.begin(), languages.end(), "en") != languages.end());
+    ASSERT_TRUE(std::find(languages.begin(), languages.end(), "zh") != languages.end());
+}
+
 void test_fasttext_detector_fallback() {
     // Test FastText detector when model is not available
     FastTextLanguageDetector detector("");
@@ -188,6 +236,139 @@ void test_multilingual_document_handling() {
     ASSERT_GT(result.total_kept, 0);
 }
 
+// Forwards to SimpleLanguageDetector and records the longest text it was asked to detect
+class RecordingDetector : public LanguageDetector {
+public:
+    explicit RecordingDetector(std::shared_ptr<size_t> longest) : longest_(std::move(longest)) {}
+    
+    LanguageDetection detect(const std::string& text) override {
+        *longest_ = std::max(*longest_, text.size());
+        return inner_.detect(text);
+    }
+    std::vector<std::string> get_supported_languages() const override { return inner_.get_supported_languages(); }
+    bool is_ready() const override { return inner_.is_ready(); }
+    
+private:
+    SimpleLanguageDetector inner_;
+    std::shared_ptr<size_t> longest_;
+};
+
+void test_language_segmentation() {
+    std::string english;
+    while (english.size() < 600) english += "The weather is nice today and we are going to the park with our friends. ";
+    std::string russian;
+    while (russian.size() < 600) russian += "Сегодня хорошая погода, и мы идём в парк с нашими друзьями. ";
+    
+    auto windows = language_utils::sliding_windows(russian, 100, 40);
+    ASSERT_GT(windows.size(), 1);
+    for (size_t i = 0; i < windows.size(); ++i) {
+        // Windows step by the stride and never split a UTF-8 character
+        ASSERT_LE(windows[i].length(), 100 + 40);
+        ASSERT_TRUE((static_cast<unsigned char>(russian[windows[i].begin]) & 0xC0) != 0x80);
+        if (i > 0) ASSERT_GT(windows[i].begin, windows[i - 1].begin);
+    }
+    ASSERT_EQ(windows.back().end, russian.size());
+    
+    LanguageFilterConfig config;
+    config.target_languages = {"en"};
+    config.min_confidence = 0.3;
+    config.segment_languages = true;
+    
+    LanguageFilter filter(config);
+    filter.set_detector(std::make_unique<SimpleLanguageDetector>());
+    
+    Document mixed(english + "\n" + russian, 1);
+    LanguageSegmentation segmentation = filter.segment_languages(mixed);
+    ASSERT_GE(segmentation.spans.size(), 2);
+    ASSERT_EQ(segmentation.spans.front().language, "en");
+    ASSERT_EQ(segmentation.spans.front().begin, 0);
+    ASSERT_EQ(segmentation.spans.back().language, "ru");
+    ASSERT_EQ(segmentation.spans.back().end, mixed.text().size());
+    ASSERT_GT(segmentation.proportions["en"], 0.3);
+    ASSERT_GT(segmentation.proportions["ru"], 0.3);
+    ASSERT_TRUE(segmentation.is_mixed(config.mixed_language_threshold));
+    
+    Document pure(english, 2);
+    ASSERT_FALSE(filter.segment_languages(pure).is_mixed(config.mixed_language_threshold));
+    ASSERT_EQ(filter.segment_languages(pure).dominant_language(), "en");
+    
+    // Mixed documents are rejected unless trimming is enabled
+    std::vector<Document> documents = {mixed, pure};
+    LanguageFilterResult rejected = filter.filter(documents);
+    ASSERT_EQ(rejected.total_kept, 1);
+    ASSERT_EQ(rejected.total_trimmed, 0);
+    
+    config.trim_mixed_documents = true;
+    filter.set_config(config);
+    LanguageFilterResult trimmed = filter.filter(documents);
+    ASSERT_EQ(trimmed.total_kept, 2);
+    ASSERT_EQ(trimmed.total_trimmed, 1);
+    const Document& kept = trimmed.filtered_documents.front();
+    ASSERT_EQ(kept.id(), 1);
+    ASSERT_TRUE(kept.text().find("weather") != std::string::npos);
+    ASSERT_TRUE(kept.text().find("погода") == std::string::npos);
+    ASSERT_GT(kept.text().size(), english.size() / 2);
+    
+    // A document that is not mixed keeps the windows' verdict instead of being detected again
+    auto longest = std::make_shared<size_t>(0);
+    filter.set_detector(std::make_unique<RecordingDetector>(longest));
+    std::vector<Document> pure_only = {pure};
+    LanguageFilterResult windowed = filter.filter(pure_only);
+    ASSERT_EQ(windowed.total_kept, 1);
+    ASSERT_EQ(windowed.language_counts["en"], 1);
+    ASSERT_GT(*longest, 0);
+    ASSERT_LT(*longest, pure.text().size());
+}
+
+void test_sampled_detection() {
+    std::string english;
+    while (english.size() < 200000) english += "The weather is nice today and we are going to the park with our friends. ";
+    std::string numbers;
+    while (numbers.size() < 3000) numbers += "2024-01-01 12:00:00 | 42 | 3.14159 | ";
+    std::string spanish;
+    while (spanish.size() < 100000) spanish += "El tiempo es agradable hoy y vamos a ir al parque con nuestros amigos. ";
+    
+    LanguageFilterConfig config;
+    config.min_confidence = 0.3;
+    config.remove_mixed_language = false;
+    config.sample_bytes = 2048;
+    config.max_samples = 4;
+    
+    LanguageFilter filter(config);
+    filter.set_detector(std::make_unique<SimpleLanguageDetector>());
+    
+    // A confident prefix decides alone
+    Document long_english(english, 1);
+    LanguageDetection prefix = filter.detect_language(long_english);
+    ASSERT_EQ(prefix.language, "en");
+    ASSERT_LE(prefix.bytes_inspected, 2048);
+    
+    // An unsure prefix escalates to strided samples, which agree
+    Document log_then_english(numbers + english, 2);
+    LanguageDetection sampled = filter.detect_language(log_then_english);
+    ASSERT_EQ(sampled.language, "en");
+    ASSERT_GT(sampled.bytes_inspected, 2048);
+    ASSERT_LE(sampled.bytes_inspected, 4 * 2048 + 8);
+    
+    // Disagreeing samples fall back to the full text
+    Document log_then_both(numbers + english + spanish, 3);
+    LanguageDetection full = filter.detect_language(log_then_both);
+    ASSERT_GE(full.bytes_inspected, log_then_both.text().size());
+    
+    // Batch filtering reads the same bytes and reports them
+    std::vector<Document> documents = {long_english, log_then_english, log_then_both};
+    LanguageFilterResult result = filter.filter(documents);
+    ASSERT_EQ(result.total_bytes, english.size() * 3 + numbers.size() * 2 + spanish.size());
+    ASSERT_EQ(result.bytes_inspected, prefix.bytes_inspected + sampled.bytes_inspected + full.bytes_inspected);
+    ASSERT_EQ(result.total_kept, 3);
+    
+    // Without sampling every byte is read
+    config.sample_bytes = 0;
+    filter.set_config(config);
+    ASSERT_EQ(filter.detect_language(long_english).bytes_inspected, english.size());
+    ASSERT_EQ(filter.filter(documents).bytes_inspected, result.total_bytes);
+}
+
 void test_language_statistics() {
     LanguageFilter filter;
     
@@ -298,6 +479,154 @@ void test_edge_cases() {
     ASSERT_EQ(result.total_processed, 1);
 }
 
+void test_parallel_batch_matches_serial() {
+    std::vector<std::string> sample_texts = {
+        "This is an English document with common English words and phrases.",
+        "Este es un documento en español con palabras y frases comunes en español.",
+        "Short",
+        "Ceci est un document français avec des mots et phrases français communs.",
+        "Dies ist ein deutsches Dokument mit gemeinsamen deutschen Wörtern und Phrasen."
+    };
+    
+    std::vector<Document> documents;
+    std::vector<std::string> texts;
+    for (int i = 0; i < 500; ++i) {
+        documents.emplace_back(sample_texts[i % sample_texts.size()], i);
+        texts.push_back(sample_texts[i % sample_texts.size()]);
+    }
+    
+    // Batches keep input order
+    SimpleLanguageDetector detector;
+    std::vector<LanguageDetection> batch = detector.detect_batch(texts);
+    ASSERT_EQ(batch.size(), texts.size());
+    for (size_t i = 0; i < texts.size(); ++i) {
+        LanguageDetection single = detector.detect(texts[i]);
+        ASSERT_EQ(batch[i].language, single.language);
+        ASSERT_EQ(batch[i].confidence, single.confidence);
+    }
+    
+    LanguageFilterConfig serial_config;
+    serial_config.target_languages = {"en", "es"};
+    serial_config.min_confidence = 0.1;
+    serial_config.enable_parallel_processing = false;
+    
+    LanguageFilterConfig parallel_config = serial_config;
+    parallel_config.enable_parallel_processing = true;
+    parallel_config.batch_size = 64;  // Several batches
+    
+    LanguageFilterResult serial = LanguageFilter(serial_config).filter(documents);
+    LanguageFilterResult parallel = LanguageFilter(parallel_config).filter(documents);
+    
+    ASSERT_EQ(parallel.total_kept, serial.total_kept);
+    ASSERT_EQ(parallel.total_rejected, serial.total_rejected);
+    ASSERT_TRUE(parallel.language_counts == serial.language_counts);
+    ASSERT_EQ(parallel.filtered_documents.size(), serial.filtered_documents.size());
+    for (size_t i = 0; i < serial.filtered_documents.size(); ++i) {
+        ASSERT_EQ(parallel.filtered_documents[i].id(), serial.filtered_documents[i].id());
+    }
+}
+
+void test_ngram_language_model() {
+    const std::string corpus_path = "test_langid_corpus.txt";
+    const std::string model_path = "test_langid_model.bin";
+    {
+        std::ofstream corpus(corpus_path);
+        corpus << "__label__en The weather is nice today and we are going to the park.\n"
+               << "__label__en She reads a book every evening before going to sleep.\n"
+               << "__label__en This house has three bedrooms and a small garden.\n"
+               << "__label__en They were talking about the news with their friends.\n"
+               << "__label__es El tiempo es agradable hoy y vamos a ir al parque.\n"
+               << "__label__es Ella lee un libro todas las noches antes de dormir.\n"
+               << "__label__es Esta casa tiene tres habitaciones y un jardín pequeño.\n"
+               << "__label__es Ellos estaban hablando de las noticias con sus amigos.\n"
+               << "de\tDas Wetter ist heute schön und wir gehen in den Park.\n"
+               << "de\tSie liest jeden Abend ein Buch, bevor sie schlafen geht.\n"
+               << "de\tDieses Haus hat drei Schlafzimmer und einen kleinen Garten.\n"
+               << "de\tSie haben mit ihren Freunden über die Nachrichten gesprochen.\n"
+               << "ru\tСегодня хорошая погода, и мы идём в парк.\n"
+               << "ru\tОна читает книгу каждый вечер перед сном.\n"
+               << "ru\tВ этом доме три спальни и маленький сад.\n"
+               << "ru\tОни говорили о новостях со своими друзьями.\n"
+               << "unlabeled line is skipped\n";
+    }
+    
+    LanguageModelTrainingConfig config;
+    config.bucket_bits = 14;
+    config.epochs = 50;
+    CharNGramModelTrainer trainer(config);
+    ASSERT_EQ(trainer.add_corpus(corpus_path), 16);
+    ASSERT_EQ(trainer.num_languages(), 4);
+    
+    CharNGramLanguageModel trained = trainer.train();
+    trained.save(model_path);
+    
+    // The saved model is mapped back and predicts exactly like the trained one
+    CharNGramLanguageModel loaded;
+    loaded.load(model_path);
+    ASSERT_EQ(loaded.num_languages(), 4);
+    ASSERT_EQ(loaded.bucket_bits(), 14);
+    
+    std::vector<std::pair<std::string, std::string>> held_out = {
+        {"en", "We are going to read the news in the garden this evening."},
+        {"es", "Vamos a leer las noticias en el jardín esta noche."},
+        {"de", "Wir lesen heute Abend die Nachrichten im Garten."},
+        {"ru", "Сегодня вечером мы читаем новости в саду."}
+    };
+    for (const auto& [language, text] : held_out) {
+        auto expected = trained.predict(text);
+        auto actual = loaded.predict(text);
+        ASSERT_EQ(actual.language, expected.language);
+        ASSERT_EQ(actual.probability, expected.probability);
+        ASSERT_EQ(loaded.language(actual.language), language);
+    }
+    
+    // Text without letters has no features
+    ASSERT_EQ(loaded.predict("12345 !!! ...").features, 0);
+    
+    CharNGramLanguageDetector detector(model_path);
+    ASSERT_TRUE(detector.is_ready());
+    ASSERT_EQ(detector.get_supported_languages().size(), 4);
+    ASSERT_EQ(detector.detect("Ella lee las noticias con sus amigos.").language, "es");
+    ASSERT_EQ(detector.detect("").language, "unknown");
+    
+    // Sliding windows reuse one feature pass and agree with scoring each window alone
+    std::string mixed;
+    for (int i = 0; i < 4; ++i) mixed += held_out[0].second + " ";
+    for (int i = 0; i < 4; ++i) mixed += held_out[3].second + " ";
+    auto windows = detector.detect_windows(mixed, 64, 32);
+    auto separate = detector.LanguageDetector::detect_windows(mixed, 64, 32);
+    ASSERT_EQ(windows.size(), separate.size());
+    ASSERT_EQ(windows.front().begin, 0);
+    ASSERT_EQ(windows.back().end, mixed.size());
+    ASSERT_EQ(windows.front().language, "en");
+    ASSERT_EQ(windows.back().language, "ru");
+    ASSERT_EQ(separate.front().language, "en");
+    ASSERT_EQ(separate.back().language, "ru");
+    
+    // A corrupt file is rejected, leaving the detector unready
+    {
+        std::ofstream corrupt(model_path, std::ios::binary | std::ios::trunc);
+        corrupt << "RSLANGID but truncated";
+    }
+    ASSERT_THROWS(loaded.load(model_path), std::runtime_error);
+    CharNGramLanguageDetector unready(model_path);
+    ASSERT_FALSE(unready.is_ready());
+    
+    std::remove(corpus_path.c_str());
+    std::remove(model_path.c_str());
+    
+    // Throughput on the in-memory model
+    std::string text;
+    while (text.size() < (8u << 20)) text += held_out[text.size() % held_out.size()].second + " ";
+    auto start = std::chrono::high_resolution_clock::now();
+    auto prediction = trained.predict(text);
+    auto end = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    ASSERT_GT(prediction.features, 0);
+    std::cout << "  N-gram language ID: " << (text.size() / (1024.0 * 1024.0)) / seconds << " MB/s per thread"
+              << std::endl;
+}
+
 void test_performance_benchmark() {
     LanguageFilter filter;
     
@@ -337,6 +666,7 @@ int main() {
     TestSuite suite("Language Filter Tests");
     
     suite.add_test("Simple language detector", test_simple_language_detector);
+    suite.add_test("Simple detector scripts", test_simple_detector_scripts);
     suite.add_test("FastText detector fallback", test_fasttext_detector_fallback);
     suite.add_test("Language filter configuration", test_language_filter_config);
     suite.add_test("Basic language filtering", test_basic_language_filtering);
@@ -344,10 +674,14 @@ int main() {
     suite.add_test("Minimum text length filtering", test_minimum_text_length_filtering);
     suite.add_test("Confidence threshold filtering", test_confidence_threshold_filtering);
     suite.add_test("Multilingual document handling", test_multilingual_document_handling);
+    suite.add_test("Sliding-window language segmentation", test_language_segmentation);
+    suite.add_test("Sampled detection with escalation", test_sampled_detection);
     suite.add_test("Language statistics", test_language_statistics);
     suite.add_test("Language utilities", test_language_utilities);
     suite.add_test("Filter with progress callback", test_filter_with_progress_callback);
     suite.add_test("Edge cases", test_edge_cases);
+    suite.add_test("Parallel batch matches serial", test_parallel_batch_matches_serial);
+    suite.add_test("N-gram language model", test_ngram_language_model);
     suite.add_test("Performance benchmark", test_performance_benchmark);
     
     suite.run_all();
@@ -1,8 +1,16 @@
 #include "test_framework.hpp"
 #include "rapidsift/text_extractor.hpp"
+#include "rapidsift/warc_reader.hpp"
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include <random>
+#include <regex>
+#include <chrono>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 // Template specialization for ContentType
 namespace test_framework {
@@ -164,6 +172,252 @@ void test_html_parser_basic() {
     std::cout << "✓ HTML parser basic functionality test passed" << std::endl;
 }
 
+void test_flat_dom_parser() {
+    std::cout << "Testing flat DOM parser..." << std::endl;
+    
+    std::string html = "<!DOCTYPE html><!-- note <p>not a node</p> -->"
+                       "<HTML><body class=\"Main Page\" data-x=1>"
+                       "<p>First<br/>line<p>Second <A HREF='/next'>link</A>"
+                       "<script>if (a < b) { x = '</p>'; }</script>"
+                       "<ul><li>one<li>two</ul></body></html>";
+    
+    FlatHtmlDocument document;
+    HtmlParser::parse_flat(html, document);
+    
+    ASSERT_EQ(document.node(document.root()).tag, "document");
+    ASSERT_EQ(document.node(document.root()).end, document.size());
+    
+    // Collect elements by tag; text and attribute values point into the source
+    std::vector<uint32_t> paragraphs, items;
+    uint32_t html_node = FlatHtmlDocument::NO_NODE, body = FlatHtmlDocument::NO_NODE;
+    uint32_t link = FlatHtmlDocument::NO_NODE, script = FlatHtmlDocument::NO_NODE;
+    for (uint32_t i = 0; i < document.size(); ++i) {
+        const FlatHtmlNode& node = document.node(i);
+        if (node.tag == "html") html_node = i;
+        if (node.tag == "body") body = i;
+        if (node.tag == "a") link = i;
+        if (node.tag == "script") script = i;
+        if (node.tag == "p") paragraphs.push_back(i);
+        if (node.tag == "li") items.push_back(i);
+        if (node.is_text()) {
+            ASSERT_TRUE(node.text.data() >= html.data() && node.text.data() + node.text.size() <= html.data() + html.size());
+        }
+    }
+    
+    // Comments and the doctype make no nodes; upper-case names are lowered
+    ASSERT_TRUE(html_node != FlatHtmlDocument::NO_NODE);
+    ASSERT_EQ(document.first_child(document.root()), html_node);
+    ASSERT_EQ(document.next_sibling(html_node), FlatHtmlDocument::NO_NODE);
+    ASSERT_EQ(document.attribute(body, "class"), "Main Page");
+    ASSERT_EQ(document.attribute(body, "data-x"), "1");
+    ASSERT_TRUE(document.has_class(body, "Main"));
+    ASSERT_FALSE(document.has_attribute(body, "id"));
+    ASSERT_EQ(document.attribute(link, "href"), "/next");
+    
+    // The second <p> closes the first; <br/> takes no children
+    ASSERT_EQ(paragraphs.size(), 2);
+    ASSERT_EQ(document.node(paragraphs[0]).parent, body);
+    ASSERT_EQ(document.node(paragraphs[1]).parent, body);
+    ASSERT_EQ(document.text_content(paragraphs[0]), "Firstline");
+    ASSERT_EQ(document.node(link).parent, paragraphs[1]);
+    
+    // Script content is one raw text node, even with markup inside
+    ASSERT_EQ(document.text_content(script), "if (a < b) { x = '</p>'; }");
+    
+    // <li> closes the previous <li>
+    ASSERT_EQ(items.size(), 2);
+    ASSERT_EQ(document.node(items[0]).parent, document.node(items[1]).parent);
+    ASSERT_EQ(document.text_content(items[1]), "two");
+    
+    // Reuse after clear keeps working
+    document.clear();
+    HtmlParser::parse_flat("plain <b>bold</b>", document);
+    ASSERT_EQ(document.text_content(document.root()), "plain bold");
+    
+    // The tree parser no longer hangs on doctypes and comments
+    HtmlParser parser("<!DOCTYPE html><!-- c --><html><body>ok</body></html>");
+    auto root = parser.parse();
+    ASSERT_EQ(root->children.size(), 1);
+    ASSERT_EQ(root->children[0]->tag, "html");
+    
+    // Both DOMs extract the main content
+    TextExtractionConfig tree_config;
+    tree_config.use_flat_dom = false;
+    TextExtractor tree_extractor(tree_config);
+    TextExtractor flat_extractor;
+    auto tree_result = tree_extractor.extract(COMPLEX_HTML);
+    auto flat_result = flat_extractor.extract(COMPLEX_HTML);
+    ASSERT_TRUE(tree_result.extracted_text.find("main content paragraph") != std::string::npos);
+    ASSERT_TRUE(flat_result.extracted_text.find("main content paragraph") != std::string::npos);
+    ASSERT_TRUE(flat_result.extracted_text.find("Article Title") != std::string::npos);
+    
+    std::cout << "✓ Flat DOM parser test passed" << std::endl;
+}
+
+void test_html_parser_malformed() {
+    std::cout << "Testing HTML parser on malformed nesting..." << std::endl;
+    
+    // Implied end tags: cells, rows, list items and paragraphs close without end tags
+    HtmlParser table_parser("<table><tr><td>a<td>b<tr><td><p>c<div>d</div></table>"
+                            "<ul><li>one<ul><li>inner</ul><li>two</ul>");
+    auto root = table_parser.parse();
+    ASSERT_EQ(root->children.size(), 2);
+    auto table = root->children[0];
+    ASSERT_EQ(table->children.size(), 2);
+    ASSERT_EQ(table->children[0]->tag, "tr");
+    ASSERT_EQ(table->children[0]->children.size(), 2);
+    ASSERT_EQ(table->children[0]->children[1]->text, "b");
+    auto last_cell = table->children[1]->children[0];
+    ASSERT_EQ(last_cell->children.size(), 2);     // <div> closed the <p>
+    ASSERT_EQ(last_cell->children[0]->tag, "p");
+    ASSERT_EQ(last_cell->children[1]->tag, "div");
+    auto list = root->children[1];
+    ASSERT_EQ(list->children.size(), 2);          // The nested list's <li> did not close the outer one
+    ASSERT_EQ(list->children[0]->children[0]->children[0]->text, "inner");
+    ASSERT_EQ(list->children[1]->text, "two");
+    
+    // Stray end tags are ignored rather than read as text
+    HtmlParser stray_parser("<div>keep</span></p>this</div>");
+    root = stray_parser.parse();
+    ASSERT_EQ(root->children.size(), 1);
+    ASSERT_EQ(root->children[0]->text, "keepthis");
+    
+    // Unclosed tags nest only down to the depth cap, and text past it is kept
+    std::string deep;
+    for (int i = 0; i < 100000; ++i) deep += "<div><span>";
+    deep += "bottom";
+    HtmlParser deep_parser(deep, 64);
+    root = deep_parser.parse();
+    size_t depth = 0;
+    auto node = root;
+    while (!node->children.empty()) {
+        ASSERT_EQ(node->children.size(), 1);
+        node = node->children[0];
+        depth++;
+    }
+    ASSERT_EQ(depth, 64);
+    ASSERT_EQ(node->text, "bottom");
+    
+    FlatHtmlDocument document;
+    HtmlParser::parse_flat(deep, document, 64);
+    ASSERT_EQ(document.size(), 66);               // Root, 64 elements, one text node
+    ASSERT_EQ(document.text_content(document.root()), "bottom");
+    
+    // End tags of dropped elements close them, not the deepest kept element of the same name
+    const std::string capped = "<div><div><div>x</div>y</div><b>after</b></div><p>z</p>";
+    HtmlParser capped_parser(capped, 2);
+    root = capped_parser.parse();
+    ASSERT_EQ(root->children.size(), 2);
+    auto outer = root->children[0];
+    ASSERT_EQ(outer->text, "");
+    ASSERT_EQ(outer->children.size(), 2);
+    ASSERT_EQ(outer->children[0]->text, "xy");
+    ASSERT_EQ(outer->children[1]->tag, "b");
+    ASSERT_EQ(root->children[1]->tag, "p");
+    
+    HtmlParser::parse_flat(capped, document, 2);
+    uint32_t outer_node = document.first_child(document.root());
+    uint32_t inner_node = document.first_child(outer_node);
+    ASSERT_EQ(document.node(inner_node).tag, "div");
+    ASSERT_EQ(document.text_content(inner_node), "xy");
+    ASSERT_EQ(document.node(document.next_sibling(inner_node)).tag, "b");
+    ASSERT_EQ(document.node(document.next_sibling(outer_node)).tag, "p");
+    
+    // All three extraction paths survive the adversarial page
+    for (int mode = 0; mode < 3; ++mode) {
+        TextExtractionConfig config;
+        config.use_flat_dom = mode == 1;
+        config.streaming_extraction = mode == 2;
+        TextExtractor extractor(config);
+        auto result = extractor.extract(deep + "</span></div>");
+        ASSERT_TRUE(result.extracted_text.find("bottom") != std::string::npos);
+    }
+    
+    // Tags past the cap cost O(1) each: quadrupling the page at most roughly quadruples the time
+    auto past_cap = [](size_t n, const std::string& tail) {
+        std::string html;
+        for (size_t i = 0; i < n; ++i) html += "<span>";
+        for (size_t i = 0; i < n; ++i) html += tail;
+        return html;
+    };
+    for (const std::string tail : {"<div>x</div>", "</b>"}) {
+        for (int mode = 0; mode < 3; ++mode) {
+            TextExtractionConfig config;
+            config.use_flat_dom = mode == 1;
+            config.streaming_extraction = mode == 2;
+            TextExtractor extractor(config);
+            auto time_ms = [&](size_t n) {
+                std::string html = past_cap(n, tail);
+                auto start = std::chrono::steady_clock::now();
+                extractor.extract(html);
+                return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            };
+            double small_ms = time_ms(10000);
+            double large_ms = time_ms(40000);
+            ASSERT_LT(large_ms, 8 * small_ms + 100);
+        }
+    }
+    
+    std::cout << "✓ HTML parser malformed nesting test passed" << std::endl;
+}
+
+void test_streaming_extraction() {
+    std::cout << "Testing streaming extraction..." << std::endl;
+    
+    TextExtractionConfig config;
+    config.streaming_extraction = true;
+    config.preserve_headings = true;
+    config.preserve_links = true;
+    TextExtractor extractor(config);
+    
+    auto result = extractor.extract(COMPLEX_HTML, "http://complex.com");
+    ASSERT_TRUE(result.is_valid());
+    ASSERT_EQ(result.title, "Complex Test Page");
+    ASSERT_EQ(result.url, "http://complex.com");
+    ASSERT_TRUE(result.extracted_text.find("Article Title") != std::string::npos);
+    ASSERT_TRUE(result.extracted_text.find("main content paragraph") != std::string::npos);
+    ASSERT_TRUE(result.extracted_text.find("More detailed content") != std::string::npos);
+    
+    // Script, style, navigation, sidebar and footer subtrees are skipped
+    ASSERT_TRUE(result.extracted_text.find("console.log") == std::string::npos);
+    ASSERT_TRUE(result.extracted_text.find("margin") == std::string::npos);
+    ASSERT_TRUE(result.extracted_text.find("Home") == std::string::npos);
+    ASSERT_TRUE(result.extracted_text.find("Advertisement content") == std::string::npos);
+    ASSERT_TRUE(result.extracted_text.find("All rights reserved") == std::string::npos);
+    
+    // One line per block; headings are collected as they stream by
+    ASSERT_EQ(result.headings.size(), 2);
+    ASSERT_EQ(result.headings[0], "Article Title");
+    ASSERT_EQ(result.headings[1], "Subsection");
+    ASSERT_TRUE(result.extracted_text.find("Article Title\nThis is the main content") != std::string::npos);
+    
+    // Link-dominated blocks are dropped, entities decoded, links kept from kept blocks
+    std::string html = "<html><body>"
+                       "<div><a href=\"/a\">One</a> <a href=\"/b\">Two</a> <a href=\"/c\">Three</a></div>"
+                       "<P>Fish &amp; chips are served <A href=\"/menu\">daily</A> at the harbour.</P>"
+                       "<div class=\"cookie-banner\"><p>We use cookies.</p></div>"
+                       "<p>Unclosed paragraph<p>Second paragraph</body></html>";
+    result = extractor.extract(html);
+    ASSERT_EQ(result.extracted_text,
+              "Fish & chips are served daily at the harbour.\nUnclosed paragraph\nSecond paragraph");
+    ASSERT_EQ(result.link_count, 1);
+    ASSERT_EQ(result.links.size(), 1);
+    ASSERT_EQ(result.links[0], "/menu");
+    
+    // Agrees with the DOM extractors on the sample pages
+    TextExtractor dom_extractor;
+    for (const auto& page : {SIMPLE_HTML, BOILERPLATE_HTML, MALFORMED_HTML}) {
+        auto streamed = extractor.extract(page);
+        auto parsed = dom_extractor.extract(page);
+        ASSERT_EQ(streamed.is_valid(), parsed.is_valid());
+        ASSERT_TRUE(streamed.extracted_text_length > 0);
+    }
+    ASSERT_TRUE(extractor.extract(BOILERPLATE_HTML).extracted_text.find("cookie") == std::string::npos);
+    ASSERT_TRUE(extractor.extract(MALFORMED_HTML).extracted_text.find("Text content mixed in") != std::string::npos);
+    
+    std::cout << "✓ Streaming extraction test passed" << std::endl;
+}
+
 void test_title_extraction() {
     std::cout << "Testing title extraction..." << std::endl;
     
@@ -193,6 +447,70 @@ void test_meta_extraction() {
     std::cout << "✓ Meta tag extraction test passed" << std::endl;
 }
 
+void test_metadata_from_parse() {
+    std::cout << "Testing metadata gathered during the parse..." << std::endl;
+    
+    std::string html = "<!DOCTYPE html><HTML LANG=\"pt-BR\"><head>"
+                       "<meta http-equiv=\"Content-Type\" content=\"text/html; charset=ISO-8859-1\">"
+                       "<Meta Name=\"Description\" content=\"About us\"><meta property=\"og:title\" content=\"OG\">"
+                       "<title>Caf&eacute; <b>Central</b></title>"
+                       "<script>var t = '<title>not this</title><meta name=description content=x>';</script>"
+                       "</head><body><svg><title>Icon</title></svg><p>Body text here</p></body></html>";
+    
+    HtmlMetadata expected;
+    expected.title = "Caf&eacute; ";
+    expected.language = "pt-BR";
+    expected.charset = "iso-8859-1";
+    
+    // The tree parser, the flat parser and streaming extraction all collect the same fields
+    HtmlParser parser(html);
+    parser.parse();
+    FlatHtmlDocument document;
+    HtmlParser::parse_flat(html, document);
+    for (const HtmlMetadata* metadata : {&parser.metadata(), &document.metadata()}) {
+        ASSERT_EQ(metadata->title, expected.title);
+        ASSERT_EQ(metadata->language, expected.language);
+        ASSERT_EQ(metadata->charset, expected.charset);
+        ASSERT_EQ(metadata->meta.size(), 3);
+        ASSERT_EQ(metadata->meta.at("description"), "About us");
+        ASSERT_EQ(metadata->meta.at("og:title"), "OG");
+    }
+    
+    for (int mode = 0; mode < 3; ++mode) {
+        TextExtractionConfig config;
+        config.use_flat_dom = mode == 1;
+        config.streaming_extraction = mode == 2;
+        config.auto_detect_encoding = false;
+        TextExtractor extractor(config);
+        auto result = extractor.extract(html);
+        ASSERT_EQ(result.title, "Caf\xC3\xA9");
+        ASSERT_EQ(result.language, "pt-BR");
+        ASSERT_EQ(result.encoding, "iso-8859-1");
+        ASSERT_EQ(result.metadata.at("description"), "About us");
+    }
+    
+    // A meta language tag stands in for a missing lang attribute; an unclosed title ends at the next tag
+    document.clear();
+    HtmlParser::parse_flat("<head><title>Open<body><meta name=language content=de>", document);
+    ASSERT_EQ(document.metadata().title, "Open");
+    ASSERT_EQ(document.metadata().language, "de");
+    ASSERT_TRUE(document.metadata().charset.empty());
+    
+    // The standalone helpers scan tokens the same way
+    ASSERT_EQ(HtmlParser::extract_title(html), "Caf&eacute; ");
+    ASSERT_EQ(HtmlParser::extract_meta_content(html, "DESCRIPTION"), "About us");
+    ASSERT_EQ(HtmlParser::extract_meta_tags(html).size(), 4);    // The one in the script too
+    ASSERT_EQ(extraction_utils::extract_lang_attribute(html), "pt-BR");
+    
+    // Head elements ahead of <html> do not hide its lang; body content does
+    ASSERT_EQ(extraction_utils::detect_language_from_html(
+        "<meta charset=utf-8><link rel=icon href=x.ico><html lang=fr><body>Bonjour</body></html>"), "fr");
+    ASSERT_EQ(extraction_utils::detect_language_from_html("<head><title>t</title></head><html lang=it>"), "it");
+    ASSERT_EQ(extraction_utils::detect_language_from_html("<p>quote <html lang=de></p>"), "");
+    
+    std::cout << "✓ Metadata from parse test passed" << std::endl;
+}
+
 void test_encoding_detection() {
     std::cout << "Testing encoding detection..." << std::endl;
     
@@ -207,6 +525,151 @@ void test_encoding_detection() {
     std::cout << "✓ Encoding detection test passed" << std::endl;
 }
 
+// Straightforward decoder used as the reference for the SIMD validator
+bool reference_valid_utf8(const std::string& text) {
+    size_t i = 0;
+    while (i < text.size()) {
+        unsigned char c = text[i];
+        size_t length = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 0;
+        if (length == 0 || i + length > text.size()) return false;
+        uint32_t code_point = length == 1 ? c : c & (0x7F >> length);
+        for (size_t k = 1; k < length; ++k) {
+            unsigned char next = text[i + k];
+            if ((next & 0xC0) != 0x80) return false;
+            code_point = (code_point << 6) | (next & 0x3F);
+        }
+        static const uint32_t MIN_CODE_POINT[] = {0, 0, 0x80, 0x800, 0x10000};
+        if (code_point < MIN_CODE_POINT[length] || code_point > 0x10FFFF ||
+            (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+            return false;
+        }
+        i += length;
+    }
+    return true;
+}
+
+void test_utf8_validation() {
+    std::cout << "Testing UTF-8 validation..." << std::endl;
+    
+    using extraction_utils::is_valid_utf8;
+    
+    ASSERT_TRUE(is_valid_utf8(""));
+    ASSERT_TRUE(is_valid_utf8("plain ASCII"));
+    ASSERT_TRUE(is_valid_utf8("caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80"));
+    ASSERT_FALSE(is_valid_utf8("\xC0\xAF"));            // Overlong '/'
+    ASSERT_FALSE(is_valid_utf8("\xE0\x80\xAF"));        // Overlong three-byte
+    ASSERT_FALSE(is_valid_utf8("\xED\xA0\x80"));        // Surrogate
+    ASSERT_FALSE(is_valid_utf8("\xF4\x90\x80\x80"));    // Past U+10FFFF
+    ASSERT_FALSE(is_valid_utf8("\x80"));                // Stray continuation
+    ASSERT_FALSE(is_valid_utf8("caf\xE9"));             // Latin-1
+    ASSERT_FALSE(is_valid_utf8("\xE2\x82"));            // Truncated
+    
+    // Sequences straddling the 32-byte SIMD blocks, and a truncated one at the end
+    std::string long_text(61, 'a');
+    long_text += "\xF0\x9F\x98\x80";
+    long_text += std::string(100, 'b');
+    ASSERT_TRUE(is_valid_utf8(long_text));
+    ASSERT_FALSE(is_valid_utf8(long_text + "\xF0\x9F\x98"));
+    ASSERT_FALSE(is_valid_utf8(long_text.substr(0, 63)));
+    
+    // Random mutations of valid text, long enough for the vector path
+    const char* pieces[] = {"a", " ", "\xC3\xA9", "\xD0\x96", "\xE2\x82\xAC", "\xE6\x97\xA5",
+                            "\xEF\xBF\xBD", "\xF0\x9F\x98\x80", "\xF4\x8F\xBF\xBF"};
+    std::mt19937 rng(47);
+    for (int trial = 0; trial < 3000; ++trial) {
+        std::string text;
+        size_t pieces_count = rng() % 120;
+        for (size_t i = 0; i < pieces_count; ++i) {
+            text += pieces[rng() % 9];
+        }
+        if (!text.empty() && trial % 3 != 0) {
+            for (int edit = rng() % 3; edit >= 0; --edit) {
+                text[rng() % text.size()] = static_cast<char>(rng() % 256);
+            }
+        }
+        ASSERT_EQ(is_valid_utf8(text), reference_valid_utf8(text));
+    }
+    
+    std::cout << "✓ UTF-8 validation test passed" << std::endl;
+}
+
+void test_charset_transcoding() {
+    std::cout << "Testing charset transcoding..." << std::endl;
+    
+    using extraction_utils::sniff_charset;
+    using extraction_utils::transcode_to_utf8;
+    
+    // Sniffing: BOM, meta charset, http-equiv content, XML declaration
+    ASSERT_EQ(sniff_charset("\xEF\xBB\xBF<p>x</p>"), "utf-8");
+    ASSERT_EQ(sniff_charset("<html><head><META CharSet='Shift_JIS'>"), "shift_jis");
+    ASSERT_EQ(sniff_charset(R"(<meta http-equiv="Content-Type" content="text/html; charset=ISO8859-2">)"), "iso-8859-2");
+    ASSERT_EQ(sniff_charset(R"(<?xml version="1.0" encoding="windows-1251"?><rss>)"), "windows-1251");
+    ASSERT_EQ(sniff_charset("<p>Set charset=koi8-r in your editor</p>"), "");   // Text, not a tag
+    ASSERT_EQ(sniff_charset(std::string(5000, ' ') + "<meta charset=gbk>"), "");  // Past the sniffed prefix
+    
+    auto transcode = [](const std::string& content, const std::string& default_encoding = "utf-8") {
+        std::string out;
+        return transcode_to_utf8(content, out, default_encoding) ? out : content;
+    };
+    
+    // Declared legacy charsets
+    ASSERT_EQ(transcode("<meta charset=windows-1252>\x93" "Caf\xE9\x94 \x96 \x80" "5"),
+              "<meta charset=windows-1252>\xE2\x80\x9C" "Caf\xC3\xA9\xE2\x80\x9D \xE2\x80\x93 \xE2\x82\xAC" "5");
+    ASSERT_EQ(transcode("<meta charset=\"iso-8859-2\">Za\xBF\xF3\xB3\xE6"),
+              "<meta charset=\"iso-8859-2\">Za\xC5\xBC\xC3\xB3\xC5\x82\xC4\x87");
+    ASSERT_EQ(transcode("<meta charset=koi8-r>\xF0\xD2\xC9\xD7\xC5\xD4"),
+              "<meta charset=koi8-r>\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82");
+    ASSERT_EQ(transcode("\xCF\xF0\xE8\xE2\xE5\xF2", "windows-1251"),
+              "\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82");
+    ASSERT_EQ(transcode("<meta charset=shift_jis>\x93\xFA\x96\x7B\x8C\xEA\x83\x65\x83\x4C\x83\x58\x83\x67 \xB6\xC0"),
+              "<meta charset=shift_jis>\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E\xE3\x83\x86\xE3\x82\xAD\xE3\x82\xB9"
+              "\xE3\x83\x88 \xEF\xBD\xB6\xEF\xBE\x80");
+    ASSERT_EQ(transcode("<meta charset=gb2312>\xD6\xD0\xCE\xC4\xCD\xF8\xD2\xB3"),
+              "<meta charset=gb2312>\xE4\xB8\xAD\xE6\x96\x87\xE7\xBD\x91\xE9\xA1\xB5");
+    
+    // Unmapped double-byte pairs become U+FFFD without swallowing ASCII
+    ASSERT_EQ(transcode("<meta charset=sjis>\x85<p>"), "<meta charset=sjis>\xEF\xBF\xBD<p>");
+    
+    // Valid UTF-8 is used in place, even under a legacy label
+    std::string out = "untouched";
+    ASSERT_FALSE(transcode_to_utf8("<meta charset=iso-8859-1>caf\xC3\xA9", out, "utf-8"));
+    ASSERT_FALSE(transcode_to_utf8("plain ascii", out, "shift_jis"));
+    ASSERT_EQ(out, "untouched");
+    
+    // BOMs are dropped; UTF-16 is decoded; stray bytes in UTF-8 read as windows-1252
+    ASSERT_EQ(transcode("\xEF\xBB\xBFhi"), "hi");
+    ASSERT_EQ(transcode(std::string("\xFF\xFEh\0i\0\x3D\xD8\x00\xDE", 10)), "hi\xF0\x9F\x98\x80");
+    ASSERT_EQ(transcode("caf\xC3\xA9 caf\xE9"), "caf\xC3\xA9 caf\xC3\xA9");
+    
+    ASSERT_EQ(extraction_utils::convert_encoding("\xE9t\xE9", "latin1", "UTF-8"), "\xC3\xA9t\xC3\xA9");
+    ASSERT_EQ(extraction_utils::detect_encoding("caf\xC3\xA9"), "utf-8");
+    ASSERT_EQ(extraction_utils::detect_encoding("caf\xE9"), "windows-1252");
+    ASSERT_EQ(extraction_utils::detect_encoding("cafe"), "ascii");
+    bool threw = false;
+    try {
+        extraction_utils::convert_encoding("x", "ebcdic", "utf-8");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    ASSERT_TRUE(threw);
+    
+    // Mojibake: two- and three-byte characters decoded as windows-1252
+    ASSERT_EQ(extraction_utils::fix_mojibake("Caf\xC3\x83\xC2\xA9 \xC3\xA2\xE2\x82\xAC\xE2\x84\xA2 \xC3\x82\xC2\xA3" "5"),
+              "Caf\xC3\xA9 \xE2\x80\x99 \xC2\xA3" "5");
+    ASSERT_EQ(extraction_utils::fix_mojibake("\xC3\x83 la"), "\xC3\xA0la");
+    ASSERT_EQ(extraction_utils::fix_mojibake("S\xC3\xA3o \xC3\x83x"), "S\xC3\xA3o \xC3\x83x");   // Nothing to fold
+    
+    // Extraction decodes the page before parsing it
+    TextExtractor extractor;
+    auto result = extractor.extract("<html><head><meta charset=\"windows-1251\"><title>\xCF\xF0\xE8\xE2\xE5\xF2</title></head>"
+                                    "<body><p>\xCF\xF0\xE8\xE2\xE5\xF2 \xEC\xE8\xF0</p></body></html>");
+    ASSERT_EQ(result.title, "\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82");
+    ASSERT_TRUE(result.extracted_text.find("\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82 \xD0\xBC\xD0\xB8\xD1\x80") !=
+                std::string::npos);
+    
+    std::cout << "✓ Charset transcoding test passed" << std::endl;
+}
+
 void test_boilerplate_detection() {
     std::cout << "Testing boilerplate detection..." << std::endl;
     
@@ -236,6 +699,101 @@ void test_boilerplate_detection() {
     std::cout << "✓ Boilerplate detection test passed" << std::endl;
 }
 
+void test_block_classifier() {
+    std::cout << "Testing block classifier..." << std::endl;
+    
+    std::string html = "<html><head><title>t</title><script>var x;</script></head><body>"
+                       "<header class=\"masthead\"><p>Site name</p></header>"
+                       "<nav><ul><li><a href=\"/\">Home</a></li><li><a href=\"/a\">About</a></li></ul></nav>"
+                       "<article><h1>The headline</h1>"
+                       "<p>The river was quiet in the morning and the boats were all in the harbour.</p>"
+                       "<p>See <a href=\"/more\">more</a> of it.</p></article>"
+                       "<div class=\"sidebar-ad\"><p>Buy now and save on everything.</p></div>"
+                       "<footer><p>Copyright 2024. All rights reserved.</p></footer>"
+                       "</body></html>";
+    
+    FlatHtmlDocument document;
+    HtmlParser::parse_flat(html, document);
+    BlockClassifier classifier;
+    
+    std::vector<BlockFeatures> blocks;
+    classifier.compute_features(document, blocks);
+    
+    // One block per text-holding block element, in document order; script
+    // and title text makes none
+    std::vector<std::string> tags;
+    for (const auto& block : blocks) tags.emplace_back(document.node(block.node).tag);
+    ASSERT_EQ(tags.size(), 8);
+    ASSERT_EQ(tags[0], "p");
+    ASSERT_EQ(tags[1], "li");
+    ASSERT_EQ(tags[3], "h1");
+    
+    const BlockFeatures& masthead = blocks[0];
+    const BlockFeatures& nav_item = blocks[1];
+    const BlockFeatures& headline = blocks[3];
+    const BlockFeatures& story = blocks[4];
+    const BlockFeatures& see_more = blocks[5];
+    const BlockFeatures& ad = blocks[6];
+    const BlockFeatures& footer = blocks[7];
+    
+    ASSERT_EQ(masthead.values[BlockFeatures::IN_HEADER_FOOTER], 1.0f);
+    ASSERT_EQ(masthead.values[BlockFeatures::AD_CLASSES], 0.0f);   // "masthead" is not "ad"
+    ASSERT_EQ(nav_item.values[BlockFeatures::IN_NAV], 1.0f);
+    ASSERT_EQ(nav_item.values[BlockFeatures::IN_LIST], 1.0f);
+    ASSERT_EQ(nav_item.values[BlockFeatures::LINK_RATIO], 1.0f);
+    ASSERT_EQ(headline.values[BlockFeatures::IS_HEADING], 1.0f);
+    ASSERT_EQ(story.values[BlockFeatures::IN_ARTICLE], 1.0f);
+    ASSERT_EQ(story.values[BlockFeatures::IS_PARAGRAPH], 1.0f);
+    ASSERT_EQ(story.values[BlockFeatures::ENDS_SENTENCE], 1.0f);
+    ASSERT_EQ(story.values[BlockFeatures::LINK_RATIO], 0.0f);
+    ASSERT_GT(story.values[BlockFeatures::STOPWORD_DENSITY], 0.3f);
+    ASSERT_GT(see_more.values[BlockFeatures::LINK_RATIO], 0.0f);
+    ASSERT_LT(see_more.values[BlockFeatures::LINK_RATIO], 1.0f);
+    ASSERT_GT(ad.values[BlockFeatures::AD_CLASSES], 0.0f);
+    ASSERT_GT(footer.values[BlockFeatures::BOILERPLATE_WORDS], 0.0f);
+    
+    // The model keeps the article and drops the chrome around it
+    const BoilerplateModel& model = classifier.model();
+    ASSERT_GT(model.probability(story), model.threshold);
+    ASSERT_GT(model.probability(headline), model.threshold);
+    ASSERT_LT(model.probability(nav_item), model.threshold);
+    ASSERT_LT(model.probability(ad), model.threshold);
+    ASSERT_LT(model.probability(footer), model.threshold);
+    
+    std::vector<bool> removed = classifier.boilerplate_mask(document);
+    ASSERT_EQ(removed.size(), document.size());
+    ASSERT_FALSE(removed[story.node]);
+    ASSERT_TRUE(removed[nav_item.node]);
+    ASSERT_TRUE(removed[footer.node]);
+    
+    TextExtractor extractor;
+    auto result = extractor.extract(html);
+    ASSERT_TRUE(result.extracted_text.find("boats were all in the harbour") != std::string::npos);
+    ASSERT_TRUE(result.extracted_text.find("The headline") != std::string::npos);
+    ASSERT_TRUE(result.extracted_text.find("About") == std::string::npos);
+    ASSERT_TRUE(result.extracted_text.find("Buy now") == std::string::npos);
+    ASSERT_TRUE(result.extracted_text.find("All rights reserved") == std::string::npos);
+    ASSERT_TRUE(result.extracted_text.find("var x") == std::string::npos);
+    
+    // Same on the sample pages, including one whose <head> is never closed
+    auto boilerplate = extractor.extract(BOILERPLATE_HTML);
+    ASSERT_TRUE(boilerplate.extracted_text.find("real content that should be extracted") != std::string::npos);
+    ASSERT_TRUE(boilerplate.extracted_text.find("cookie") == std::string::npos);
+    ASSERT_TRUE(boilerplate.extracted_text.find("Special Offer") == std::string::npos);
+    ASSERT_TRUE(boilerplate.extracted_text.find("All rights reserved") == std::string::npos);
+    ASSERT_TRUE(extractor.extract(MALFORMED_HTML).extracted_text.find("Text content mixed in") != std::string::npos);
+    
+    // Without classification the flat DOM falls back to the tag and class rules
+    TextExtractionConfig rules_config;
+    rules_config.classify_blocks = false;
+    TextExtractor rules_extractor(rules_config);
+    auto rules_result = rules_extractor.extract(html);
+    ASSERT_TRUE(rules_result.extracted_text.find("boats were all in the harbour") != std::string::npos);
+    ASSERT_TRUE(rules_result.extracted_text.find("About") == std::string::npos);
+    
+    std::cout << "✓ Block classifier test passed" << std::endl;
+}
+
 void test_text_cleaning() {
     std::cout << "Testing text cleaning..." << std::endl;
     
@@ -263,6 +821,148 @@ void test_text_cleaning() {
     std::cout << "✓ Text cleaning test passed" << std::endl;
 }
 
+void test_html_entity_decoding() {
+    std::cout << "Testing HTML entity decoding..." << std::endl;
+    
+    using extraction_utils::decode_html_entities;
+    
+    // Named references from the full HTML5 table, including two-code-point ones
+    ASSERT_EQ(decode_html_entities("Fish &amp; chips &lt;b&gt;"), "Fish & chips <b>");
+    ASSERT_EQ(decode_html_entities("&Aacute;&eacute;&Omega;&hearts;"), "\xC3\x81\xC3\xA9\xCE\xA9\xE2\x99\xA5");
+    ASSERT_EQ(decode_html_entities("&NotEqualTilde;"), "\xE2\x89\x82\xCC\xB8");
+    ASSERT_EQ(decode_html_entities("&nbsp;&mdash;&hellip;"), "\xC2\xA0\xE2\x80\x94\xE2\x80\xA6");
+    
+    // Longest match wins; legacy names need no ';', others do
+    ASSERT_EQ(decode_html_entities("&notin; &notit;"), "\xE2\x88\x89 \xC2\xACit;");
+    ASSERT_EQ(decode_html_entities("&copy2024"), "\xC2\xA9" "2024");
+    ASSERT_EQ(decode_html_entities("&hearts"), "&hearts");
+    
+    // Decimal and hex references, with or without ';'
+    ASSERT_EQ(decode_html_entities("&#65;&#x42;&#X43&#68"), "ABCD");
+    ASSERT_EQ(decode_html_entities("&#233; &#x1F600;"), "\xC3\xA9 \xF0\x9F\x98\x80");
+    ASSERT_EQ(decode_html_entities("&#150;"), "\xE2\x80\x93");
+    ASSERT_EQ(decode_html_entities("&#0;&#xD800;&#x110000;&#99999999999;"),
+              "\xEF\xBF\xBD\xEF\xBF\xBD\xEF\xBF\xBD\xEF\xBF\xBD");
+    
+    // Anything else stays as written
+    ASSERT_EQ(decode_html_entities("AT&T & co &#; &#x; &unknown; &"), "AT&T & co &#; &#x; &unknown; &");
+    ASSERT_EQ(decode_html_entities(""), "");
+    
+    // Entity-dense text decodes in one pass
+    std::string dense;
+    std::string expected;
+    for (int i = 0; i < 20000; ++i) {
+        dense += "&lt;&#x41;&amp;";
+        expected += "<A&";
+    }
+    ASSERT_EQ(decode_html_entities(dense), expected);
+    
+    std::cout << "✓ HTML entity decoding test passed" << std::endl;
+}
+
+// The std::regex cleaning pipeline TextCleaner used before its single-pass
+// rewrite, kept as the reference for the differential test
+std::string regex_normalize_whitespace(const std::string& text) {
+    std::string result = std::regex_replace(text, std::regex(R"([\t ]+)"), " ");
+    return std::regex_replace(result, std::regex(R"(\r\n|\r)"), "\n");
+}
+
+std::string regex_remove_extra_newlines(const std::string& text) {
+    std::string result = std::regex_replace(text, std::regex(R"(\n\s*\n\s*\n+)"), "\n\n");
+    return std::regex_replace(result, std::regex(R"(^\n+|\n+$)"), "");
+}
+
+std::string regex_clean_text(const TextCleaner& cleaner, const TextExtractionConfig& config, const std::string& text) {
+    std::string result = text;
+    if (config.decode_html_entities) result = cleaner.decode_html_entities(result);
+    if (config.normalize_unicode) result = cleaner.normalize_unicode(result);
+    if (config.fix_mojibake) result = cleaner.fix_mojibake(result);
+    if (config.normalize_whitespace) result = regex_normalize_whitespace(result);
+    
+    const std::vector<std::pair<std::regex, std::string>> patterns = {
+        {std::regex(R"(\s+)"), " "},
+        {std::regex(R"(^\s+|\s+$)", std::regex_constants::multiline), ""},
+        {std::regex(R"(\n\s*\n\s*\n+)"), "\n\n"},
+        {std::regex(R"(<[^>]*>)"), ""},
+        {std::regex(R"(<script[^>]*>.*?</script>)", std::regex_constants::icase), ""},
+        {std::regex(R"(<style[^>]*>.*?</style>)", std::regex_constants::icase), ""},
+    };
+    for (const auto& [pattern, replacement] : patterns) {
+        result = std::regex_replace(result, pattern, replacement);
+    }
+    
+    if (config.remove_extra_newlines) result = regex_remove_extra_newlines(result);
+    
+    if (config.trim_lines) {
+        std::istringstream iss(result);
+        std::ostringstream oss;
+        std::string line;
+        bool first = true;
+        while (std::getline(iss, line)) {
+            if (!first) oss << "\n";
+            first = false;
+            line.erase(0, line.find_first_not_of(" \t"));
+            line.erase(line.find_last_not_of(" \t") + 1);
+            oss << line;
+        }
+        result = oss.str();
+    }
+    
+    return result;
+}
+
+void test_text_cleaning_matches_regex() {
+    std::cout << "Testing single-pass cleaner against regex pipeline..." << std::endl;
+    
+    std::vector<std::string> inputs = {
+        "",
+        "   ",
+        "\n\n\n",
+        "plain text",
+        "  Multiple   spaces\t\tand\n\n\ntabs  ",
+        "&amp;  Multiple   spaces\n\n\nwith entities &copy;  ",
+        "<b> bold</b> and <i>italic </i>",
+        "text <br> more <br/>",
+        "a < b and c > d",
+        "unclosed <tag at the end",
+        "<script>var x = 1;</script> after",
+        "line one\r\nline two\rline three",
+        "x \n \n y \n\n\n\n z \v\f end\n",
+        "\xC2\xA0" "caf\xC3\xA9 \xE2\x80\x9C" "quoted\xE2\x80\x9D\xE2\x80\xA6",
+    };
+    
+    // Random strings over the characters the pipeline treats specially
+    const std::string alphabet = " \t\n\r\v\fab<>/&;#";
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> length(0, 24);
+    std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+    for (int i = 0; i < 500; ++i) {
+        std::string text;
+        for (size_t n = length(rng); n > 0; --n) text += alphabet[pick(rng)];
+        inputs.push_back(text);
+    }
+    
+    for (int variant = 0; variant < 8; ++variant) {
+        TextExtractionConfig config;
+        config.normalize_whitespace = (variant & 1) != 0;
+        config.remove_extra_newlines = (variant & 2) != 0;
+        config.trim_lines = (variant & 4) != 0;
+        TextCleaner cleaner(config);
+        
+        for (const auto& text : inputs) {
+            ASSERT_EQ(cleaner.clean_text(text), regex_clean_text(cleaner, config, text));
+        }
+    }
+    
+    TextCleaner cleaner;
+    for (const auto& text : inputs) {
+        ASSERT_EQ(cleaner.normalize_whitespace(text), regex_normalize_whitespace(text));
+        ASSERT_EQ(cleaner.remove_extra_newlines(text), regex_remove_extra_newlines(text));
+    }
+    
+    std::cout << "✓ Single-pass cleaner matches regex pipeline test passed" << std::endl;
+}
+
 void test_simple_extraction() {
     std::cout << "Testing simple text extraction..." << std::endl;
     
@@ -385,9 +1085,184 @@ void test_batch_extraction() {
         ASSERT_TRUE(results[i].extracted_text_length > 0);
     }
     
+    // Parallel batches of very uneven documents match serial extraction, in input order
+    std::vector<std::string> uneven_docs;
+    std::vector<std::string> uneven_urls;
+    for (size_t i = 0; i < 40; ++i) {
+        std::string body;
+        for (size_t p = 0; p < (i % 7 == 0 ? 400 : 2); ++p) {
+            body += "<p>Paragraph " + std::to_string(p) + " of document " + std::to_string(i) +
+                    " has enough words to count as content.</p>";
+        }
+        uneven_docs.push_back("<html><head><title>Doc " + std::to_string(i) + "</title></head><body>" + body +
+                              "</body></html>");
+        uneven_urls.push_back("http://example.com/" + std::to_string(i));
+    }
+    
+    TextExtractionConfig serial_config;
+    serial_config.enable_parallel_processing = false;
+    TextExtractor serial_extractor(serial_config);
+    auto serial_results = serial_extractor.extract_batch(uneven_docs, uneven_urls);
+    
+    size_t last_progress = 0;
+    bool progress_in_order = true;
+    auto parallel_results = extractor.extract_batch(uneven_docs,
+        [&](size_t current, size_t total, const std::string&) {
+            progress_in_order = progress_in_order && current == last_progress + 1 && total == uneven_docs.size();
+            last_progress = current;
+        }, uneven_urls);
+    
+    ASSERT_EQ(parallel_results.size(), uneven_docs.size());
+    ASSERT_TRUE(progress_in_order);
+    ASSERT_EQ(last_progress, uneven_docs.size());
+    for (size_t i = 0; i < uneven_docs.size(); ++i) {
+        ASSERT_EQ(parallel_results[i].url, uneven_urls[i]);
+        ASSERT_EQ(parallel_results[i].title, "Doc " + std::to_string(i));
+        ASSERT_EQ(parallel_results[i].extracted_text, serial_results[i].extracted_text);
+    }
+    
     std::cout << "✓ Batch extraction test passed" << std::endl;
 }
 
+std::string make_warc_record(const std::string& type, const std::string& uri, const std::string& content_type,
+                             const std::string& block) {
+    return "WARC/1.0\r\nWARC-Type: " + type + "\r\nWARC-Target-URI: " + uri +
+           "\r\nWARC-Record-ID: <urn:uuid:" + uri + ">\r\nContent-Type: " + content_type +
+           "\r\nContent-Length: " + std::to_string(block.size()) + "\r\n\r\n" + block + "\r\n\r\n";
+}
+
+std::string make_http_response(const std::string& content_type, const std::string& body,
+                               const std::string& status = "200 OK") {
+    std::string type_header = content_type.empty() ? "" : "Content-Type: " + content_type + "\r\n";
+    return "HTTP/1.1 " + status + "\r\n" + type_header + "Content-Length: " +
+           std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+#ifdef HAVE_ZLIB
+std::string gzip_member(const std::string& data) {
+    z_stream stream = {};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&stream, data.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+#endif
+
+void test_warc_reader() {
+    std::cout << "Testing WARC reader..." << std::endl;
+    
+    std::string big_body = "<html><body>" + std::string(3 * WarcReader::BUFFER_SIZE, 'x') + "</body></html>";
+    std::vector<std::string> records = {
+        make_warc_record("warcinfo", "", "application/warc-fields", "software: test\r\n"),
+        make_warc_record("request", "http://a.com/", "application/http; msgtype=request", "GET / HTTP/1.1\r\n\r\n"),
+        make_warc_record("response", "http://a.com/", "application/http; msgtype=response",
+                         make_http_response("text/html; charset=utf-8", SIMPLE_HTML)),
+        make_warc_record("response", "http://a.com/logo.png", "application/http; msgtype=response",
+                         make_http_response("image/png", "\x89PNG")),
+        make_warc_record("response", "http://b.com/", "application/http; msgtype=response",
+                         make_http_response("text/html", big_body)),
+        make_warc_record("conversion", "http://a.com/", "text/plain", "Main Heading\nThis is a paragraph."),
+    };
+    
+    auto check_records = [&](const std::string& data, size_t max_record_bytes) {
+        std::istringstream input(data);
+        WarcReader reader(input, max_record_bytes);
+        WarcRecord record;
+        std::vector<std::string> types;
+        
+        while (reader.next(record)) {
+            types.emplace_back(record.type);
+            if (record.target_uri == "http://a.com/" && record.is_response()) {
+                ASSERT_EQ(record.http_status, 200);
+                ASSERT_EQ(std::string(record.http_content_type), "text/html; charset=utf-8");
+                ASSERT_EQ(std::string(record.payload), SIMPLE_HTML);
+                ASSERT_TRUE(record.is_html());
+            } else if (record.target_uri == "http://a.com/logo.png") {
+                ASSERT_FALSE(record.is_html());
+                ASSERT_EQ(std::string(record.payload), "\x89PNG");
+            } else if (record.target_uri == "http://b.com/") {
+                ASSERT_EQ(record.payload.size(), big_body.size());
+            } else if (record.type == "conversion") {
+                ASSERT_EQ(std::string(record.payload), "Main Heading\nThis is a paragraph.");
+                ASSERT_EQ(std::string(record.content_type), "text/plain");
+            }
+        }
+        
+        ASSERT_EQ(reader.records_read(), records.size());
+        ASSERT_EQ(reader.bytes_read(), data.size());
+        return types.size();
+    };
+    
+    std::string plain;
+    for (const auto& record : records) plain += record;
+    ASSERT_EQ(check_records(plain, WarcReader::DEFAULT_MAX_RECORD_BYTES), records.size());
+    
+    // Records over the limit are read past without being returned
+    ASSERT_EQ(check_records(plain, WarcReader::BUFFER_SIZE), records.size() - 1);
+    
+#ifdef HAVE_ZLIB
+    // One gzip member per record, as Common Crawl writes them
+    std::string compressed;
+    for (const auto& record : records) compressed += gzip_member(record);
+    ASSERT_EQ(check_records(compressed, WarcReader::DEFAULT_MAX_RECORD_BYTES), records.size());
+    
+    std::istringstream truncated(compressed.substr(0, compressed.size() - 10));
+    WarcReader truncated_reader(truncated);
+    WarcRecord record;
+    ASSERT_THROWS(while (truncated_reader.next(record)) {}, std::runtime_error);
+#endif
+    
+    std::istringstream garbage("not a warc file\r\n\r\n");
+    WarcReader garbage_reader(garbage);
+    WarcRecord garbage_record;
+    ASSERT_THROWS(garbage_reader.next(garbage_record), std::runtime_error);
+    
+    // End-to-end: HTML responses only, in file order, through a small queue
+    std::string warc;
+    for (size_t i = 0; i < 10; ++i) {
+        warc += make_warc_record("response", "http://c.com/" + std::to_string(i), "application/http; msgtype=response",
+                                 make_http_response(i % 3 == 0 ? "text/html" : "text/css", SIMPLE_HTML));
+    }
+    // Error pages, redirects and untyped bodies are not extracted
+    warc += make_warc_record("response", "http://d.com/missing", "application/http; msgtype=response",
+                             make_http_response("text/html", SIMPLE_HTML, "404 Not Found"));
+    warc += make_warc_record("response", "http://d.com/moved", "application/http; msgtype=response",
+                             make_http_response("text/html", SIMPLE_HTML, "301 Moved Permanently"));
+    warc += make_warc_record("response", "http://d.com/untyped", "application/http; msgtype=response",
+                             make_http_response("", SIMPLE_HTML));
+    // WET conversion records are text already and pass straight through
+    warc += make_warc_record("conversion", "http://d.com/text", "text/plain", "Main Heading\nThis is a paragraph.");
+    std::istringstream input(warc);
+    TextExtractor extractor;
+    WarcExtractionOptions options;
+    options.batch_size = 2;
+    options.queue_batches = 1;
+    std::vector<std::string> urls;
+    auto stats = extract_warc(input, extractor, [&](const TextExtractionResult& result) {
+        ASSERT_TRUE(result.extracted_text.find("Main Heading") != std::string::npos);
+        urls.push_back(result.url);
+    }, options);
+    
+    ASSERT_EQ(stats.records_read, 14);
+    ASSERT_EQ(stats.documents_extracted, 5);
+    ASSERT_EQ(urls.size(), 5);
+    ASSERT_EQ(urls[0], "http://c.com/0");
+    ASSERT_EQ(urls[3], "http://c.com/9");
+    ASSERT_EQ(urls[4], "http://d.com/text");
+    
+    auto converted = extractor.from_text("Main Heading\nThis is a paragraph.", "http://d.com/text");
+    ASSERT_EQ(converted.extracted_text, "Main Heading\nThis is a paragraph.");
+    ASSERT_EQ(converted.paragraph_count, 1);
+    
+    std::cout << "✓ WARC reader test passed" << std::endl;
+}
+
 void test_configuration_options() {
     std::cout << "Testing configuration options..." << std::endl;
     
@@ -515,17 +1390,27 @@ int main() {
     
     try {
         test_html_parser_basic();
+        test_flat_dom_parser();
+        test_html_parser_malformed();
+        test_streaming_extraction();
         test_title_extraction();
         test_meta_extraction();
+        test_metadata_from_parse();
         test_encoding_detection();
+        test_utf8_validation();
+        test_charset_transcoding();
         test_boilerplate_detection();
+        test_block_classifier();
         test_text_cleaning();
+        test_text_cleaning_matches_regex();
+        test_html_entity_decoding();
         test_simple_extraction();
         test_complex_extraction();
         test_boilerplate_filtering();
         test_malformed_html_handling();
         test_quality_metrics();
         test_batch_extraction();
+        test_warc_reader();
         test_configuration_options();
         test_utility_functions();
         test_edge_cases();